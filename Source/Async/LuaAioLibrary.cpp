@@ -0,0 +1,103 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include "LuaAioLibrary.hpp"
+#include "LuaBindingHelpers.hpp"
+
+using namespace LuaCpp::Async;
+
+namespace {
+
+	int PushResult(lua_State *L, LuaFileRequest::Mode mode, const LuaFileResult &result) {
+		if (result.error != 0) {
+			lua_pushnil(L);
+			lua_pushstring(L, result.message.c_str());
+			lua_pushinteger(L, result.error);
+			return 3;
+		}
+		if (mode == LuaFileRequest::READ) {
+			lua_pushlstring(L, result.data.data(), result.data.size());
+		} else {
+			lua_pushinteger(L, (lua_Integer) result.bytes);
+		}
+		return 1;
+	}
+
+	/**
+	 * @brief Submits the request, returns the number of the results, or `-1` if the task was suspended
+	 *
+	 * @details
+	 * Without a scheduler the request runs on the calling thread.
+	 */
+	int Start(lua_State *L, LuaFileIO &io, LuaFileRequest::Mode mode, const char *path, const char *data, size_t length, lua_Integer size, lua_Integer offset) {
+		LuaFileRequest request;
+		request.mode = mode;
+		request.path = path;
+		if (data != nullptr) {
+			request.data.assign(data, length);
+		}
+		request.size = size;
+		request.offset = offset;
+		return SuspendOrRun<LuaFileResult>(L, [&io, &request](LuaFileIO::Callback done) {
+			io.Submit(std::move(request), std::move(done));
+		}, [&request]() {
+			return LuaFileIO::Execute(request);
+		}, [mode](lua_State *co, const LuaFileResult &result) {
+			return PushResult(co, mode, result);
+		});
+	}
+}
+
+LuaAioLibrary::LuaAioLibrary(std::shared_ptr<LuaFileIO> _io) : LuaLibrary("aio"), io(std::move(_io)) {
+	std::shared_ptr<LuaFileIO> backend = io;
+
+	AddFunction("read", [backend](lua_State *L) {
+		const char *path = luaL_checkstring(L, 1);
+		lua_Integer size = luaL_optinteger(L, 2, -1);
+		lua_Integer offset = luaL_optinteger(L, 3, 0);
+		luaL_argcheck(L, offset >= 0, 3, "negative offset");
+		return Yield(L, Start(L, *backend, LuaFileRequest::READ, path, nullptr, 0, size, offset));
+	});
+
+	AddFunction("write", [backend](lua_State *L) {
+		size_t length = 0;
+		const char *path = luaL_checkstring(L, 1);
+		const char *data = luaL_checklstring(L, 2, &length);
+		lua_Integer offset = luaL_optinteger(L, 3, -1);
+		luaL_argcheck(L, offset >= 0 || lua_isnoneornil(L, 3), 3, "negative offset");
+		return Yield(L, Start(L, *backend, LuaFileRequest::WRITE, path, data, length, -1, offset));
+	});
+
+	AddFunction("append", [backend](lua_State *L) {
+		size_t length = 0;
+		const char *path = luaL_checkstring(L, 1);
+		const char *data = luaL_checklstring(L, 2, &length);
+		return Yield(L, Start(L, *backend, LuaFileRequest::APPEND, path, data, length, -1, -1));
+	});
+
+	AddFunction("backend", [backend](lua_State *L) {
+		lua_pushstring(L, backend->getName());
+		return 1;
+	});
+}
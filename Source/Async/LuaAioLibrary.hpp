@@ -0,0 +1,75 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAAIOLIBRARY_HPP
+#define LUACPP_LUAAIOLIBRARY_HPP
+
+#include <memory>
+
+#include "../Lua.hpp"
+#include "../Registry/LuaLibrary.hpp"
+#include "LuaFileIO.hpp"
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Library `aio` reading and writing the files without blocking the coroutines
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `aio.read(path [, size [, offset]])` returns the data
+		 *  - `aio.write(path, data [, offset])` returns the number of the written bytes,
+		 *    the file is truncated when the offset is not given
+		 *  - `aio.append(path, data)` returns the number of the written bytes
+		 *  - `aio.backend()` returns the name of the backend
+		 *
+		 * The failed operations return `nil`, the message and the `errno`,
+		 * like the `io` library. Called from a task of the LuaScheduler of 
+		 * the state, the function suspends the task until the operation
+		 * completes, so the other tasks keep running. Called from anywhere
+		 * else, the operation blocks.
+		 */
+		class LuaAioLibrary : public Registry::LuaLibrary {
+		   private:
+			std::shared_ptr<LuaFileIO> io;
+
+		   public:
+			/**
+			 * @brief Creates the library running the operations on the backend
+			 *
+			 * @param io the backend shared by the states of the library
+			 */
+			explicit LuaAioLibrary(std::shared_ptr<LuaFileIO> io = LuaFileIO::Create());
+
+			/**
+			 * @brief Returns the backend of the library
+			 */
+			inline std::shared_ptr<LuaFileIO> getFileIO() const { return io; }
+		};
+	}
+}
+
+#endif // LUACPP_LUAAIOLIBRARY_HPP
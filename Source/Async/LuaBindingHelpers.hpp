@@ -0,0 +1,144 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUABINDINGHELPERS_HPP
+#define LUACPP_LUABINDINGHELPERS_HPP
+
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "../Lua.hpp"
+#include "../Engine/LuaError.hpp"
+#include "LuaScheduler.hpp"
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Runs the action, returns `false` with the message of the C++ exception
+		 *
+		 * @details
+		 * Internal helper of the libraries. The message is copied into the
+		 * buffer of `LUACPP_ERROR_MESSAGE_SIZE` bytes, so the caller can 
+		 * raise or return it after the exception is handled. The `code` is
+		 * set to the value of a `std::system_error`, to `0` otherwise.
+		 */
+		template <typename F>
+		bool Catch(F &&action, char *error, int *code = nullptr) {
+			try {
+				action();
+				return true;
+			} catch (const std::system_error &e) {
+				if (code != nullptr) {
+					*code = e.code().value();
+				}
+				snprintf(error, LUACPP_ERROR_MESSAGE_SIZE, "%s", e.what());
+			} catch (const std::exception &e) {
+				if (code != nullptr) {
+					*code = 0;
+				}
+				snprintf(error, LUACPP_ERROR_MESSAGE_SIZE, "%s", e.what());
+			}
+			return false;
+		}
+
+		/**
+		 * @brief Runs the action, turning the C++ exceptions into the Lua errors
+		 *
+		 * @details
+		 * The error is raised after the exception is handled, so the unwinding
+		 * does not cross the frames of the Lua library.
+		 */
+		template <typename F>
+		void Guarded(lua_State *L, F &&action) {
+			char error[LUACPP_ERROR_MESSAGE_SIZE];
+			if (!Catch(std::forward<F>(action), error)) {
+				luaL_error(L, "%s", error);
+			}
+		}
+
+		/**
+		 * @brief Starts the operation and suspends the task, or runs it on this thread without a scheduler
+		 *
+		 * @details
+		 * Internal helper of the libraries. With a scheduler attached to the
+		 * state, `start(done)` starts the operation, which calls `done` with
+		 * its `Result` on any thread, and the result is pushed by 
+		 * `push(co, result)` when the task is resumed. Otherwise the result
+		 * returned by `block()` is pushed at once.
+		 *
+		 * The C++ objects of the call are gone when it returns, so the value
+		 * is passed to `Yield()` in the frame of the function of the library.
+		 *
+		 * @return the number of the pushed values, or `-1` if the task was suspended
+		 */
+		template <typename Result, typename Start, typename Block, typename Push>
+		int SuspendOrRun(lua_State *L, Start &&start, Block &&block, Push push) {
+			LuaScheduler *scheduler = LuaScheduler::From(L);
+			uint64_t task = scheduler == nullptr ? 0 : scheduler->Suspend(L);
+			if (task == 0) {
+				Result result = block();
+				return push(L, result);
+			}
+			start([scheduler, task, push](Result &&result) {
+				std::shared_ptr<Result> shared = std::make_shared<Result>(std::move(result));
+				scheduler->Post(task, [push, shared](lua_State *co) {
+					return push(co, *shared);
+				});
+			});
+			return -1;
+		}
+
+		/**
+		 * @brief Same as `SuspendOrRun()`, waits for the started operation without a scheduler
+		 */
+		template <typename Result, typename Start, typename Push>
+		int SuspendOrBlock(lua_State *L, Start &&start, Push push) {
+			return SuspendOrRun<Result>(L, start, [&start]() {
+				std::shared_ptr<std::promise<Result>> promise = std::make_shared<std::promise<Result>>();
+				std::future<Result> future = promise->get_future();
+				start([promise](Result &&result) {
+					promise->set_value(std::move(result));
+				});
+				return future.get();
+			}, push);
+		}
+
+		/**
+		 * @brief Returns the values pushed by `SuspendOrRun()`, or yields the suspended task
+		 */
+		inline int Yield(lua_State *L, int pushed) {
+			if (pushed >= 0) {
+				return pushed;
+			}
+			return lua_yield(L, 0);
+		}
+	}
+}
+
+#endif // LUACPP_LUABINDINGHELPERS_HPP
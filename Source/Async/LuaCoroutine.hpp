@@ -0,0 +1,286 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUACOROUTINE_HPP
+#define LUACPP_LUACOROUTINE_HPP
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "../Lua.hpp"
+#include "../Engine/LuaError.hpp"
+#include "LuaScheduler.hpp"
+
+#define LUACPP_HAS_COROUTINES 1
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Runs the work on a thread chosen by the application
+		 *
+		 * @details
+		 * The C++ coroutines suspended on the Lua tasks are resumed through
+		 * the executor, ex. `[&pool](std::function<void()> work) { pool.Submit(std::move(work)); }`
+		 * with a LuaThreadPool, or `[](std::function<void()> work) { work(); }`
+		 * to resume them on the thread of the loop.
+		 */
+		typedef std::function<void(std::function<void()>)> LuaExecutor;
+
+		/**
+		 * @brief Coroutine which starts at once and is destroyed when it ends
+		 *
+		 * @details
+		 * The coroutine returning the LuaDetachedTask can not be awaited,
+		 * and an exception escaping it terminates the program.
+		 */
+		struct LuaDetachedTask {
+			struct promise_type {
+				LuaDetachedTask get_return_object() noexcept { return {}; }
+				std::suspend_never initial_suspend() noexcept { return {}; }
+				std::suspend_never final_suspend() noexcept { return {}; }
+				void return_void() noexcept {}
+				void unhandled_exception() noexcept { std::terminate(); }
+			};
+		};
+
+		/**
+		 * @brief Awaits the call of a Lua function running as a task of the scheduler
+		 *
+		 * @details
+		 * When awaited, the pusher is called on the thread of the loop and 
+		 * pushes the function with its arguments on the stack of the state,
+		 * returning the number of the arguments. The function is spawned as
+		 * a task of the scheduler, so it can wait for the asynchronous 
+		 * operations without blocking a thread. When the task ends, the 
+		 * reader converts its results, on the thread of the loop, and the
+		 * awaiting coroutine is resumed through the executor.
+		 *
+		 * The `co_await` returns the value of the reader, or throws 
+		 * `std::runtime_error` with the message of the Lua error, or the 
+		 * exception thrown by the pusher or the reader.
+		 *
+		 * @tparam T the type of the result
+		 */
+		template <typename T>
+		class LuaCallAwaitable {
+		   public:
+			typedef std::function<int(lua_State *)> Pusher;
+			typedef std::function<T(lua_State *, int)> Reader;
+
+		   private:
+			LuaScheduler &scheduler;
+			LuaExecutor executor;
+			Pusher pusher;
+			Reader reader;
+			std::optional<T> value;
+			std::exception_ptr error;
+
+			void Complete(lua_State *co, int status, int nresults) {
+				try {
+					if (status != LUA_OK) {
+						throw std::runtime_error(Engine::LuaError::FromStatus(co, status).getMessage());
+					}
+					value.emplace(reader(co, nresults));
+				} catch (...) {
+					error = std::current_exception();
+				}
+			}
+
+		   public:
+			LuaCallAwaitable(LuaScheduler &_scheduler, LuaExecutor _executor, Pusher _pusher, Reader _reader)
+			    : scheduler(_scheduler), executor(std::move(_executor)), pusher(std::move(_pusher)), reader(std::move(_reader)) {}
+
+			bool await_ready() const noexcept { return false; }
+
+			void await_suspend(std::coroutine_handle<> handle) {
+				// the awaitable is destroyed as soon as the coroutine resumes,
+				// only the copies in the callbacks are used after that
+				scheduler.Dispatch([this, handle, run = executor]() {
+					try {
+						int nargs = pusher(scheduler.getState());
+						scheduler.Spawn(nargs, [this, handle, run](lua_State *co, int status, int nresults) {
+							Complete(co, status, nresults);
+							run([handle]() { handle.resume(); });
+						});
+					} catch (...) {
+						error = std::current_exception();
+						run([handle]() { handle.resume(); });
+					}
+				});
+			}
+
+			T await_resume() {
+				if (error) {
+					std::rethrow_exception(error);
+				}
+				return std::move(*value);
+			}
+		};
+
+		/**
+		 * @brief Returns the awaitable calling the Lua function
+		 *
+		 * @see LuaCallAwaitable
+		 */
+		template <typename T>
+		LuaCallAwaitable<T> LuaCall(LuaScheduler &scheduler, LuaExecutor executor, typename LuaCallAwaitable<T>::Pusher pusher, typename LuaCallAwaitable<T>::Reader reader) {
+			return LuaCallAwaitable<T>(scheduler, std::move(executor), std::move(pusher), std::move(reader));
+		}
+
+		/**
+		 * @brief Returns the awaitable running the snippet of the context
+		 *
+		 * @details
+		 * The context has to outlive the awaitable.
+		 */
+		template <typename T>
+		LuaCallAwaitable<T> LuaCall(LuaScheduler &scheduler, LuaExecutor executor, LuaContext &ctx, const std::string &name, typename LuaCallAwaitable<T>::Reader reader) {
+			return LuaCallAwaitable<T>(
+			    scheduler, std::move(executor), [&ctx, name](lua_State *L) {
+				    Engine::LuaState state(L, true);
+				    ctx.PushSnippet(state, name);
+				    return 0;
+			    },
+			    std::move(reader));
+		}
+
+		/**
+		 * @brief Awaits the `std::future` on a thread of the executor
+		 *
+		 * @details
+		 * The future has no way to notify its completion, so a thread of
+		 * the executor waits for it, then resumes the coroutine on the 
+		 * same thread. The functions returning the awaitables which 
+		 * complete on their own do not need this adapter.
+		 */
+		template <typename T>
+		class LuaFutureAwaitable {
+		   private:
+			std::future<T> future;
+			LuaExecutor executor;
+
+		   public:
+			LuaFutureAwaitable(std::future<T> _future, LuaExecutor _executor) : future(std::move(_future)), executor(std::move(_executor)) {}
+
+			bool await_ready() const {
+				return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle) {
+				// the awaitable is destroyed as soon as the coroutine resumes,
+				// which may happen before the executor returns
+				LuaExecutor run = executor;
+				run([this, handle]() {
+					future.wait();
+					handle.resume();
+				});
+			}
+
+			T await_resume() {
+				return future.get();
+			}
+		};
+
+		namespace Detail {
+			template <typename Awaitable, typename Pusher>
+			LuaDetachedTask AwaitForTask(LuaScheduler *scheduler, uint64_t id, Awaitable awaitable, Pusher pusher) {
+				typedef std::decay_t<decltype(std::declval<Awaitable &>().await_resume())> Result;
+				std::optional<Result> value;
+				std::string error;
+				try {
+					value.emplace(co_await std::move(awaitable));
+				} catch (std::exception &e) {
+					error = e.what();
+				} catch (...) {
+					error = "unknown exception";
+				}
+
+				if (value) {
+					scheduler->Post(id, [result = std::move(*value), pusher = std::move(pusher)](lua_State *L) mutable {
+						return pusher(L, result);
+					});
+				} else {
+					scheduler->Post(id, [error](lua_State *L) {
+						lua_pushnil(L);
+						lua_pushlstring(L, error.data(), error.size());
+						return 2;
+					});
+				}
+			}
+		}
+
+		/**
+		 * @brief Suspends the running Lua task until the C++ awaitable completes
+		 *
+		 * @details
+		 * Called by a function of a library, which yields after it when
+		 * the task was suspended:
+		 *
+		 * ```
+		 * if (!LuaAwait(L, LuaFutureAwaitable<int>(Compute(), executor), [](lua_State *L, int &value) {
+		 *         lua_pushinteger(L, value);
+		 *         return 1;
+		 *     })) {
+		 *     return luaL_error(L, "compute needs a scheduler task");
+		 * }
+		 * return lua_yield(L, 0);
+		 * ```
+		 *
+		 * The awaitable is awaited by a detached C++ coroutine, and the 
+		 * task is resumed with the values pushed by the pusher on the 
+		 * thread of the loop, or with `nil` and the message if the 
+		 * awaitable throws. The awaitable has to return a value.
+		 *
+		 * @param L the coroutine calling the function
+		 * @param awaitable the awaitable
+		 * @param pusher `int(lua_State *, Result &)` pushing the result and returning the number of the values
+		 * @return `false` if the coroutine is not a task which can be suspended
+		 */
+		template <typename Awaitable, typename Pusher>
+		bool LuaAwait(lua_State *L, Awaitable &&awaitable, Pusher &&pusher) {
+			LuaScheduler *scheduler = LuaScheduler::From(L);
+			uint64_t id = scheduler != nullptr ? scheduler->Suspend(L) : 0;
+			if (id == 0) {
+				return false;
+			}
+			Detail::AwaitForTask(scheduler, id, std::forward<Awaitable>(awaitable), std::forward<Pusher>(pusher));
+			return true;
+		}
+	}
+}
+
+#endif // __cpp_impl_coroutine
+
+#endif // LUACPP_LUACOROUTINE_HPP
@@ -0,0 +1,330 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "LuaFileIO.hpp"
+#include "LuaThreadPool.hpp"
+
+#ifdef LUACPP_HAS_IO_URING
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <liburing.h>
+#endif
+
+#ifdef _WIN32
+#define LUACPP_FSEEK _fseeki64
+#else
+#define LUACPP_FSEEK fseeko
+#endif
+
+using namespace LuaCpp::Async;
+
+namespace {
+
+	void SetError(LuaFileResult &result, const std::string &path, int error) {
+		result.error = error;
+		result.message = path + ": " + strerror(error);
+	}
+
+	/**
+	 * @brief Runs the blocking calls on the threads of a pool
+	 */
+	class LuaThreadedFileIO : public LuaFileIO {
+	   private:
+		LuaThreadPool pool;
+
+	   public:
+		explicit LuaThreadedFileIO(unsigned threads) : pool(threads) {}
+
+		void Submit(LuaFileRequest &&request, Callback done) override {
+			std::shared_ptr<LuaFileRequest> shared = std::make_shared<LuaFileRequest>(std::move(request));
+			pool.Submit([shared, done] {
+				done(LuaFileIO::Execute(*shared));
+			});
+		}
+
+		const char *getName() const override {
+			return "threads";
+		}
+	};
+
+#ifdef LUACPP_HAS_IO_URING
+	/**
+	 * @brief Submits the reads and the writes to io_uring
+	 *
+	 * @details
+	 * The files are opened on the calling thread and the completions are
+	 * reaped by a single thread, which resubmits the short reads and 
+	 * writes for the rest of the data. The files that are not regular
+	 * files are read with the blocking calls.
+	 */
+	class LuaUringFileIO : public LuaFileIO {
+	   private:
+		static constexpr unsigned QUEUE_DEPTH = 64;
+		static constexpr size_t MAX_CHUNK = 1 << 30;
+
+		struct Operation {
+			LuaFileRequest request;
+			Callback done;
+			int fd;
+			LuaFileResult result;
+			size_t remaining;
+			uint64_t offset;
+		};
+
+		io_uring ring;
+		std::mutex mutex;
+		std::condition_variable idle;
+		size_t inflight;
+		std::thread reaper;
+
+		void Queue(Operation *op) {
+			std::lock_guard<std::mutex> lock(mutex);
+			io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+			while (sqe == nullptr) {
+				io_uring_submit(&ring);
+				sqe = io_uring_get_sqe(&ring);
+			}
+			unsigned length = (unsigned) std::min(op->remaining, MAX_CHUNK);
+			if (op->request.mode == LuaFileRequest::READ) {
+				io_uring_prep_read(sqe, op->fd, &op->result.data[op->result.bytes], length, op->offset);
+			} else {
+				io_uring_prep_write(sqe, op->fd, op->request.data.data() + op->result.bytes, length, op->offset);
+			}
+			io_uring_sqe_set_data(sqe, op);
+			io_uring_submit(&ring);
+		}
+
+		void Complete(Operation *op) {
+			close(op->fd);
+			if (op->request.mode == LuaFileRequest::READ) {
+				op->result.data.resize(op->result.bytes);
+			}
+			op->done(std::move(op->result));
+			delete op;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--inflight == 0) {
+				idle.notify_all();
+			}
+		}
+
+		void Reap() {
+			for (;;) {
+				io_uring_cqe *cqe = nullptr;
+				if (io_uring_wait_cqe(&ring, &cqe) < 0) {
+					continue;
+				}
+				Operation *op = (Operation *) io_uring_cqe_get_data(cqe);
+				int res = cqe->res;
+				io_uring_cqe_seen(&ring, cqe);
+				if (op == nullptr) {
+					return;
+				}
+
+				if (res == -EINTR || res == -EAGAIN) {
+					Queue(op);
+				} else if (res < 0) {
+					SetError(op->result, op->request.path, -res);
+					Complete(op);
+				} else {
+					op->result.bytes += res;
+					op->remaining -= res;
+					if (op->offset != (uint64_t) -1) {
+						op->offset += res;
+					}
+					if (res == 0 || op->remaining == 0) {
+						Complete(op);
+					} else {
+						Queue(op);
+					}
+				}
+			}
+		}
+
+	   public:
+		LuaUringFileIO() : inflight(0) {
+			int res = io_uring_queue_init(QUEUE_DEPTH, &ring, 0);
+			if (res < 0) {
+				throw std::runtime_error(std::string("Error: io_uring is not available: ") + strerror(-res));
+			}
+			reaper = std::thread(&LuaUringFileIO::Reap, this);
+		}
+
+		~LuaUringFileIO() override {
+			std::unique_lock<std::mutex> lock(mutex);
+			idle.wait(lock, [this] { return inflight == 0; });
+
+			// the completion without an operation stops the reaper
+			io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+			while (sqe == nullptr) {
+				io_uring_submit(&ring);
+				sqe = io_uring_get_sqe(&ring);
+			}
+			io_uring_prep_nop(sqe);
+			io_uring_sqe_set_data(sqe, nullptr);
+			io_uring_submit(&ring);
+			lock.unlock();
+
+			reaper.join();
+			io_uring_queue_exit(&ring);
+		}
+
+		void Submit(LuaFileRequest &&request, Callback done) override {
+			int flags = O_CLOEXEC;
+			if (request.mode == LuaFileRequest::READ) {
+				flags |= O_RDONLY;
+			} else if (request.mode == LuaFileRequest::APPEND) {
+				flags |= O_WRONLY | O_CREAT | O_APPEND;
+			} else {
+				flags |= O_WRONLY | O_CREAT | (request.offset < 0 ? O_TRUNC : 0);
+			}
+
+			LuaFileResult failed;
+			int fd = open(request.path.c_str(), flags, 0666);
+			if (fd < 0) {
+				SetError(failed, request.path, errno);
+				done(std::move(failed));
+				return;
+			}
+
+			Operation *op = new Operation{std::move(request), std::move(done), fd, LuaFileResult(), 0, 0};
+			if (op->request.mode == LuaFileRequest::READ) {
+				op->offset = op->request.offset < 0 ? 0 : op->request.offset;
+				if (op->request.size < 0) {
+					struct stat st;
+					if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+						close(fd);
+						op->done(LuaFileIO::Execute(op->request));
+						delete op;
+						return;
+					}
+					op->remaining = st.st_size > (off_t) op->offset ? st.st_size - op->offset : 0;
+				} else {
+					op->remaining = op->request.size;
+				}
+				op->result.data.resize(op->remaining);
+			} else {
+				// the appends are written at the current position of the file
+				if (op->request.mode == LuaFileRequest::APPEND) {
+					op->offset = (uint64_t) -1;
+				} else {
+					op->offset = op->request.offset < 0 ? 0 : op->request.offset;
+				}
+				op->remaining = op->request.data.size();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				inflight++;
+			}
+			if (op->remaining == 0) {
+				Complete(op);
+				return;
+			}
+			Queue(op);
+		}
+
+		const char *getName() const override {
+			return "io_uring";
+		}
+	};
+#endif
+}
+
+LuaFileResult LuaFileIO::Execute(const LuaFileRequest &request) {
+	LuaFileResult result;
+	const char *mode = "rb";
+	if (request.mode == LuaFileRequest::APPEND) {
+		mode = "ab";
+	} else if (request.mode == LuaFileRequest::WRITE) {
+		mode = request.offset < 0 ? "wb" : "r+b";
+	}
+
+	FILE *file = fopen(request.path.c_str(), mode);
+	if (file == nullptr && errno == ENOENT && request.mode == LuaFileRequest::WRITE) {
+		file = fopen(request.path.c_str(), "wb");
+	}
+	if (file == nullptr) {
+		SetError(result, request.path, errno);
+		return result;
+	}
+
+	if (request.offset > 0 && request.mode != LuaFileRequest::APPEND && LUACPP_FSEEK(file, request.offset, SEEK_SET) != 0) {
+		SetError(result, request.path, errno);
+		fclose(file);
+		return result;
+	}
+
+	if (request.mode == LuaFileRequest::READ) {
+		char buffer[16384];
+		size_t remaining = request.size < 0 ? SIZE_MAX : (size_t) request.size;
+		while (remaining > 0) {
+			size_t n = fread(buffer, 1, std::min(remaining, sizeof(buffer)), file);
+			if (n == 0) {
+				break;
+			}
+			result.data.append(buffer, n);
+			remaining -= n;
+		}
+		if (ferror(file)) {
+			SetError(result, request.path, errno);
+		}
+		result.bytes = result.data.size();
+	} else {
+		result.bytes = fwrite(request.data.data(), 1, request.data.size(), file);
+		if (result.bytes < request.data.size()) {
+			SetError(result, request.path, errno);
+		}
+	}
+	if (fclose(file) != 0 && result.error == 0) {
+		SetError(result, request.path, errno);
+	}
+	return result;
+}
+
+std::shared_ptr<LuaFileIO> LuaFileIO::Create(unsigned threads, bool uring) {
+#ifdef LUACPP_HAS_IO_URING
+	if (uring) {
+		try {
+			return std::make_shared<LuaUringFileIO>();
+		} catch (const std::runtime_error &) {
+			// the kernel does not support io_uring or it is disabled
+		}
+	}
+#else
+	(void) uring;
+#endif
+	return std::make_shared<LuaThreadedFileIO>(threads);
+}
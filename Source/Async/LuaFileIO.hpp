@@ -0,0 +1,121 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAFILEIO_HPP
+#define LUACPP_LUAFILEIO_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief File operation run by LuaFileIO
+		 *
+		 * @details
+		 * `READ` reads up to `size` bytes from the `offset`, the whole rest
+		 * of the file when `size` is negative. `WRITE` writes the `data` at 
+		 * the `offset`, or truncates the file and writes it from the start 
+		 * when the `offset` is negative. `APPEND` writes the `data` at the 
+		 * end of the file. The written files are created if missing.
+		 */
+		struct LuaFileRequest {
+			enum Mode { READ, WRITE, APPEND };
+
+			Mode mode = READ;
+			std::string path;
+			std::string data;
+			int64_t size = -1;
+			int64_t offset = -1;
+		};
+
+		/**
+		 * @brief Outcome of the LuaFileRequest
+		 *
+		 * @details
+		 * The `error` is the `errno` of the failed operation, or `0`. The 
+		 * `data` holds the bytes that were read, `bytes` the number of the
+		 * bytes that were read or written.
+		 */
+		struct LuaFileResult {
+			int error = 0;
+			std::string message;
+			std::string data;
+			size_t bytes = 0;
+		};
+
+		/**
+		 * @brief Backend running the file operations in the background
+		 *
+		 * @details
+		 * `Submit()` returns immediately and the callback is called with
+		 * the result on a thread of the backend, or on the calling thread 
+		 * when the operation fails to start. `Create()` uses io_uring 
+		 * when the library is built with liburing and the kernel supports 
+		 * it, and a pool of threads running the blocking calls otherwise.
+		 * The destructor waits for the submitted operations.
+		 */
+		class LuaFileIO {
+		   public:
+			typedef std::function<void(LuaFileResult &&)> Callback;
+
+			virtual ~LuaFileIO() {}
+
+			/**
+			 * @brief Starts the operation
+			 *
+			 * @param request the operation
+			 * @param done the callback called with the result
+			 */
+			virtual void Submit(LuaFileRequest &&request, Callback done) = 0;
+
+			/**
+			 * @brief Returns the name of the backend, `io_uring` or `threads`
+			 */
+			virtual const char *getName() const = 0;
+
+			/**
+			 * @brief Runs the operation with the blocking calls
+			 *
+			 * @param request the operation
+			 * @return the result of the operation
+			 */
+			static LuaFileResult Execute(const LuaFileRequest &request);
+
+			/**
+			 * @brief Creates the backend
+			 *
+			 * @param threads number of the threads of the pool, `0` uses the number of the cores
+			 * @param uring use io_uring when it is available
+			 * @return the backend
+			 */
+			static std::shared_ptr<LuaFileIO> Create(unsigned threads = 0, bool uring = true);
+		};
+	}
+}
+
+#endif // LUACPP_LUAFILEIO_HPP
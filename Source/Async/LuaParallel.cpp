@@ -0,0 +1,227 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#include "LuaParallel.hpp"
+#include "../Engine/LuaCodec.hpp"
+#include "../Engine/LuaError.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Async;
+using namespace LuaCpp::Engine;
+
+namespace {
+
+	/**
+	 * @brief Key of the table of the loaded snippets in the registry of the worker states
+	 */
+	char functionsKey = 0;
+
+	/**
+	 * @brief Set on the threads running the chunks
+	 */
+	thread_local bool inWorker = false;
+
+	/**
+	 * @brief Number of the chunks per thread, so the threads finishing early take the remaining ones
+	 */
+	const size_t CHUNKS_PER_THREAD = 4;
+}
+
+struct LuaParallel::Batch {
+	std::string name;
+	bool reduce;
+	std::vector<std::string> values;
+	size_t chunkSize;
+	size_t chunks;
+	std::vector<std::string> results;
+	std::atomic<size_t> pending;
+	std::atomic<bool> failed;
+	std::mutex mutex;
+	std::string error;
+	Callback done;
+
+	Batch(const std::string &_name, bool _reduce, std::vector<std::string> &&_values, size_t _chunkSize, Callback &&_done)
+	    : name(_name), reduce(_reduce), values(std::move(_values)), chunkSize(std::max<size_t>(_chunkSize, 1)), chunks((values.size() + chunkSize - 1) / chunkSize), pending(chunks), failed(false), done(std::move(_done)) {
+		results.resize(reduce ? chunks : values.size());
+	}
+};
+
+LuaParallel::LuaParallel(LuaContext &_ctx, unsigned count) : ctx(_ctx), stateCount(0), threads(count) {}
+
+void LuaParallel::Map(const std::string &name, std::vector<std::string> values, Callback done) {
+	size_t size = values.size();
+	Start(std::make_shared<Batch>(name, false, std::move(values), (size + threads.getThreadCount() * CHUNKS_PER_THREAD - 1) / (threads.getThreadCount() * CHUNKS_PER_THREAD), std::move(done)));
+}
+
+void LuaParallel::Reduce(const std::string &name, std::vector<std::string> values, Callback done) {
+	size_t size = values.size();
+	Start(std::make_shared<Batch>(name, true, std::move(values), (size + threads.getThreadCount() * CHUNKS_PER_THREAD - 1) / (threads.getThreadCount() * CHUNKS_PER_THREAD), std::move(done)));
+}
+
+size_t LuaParallel::getStateCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stateCount;
+}
+
+void LuaParallel::Start(std::shared_ptr<Batch> batch) {
+	if (batch->chunks == 0) {
+		batch->done(LuaParallelResult());
+		return;
+	}
+	for (size_t chunk = 0; chunk < batch->chunks; chunk++) {
+		Submit([this, batch, chunk]() { RunChunk(batch, chunk); });
+	}
+}
+
+void LuaParallel::Submit(std::function<void()> job) {
+	if (inWorker) {
+		job();
+		return;
+	}
+	threads.Submit([job]() {
+		inWorker = true;
+		job();
+		inWorker = false;
+	});
+}
+
+std::unique_ptr<LuaState> LuaParallel::Acquire() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!idle.empty()) {
+		std::unique_ptr<LuaState> L = std::move(idle.back());
+		idle.pop_back();
+		return L;
+	}
+	stateCount++;
+	return ctx.newState();
+}
+
+void LuaParallel::Release(std::unique_ptr<LuaState> L) {
+	std::lock_guard<std::mutex> lock(mutex);
+	idle.push_back(std::move(L));
+}
+
+void LuaParallel::RunChunk(std::shared_ptr<Batch> batch, size_t chunk) {
+	if (!batch->failed.load()) {
+		std::unique_ptr<LuaState> L;
+		std::string error;
+		int top = 0;
+		try {
+			L = Acquire();
+			top = lua_gettop(*L);
+
+			// the snippet is loaded once in each state
+			lua_pushlightuserdata(*L, &functionsKey);
+			lua_rawget(*L, LUA_REGISTRYINDEX);
+			if (lua_isnil(*L, -1)) {
+				lua_pop(*L, 1);
+				lua_newtable(*L);
+				lua_pushlightuserdata(*L, &functionsKey);
+				lua_pushvalue(*L, -2);
+				lua_rawset(*L, LUA_REGISTRYINDEX);
+			}
+			lua_getfield(*L, -1, batch->name.c_str());
+			if (!lua_isfunction(*L, -1)) {
+				lua_pop(*L, 1);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					ctx.PushSnippet(*L, batch->name);
+				}
+				lua_pushvalue(*L, -1);
+				lua_setfield(*L, -3, batch->name.c_str());
+			}
+			int function = lua_gettop(*L);
+
+			size_t begin = chunk * batch->chunkSize;
+			size_t end = std::min(begin + batch->chunkSize, batch->values.size());
+			int nargs = 1;
+			if (batch->reduce) {
+				const char *pos = batch->values[begin].data();
+				LuaCodec::Push(*L, pos, pos + batch->values[begin].size());
+				begin++;
+				nargs = 2;
+			}
+
+			for (size_t i = begin; i < end && !batch->failed.load(std::memory_order_relaxed); i++) {
+				lua_pushvalue(*L, function);
+				if (batch->reduce) {
+					lua_pushvalue(*L, function + 1);
+				}
+				const char *pos = batch->values[i].data();
+				LuaCodec::Push(*L, pos, pos + batch->values[i].size());
+				int status = lua_pcall(*L, nargs, 1, 0);
+				if (status != LUA_OK) {
+					error = LuaError::FromStatus(*L, status).getMessage();
+					break;
+				}
+				if (batch->reduce) {
+					lua_replace(*L, function + 1);
+				} else {
+					LuaCodec::Encode(*L, -1, batch->results[i]);
+					lua_pop(*L, 1);
+				}
+			}
+			if (batch->reduce && error.empty()) {
+				LuaCodec::Encode(*L, function + 1, batch->results[chunk]);
+			}
+		} catch (std::exception &e) {
+			error = e.what();
+		}
+
+		if (L) {
+			lua_settop(*L, top);
+			Release(std::move(L));
+		}
+		if (!error.empty()) {
+			std::lock_guard<std::mutex> lock(batch->mutex);
+			if (batch->error.empty()) {
+				batch->error = error;
+			}
+			batch->failed.store(true);
+		}
+	}
+
+	if (batch->pending.fetch_sub(1) == 1) {
+		Finish(batch);
+	}
+}
+
+void LuaParallel::Finish(std::shared_ptr<Batch> batch) {
+	LuaParallelResult result;
+	if (batch->failed.load()) {
+		result.error = std::move(batch->error);
+	} else if (batch->reduce && batch->chunks > 1) {
+		// the results of the chunks are folded in order by one more chunk
+		size_t size = batch->results.size();
+		Start(std::make_shared<Batch>(batch->name, true, std::move(batch->results), size, std::move(batch->done)));
+		return;
+	} else {
+		result.values = std::move(batch->results);
+	}
+	batch->done(std::move(result));
+}
@@ -0,0 +1,149 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAPARALLEL_HPP
+#define LUACPP_LUAPARALLEL_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../LuaContext.hpp"
+#include "../Engine/LuaState.hpp"
+#include "LuaThreadPool.hpp"
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Results of a parallel batch
+		 *
+		 * @details
+		 * The values are serialised by the Engine::LuaCodec. The `error`
+		 * is empty when all of the calls succeeded, the values are empty
+		 * otherwise.
+		 */
+		struct LuaParallelResult {
+			std::vector<std::string> values;
+			std::string error;
+		};
+
+		/**
+		 * @brief Runs a snippet of the context over many values on a pool of threads
+		 *
+		 * @details
+		 * Each thread of the pool borrows a state of its own, created by
+		 * the context on the first use and kept for the next batches. The 
+		 * values are serialised by the Engine::LuaCodec, split into chunks
+		 * and each chunk is run on one state. The snippet is called with
+		 * the value as its argument and its first result is kept; it is 
+		 * loaded once in each state, so it can not share any data with the
+		 * other calls besides the globals of its state.
+		 *
+		 * The batches are asynchronous, the callback is called on a thread
+		 * of the pool when all of the chunks are done. The batches started
+		 * from the threads of the pool, ex. by a snippet calling the 
+		 * `parallel` library, run on the calling thread, so they can not
+		 * exhaust the pool.
+		 *
+		 * The context has to outlive the object, and the snippets should
+		 * not be recompiled while it exists.
+		 */
+		class LuaParallel {
+		   public:
+			typedef std::function<void(LuaParallelResult &&)> Callback;
+
+		   private:
+			struct Batch;
+
+			LuaContext &ctx;
+			std::mutex mutex;
+			std::vector<std::unique_ptr<Engine::LuaState>> idle;
+			size_t stateCount;
+			LuaThreadPool threads;
+
+			void Start(std::shared_ptr<Batch> batch);
+			void RunChunk(std::shared_ptr<Batch> batch, size_t chunk);
+			void Finish(std::shared_ptr<Batch> batch);
+			std::unique_ptr<Engine::LuaState> Acquire();
+			void Release(std::unique_ptr<Engine::LuaState> L);
+			void Submit(std::function<void()> job);
+
+		   public:
+			/**
+			 * @brief Creates the pool
+			 *
+			 * @param ctx the context holding the snippets and creating the states
+			 * @param threads number of the threads, `0` for the number of the cores
+			 */
+			explicit LuaParallel(LuaContext &ctx, unsigned threads = 0);
+
+			LuaParallel(const LuaParallel &) = delete;
+			LuaParallel &operator=(const LuaParallel &) = delete;
+
+			/**
+			 * @brief Calls the snippet with each of the values
+			 *
+			 * @details
+			 * The results are in the order of the values. The first error 
+			 * stops the batch.
+			 *
+			 * @param name the name of the snippet
+			 * @param values the serialised values
+			 * @param done called with the serialised results
+			 */
+			void Map(const std::string &name, std::vector<std::string> values, Callback done);
+
+			/**
+			 * @brief Folds the values with the snippet
+			 *
+			 * @details
+			 * The snippet is called with the accumulated value and the next
+			 * value and returns the new accumulated value. The chunks are 
+			 * folded in parallel and their results are folded in order, so
+			 * the snippet has to be associative. The result has one value,
+			 * or none if there are no values.
+			 *
+			 * @param name the name of the snippet
+			 * @param values the serialised values
+			 * @param done called with the serialised result
+			 */
+			void Reduce(const std::string &name, std::vector<std::string> values, Callback done);
+
+			/**
+			 * @brief Returns the number of the threads
+			 */
+			inline size_t getThreadCount() const { return threads.getThreadCount(); }
+
+			/**
+			 * @brief Returns the number of the states created for the threads
+			 */
+			size_t getStateCount();
+		};
+	}
+}
+
+#endif // LUACPP_LUAPARALLEL_HPP
@@ -0,0 +1,128 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include "LuaParallelLibrary.hpp"
+#include "LuaBindingHelpers.hpp"
+#include "../Engine/LuaCodec.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Async;
+using namespace LuaCpp::Engine;
+
+namespace {
+
+	int PushResult(lua_State *L, bool reduce, const LuaParallelResult &result) {
+		if (!result.error.empty()) {
+			lua_pushnil(L);
+			lua_pushlstring(L, result.error.data(), result.error.size());
+			return 2;
+		}
+		if (reduce) {
+			if (result.values.empty()) {
+				lua_pushnil(L);
+			} else {
+				const char *pos = result.values[0].data();
+				LuaCodec::Push(L, pos, pos + result.values[0].size());
+			}
+			return 1;
+		}
+		lua_createtable(L, (int) result.values.size(), 0);
+		for (size_t i = 0; i < result.values.size(); i++) {
+			const char *pos = result.values[i].data();
+			LuaCodec::Push(L, pos, pos + result.values[i].size());
+			lua_rawseti(L, -2, (lua_Integer) i + 1);
+		}
+		return 1;
+	}
+
+	/**
+	 * @brief Serialises the initial value and the values of the array, returns `false` with the message
+	 */
+	bool EncodeValues(lua_State *L, int array, int init, std::vector<std::string> &values, char *error) {
+		int top = lua_gettop(L);
+		bool encoded = Catch([L, array, init, &values]() {
+			size_t count = (size_t) lua_rawlen(L, array);
+			values.reserve(count + (init != 0 ? 1 : 0));
+			if (init != 0) {
+				values.emplace_back();
+				LuaCodec::Encode(L, init, values.back());
+			}
+			for (size_t i = 1; i <= count; i++) {
+				lua_rawgeti(L, array, (lua_Integer) i);
+				values.emplace_back();
+				LuaCodec::Encode(L, -1, values.back());
+				lua_pop(L, 1);
+			}
+		}, error);
+		if (!encoded) {
+			lua_settop(L, top);
+		}
+		return encoded;
+	}
+
+	/**
+	 * @brief Starts the batch, returns the number of the results, or `-1` if the task was suspended
+	 */
+	int Start(lua_State *L, LuaParallel &parallel, bool reduce, const char *name, int init) {
+		std::vector<std::string> values;
+		char error[LUACPP_ERROR_MESSAGE_SIZE];
+		if (!EncodeValues(L, 2, init, values, error)) {
+			lua_pushnil(L);
+			lua_pushstring(L, error);
+			return 2;
+		}
+
+		return SuspendOrBlock<LuaParallelResult>(L, [&parallel, reduce, name, &values](LuaParallel::Callback done) {
+			if (reduce) {
+				parallel.Reduce(name, std::move(values), std::move(done));
+			} else {
+				parallel.Map(name, std::move(values), std::move(done));
+			}
+		}, [reduce](lua_State *co, const LuaParallelResult &result) {
+			return PushResult(co, reduce, result);
+		});
+	}
+}
+
+LuaParallelLibrary::LuaParallelLibrary(LuaContext &ctx, unsigned threads) : LuaLibrary("parallel"), parallel(std::make_shared<LuaParallel>(ctx, threads)) {
+	// the states of the pool hold the functions of the library, which must not keep the pool alive
+	LuaParallel *pool = parallel.get();
+
+	AddFunction("map", [pool](lua_State *L) {
+		const char *name = luaL_checkstring(L, 1);
+		luaL_checktype(L, 2, LUA_TTABLE);
+		return Yield(L, Start(L, *pool, false, name, 0));
+	});
+
+	AddFunction("reduce", [pool](lua_State *L) {
+		const char *name = luaL_checkstring(L, 1);
+		luaL_checktype(L, 2, LUA_TTABLE);
+		return Yield(L, Start(L, *pool, true, name, lua_isnoneornil(L, 3) ? 0 : 3));
+	});
+
+	AddFunction("workers", [pool](lua_State *L) {
+		lua_pushinteger(L, (lua_Integer) pool->getThreadCount());
+		return 1;
+	});
+}
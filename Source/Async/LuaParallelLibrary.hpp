@@ -0,0 +1,81 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAPARALLELLIBRARY_HPP
+#define LUACPP_LUAPARALLELLIBRARY_HPP
+
+#include <memory>
+
+#include "../Lua.hpp"
+#include "../LuaContext.hpp"
+#include "../Registry/LuaLibrary.hpp"
+#include "LuaParallel.hpp"
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Library `parallel` running the snippets over many values at once
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `parallel.map(name, values)` calls the snippet with each value of the
+		 *    array and returns the array of the first results
+		 *  - `parallel.reduce(name, values [, init])` folds the values with the 
+		 *    snippet, called with the accumulated value and the next value, and
+		 *    returns the result; the snippet has to be associative
+		 *  - `parallel.workers()` returns the number of the threads
+		 *
+		 * The values and the results are copied between the states, so they
+		 * can be `nil`, booleans, numbers, strings and tables of them. The
+		 * snippets run on the states of the LuaParallel, and the first error
+		 * is raised in the calling script.
+		 *
+		 * Called from a task of the LuaScheduler of the state, the function
+		 * suspends the task until the results are ready. Called from 
+		 * anywhere else, it blocks.
+		 */
+		class LuaParallelLibrary : public Registry::LuaLibrary {
+		   private:
+			std::shared_ptr<LuaParallel> parallel;
+
+		   public:
+			/**
+			 * @brief Creates the library running the snippets of the context
+			 *
+			 * @param ctx the context holding the snippets
+			 * @param threads number of the threads, `0` for the number of the cores
+			 */
+			explicit LuaParallelLibrary(LuaContext &ctx, unsigned threads = 0);
+
+			/**
+			 * @brief Returns the pool running the snippets
+			 */
+			inline std::shared_ptr<LuaParallel> getParallel() const { return parallel; }
+		};
+	}
+}
+
+#endif // LUACPP_LUAPARALLELLIBRARY_HPP
@@ -0,0 +1,293 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <chrono>
+#include <stdexcept>
+
+#include "LuaScheduler.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Async;
+using namespace LuaCpp::Engine;
+
+char LuaScheduler::schedulerKey = 0;
+char LuaScheduler::threadsKey = 0;
+
+LuaScheduler::LuaScheduler(LuaState &_L) : L(_L), lastId(0), waiting(0), origin(std::chrono::steady_clock::now()), wheel(0), lastTimer(0) {
+	if (From(L) != nullptr) {
+		throw std::logic_error("Error: The state has a scheduler already ...");
+	}
+	lua_pushlightuserdata(L, &schedulerKey);
+	lua_pushlightuserdata(L, this);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+
+	lua_pushlightuserdata(L, &threadsKey);
+	lua_newtable(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+LuaScheduler::~LuaScheduler() {
+	lua_pushlightuserdata(L, &schedulerKey);
+	lua_pushnil(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+
+	lua_pushlightuserdata(L, &threadsKey);
+	lua_pushnil(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+LuaScheduler *LuaScheduler::From(lua_State *L) {
+	lua_pushlightuserdata(L, &schedulerKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	LuaScheduler *scheduler = (LuaScheduler *) lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return scheduler;
+}
+
+uint64_t LuaScheduler::Spawn(int nargs) {
+	return Start(nargs, nullptr);
+}
+
+uint64_t LuaScheduler::Spawn(int nargs, Completion completion) {
+	if (!completion) {
+		throw std::invalid_argument("Error: The completion of the task is empty ...");
+	}
+	return Start(nargs, std::move(completion));
+}
+
+uint64_t LuaScheduler::Start(int nargs, Completion completion) {
+	int function = lua_gettop(L) - nargs;
+	if (nargs < 0 || function < 1 || lua_type(L, function) != LUA_TFUNCTION) {
+		throw std::invalid_argument("Error: The function to spawn is not on the stack ...");
+	}
+
+	uint64_t id = ++lastId;
+	lua_State *co = lua_newthread(L);
+
+	// the coroutine is anchored in the registry until the task ends
+	lua_pushlightuserdata(L, &threadsKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	lua_pushinteger(L, (lua_Integer) id);
+	lua_pushvalue(L, -3);
+	lua_rawset(L, -3);
+	lua_pop(L, 2);
+
+	lua_xmove(L, co, nargs + 1);
+
+	tasks[id] = Task{co, false, std::move(completion)};
+	threads[co] = id;
+	ready.emplace_back(id, nargs);
+	return id;
+}
+
+uint64_t LuaScheduler::Spawn(LuaContext &ctx, const std::string &name) {
+	LuaState state(L, true);
+	ctx.PushSnippet(state, name);
+	return Spawn(0);
+}
+
+void LuaScheduler::Run() {
+	while (!tasks.empty() || !timers.empty()) {
+		RunOnce(-1);
+	}
+}
+
+size_t LuaScheduler::RunOnce(int timeoutMs) {
+	size_t resumed = 0;
+
+	// the tasks yielding again are run in the next round
+	for (size_t count = ready.size(); count > 0 && !ready.empty(); count--) {
+		std::pair<uint64_t, int> next = ready.front();
+		ready.pop_front();
+		if (tasks.find(next.first) != tasks.end()) {
+			Resume(next.first, next.second);
+			resumed++;
+		}
+	}
+
+	FireTimers();
+
+	std::deque<std::pair<uint64_t, Resumer>> done;
+	std::deque<std::function<void()>> dispatched;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (completions.empty() && calls.empty() && ready.empty() && (waiting > 0 || !wheel.empty() || timeoutMs > 0) && timeoutMs != 0) {
+			int64_t wait = timeoutMs;
+			uint64_t next = wheel.getNextTick();
+			if (next != UINT64_MAX) {
+				uint64_t now = Now();
+				int64_t untilTimer = next > now ? (int64_t) (next - now) : 0;
+				if (wait < 0 || untilTimer < wait) {
+					wait = untilTimer;
+				}
+			}
+
+			auto posted = [this] { return !completions.empty() || !calls.empty(); };
+			if (wait < 0) {
+				wake.wait(lock, posted);
+			} else if (wait > 0) {
+				wake.wait_for(lock, std::chrono::milliseconds(wait), posted);
+			}
+		}
+		done.swap(completions);
+		dispatched.swap(calls);
+	}
+
+	FireTimers();
+
+	for (std::function<void()> &call : dispatched) {
+		call();
+	}
+
+	for (std::pair<uint64_t, Resumer> &completion : done) {
+		auto it = tasks.find(completion.first);
+		if (it == tasks.end() || !it->second.waiting) {
+			continue;
+		}
+		it->second.waiting = false;
+		waiting--;
+		int nargs = completion.second(it->second.thread);
+		Resume(completion.first, nargs);
+		resumed++;
+	}
+	return resumed;
+}
+
+uint64_t LuaScheduler::Suspend(lua_State *co) {
+	auto it = threads.find(co);
+	if (it == threads.end()) {
+		return 0;
+	}
+#if LUA_VERSION_NUM >= 503 || defined(LUACPP_LUAJIT)
+	if (!lua_isyieldable(co)) {
+		return 0;
+	}
+#endif
+	Task &task = tasks[it->second];
+	if (task.waiting) {
+		return 0;
+	}
+	task.waiting = true;
+	waiting++;
+	return it->second;
+}
+
+void LuaScheduler::Dispatch(std::function<void()> call) {
+	std::lock_guard<std::mutex> lock(mutex);
+	calls.push_back(std::move(call));
+	wake.notify_one();
+}
+
+void LuaScheduler::Post(uint64_t id, Resumer resumer) {
+	// notified under the lock, the loop may destroy the scheduler as soon as it sees the entry
+	std::lock_guard<std::mutex> lock(mutex);
+	completions.emplace_back(id, std::move(resumer));
+	wake.notify_one();
+}
+
+uint64_t LuaScheduler::AddTimer(uint64_t delayMs, TimerCallback callback, uint64_t periodMs) {
+	uint64_t id = ++lastTimer;
+	timers[id] = Timer{std::make_shared<TimerCallback>(std::move(callback)), periodMs};
+	wheel.Schedule(id, Now() + delayMs);
+	return id;
+}
+
+bool LuaScheduler::CancelTimer(uint64_t id) {
+	wheel.Cancel(id);
+	return timers.erase(id) > 0;
+}
+
+uint64_t LuaScheduler::Now() const {
+	return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void LuaScheduler::FireTimers() {
+	expired.clear();
+	if (wheel.Advance(Now(), expired) == 0) {
+		return;
+	}
+
+	for (uint64_t id : expired) {
+		auto it = timers.find(id);
+		// cancelled by a callback of the same batch
+		if (it == timers.end()) {
+			continue;
+		}
+		// the callback may cancel its own timer
+		std::shared_ptr<TimerCallback> callback = it->second.callback;
+		if (it->second.period > 0) {
+			wheel.Schedule(id, wheel.getCurrentTick() + it->second.period);
+		} else {
+			timers.erase(it);
+		}
+		(*callback)(id);
+	}
+}
+
+void LuaScheduler::Resume(uint64_t id, int nargs) {
+	Task &task = tasks[id];
+	int nresults = 0;
+	int status = lua_resume(task.thread, L, nargs, &nresults);
+	if (status == LUA_YIELD) {
+		lua_pop(task.thread, nresults);
+		if (!task.waiting) {
+			ready.emplace_back(id, 0);
+		}
+		return;
+	}
+	if (task.completion) {
+		// the task is removed first, the completion may spawn the next one
+		Completion completion = std::move(task.completion);
+		lua_State *co = task.thread;
+		lua_pushlightuserdata(L, &threadsKey);
+		lua_rawget(L, LUA_REGISTRYINDEX);
+		lua_pushinteger(L, (lua_Integer) id);
+		lua_rawget(L, -2);
+		Finish(id);
+		// the coroutine is kept on the stack of the state during the call
+		completion(co, status, status == LUA_OK ? nresults : 1);
+		lua_pop(L, 2);
+		return;
+	}
+	if (status != LUA_OK) {
+		errors.push_back(LuaError::FromStatus(task.thread, status));
+	}
+	Finish(id);
+}
+
+void LuaScheduler::Finish(uint64_t id) {
+	auto it = tasks.find(id);
+	if (it->second.waiting) {
+		waiting--;
+	}
+	threads.erase(it->second.thread);
+	tasks.erase(it);
+
+	lua_pushlightuserdata(L, &threadsKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	lua_pushinteger(L, (lua_Integer) id);
+	lua_pushnil(L);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+}
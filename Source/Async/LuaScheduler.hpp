@@ -0,0 +1,314 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASCHEDULER_HPP
+#define LUACPP_LUASCHEDULER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../Lua.hpp"
+#include "../LuaContext.hpp"
+#include "../Engine/LuaState.hpp"
+#include "../Engine/LuaError.hpp"
+#include "LuaTimerWheel.hpp"
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Runs the Lua functions as coroutines waiting for asynchronous operations
+		 *
+		 * @details
+		 * The scheduler is attached to a state, and the functions spawned 
+		 * on it run as coroutines of the state. A library function called 
+		 * from a coroutine can start an operation, `Suspend()` the task and
+		 * yield; when the operation completes, any thread can `Post()` the
+		 * task with a callback pushing the results, and the loop resumes 
+		 * the coroutine with them. A coroutine yielding on its own is put 
+		 * back at the end of the queue of the ready tasks.
+		 *
+		 * All of the Lua code runs on the thread calling `Run()` or 
+		 * `RunOnce()`, only `Post()` is thread-safe. The errors raised by 
+		 * the tasks end the tasks and are collected by `getErrors()`.
+		 *
+		 * The timers are kept in a LuaTimerWheel with the resolution of one
+		 * millisecond. The loop sleeps until the next timer or operation, 
+		 * and runs the callbacks of all the timers expired since the last
+		 * round together, in the order of their deadlines.
+		 *
+		 * The state has to outlive the scheduler, and the scheduler has to
+		 * outlive the operations started by its tasks.
+		 */
+		class LuaScheduler {
+		   public:
+			/**
+			 * @brief Pushes the results of the operation on the coroutine and returns their number
+			 */
+			typedef std::function<int(lua_State *)> Resumer;
+
+			/**
+			 * @brief Called on the thread of the loop with the id of the expired timer
+			 */
+			typedef std::function<void(uint64_t)> TimerCallback;
+
+			/**
+			 * @brief Called when the task ends, with its coroutine, its status and the number of its results
+			 *
+			 * @details
+			 * The results, or the error if the status is not `LUA_OK`, are 
+			 * on the top of the stack of the coroutine.
+			 */
+			typedef std::function<void(lua_State *, int, int)> Completion;
+
+		   private:
+			struct Task {
+				lua_State *thread;
+				bool waiting;
+				Completion completion;
+			};
+
+			struct Timer {
+				std::shared_ptr<TimerCallback> callback;
+				uint64_t period;
+			};
+
+			/**
+			 * @brief Key of the scheduler in the registry of the state
+			 */
+			static char schedulerKey;
+
+			/**
+			 * @brief Key of the table anchoring the coroutines in the registry
+			 */
+			static char threadsKey;
+
+			lua_State *L;
+			uint64_t lastId;
+			size_t waiting;
+			std::unordered_map<uint64_t, Task> tasks;
+			std::unordered_map<lua_State *, uint64_t> threads;
+			std::deque<std::pair<uint64_t, int>> ready;
+			std::vector<Engine::LuaError> errors;
+
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::deque<std::pair<uint64_t, Resumer>> completions;
+			std::deque<std::function<void()>> calls;
+
+			std::chrono::steady_clock::time_point origin;
+			LuaTimerWheel wheel;
+			uint64_t lastTimer;
+			std::unordered_map<uint64_t, Timer> timers;
+			std::vector<uint64_t> expired;
+
+			void Resume(uint64_t id, int nargs);
+			uint64_t Start(int nargs, Completion completion);
+			void Finish(uint64_t id);
+			void FireTimers();
+
+		   public:
+			/**
+			 * @brief Attaches the scheduler to the state
+			 *
+			 * @details
+			 * Throws `std::logic_error` if the state has a scheduler already.
+			 *
+			 * @param L the state running the tasks
+			 */
+			explicit LuaScheduler(Engine::LuaState &L);
+
+			LuaScheduler(const LuaScheduler &) = delete;
+			LuaScheduler &operator=(const LuaScheduler &) = delete;
+
+			/**
+			 * @brief Detaches the scheduler from the state
+			 */
+			~LuaScheduler();
+
+			/**
+			 * @brief Spawns the function on the stack as a new task
+			 *
+			 * @details
+			 * The function and the `nargs` arguments are popped from the
+			 * stack like with `lua_call`. The task runs on the next call to
+			 * `RunOnce()`.
+			 *
+			 * @param nargs number of the arguments above the function
+			 * @return the id of the task
+			 */
+			uint64_t Spawn(int nargs = 0);
+
+			/**
+			 * @brief Spawns the function on the stack as a new task, calling the completion when it ends
+			 *
+			 * @details
+			 * The errors of the task are passed to the completion instead of
+			 * being collected by `getErrors()`.
+			 *
+			 * @param nargs number of the arguments above the function
+			 * @param completion called on the thread of the loop when the task ends
+			 * @return the id of the task
+			 */
+			uint64_t Spawn(int nargs, Completion completion);
+
+			/**
+			 * @brief Spawns the snippet of the context as a new task
+			 *
+			 * @param ctx the context holding the snippet
+			 * @param name the name of the snippet
+			 * @return the id of the task
+			 */
+			uint64_t Spawn(LuaContext &ctx, const std::string &name);
+
+			/**
+			 * @brief Runs until all of the tasks are finished and all of the timers are cancelled or expired
+			 */
+			void Run();
+
+			/**
+			 * @brief Runs one round of the loop
+			 *
+			 * @details
+			 * Resumes the ready tasks, then waits for the completed 
+			 * operations or the next timer if there are none, runs the
+			 * callbacks of the expired timers and resumes the tasks of the
+			 * completed operations.
+			 *
+			 * A positive timeout waits for the `Dispatch()` calls also when
+			 * there are no operations and no timers.
+			 *
+			 * @param timeoutMs maximum time to wait in milliseconds, `-1` waits until an operation completes or a timer expires
+			 * @return the number of the resumed tasks
+			 */
+			size_t RunOnce(int timeoutMs = -1);
+
+			/**
+			 * @brief Marks the running task as waiting for an operation
+			 *
+			 * @details
+			 * Called by the library functions before starting the operation.
+			 * Returns `0` when the coroutine is not a task of the scheduler
+			 * or can not yield, the function should complete the operation
+			 * synchronously then. Otherwise the function should start the
+			 * operation, `Post()` the returned id on completion and 
+			 * `return lua_yield(L, 0)`. The yield does not unwind the C++ 
+			 * stack, so no objects with destructors should be alive then.
+			 *
+			 * @param co the coroutine calling the function
+			 * @return the id of the task, `0` if the task can not be suspended
+			 */
+			uint64_t Suspend(lua_State *co);
+
+			/**
+			 * @brief Queues the resume of the waiting task
+			 *
+			 * @details
+			 * Thread-safe. The resumer is called on the thread of the loop.
+			 * The tasks which are no longer running are ignored.
+			 *
+			 * @param id the id returned by `Suspend()`
+			 * @param resumer the callback pushing the results of the operation
+			 */
+			void Post(uint64_t id, Resumer resumer);
+
+			/**
+			 * @brief Queues the call to run on the thread of the loop
+			 *
+			 * @details
+			 * Thread-safe. The call runs in the next round of the loop, and
+			 * can use the state, ex. to spawn a task.
+			 *
+			 * @param call the call
+			 */
+			void Dispatch(std::function<void()> call);
+
+			/**
+			 * @brief Adds the timer calling the callback after the delay
+			 *
+			 * @details
+			 * The periodic timers are scheduled again after each call, 
+			 * until they are cancelled.
+			 *
+			 * @param delayMs the delay in milliseconds
+			 * @param callback the callback
+			 * @param periodMs the period of the repeated calls, `0` calls the callback once
+			 * @return the id of the timer
+			 */
+			uint64_t AddTimer(uint64_t delayMs, TimerCallback callback, uint64_t periodMs = 0);
+
+			/**
+			 * @brief Cancels the timer
+			 *
+			 * @param id the id returned by `AddTimer()`
+			 * @return `false` if the timer has expired or was cancelled already
+			 */
+			bool CancelTimer(uint64_t id);
+
+			/**
+			 * @brief Returns the milliseconds since the creation of the scheduler
+			 */
+			uint64_t Now() const;
+
+			/**
+			 * @brief Returns the scheduler attached to the state
+			 *
+			 * @param L the state or any of its coroutines
+			 * @return the scheduler, `nullptr` if there is none
+			 */
+			static LuaScheduler *From(lua_State *L);
+
+			/**
+			 * @brief Returns the number of the unfinished tasks
+			 */
+			inline size_t getTaskCount() const { return tasks.size(); }
+
+			/**
+			 * @brief Returns the number of the active timers
+			 */
+			inline size_t getTimerCount() const { return timers.size(); }
+
+			/**
+			 * @brief Returns the state running the tasks
+			 */
+			inline lua_State *getState() const { return L; }
+
+			/**
+			 * @brief Returns the errors raised by the finished tasks
+			 */
+			inline const std::vector<Engine::LuaError> &getErrors() const { return errors; }
+		};
+	}
+}
+
+#endif // LUACPP_LUASCHEDULER_HPP
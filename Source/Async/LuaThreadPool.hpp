@@ -0,0 +1,87 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUATHREADPOOL_HPP
+#define LUACPP_LUATHREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Fixed pool of threads running the submitted tasks
+		 *
+		 * @details
+		 * The tasks are run in the order of the submission by the first
+		 * free thread. The destructor runs the tasks that are still queued
+		 * and joins the threads. The tasks must not throw.
+		 */
+		class LuaThreadPool {
+		   private:
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::deque<std::function<void()>> queue;
+			std::vector<std::thread> threads;
+			bool stopping;
+
+			void Work();
+
+		   public:
+			/**
+			 * @brief Starts the threads of the pool
+			 *
+			 * @param count number of the threads, `0` uses the number of the cores
+			 */
+			explicit LuaThreadPool(unsigned count = 0);
+
+			LuaThreadPool(const LuaThreadPool &) = delete;
+			LuaThreadPool &operator=(const LuaThreadPool &) = delete;
+
+			/**
+			 * @brief Runs the queued tasks and joins the threads
+			 */
+			~LuaThreadPool();
+
+			/**
+			 * @brief Queues the task to be run by one of the threads
+			 *
+			 * @param task the task
+			 */
+			void Submit(std::function<void()> task);
+
+			/**
+			 * @brief Returns the number of the threads in the pool
+			 */
+			inline size_t getThreadCount() const { return threads.size(); }
+		};
+	}
+}
+
+#endif // LUACPP_LUATHREADPOOL_HPP
@@ -0,0 +1,168 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "LuaTimerLibrary.hpp"
+#include "LuaBindingHelpers.hpp"
+
+using namespace LuaCpp::Async;
+
+namespace {
+
+	/**
+	 * @brief Key of the table holding the functions of the timers in the registry
+	 */
+	char callbacksKey = 0;
+
+	void PushCallbacks(lua_State *L) {
+		lua_pushlightuserdata(L, &callbacksKey);
+		lua_rawget(L, LUA_REGISTRYINDEX);
+		if (lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			lua_newtable(L);
+			lua_pushlightuserdata(L, &callbacksKey);
+			lua_pushvalue(L, -2);
+			lua_rawset(L, LUA_REGISTRYINDEX);
+		}
+	}
+
+	void SetCallback(lua_State *L, uint64_t id, int idx) {
+		idx = lua_absindex(L, idx);
+		PushCallbacks(L);
+		lua_pushinteger(L, (lua_Integer) id);
+		lua_pushvalue(L, idx);
+		lua_rawset(L, -3);
+		lua_pop(L, 1);
+	}
+
+	/**
+	 * @brief Adds the timer spawning the function stored under its id
+	 */
+	uint64_t AddTimer(LuaScheduler &scheduler, uint64_t delay, uint64_t period) {
+		LuaScheduler *owner = &scheduler;
+		return scheduler.AddTimer(delay, [owner, period](uint64_t id) {
+			lua_State *L = owner->getState();
+			PushCallbacks(L);
+			lua_pushinteger(L, (lua_Integer) id);
+			lua_rawget(L, -2);
+			if (period == 0) {
+				lua_pushinteger(L, (lua_Integer) id);
+				lua_pushnil(L);
+				lua_rawset(L, -4);
+			}
+			lua_remove(L, -2);
+			if (lua_type(L, -1) == LUA_TFUNCTION) {
+				owner->Spawn(0);
+			} else {
+				lua_pop(L, 1);
+			}
+		}, period);
+	}
+
+	/**
+	 * @brief Arms the timer resuming the task, or sleeps without a scheduler, returns `-1` if the task was suspended
+	 */
+	int Sleep(lua_State *L, uint64_t delay) {
+		LuaScheduler *scheduler = LuaScheduler::From(L);
+		return SuspendOrRun<bool>(L, [scheduler, delay](std::function<void(bool &&)> done) {
+			scheduler->AddTimer(delay, [done](uint64_t) {
+				done(true);
+			});
+		}, [delay]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+			return true;
+		}, [](lua_State *, const bool &) {
+			return 0;
+		});
+	}
+
+	LuaScheduler *CheckScheduler(lua_State *L, const char *name) {
+		LuaScheduler *scheduler = LuaScheduler::From(L);
+		if (scheduler == nullptr) {
+			luaL_error(L, "timer.%s needs a scheduler attached to the state", name);
+		}
+		return scheduler;
+	}
+
+	/**
+	 * @brief Longest delay in milliseconds, about 140000 years, so the deadlines and the sleeps do not overflow
+	 */
+	const uint64_t MAX_DELAY = (uint64_t) 1 << 52;
+
+	uint64_t CheckDelay(lua_State *L, int arg, bool positive) {
+		lua_Number ms = luaL_checknumber(L, arg);
+		luaL_argcheck(L, std::isfinite(ms), arg, positive ? "period must be finite" : "delay must be finite");
+		luaL_argcheck(L, positive ? ms > 0 : ms >= 0, arg, positive ? "period must be positive" : "negative delay");
+		// the period of 0 is the one-shot timer, the shorter periods are rounded up
+		if (positive && ms < 1) {
+			return 1;
+		}
+		if (ms >= (lua_Number) MAX_DELAY) {
+			return MAX_DELAY;
+		}
+		return (uint64_t) ms;
+	}
+}
+
+LuaTimerLibrary::LuaTimerLibrary() : LuaLibrary("timer") {
+	AddCFunction("sleep", [](lua_State *L) -> int {
+		uint64_t delay = CheckDelay(L, 1, false);
+		return Yield(L, Sleep(L, delay));
+	});
+
+	AddCFunction("after", [](lua_State *L) -> int {
+		uint64_t delay = CheckDelay(L, 1, false);
+		luaL_checktype(L, 2, LUA_TFUNCTION);
+		LuaScheduler *scheduler = CheckScheduler(L, "after");
+		uint64_t id = AddTimer(*scheduler, delay, 0);
+		SetCallback(L, id, 2);
+		lua_pushinteger(L, (lua_Integer) id);
+		return 1;
+	});
+
+	AddCFunction("every", [](lua_State *L) -> int {
+		uint64_t period = CheckDelay(L, 1, true);
+		luaL_checktype(L, 2, LUA_TFUNCTION);
+		LuaScheduler *scheduler = CheckScheduler(L, "every");
+		uint64_t id = AddTimer(*scheduler, period, period);
+		SetCallback(L, id, 2);
+		lua_pushinteger(L, (lua_Integer) id);
+		return 1;
+	});
+
+	AddCFunction("cancel", [](lua_State *L) -> int {
+		lua_Integer id = luaL_checkinteger(L, 1);
+		LuaScheduler *scheduler = CheckScheduler(L, "cancel");
+		lua_pushboolean(L, scheduler->CancelTimer((uint64_t) id));
+		PushCallbacks(L);
+		lua_pushinteger(L, id);
+		lua_pushnil(L);
+		lua_rawset(L, -3);
+		lua_pop(L, 1);
+		return 1;
+	});
+}
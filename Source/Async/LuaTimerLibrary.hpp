@@ -0,0 +1,62 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUATIMERLIBRARY_HPP
+#define LUACPP_LUATIMERLIBRARY_HPP
+
+#include "../Lua.hpp"
+#include "../Registry/LuaLibrary.hpp"
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Library `timer` with the sleep and the timers of the LuaScheduler
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `timer.sleep(ms)` suspends the task for the time
+		 *  - `timer.after(ms, fn)` runs the function as a new task after the time,
+		 *    returns the id of the timer
+		 *  - `timer.every(ms, fn)` runs the function as a new task every period,
+		 *    of at least 1 ms, returns the id of the timer
+		 *  - `timer.cancel(id)` cancels the timer, returns `false` if it is not active
+		 *
+		 * The sleep yields the task, so the other tasks keep running. Called 
+		 * outside of a task of the scheduler, the sleep blocks the thread. 
+		 * The timers need the scheduler attached to the state, and keep it 
+		 * running until they are cancelled or expire.
+		 */
+		class LuaTimerLibrary : public Registry::LuaLibrary {
+		   public:
+			/**
+			 * @brief Creates the library
+			 */
+			LuaTimerLibrary();
+		};
+	}
+}
+
+#endif // LUACPP_LUATIMERLIBRARY_HPP
@@ -0,0 +1,140 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+
+#include "LuaTimerWheel.hpp"
+
+using namespace LuaCpp::Async;
+
+void LuaTimerWheel::Schedule(uint64_t id, uint64_t deadline) {
+	deadlines[id] = deadline;
+	if (deadline <= current) {
+		due.emplace_back(id, deadline);
+		return;
+	}
+	Place(id, deadline);
+}
+
+bool LuaTimerWheel::Cancel(uint64_t id) {
+	return deadlines.erase(id) > 0;
+}
+
+void LuaTimerWheel::Place(uint64_t id, uint64_t deadline) {
+	uint64_t delta = deadline > current ? deadline - current : 0;
+	unsigned level = 0;
+	while (level < LEVELS - 1 && delta >= (uint64_t) 1 << (SLOT_BITS * (level + 1))) {
+		level++;
+	}
+
+	// the timers beyond the span wait in the furthest slot
+	uint64_t span = (uint64_t) 1 << (SLOT_BITS * LEVELS);
+	uint64_t tick = delta < span ? deadline : current + span - 1;
+	slots[level][(tick >> (SLOT_BITS * level)) & (SLOTS - 1)].emplace_back(id, deadline);
+}
+
+void LuaTimerWheel::Expire(Slot &slot, std::vector<uint64_t> &expired) {
+	scratch.clear();
+	scratch.swap(slot);
+	for (const std::pair<uint64_t, uint64_t> &entry : scratch) {
+		auto it = deadlines.find(entry.first);
+		// the cancelled and the moved timers leave the stale entries
+		if (it == deadlines.end() || it->second != entry.second) {
+			continue;
+		}
+		if (entry.second > current) {
+			Place(entry.first, entry.second);
+			continue;
+		}
+		expired.push_back(entry.first);
+		deadlines.erase(it);
+	}
+}
+
+size_t LuaTimerWheel::Advance(uint64_t now, std::vector<uint64_t> &expired) {
+	size_t before = expired.size();
+	if (!due.empty()) {
+		std::stable_sort(due.begin(), due.end(), [](const std::pair<uint64_t, uint64_t> &a, const std::pair<uint64_t, uint64_t> &b) {
+			return a.second < b.second;
+		});
+		Expire(due, expired);
+	}
+
+	while (current < now) {
+		if (deadlines.empty()) {
+			current = now;
+			break;
+		}
+
+		// the ticks before the next non-empty slot have nothing to expire or cascade
+		if (slots[0][(current + 1) & (SLOTS - 1)].empty()) {
+			uint64_t next = std::min(getNextTick(), now);
+			if (next > current + 1) {
+				current = next - 1;
+			}
+		}
+		current++;
+
+		// the slots of the higher levels are cascaded when the lower level wraps
+		for (unsigned level = 1; level < LEVELS; level++) {
+			uint64_t shift = SLOT_BITS * level;
+			if ((current & (((uint64_t) 1 << shift) - 1)) != 0) {
+				break;
+			}
+			scratch.clear();
+			scratch.swap(slots[level][(current >> shift) & (SLOTS - 1)]);
+			for (const std::pair<uint64_t, uint64_t> &entry : scratch) {
+				auto it = deadlines.find(entry.first);
+				if (it != deadlines.end() && it->second == entry.second) {
+					Place(entry.first, entry.second);
+				}
+			}
+		}
+
+		Expire(slots[0][current & (SLOTS - 1)], expired);
+	}
+	return expired.size() - before;
+}
+
+uint64_t LuaTimerWheel::getNextTick() const {
+	if (deadlines.empty()) {
+		return UINT64_MAX;
+	}
+	if (!due.empty()) {
+		return current;
+	}
+
+	uint64_t next = UINT64_MAX;
+	for (unsigned level = 0; level < LEVELS; level++) {
+		uint64_t shift = SLOT_BITS * level;
+		uint64_t base = current >> shift;
+		for (uint64_t i = 1; i <= SLOTS; i++) {
+			if (!slots[level][(base + i) & (SLOTS - 1)].empty()) {
+				next = std::min(next, (base + i) << shift);
+				break;
+			}
+		}
+	}
+	return next;
+}
@@ -0,0 +1,145 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUATIMERWHEEL_HPP
+#define LUACPP_LUATIMERWHEEL_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace LuaCpp {
+	namespace Async {
+
+		/**
+		 * @brief Hierarchical wheel of the timers
+		 *
+		 * @details
+		 * The timers are identified by the ids given by the caller and 
+		 * expire at a tick. The wheel has `LEVELS` levels of `SLOTS` slots, 
+		 * the first level holds the timers of the next `SLOTS` ticks, each
+		 * higher level covers `SLOTS` times longer span and its slots are
+		 * cascaded to the lower levels when the wheel reaches them. Adding 
+		 * and cancelling a timer is constant time, advancing the wheel is
+		 * constant time per tick plus the expired timers, and the ticks
+		 * before the next non-empty slot are skipped.
+		 *
+		 * The timers beyond the span of the wheel wait in the last slot and
+		 * are placed again when it is cascaded. The cancelled timers are 
+		 * dropped when the wheel reaches their slot.
+		 */
+		class LuaTimerWheel {
+		   public:
+			static constexpr unsigned LEVELS = 4;
+			static constexpr unsigned SLOT_BITS = 6;
+			static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+
+		   private:
+			typedef std::vector<std::pair<uint64_t, uint64_t>> Slot;
+
+			uint64_t current;
+			Slot slots[LEVELS][SLOTS];
+			Slot due;
+
+			/**
+			 * @brief Buffer swapped with the processed slot, so the slots keep their capacity
+			 */
+			Slot scratch;
+			std::unordered_map<uint64_t, uint64_t> deadlines;
+
+			void Place(uint64_t id, uint64_t deadline);
+			void Expire(Slot &slot, std::vector<uint64_t> &expired);
+
+		   public:
+			/**
+			 * @brief Creates an empty wheel
+			 *
+			 * @param now the current tick
+			 */
+			explicit LuaTimerWheel(uint64_t now = 0) : current(now) {}
+
+			/**
+			 * @brief Adds the timer, or moves it if the id is in the wheel
+			 *
+			 * @details
+			 * The timers at a tick which already passed expire at the next
+			 * call to `Advance()`.
+			 *
+			 * @param id the id of the timer
+			 * @param deadline the tick of the expiration
+			 */
+			void Schedule(uint64_t id, uint64_t deadline);
+
+			/**
+			 * @brief Removes the timer
+			 *
+			 * @param id the id of the timer
+			 * @return `false` if the timer is not in the wheel
+			 */
+			bool Cancel(uint64_t id);
+
+			/**
+			 * @brief Moves the wheel to the tick and collects the expired timers
+			 *
+			 * @details
+			 * The ids are appended to the vector in the order of their
+			 * deadlines, and removed from the wheel.
+			 *
+			 * @param now the current tick
+			 * @param expired the vector receiving the ids of the expired timers
+			 * @return the number of the expired timers
+			 */
+			size_t Advance(uint64_t now, std::vector<uint64_t> &expired);
+
+			/**
+			 * @brief Returns the tick at which the wheel has to be advanced next
+			 *
+			 * @details
+			 * The tick is not later than the earliest deadline, it may be 
+			 * earlier when the timer is on a higher level.
+			 *
+			 * @return the tick, `UINT64_MAX` if the wheel is empty
+			 */
+			uint64_t getNextTick() const;
+
+			/**
+			 * @brief Returns the tick the wheel was advanced to
+			 */
+			inline uint64_t getCurrentTick() const { return current; }
+
+			/**
+			 * @brief Returns the number of the timers in the wheel
+			 */
+			inline size_t size() const { return deadlines.size(); }
+
+			/**
+			 * @brief Check if there are no timers in the wheel
+			 */
+			inline bool empty() const { return deadlines.empty(); }
+		};
+	}
+}
+
+#endif // LUACPP_LUATIMERWHEEL_HPP
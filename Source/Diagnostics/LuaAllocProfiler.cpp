@@ -0,0 +1,154 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <iomanip>
+
+#include "LuaAllocProfiler.hpp"
+
+using namespace LuaCpp::Diagnostics;
+using namespace LuaCpp::Engine;
+
+extern "C" {
+	static void *sampling_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+		LuaAllocProfiler::Allocator *allocator = (LuaAllocProfiler::Allocator *) ud;
+
+		// when `ptr` is NULL the `osize` holds the type of the new object
+		size_t previous = ptr != NULL ? osize : 0;
+		if (nsize > previous) {
+			size_t grow = nsize - previous;
+			allocator->profiler->Count(grow);
+			allocator->countdown -= (int64_t) grow;
+			if (allocator->countdown <= 0) {
+				int64_t interval = (int64_t) allocator->profiler->getSampleBytes();
+				uint64_t samples = (uint64_t) (-allocator->countdown / interval) + 1;
+				allocator->countdown += (int64_t) samples * interval;
+				allocator->pending += samples;
+			}
+			// the stack is consistent only when a new object is allocated
+			if (allocator->pending > 0 && ptr == NULL) {
+				allocator->profiler->Sample(*allocator, allocator->pending);
+				allocator->pending = 0;
+			}
+		}
+
+		return allocator->allocf(allocator->ud, ptr, osize, nsize);
+	}
+}
+
+void LuaAllocProfiler::Attach(LuaState &L) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::unique_ptr<Allocator> &allocator = allocators[L.getState()];
+	allocator = std::make_unique<Allocator>();
+	allocator->profiler = this;
+	allocator->L = L.getState();
+	allocator->allocf = lua_getallocf(L, &allocator->ud);
+	allocator->countdown = (int64_t) sampleBytes;
+	allocator->pending = 0;
+
+	lua_setallocf(L, sampling_alloc, allocator.get());
+}
+
+void LuaAllocProfiler::Detach(LuaState &L) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = allocators.find(L.getState());
+	if (it == allocators.end()) {
+		return;
+	}
+	lua_setallocf(L, it->second->allocf, it->second->ud);
+	allocators.erase(it);
+}
+
+void LuaAllocProfiler::Sample(Allocator &allocator, uint64_t samples) {
+	lua_Debug ar;
+	std::string function = "?";
+	std::string source = "[C]";
+	int line = 0;
+
+	for (int level = 0; lua_getstack(allocator.L, level, &ar) == 1; level++) {
+		lua_getinfo(allocator.L, "Sln", &ar);
+		if (ar.currentline >= 0) {
+			source = ar.short_src;
+			line = ar.currentline;
+			if (ar.name != NULL) {
+				function = ar.name;
+			} else if (ar.what != NULL && std::string(ar.what) == "main") {
+				function = "main chunk";
+			}
+			break;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	LuaAllocSite &site = sites[std::make_pair(source, line)];
+	if (site.samples == 0) {
+		site.function = function;
+		site.source = source;
+		site.line = line;
+	}
+	site.samples += samples;
+	site.bytes += samples * sampleBytes;
+}
+
+size_t LuaAllocProfiler::getSampleBytes() const {
+	return sampleBytes;
+}
+
+uint64_t LuaAllocProfiler::getTotalBytes() const {
+	return totalBytes.load();
+}
+
+uint64_t LuaAllocProfiler::getTotalAllocations() const {
+	return totalAllocations.load();
+}
+
+std::vector<LuaAllocSite> LuaAllocProfiler::getSites() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<LuaAllocSite> result;
+	for (const auto &site : sites) {
+		result.push_back(site.second);
+	}
+	std::sort(result.begin(), result.end(), [](const LuaAllocSite &a, const LuaAllocSite &b) {
+		return a.bytes > b.bytes;
+	});
+	return result;
+}
+
+void LuaAllocProfiler::WriteReport(std::ostream &out) {
+	out << "Allocated " << getTotalBytes() << " bytes in " << getTotalAllocations() << " allocations, sampled every " << sampleBytes << " bytes\n";
+	out << std::setw(14) << "bytes" << std::setw(10) << "samples" << "  site\n";
+	for (const auto &site : getSites()) {
+		out << std::setw(14) << site.bytes << std::setw(10) << site.samples
+		    << "  " << site.source << ":" << site.line << " (" << site.function << ")\n";
+	}
+}
+
+void LuaAllocProfiler::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	sites.clear();
+	totalBytes.store(0);
+	totalAllocations.store(0);
+}
@@ -0,0 +1,178 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAALLOCPROFILER_HPP
+#define LUACPP_LUAALLOCPROFILER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../Lua.hpp"
+#include "../Engine/LuaState.hpp"
+
+namespace LuaCpp {
+	namespace Diagnostics {
+
+		/**
+		 * @brief Allocations attributed to a line of a Lua source
+		 *
+		 * @details
+		 * The `bytes` is the estimate of the allocated bytes based on the
+		 * sampling interval, and `samples` is the number of samples taken on
+		 * the line.
+		 */
+		struct LuaAllocSite {
+			std::string function;
+			std::string source;
+			int line;
+			uint64_t bytes;
+			uint64_t samples;
+		};
+
+		/**
+		 * @brief Sampling allocation profiler
+		 *
+		 * @details
+		 * The profiler replaces the allocator of the state with an allocator 
+		 * that forwards the requests to the original one and counts the
+		 * allocated bytes. Every `sampleBytes` allocated bytes, the current Lua
+		 * line and function are captured with `lua_getinfo` and the sample is
+		 * added to the site. With `sampleBytes` equal to 1, every allocation
+		 * is attributed with its exact size.
+		 *
+		 * The stack of the state can not be inspected while Lua is resizing
+		 * existing blocks (ex. the stack itself), so the sample that falls on
+		 * a resize is attributed on the next allocation of a new object.
+		 *
+		 * The line is captured from the main thread of the state, so the 
+		 * allocations made from a coroutine are attributed to the line 
+		 * that resumed the coroutine.
+		 *
+		 * The profiler should be detached, or remain alive, until the state
+		 * is closed.
+		 */
+		class LuaAllocProfiler {
+		   public:
+			struct Allocator {
+				LuaAllocProfiler *profiler;
+				lua_State *L;
+				lua_Alloc allocf;
+				void *ud;
+				int64_t countdown;
+				uint64_t pending;
+			};
+
+		   private:
+			size_t sampleBytes;
+			std::mutex mutex;
+			std::map<std::pair<std::string, int>, LuaAllocSite> sites;
+			std::map<lua_State *, std::unique_ptr<Allocator>> allocators;
+			std::atomic<uint64_t> totalBytes;
+			std::atomic<uint64_t> totalAllocations;
+
+		   public:
+			/**
+			 * @brief Constructs the profiler
+			 *
+			 * @param _sampleBytes Number of allocated bytes between two samples
+			 */
+			explicit LuaAllocProfiler(size_t _sampleBytes = 4096) : sampleBytes(_sampleBytes > 0 ? _sampleBytes : 1), mutex(), sites(), allocators(), totalBytes(0), totalAllocations(0) {}
+			~LuaAllocProfiler() {}
+
+			/**
+			 * @brief Starts profiling the allocations of the state
+			 *
+			 * @param L State that will be profiled
+			 */
+			void Attach(Engine::LuaState &L);
+
+			/**
+			 * @brief Restores the original allocator of the state
+			 *
+			 * @param L State that is profiled
+			 */
+			void Detach(Engine::LuaState &L);
+
+			/**
+			 * @brief Called by the allocator when the sampling interval is reached
+			 *
+			 * @details
+			 * Captures the current line of the state and adds the samples
+			 * to the site.
+			 *
+			 * @param allocator The allocator of the state
+			 * @param samples Number of sampling intervals reached
+			 */
+			void Sample(Allocator &allocator, uint64_t samples);
+
+			/**
+			 * @brief Returns the sampling interval in bytes
+			 */
+			size_t getSampleBytes() const;
+
+			/**
+			 * @brief Counts the allocation in the totals
+			 */
+			inline void Count(size_t bytes) {
+				totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+				totalAllocations.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			/**
+			 * @brief Returns the total number of bytes allocated in the profiled states
+			 */
+			uint64_t getTotalBytes() const;
+
+			/**
+			 * @brief Returns the total number of allocations in the profiled states
+			 */
+			uint64_t getTotalAllocations() const;
+
+			/**
+			 * @brief Returns the sites sorted by the allocated bytes
+			 */
+			std::vector<LuaAllocSite> getSites();
+
+			/**
+			 * @brief Writes the sites as a table sorted by the allocated bytes
+			 *
+			 * @param out Stream where the report will be written
+			 */
+			void WriteReport(std::ostream &out);
+
+			/**
+			 * @brief Removes the collected samples and totals
+			 */
+			void Clear();
+		};
+	}
+}
+
+#endif // LUACPP_LUAALLOCPROFILER_HPP
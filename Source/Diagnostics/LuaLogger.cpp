@@ -0,0 +1,346 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+
+#include "LuaLogger.hpp"
+
+using namespace LuaCpp::Diagnostics;
+
+/**
+ * Ring of the records written by a single thread. Only the owning thread
+ * advances the `head`, only the writer advances the `tail`. The thread 
+ * marks the ring `ended` when it exits, the logger marks it `closed` when
+ * it is destroyed.
+ */
+struct LuaLogger::Ring {
+	struct Slot {
+		LuaLogLevel level;
+		uint64_t timestamp;
+		size_t length;
+		char text[LUACPP_LOG_RECORD_SIZE];
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t capacity;
+	uint32_t thread;
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+	std::atomic<bool> ended;
+	std::atomic<bool> closed;
+
+	Ring(size_t _capacity, uint32_t _thread) : slots(new Slot[_capacity]), capacity(_capacity), thread(_thread), head(0), tail(0), ended(false), closed(false) {}
+};
+
+namespace {
+	std::atomic<uint64_t> nextLoggerId(1);
+
+	std::mutex defaultMutex;
+	std::shared_ptr<LuaLogger> defaultLogger;
+
+	const char *levelNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+
+	/**
+	 * Appends to the fixed size text of the record, truncating what
+	 * does not fit.
+	 */
+	struct TextWriter {
+		char *buff;
+		size_t length;
+
+		void Append(const char *str, size_t len) {
+			size_t room = LUACPP_LOG_RECORD_SIZE - length;
+			if (len > room) {
+				len = room;
+			}
+			memcpy(buff + length, str, len);
+			length += len;
+		}
+
+		void Append(char c) {
+			if (length < LUACPP_LOG_RECORD_SIZE) {
+				buff[length++] = c;
+			}
+		}
+
+		void AppendValue(const char *str, size_t len) {
+			bool quote = (len == 0);
+			for (size_t i = 0; i < len && !quote; i++) {
+				unsigned char c = (unsigned char) str[i];
+				quote = (c <= ' ' || c == '"' || c == '=' || c == '\\');
+			}
+			if (!quote) {
+				Append(str, len);
+				return;
+			}
+
+			Append('"');
+			for (size_t i = 0; i < len; i++) {
+				switch (str[i]) {
+					case '"': Append("\\\"", 2); break;
+					case '\\': Append("\\\\", 2); break;
+					case '\n': Append("\\n", 2); break;
+					case '\r': Append("\\r", 2); break;
+					case '\t': Append("\\t", 2); break;
+					default:
+						if ((unsigned char) str[i] >= 0x20) {
+							Append(str[i]);
+						}
+				}
+			}
+			Append('"');
+		}
+	};
+}
+
+LuaLogger::LuaLogger(Sink _sink, size_t _capacity) : id(nextLoggerId.fetch_add(1)), sink(std::move(_sink)), capacity(_capacity > 0 ? _capacity : 1), level((uint8_t) LuaLogLevel::Info), dropped(0), ringsVersion(0), threads(0), running(true) {
+	writer = std::thread(&LuaLogger::Write, this);
+}
+
+LuaLogger::LuaLogger(std::ostream &out, size_t _capacity) : LuaLogger([&out](const LuaLogRecord &record) { WriteRecord(out, record); }, _capacity) {}
+
+LuaLogger::~LuaLogger() {
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		running = false;
+	}
+	wake.notify_all();
+	writer.join();
+
+	// the threads drop their entries of the closed rings when they exit or add a ring
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	for (const auto &ring : rings) {
+		ring->slots.reset();
+		ring->closed.store(true, std::memory_order_release);
+	}
+	rings.clear();
+}
+
+LuaLogger::Ring &LuaLogger::getThreadRing() {
+	/**
+	 * Rings of the thread by the id of the logger, marked ended when the
+	 * thread exits.
+	 */
+	struct ThreadRings {
+		std::unordered_map<uint64_t, std::shared_ptr<Ring>> rings;
+
+		~ThreadRings() {
+			for (const auto &ring : rings) {
+				ring.second->ended.store(true, std::memory_order_release);
+			}
+		}
+	};
+	thread_local ThreadRings threadRings;
+
+	auto it = threadRings.rings.find(id);
+	if (it != threadRings.rings.end()) {
+		return *it->second;
+	}
+
+	for (auto entry = threadRings.rings.begin(); entry != threadRings.rings.end();) {
+		if (entry->second->closed.load(std::memory_order_acquire)) {
+			entry = threadRings.rings.erase(entry);
+		} else {
+			++entry;
+		}
+	}
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	std::shared_ptr<Ring> ring = std::make_shared<Ring>(capacity, ++threads);
+	rings.push_back(ring);
+	ringsVersion++;
+	threadRings.rings[id] = ring;
+	return *ring;
+}
+
+bool LuaLogger::Log(LuaLogLevel _level, const char *message, size_t length, const LuaLogField *fields, size_t count) {
+	if (!isEnabled(_level)) {
+		return false;
+	}
+
+	Ring &ring = getThreadRing();
+	size_t head = ring.head.load(std::memory_order_relaxed);
+	if (head - ring.tail.load(std::memory_order_acquire) >= ring.capacity) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Ring::Slot &slot = ring.slots[head % ring.capacity];
+	slot.level = _level;
+	slot.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	TextWriter text{slot.text, 0};
+	text.Append(message, length);
+	for (size_t i = 0; i < count; i++) {
+		text.Append(' ');
+		text.Append(fields[i].key, strlen(fields[i].key));
+		text.Append('=');
+		text.AppendValue(fields[i].value, fields[i].length);
+	}
+	slot.length = text.length;
+
+	ring.head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+bool LuaLogger::Log(LuaLogLevel _level, const char *message) {
+	return Log(_level, message, strlen(message));
+}
+
+bool LuaLogger::Drain(std::vector<std::shared_ptr<Ring>> &local, uint64_t &version) {
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		if (version != ringsVersion) {
+			local = rings;
+			version = ringsVersion;
+		}
+	}
+
+	bool written = false;
+	bool released = false;
+	for (const auto &ring : local) {
+		// the records logged before the thread ended are written by this pass
+		bool ended = ring->ended.load(std::memory_order_acquire);
+		size_t tail = ring->tail.load(std::memory_order_relaxed);
+		size_t head = ring->head.load(std::memory_order_acquire);
+		for (; tail != head; tail++) {
+			const Ring::Slot &slot = ring->slots[tail % ring->capacity];
+			LuaLogRecord record{slot.level, slot.timestamp, ring->thread, slot.text, slot.length};
+			try {
+				sink(record);
+			} catch (...) {
+				// the failing sink must not stop the writer
+			}
+			ring->tail.store(tail + 1, std::memory_order_release);
+			written = true;
+		}
+		released |= ended;
+	}
+
+	if (released) {
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring> &ring) {
+			return ring->ended.load(std::memory_order_acquire) && ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+		}), rings.end());
+		ringsVersion++;
+	}
+	return written;
+}
+
+void LuaLogger::Write() {
+	std::vector<std::shared_ptr<Ring>> local;
+	uint64_t version = 0;
+	std::unique_lock<std::mutex> lock(writerMutex);
+	while (running) {
+		lock.unlock();
+		bool written = Drain(local, version);
+		lock.lock();
+		drained.notify_all();
+		if (!written && running) {
+			wake.wait_for(lock, std::chrono::milliseconds(5));
+		}
+	}
+	lock.unlock();
+	Drain(local, version);
+	drained.notify_all();
+}
+
+void LuaLogger::Flush() {
+	std::vector<std::pair<std::shared_ptr<Ring>, size_t>> marks;
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (const auto &ring : rings) {
+			marks.emplace_back(ring, ring->head.load(std::memory_order_acquire));
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(writerMutex);
+	wake.notify_all();
+	drained.wait(lock, [&marks]() {
+		for (const auto &mark : marks) {
+			if (mark.first->tail.load(std::memory_order_acquire) < mark.second) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
+size_t LuaLogger::getRingCount() {
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	return rings.size();
+}
+
+void LuaLogger::WriteRecord(std::ostream &out, const LuaLogRecord &record) {
+	time_t seconds = (time_t) (record.timestamp / 1000000000ull);
+	struct tm utc;
+#ifdef _WIN32
+	gmtime_s(&utc, &seconds);
+#else
+	gmtime_r(&seconds, &utc);
+#endif
+	char buff[64];
+	size_t len = strftime(buff, sizeof(buff), "%Y-%m-%dT%H:%M:%S", &utc);
+	snprintf(buff + len, sizeof(buff) - len, ".%06uZ %s [%u] ", (unsigned) ((record.timestamp / 1000) % 1000000), getLevelName(record.level), (unsigned) record.thread);
+
+	out << buff;
+	out.write(record.text, (std::streamsize) record.length);
+	out << '\n';
+}
+
+const char *LuaLogger::getLevelName(LuaLogLevel level) {
+	size_t idx = (size_t) level;
+	return idx < sizeof(levelNames) / sizeof(levelNames[0]) ? levelNames[idx] : "UNKNOWN";
+}
+
+bool LuaLogger::ParseLevel(const char *name, LuaLogLevel &level) {
+	for (size_t i = 0; i < sizeof(levelNames) / sizeof(levelNames[0]); i++) {
+		const char *n = levelNames[i];
+		const char *c = name;
+		while (*n != '\0' && toupper((unsigned char) *c) == *n) {
+			n++;
+			c++;
+		}
+		if (*n == '\0' && *c == '\0') {
+			level = (LuaLogLevel) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void LuaLogger::setDefault(std::shared_ptr<LuaLogger> logger) {
+	std::lock_guard<std::mutex> lock(defaultMutex);
+	defaultLogger = std::move(logger);
+}
+
+std::shared_ptr<LuaLogger> LuaLogger::getDefault() {
+	std::lock_guard<std::mutex> lock(defaultMutex);
+	return defaultLogger;
+}
@@ -0,0 +1,244 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUALOGGER_HPP
+#define LUACPP_LUALOGGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Size of the text of a log record, the longer texts are truncated
+ */
+#define LUACPP_LOG_RECORD_SIZE 512
+
+/**
+ * @brief Default number of the records that each thread can buffer
+ */
+#define LUACPP_LOG_DEFAULT_CAPACITY 1024
+
+namespace LuaCpp {
+	namespace Diagnostics {
+
+		/**
+		 * @brief Severity of the log record
+		 */
+		enum class LuaLogLevel : uint8_t {
+			Trace = 0,
+			Debug = 1,
+			Info = 2,
+			Warn = 3,
+			Error = 4
+		};
+
+		/**
+		 * @brief Structured field of the log record
+		 *
+		 * @details
+		 * The key is a plain identifier, the value can be any text and is
+		 * quoted in the record when needed.
+		 */
+		struct LuaLogField {
+			const char *key;
+			const char *value;
+			size_t length;
+		};
+
+		/**
+		 * @brief Log record passed to the sink
+		 *
+		 * @details
+		 * The `text` is the message followed by the fields in the `key=value`
+		 * format, and is valid only during the call to the sink. The 
+		 * `timestamp` is in nanoseconds since the Unix epoch, the `thread` is
+		 * the number of the logging thread assigned by the logger.
+		 */
+		struct LuaLogRecord {
+			LuaLogLevel level;
+			uint64_t timestamp;
+			uint32_t thread;
+			const char *text;
+			size_t length;
+		};
+
+		/**
+		 * @brief Logger which never blocks the logging threads
+		 *
+		 * @details
+		 * Each thread writes its records into its own ring buffer, with no
+		 * locks and no allocations after the first record of the thread. A
+		 * background thread takes the records from the rings and passes them
+		 * to the sink. When the ring of a thread is full, the records are 
+		 * dropped and counted, so a slow sink never stalls the callers.
+		 *
+		 * The records of one thread reach the sink in order, the records of
+		 * different threads are interleaved. The ring of a thread is released
+		 * once the thread has exited and its records are written. The 
+		 * destructor writes the remaining records, stops the writer and 
+		 * releases the rings of the threads still running.
+		 *
+		 * The default logger, when set, also receives the errors reported
+		 * by LuaContext.
+		 */
+		class LuaLogger {
+		   public:
+			typedef std::function<void(const LuaLogRecord &)> Sink;
+
+		   private:
+			struct Ring;
+
+			uint64_t id;
+			Sink sink;
+			size_t capacity;
+			std::atomic<uint8_t> level;
+			std::atomic<uint64_t> dropped;
+
+			std::mutex ringsMutex;
+			std::vector<std::shared_ptr<Ring>> rings;
+			// changes when a ring is added or removed
+			uint64_t ringsVersion;
+			uint32_t threads;
+
+			std::mutex writerMutex;
+			std::condition_variable wake;
+			std::condition_variable drained;
+			bool running;
+			std::thread writer;
+
+			Ring &getThreadRing();
+			bool Drain(std::vector<std::shared_ptr<Ring>> &local, uint64_t &version);
+			void Write();
+
+		   public:
+			/**
+			 * @brief Creates the logger passing the records to the sink
+			 *
+			 * @param sink the sink, called on the thread of the writer
+			 * @param capacity the number of the records buffered by each thread
+			 */
+			explicit LuaLogger(Sink sink, size_t capacity = LUACPP_LOG_DEFAULT_CAPACITY);
+
+			/**
+			 * @brief Creates the logger writing the records as lines to the stream
+			 *
+			 * @see WriteRecord()
+			 */
+			explicit LuaLogger(std::ostream &out, size_t capacity = LUACPP_LOG_DEFAULT_CAPACITY);
+
+			LuaLogger(const LuaLogger &) = delete;
+			LuaLogger &operator=(const LuaLogger &) = delete;
+
+			/**
+			 * @brief Writes the buffered records and stops the writer
+			 */
+			~LuaLogger();
+
+			/**
+			 * @brief Logs the message with the fields
+			 *
+			 * @param level the severity
+			 * @param message the message
+			 * @param length the length of the message
+			 * @param fields the fields, or `nullptr`
+			 * @param count the number of the fields
+			 * @return `false` if the record was filtered out or dropped
+			 */
+			bool Log(LuaLogLevel level, const char *message, size_t length, const LuaLogField *fields = nullptr, size_t count = 0);
+
+			/**
+			 * @brief Logs the null terminated message
+			 */
+			bool Log(LuaLogLevel level, const char *message);
+
+			/**
+			 * @brief Waits until the records logged before the call are passed to the sink
+			 */
+			void Flush();
+
+			/**
+			 * @brief Sets the lowest level that is logged, `Info` by default
+			 */
+			inline void setLevel(LuaLogLevel _level) { level.store((uint8_t) _level, std::memory_order_relaxed); }
+
+			/**
+			 * @brief Returns the lowest level that is logged
+			 */
+			inline LuaLogLevel getLevel() const { return (LuaLogLevel) level.load(std::memory_order_relaxed); }
+
+			/**
+			 * @brief Check if the records of the level are logged
+			 */
+			inline bool isEnabled(LuaLogLevel _level) const { return (uint8_t) _level >= level.load(std::memory_order_relaxed); }
+
+			/**
+			 * @brief Returns the number of the records dropped because a ring was full
+			 */
+			inline uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+			/**
+			 * @brief Returns the number of the rings not yet released
+			 */
+			size_t getRingCount();
+
+			/**
+			 * @brief Writes the record as a line with the time, the level and the thread
+			 *
+			 * @details
+			 * Ex. `2024-01-02T03:04:05.678901Z INFO [1] message key=value`
+			 */
+			static void WriteRecord(std::ostream &out, const LuaLogRecord &record);
+
+			/**
+			 * @brief Returns the upper case name of the level
+			 */
+			static const char *getLevelName(LuaLogLevel level);
+
+			/**
+			 * @brief Parses the name of the level, ignoring the case
+			 *
+			 * @return `false` if the name is not known
+			 */
+			static bool ParseLevel(const char *name, LuaLogLevel &level);
+
+			/**
+			 * @brief Sets the default logger, `nullptr` removes it
+			 */
+			static void setDefault(std::shared_ptr<LuaLogger> logger);
+
+			/**
+			 * @brief Returns the default logger, `nullptr` if there is none
+			 */
+			static std::shared_ptr<LuaLogger> getDefault();
+		};
+	}
+}
+
+#endif // LUACPP_LUALOGGER_HPP
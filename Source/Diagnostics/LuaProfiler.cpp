@@ -0,0 +1,465 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <new>
+
+#include "LuaProfiler.hpp"
+
+using namespace LuaCpp::Diagnostics;
+using namespace LuaCpp::Engine;
+
+namespace {
+	const char sessionKey = 0;
+
+	uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	LuaProfiler::Session *getSession(lua_State *L) {
+		lua_pushlightuserdata(L, (void *) &sessionKey);
+		lua_rawget(L, LUA_REGISTRYINDEX);
+		LuaProfiler::Session *session = (LuaProfiler::Session *) lua_touserdata(L, -1);
+		lua_pop(L, 1);
+		return session;
+	}
+
+	/**
+	 * @brief Finishes the session that was not detached when the state is closed
+	 */
+	int collectSession(lua_State *L) {
+		LuaProfiler::Session *session = (LuaProfiler::Session *) lua_touserdata(L, 1);
+		if (session->profiler != NULL) {
+			session->profiler->Finish(*session);
+		}
+		session->~Session();
+		return 0;
+	}
+
+	/**
+	 * @brief Creates the session as a userdata in the registry, so it is finished with the state
+	 */
+	LuaProfiler::Session *newSession(lua_State *L, LuaProfiler *profiler, const std::string &snippet, uint64_t generation) {
+		lua_pushlightuserdata(L, (void *) &sessionKey);
+		void *storage = lua_newuserdata(L, sizeof(LuaProfiler::Session));
+		lua_createtable(L, 0, 1);
+		lua_pushcfunction(L, collectSession);
+		lua_setfield(L, -2, "__gc");
+		LuaProfiler::Session *session = new (storage) LuaProfiler::Session(profiler, snippet, generation);
+		lua_setmetatable(L, -2);
+		lua_rawset(L, LUA_REGISTRYINDEX);
+		return session;
+	}
+
+	void removeSession(lua_State *L) {
+		lua_pushlightuserdata(L, (void *) &sessionKey);
+		lua_pushnil(L);
+		lua_rawset(L, LUA_REGISTRYINDEX);
+	}
+}
+
+extern "C" {
+	static void profiler_hook(lua_State *L, lua_Debug *ar) {
+		LuaProfiler::Session *session = getSession(L);
+		if (session != NULL) {
+			session->profiler->OnHook(*session, L, ar);
+		}
+	}
+}
+
+void LuaProfiler::Attach(LuaState &L, const std::string &snippet) {
+	lua_Hook hook = lua_gethook(L);
+	int hookMask = lua_gethookmask(L);
+	int hookCount = lua_gethookcount(L);
+	Session *previous = getSession(L);
+	if (previous != NULL) {
+		// restarted, keep the hook from before the first attach
+		hook = previous->hook;
+		hookMask = previous->hookMask;
+		hookCount = previous->hookCount;
+		if (previous->profiler != NULL) {
+			previous->profiler->Finish(*previous);
+		}
+	}
+
+	uint64_t current;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current = generation;
+	}
+	Session *session = newSession(L, this, snippet, current);
+	session->hook = hook;
+	session->hookMask = hookMask;
+	session->hookCount = hookCount;
+#ifdef LUACPP_LUAJIT
+	// the hooks are not called from the compiled code
+	luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+#endif
+	lua_sethook(L, profiler_hook, LUA_MASKCALL | LUA_MASKRET, 0);
+}
+
+void LuaProfiler::Detach(LuaState &L) {
+	Session *session = getSession(L);
+	lua_Hook hook = session != NULL ? session->hook : NULL;
+	if (hook != NULL) {
+		lua_sethook(L, hook, session->hookMask, session->hookCount);
+	} else {
+		lua_sethook(L, NULL, 0, 0);
+#ifdef LUACPP_LUAJIT
+		// the compiler stays off for the hooks installed before the profiler
+		luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON);
+#endif
+	}
+
+	if (session != NULL && session->profiler != NULL) {
+		session->profiler->Finish(*session);
+	}
+	removeSession(L);
+}
+
+void LuaProfiler::Finish(Session &session) {
+	uint64_t end = now();
+	for (auto &stack : session.stacks) {
+		_closeFrames(stack.second, 0, end);
+	}
+	session.stacks.clear();
+	session.profiler = NULL;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (session.generation != generation) {
+		return;
+	}
+	std::unique_ptr<Node> &root = snippets[session.snippet];
+	if (!root) {
+		root = std::make_unique<Node>(-1);
+	}
+
+	// the functions of the session are numbered again in the profile
+	std::vector<int> ids;
+	ids.reserve(session.functions.size());
+	for (auto &function : session.functions) {
+		auto found = functionKeys.find(function.first);
+		if (found != functionKeys.end()) {
+			ids.push_back(found->second);
+			continue;
+		}
+		int id = (int) functions.size();
+		functions.push_back(std::move(function.second));
+		functionKeys[function.first] = id;
+		ids.push_back(id);
+	}
+	_merge(session.root, *root, ids);
+}
+
+void LuaProfiler::_merge(const Node &from, Node &to, const std::vector<int> &ids) {
+	for (const auto &pair : from.children) {
+		int id = ids[pair.first];
+		std::unique_ptr<Node> &child = to.children[id];
+		if (!child) {
+			child = std::make_unique<Node>(id);
+		}
+		child->calls += pair.second->calls;
+		child->inclusive += pair.second->inclusive;
+		_merge(*pair.second, *child, ids);
+	}
+}
+
+int LuaProfiler::_getFunctionId(Session &session, lua_State *L, lua_Debug *ar) {
+	lua_getinfo(L, "Snfu", ar);
+	const void *ptr;
+	int line;
+	if (ar->what != NULL && ar->what[0] == 'C') {
+		// the C closures share their function with the other closures of
+		// the same binding type (ex. the trampolines of the instrumented
+		// bindings), so they are told apart by the closure
+		ptr = ar->nups > 0 ? lua_topointer(L, -1) : (const void *) lua_tocfunction(L, -1);
+		line = -1;
+	} else {
+		ptr = (const void *) ar->source;
+		line = ar->linedefined;
+	}
+
+	// The source pointer is only valid while the state is alive, so the
+	// fast lookup is kept in the session and the function is identified
+	// by its description on the first call in each state
+	std::pair<const void *, int> ptrKey(ptr, line);
+	auto it = session.functionIds.find(ptrKey);
+	if (it != session.functionIds.end()) {
+		lua_pop(L, 1);
+		return it->second;
+	}
+
+	char cfunction[32];
+	std::string key;
+	if (line < 0) {
+		snprintf(cfunction, sizeof(cfunction), "%p", (void *) lua_tocfunction(L, -1));
+		key = std::string("[C]\n") + cfunction;
+		if (ar->nups > 0) {
+			// the closure is identified in the other states by its name and
+			// the upvalues that are the same in all states
+			key += std::string("\n") + (ar->name != NULL ? ar->name : "");
+			for (int i = 1; i <= ar->nups; i++) {
+				lua_getupvalue(L, -1, i);
+				const void *upvalue = NULL;
+				if (lua_islightuserdata(L, -1)) {
+					upvalue = lua_touserdata(L, -1);
+				} else if (lua_iscfunction(L, -1)) {
+					// only the functions without the upvalues are the same in all states
+					if (lua_getupvalue(L, -1, 1) != NULL) {
+						lua_pop(L, 1);
+					} else {
+						upvalue = (const void *) lua_tocfunction(L, -1);
+					}
+				}
+				lua_pop(L, 1);
+				if (upvalue != NULL) {
+					char buff[32];
+					snprintf(buff, sizeof(buff), "\n%p", upvalue);
+					key += buff;
+				}
+			}
+		}
+	} else {
+		key = std::string(ar->source) + "\n" + std::to_string(line);
+	}
+	lua_pop(L, 1);
+
+	Function fn;
+	fn.line = line < 0 ? 0 : line;
+	fn.source = line < 0 ? "[C]" : ar->short_src;
+	if (ar->name != NULL) {
+		fn.name = ar->name;
+	} else if (ar->what != NULL && std::string(ar->what) == "main") {
+		fn.name = "main chunk";
+	} else if (line < 0) {
+		fn.name = cfunction;
+	} else {
+		fn.name = fn.source + ":" + std::to_string(fn.line);
+	}
+
+	int id = (int) session.functions.size();
+	session.functions.emplace_back(std::move(key), std::move(fn));
+	session.functionIds[ptrKey] = id;
+	return id;
+}
+
+void LuaProfiler::_closeFrames(std::vector<Frame> &stack, size_t depth, uint64_t end) {
+	while (stack.size() > depth) {
+		Frame &frame = stack.back();
+		frame.node->inclusive += end - frame.start;
+		stack.pop_back();
+	}
+}
+
+void LuaProfiler::OnHook(Session &session, lua_State *L, lua_Debug *ar) {
+	uint64_t start = now();
+	std::vector<Frame> &stack = session.stacks[L];
+
+#ifdef LUA_HOOKTAILRET
+	if (ar->event == LUA_HOOKTAILRET) {
+		// the return of a frame replaced by a tail call (Lua 5.1 and LuaJIT)
+		if (!stack.empty()) {
+			_closeFrames(stack, stack.size() - 1, start);
+		}
+		return;
+	}
+#endif
+
+	int id = _getFunctionId(session, L, ar);
+
+	if (ar->event == LUA_HOOKRET) {
+		for (size_t i = stack.size(); i > 0; i--) {
+			if (stack[i - 1].node->function == id) {
+				// frames above the returning function were unwound by an error
+				_closeFrames(stack, i - 1, start);
+				break;
+			}
+		}
+		return;
+	}
+
+#ifdef LUA_HOOKTAILCALL
+	if (ar->event == LUA_HOOKTAILCALL && !stack.empty()) {
+		_closeFrames(stack, stack.size() - 1, start);
+	}
+#endif
+
+	Node *parent = stack.empty() ? &session.root : stack.back().node;
+	std::unique_ptr<Node> &child = parent->children[id];
+	if (!child) {
+		child = std::make_unique<Node>(id);
+	}
+	child->calls++;
+
+	Frame frame;
+	frame.node = child.get();
+	frame.start = now();
+	stack.push_back(frame);
+}
+
+std::vector<std::string> LuaProfiler::getSnippets() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::string> names;
+	for (const auto &snippet : snippets) {
+		names.push_back(snippet.first);
+	}
+	return names;
+}
+
+void LuaProfiler::_aggregate(const Node &node, std::map<int, LuaProfileEntry> &entries) const {
+	for (const auto &pair : node.children) {
+		const Node &child = *pair.second;
+		uint64_t children = 0;
+		for (const auto &grandchild : child.children) {
+			children += grandchild.second->inclusive;
+		}
+
+		LuaProfileEntry &entry = entries[child.function];
+		if (entry.calls == 0 && entry.inclusive == 0) {
+			const Function &fn = functions[child.function];
+			entry.name = fn.name;
+			entry.source = fn.source;
+			entry.line = fn.line;
+		}
+		entry.calls += child.calls;
+		entry.inclusive += child.inclusive;
+		entry.exclusive += child.inclusive > children ? child.inclusive - children : 0;
+
+		_aggregate(child, entries);
+	}
+}
+
+std::vector<LuaProfileEntry> LuaProfiler::getEntries(const std::string &snippet) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<LuaProfileEntry> result;
+
+	auto it = snippets.find(snippet);
+	if (it == snippets.end()) {
+		return result;
+	}
+
+	std::map<int, LuaProfileEntry> entries;
+	_aggregate(*it->second, entries);
+	for (auto &entry : entries) {
+		result.push_back(std::move(entry.second));
+	}
+	std::sort(result.begin(), result.end(), [](const LuaProfileEntry &a, const LuaProfileEntry &b) {
+		return a.exclusive > b.exclusive;
+	});
+	return result;
+}
+
+const LuaProfiler::Node *LuaProfiler::getCallTree(const std::string &snippet) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = snippets.find(snippet);
+	if (it == snippets.end()) {
+		return NULL;
+	}
+	return it->second.get();
+}
+
+const LuaProfiler::Function &LuaProfiler::getFunction(int id) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return functions.at(id);
+}
+
+void LuaProfiler::WriteReport(std::ostream &out) {
+	for (const auto &snippet : getSnippets()) {
+		out << "Snippet: " << snippet << "\n";
+		out << std::setw(10) << "calls" << std::setw(16) << "inclusive(us)" << std::setw(16) << "exclusive(us)" << "  function\n";
+		for (const auto &entry : getEntries(snippet)) {
+			out << std::setw(10) << entry.calls
+			    << std::setw(16) << entry.inclusive / 1000
+			    << std::setw(16) << entry.exclusive / 1000
+			    << "  " << entry.name << " (" << entry.source << ":" << entry.line << ")\n";
+		}
+		out << "\n";
+	}
+}
+
+namespace {
+	typedef std::map<int, std::pair<uint64_t, uint64_t>> CallMap;
+
+	void collectCalls(const LuaProfiler::Node &node, std::map<int, uint64_t> &self, std::map<int, CallMap> &calls) {
+		for (const auto &pair : node.children) {
+			const LuaProfiler::Node &child = *pair.second;
+			uint64_t children = 0;
+			for (const auto &grandchild : child.children) {
+				children += grandchild.second->inclusive;
+				std::pair<uint64_t, uint64_t> &edge = calls[child.function][grandchild.first];
+				edge.first += grandchild.second->calls;
+				edge.second += grandchild.second->inclusive;
+			}
+			self[child.function] += child.inclusive > children ? child.inclusive - children : 0;
+			collectCalls(child, self, calls);
+		}
+	}
+}
+
+void LuaProfiler::WriteCallgrind(std::ostream &out, const std::string &snippet) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	out << "# callgrind format\n";
+	out << "version: 1\n";
+	out << "creator: LuaCpp\n";
+	out << "cmd: " << snippet << "\n";
+	out << "positions: line\n";
+	out << "events: Nanoseconds\n\n";
+
+	auto it = snippets.find(snippet);
+	if (it == snippets.end()) {
+		return;
+	}
+
+	std::map<int, uint64_t> self;
+	std::map<int, CallMap> calls;
+	collectCalls(*it->second, self, calls);
+
+	for (const auto &pair : self) {
+		const Function &fn = functions[pair.first];
+		out << "fl=" << fn.source << "\n";
+		out << "fn=" << fn.name << "\n";
+		out << fn.line << " " << pair.second << "\n";
+		for (const auto &edge : calls[pair.first]) {
+			const Function &callee = functions[edge.first];
+			out << "cfl=" << callee.source << "\n";
+			out << "cfn=" << callee.name << "\n";
+			out << "calls=" << edge.second.first << " " << callee.line << "\n";
+			out << fn.line << " " << edge.second.second << "\n";
+		}
+		out << "\n";
+	}
+}
+
+void LuaProfiler::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	// the sessions attached before are dropped when they finish
+	generation++;
+	for (auto &snippet : snippets) {
+		snippet.second->children.clear();
+	}
+}
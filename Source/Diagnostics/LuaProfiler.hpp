@@ -0,0 +1,248 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAPROFILER_HPP
+#define LUACPP_LUAPROFILER_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../Lua.hpp"
+#include "../Engine/LuaState.hpp"
+
+namespace LuaCpp {
+	namespace Diagnostics {
+
+		/**
+		 * @brief Flat profile of a single function
+		 *
+		 * @details
+		 * Aggregated information for a function over the whole call tree
+		 * of the snippet. The times are in nanoseconds.
+		 */
+		struct LuaProfileEntry {
+			std::string name;
+			std::string source;
+			int line;
+			uint64_t calls;
+			uint64_t inclusive;
+			uint64_t exclusive;
+		};
+
+		/**
+		 * @brief Deterministic call-graph profiler
+		 *
+		 * @details
+		 * The profiler installs a call/return hook on the state and builds
+		 * a call tree per snippet. Each node of the tree counts the calls
+		 * and measures the inclusive time of the function in the call path.
+		 * The exclusive time is the inclusive time without the time spent
+		 * in the called functions.
+		 *
+		 * The Lua functions are identified by the source and the line where
+		 * they are defined (`lua_getinfo` fields `source` and `linedefined`).
+		 * The `C` functions, including the ones registered by the LuaLibrary,
+		 * are identified by the function pointer and reported under the name 
+		 * used in the call.
+		 *
+		 * The results can be reported as a table sorted by the exclusive time, 
+		 * or in callgrind format that can be opened in KCachegrind.
+		 *
+		 * The profiler uses the hook of the state, so it replaces the hooks
+		 * added with `LuaContext::addHook()` and the call tracing of the `LuaTracer`.
+		 * The time of a coroutine that is suspended is accounted to the functions
+		 * that are active in the coroutine.
+		 */
+		class LuaProfiler {
+		   public:
+			struct Function {
+				std::string name;
+				std::string source;
+				int line;
+			};
+
+			struct Node {
+				int function;
+				uint64_t calls;
+				uint64_t inclusive;
+				std::map<int, std::unique_ptr<Node>> children;
+
+				explicit Node(int _function) : function(_function), calls(0), inclusive(0), children() {}
+			};
+
+			struct Frame {
+				Node *node;
+				uint64_t start;
+			};
+
+			/**
+			 * @brief Profile of one state, kept in the registry of the state
+			 *
+			 * @details
+			 * The hook builds the call tree of the session without a lock, the 
+			 * functions are numbered in the session and identified by their
+			 * key when the tree is merged into the profile of the snippet.
+			 */
+			struct Session {
+				LuaProfiler *profiler;
+				std::string snippet;
+				uint64_t generation;
+				Node root;
+				std::vector<std::pair<std::string, Function>> functions;
+				std::map<lua_State *, std::vector<Frame>> stacks;
+				std::map<std::pair<const void *, int>, int> functionIds;
+				// the hook replaced by the profiler, restored on detach
+				lua_Hook hook;
+				int hookMask;
+				int hookCount;
+
+				Session(LuaProfiler *_profiler, std::string _snippet, uint64_t _generation) : profiler(_profiler), snippet(std::move(_snippet)), generation(_generation), root(-1), functions(), stacks(), functionIds(), hook(NULL), hookMask(0), hookCount(0) {}
+			};
+
+		   private:
+			std::mutex mutex;
+			std::vector<Function> functions;
+			std::map<std::string, int> functionKeys;
+			std::map<std::string, std::unique_ptr<Node>> snippets;
+			uint64_t generation;
+
+			int _getFunctionId(Session &session, lua_State *L, lua_Debug *ar);
+			void _closeFrames(std::vector<Frame> &stack, size_t depth, uint64_t now);
+			void _merge(const Node &from, Node &to, const std::vector<int> &ids);
+			void _aggregate(const Node &node, std::map<int, LuaProfileEntry> &entries) const;
+
+		   public:
+			LuaProfiler() : mutex(), functions(), functionKeys(), snippets(), generation(0) {}
+			~LuaProfiler() {}
+
+			/**
+			 * @brief Starts profiling the state
+			 *
+			 * @details
+			 * Installs the call/return hook on the state. The calls made from
+			 * the state are added to the call tree of the snippet when the 
+			 * profiler is detached or the state is closed. Calling the method
+			 * again for the same state restarts the profiling.
+			 *
+			 * The profiler should be detached, or remain alive, until the state
+			 * is closed.
+			 *
+			 * @param L State that will be profiled
+			 * @param snippet Name of the snippet under which the calls will be reported
+			 */
+			void Attach(Engine::LuaState &L, const std::string &snippet);
+
+			/**
+			 * @brief Stops profiling the state
+			 *
+			 * @details
+			 * Restores the hook that was installed before the profiler was
+			 * attached and closes the functions that are still active. With
+			 * LuaJIT the compiler is turned back on only when no hook remains.
+			 *
+			 * @param L State that is profiled
+			 */
+			void Detach(Engine::LuaState &L);
+
+			/**
+			 * @brief Hook handler
+			 *
+			 * @details
+			 * Called from the `C` hook installed on the state
+			 */
+			void OnHook(Session &session, lua_State *L, lua_Debug *ar);
+
+			/**
+			 * @brief Adds the call tree of the session to the profile of the snippet
+			 * @details
+			 * Called when the state is detached or closed, the functions that
+			 * are still active are closed.
+			 */
+			void Finish(Session &session);
+
+			/**
+			 * @brief Returns the names of the profiled snippets
+			 */
+			std::vector<std::string> getSnippets();
+
+			/**
+			 * @brief Returns the flat profile of a snippet
+			 *
+			 * @details
+			 * Returns the functions called from the snippet, sorted by the exclusive
+			 * time. The inclusive time of recursive functions contains the time of each 
+			 * active call.
+			 *
+			 * @param snippet Name of the snippet
+			 */
+			std::vector<LuaProfileEntry> getEntries(const std::string &snippet);
+
+			/**
+			 * @brief Returns the root of the call tree of the snippet
+			 *
+			 * @details
+			 * Returns the root of the call tree or NULL if the snippet was not profiled.
+			 * The root is not a function, the children of the root are the functions
+			 * called from the host.
+			 */
+			const Node *getCallTree(const std::string &snippet);
+
+			/**
+			 * @brief Returns the function identified in the call tree
+			 */
+			const Function &getFunction(int id);
+
+			/**
+			 * @brief Writes a table with the flat profile of all snippets
+			 *
+			 * @param out Stream where the report will be written
+			 */
+			void WriteReport(std::ostream &out);
+
+			/**
+			 * @brief Writes the profile of the snippet in callgrind format
+			 *
+			 * @param out Stream where the profile will be written
+			 * @param snippet Name of the snippet
+			 */
+			void WriteCallgrind(std::ostream &out, const std::string &snippet);
+
+			/**
+			 * @brief Removes the collected profiles
+			 *
+			 * @details
+			 * Resets the call trees of all snippets. The states that are attached
+			 * at the time of the call are not reported.
+			 */
+			void Clear();
+		};
+	}
+}
+
+#endif // LUACPP_LUAPROFILER_HPP
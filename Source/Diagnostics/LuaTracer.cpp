@@ -0,0 +1,318 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "LuaTracer.hpp"
+
+// the events are allocated in blocks, as the buffer fills up
+#define LUACPP_TRACE_BLOCK_SIZE 1024
+
+using namespace LuaCpp::Diagnostics;
+using namespace LuaCpp::Engine;
+
+namespace {
+	/**
+	 * Buffer owned by a single thread. Only the owning thread writes
+	 * the events, allocating the blocks as needed, and publishes them
+	 * by incrementing the `count`.
+	 */
+	struct TraceBuffer {
+		std::unique_ptr<std::unique_ptr<LuaTraceEvent[]>[]> blocks;
+		size_t capacity;
+		std::atomic<size_t> count;
+		std::atomic<size_t> dropped;
+		// the recorded begin events not yet ended, their end events have reserved room
+		std::atomic<size_t> open;
+		// the begin events dropped and not yet ended
+		std::atomic<size_t> skipped;
+		uint32_t tid;
+		bool ended;
+
+		TraceBuffer(size_t _capacity, uint32_t _tid)
+			: blocks(new std::unique_ptr<LuaTraceEvent[]>[(_capacity + LUACPP_TRACE_BLOCK_SIZE - 1) / LUACPP_TRACE_BLOCK_SIZE]),
+			  capacity(_capacity), count(0), dropped(0), open(0), skipped(0), tid(_tid), ended(false) {}
+
+		LuaTraceEvent &at(size_t idx) const {
+			return blocks[idx / LUACPP_TRACE_BLOCK_SIZE][idx % LUACPP_TRACE_BLOCK_SIZE];
+		}
+	};
+
+	std::mutex buffersMutex;
+	std::vector<std::shared_ptr<TraceBuffer>> buffers;
+	uint32_t nextTid = 1;
+	std::atomic<size_t> bufferCapacity(LUACPP_TRACE_DEFAULT_CAPACITY);
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	/**
+	 * Registers the buffer of the thread, and marks it ended when the
+	 * thread exits. The events of the ended threads are kept until the
+	 * buffers are cleared.
+	 */
+	struct ThreadBuffer {
+		std::shared_ptr<TraceBuffer> buffer;
+
+		~ThreadBuffer() {
+			if (!buffer) {
+				return;
+			}
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			buffer->ended = true;
+			if (buffer->count.load() == 0) {
+				for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+					if (*it == buffer) {
+						buffers.erase(it);
+						break;
+					}
+				}
+			}
+		}
+	};
+
+	TraceBuffer &threadBuffer() {
+		thread_local ThreadBuffer local;
+		if (!local.buffer) {
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			local.buffer = std::make_shared<TraceBuffer>(bufferCapacity.load(), nextTid++);
+			buffers.push_back(local.buffer);
+		}
+		return *local.buffer;
+	}
+
+	void writeEscaped(std::ostream &out, const char *str) {
+		for (const char *c = str; *c != '\0'; c++) {
+			switch (*c) {
+				case '"': out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n"; break;
+				case '\t': out << "\\t"; break;
+				default:
+					if ((unsigned char) *c >= 0x20) {
+						out << *c;
+					}
+			}
+		}
+	}
+
+	void writeMicroseconds(std::ostream &out, uint64_t ns) {
+		char buff[32];
+		snprintf(buff, sizeof(buff), "%llu.%03llu", (unsigned long long) (ns / 1000), (unsigned long long) (ns % 1000));
+		out << buff;
+	}
+}
+
+std::atomic<bool> LuaTracer::enabled(false);
+std::atomic<bool> LuaTracer::luaCalls(false);
+
+void LuaTracer::Enable(size_t capacity) {
+	bufferCapacity.store(capacity > 0 ? capacity : 1);
+	enabled.store(true);
+}
+
+void LuaTracer::Disable() {
+	enabled.store(false);
+}
+
+void LuaTracer::setTraceLuaCalls(bool trace) {
+	luaCalls.store(trace);
+}
+
+uint64_t LuaTracer::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void LuaTracer::Record(char phase, const char *name, const char *category, uint64_t timestamp, uint64_t duration, const char *label) {
+	TraceBuffer &buffer = threadBuffer();
+	size_t idx = buffer.count.load(std::memory_order_relaxed);
+	size_t open = buffer.open.load(std::memory_order_relaxed);
+	if (phase == 'E') {
+		size_t skipped = buffer.skipped.load(std::memory_order_relaxed);
+		if (skipped > 0) {
+			// the end of a dropped begin
+			buffer.skipped.store(skipped - 1, std::memory_order_relaxed);
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (open == 0) {
+			// begun before the buffer was cleared
+			return;
+		}
+		buffer.open.store(open - 1, std::memory_order_relaxed);
+	} else if (idx + open + (phase == 'B' ? 1 : 0) >= buffer.capacity) {
+		// the room left is reserved for the end events of the open spans
+		if (phase == 'B') {
+			buffer.skipped.fetch_add(1, std::memory_order_relaxed);
+		}
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	} else if (phase == 'B') {
+		buffer.open.store(open + 1, std::memory_order_relaxed);
+	}
+
+	std::unique_ptr<LuaTraceEvent[]> &block = buffer.blocks[idx / LUACPP_TRACE_BLOCK_SIZE];
+	if (!block) {
+		block.reset(new LuaTraceEvent[LUACPP_TRACE_BLOCK_SIZE]);
+	}
+	LuaTraceEvent &event = block[idx % LUACPP_TRACE_BLOCK_SIZE];
+	event.name = name;
+	event.category = category;
+	event.phase = phase;
+	event.timestamp = timestamp;
+	event.duration = duration;
+	if (label != NULL) {
+		strncpy(event.label, label, LUACPP_TRACE_LABEL_SIZE - 1);
+		event.label[LUACPP_TRACE_LABEL_SIZE - 1] = '\0';
+	} else {
+		event.label[0] = '\0';
+	}
+
+	buffer.count.store(idx + 1, std::memory_order_release);
+}
+
+void LuaTracer::WriteChromeTrace(std::ostream &out) {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool add_comma = false;
+	for (const auto &buffer : buffers) {
+		size_t count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++) {
+			const LuaTraceEvent &event = buffer->at(i);
+			if (add_comma) {
+				out << ",\n";
+			} else {
+				add_comma = true;
+			}
+			out << "{\"name\":\"";
+			writeEscaped(out, event.name != NULL ? event.name : event.label);
+			out << "\",\"cat\":\"";
+			writeEscaped(out, event.category != NULL ? event.category : "");
+			out << "\",\"ph\":\"" << event.phase << "\",\"ts\":";
+			writeMicroseconds(out, event.timestamp);
+			if (event.phase == 'X') {
+				out << ",\"dur\":";
+				writeMicroseconds(out, event.duration);
+			}
+			out << ",\"pid\":1,\"tid\":" << buffer->tid;
+			if (event.name != NULL && event.label[0] != '\0') {
+				out << ",\"args\":{\"detail\":\"";
+				writeEscaped(out, event.label);
+				out << "\"}";
+			}
+			out << "}";
+		}
+	}
+	out << "]}\n";
+}
+
+void LuaTracer::Clear() {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	// the buffers of the ended threads are released
+	std::vector<std::shared_ptr<TraceBuffer>> live;
+	for (const auto &buffer : buffers) {
+		if (buffer->ended) {
+			continue;
+		}
+		buffer->count.store(0);
+		buffer->dropped.store(0);
+		buffer->open.store(0);
+		buffer->skipped.store(0);
+		live.push_back(buffer);
+	}
+	buffers.swap(live);
+}
+
+size_t LuaTracer::getEventCount() {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	size_t total = 0;
+	for (const auto &buffer : buffers) {
+		total += buffer->count.load(std::memory_order_acquire);
+	}
+	return total;
+}
+
+size_t LuaTracer::getDroppedCount() {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	size_t total = 0;
+	for (const auto &buffer : buffers) {
+		total += buffer->dropped.load();
+	}
+	return total;
+}
+
+extern "C" {
+	static void trace_hook(lua_State *L, lua_Debug *ar) {
+		if (!LuaTracer::isEnabled()) {
+			return;
+		}
+		uint64_t now = LuaTracer::Now();
+
+		if (ar->event == LUA_HOOKRET) {
+			LuaTracer::Record('E', NULL, "lua", now, 0, "");
+			return;
+		}
+
+#ifdef LUA_HOOKTAILRET
+		if (ar->event == LUA_HOOKTAILRET) {
+			// The return of a frame replaced by a tail call (Lua 5.1 and LuaJIT)
+			LuaTracer::Record('E', NULL, "lua", now, 0, "");
+			return;
+		}
+#endif
+
+#ifdef LUA_HOOKTAILCALL
+		if (ar->event == LUA_HOOKTAILCALL) {
+			// The tail call replaces the frame of the caller, which will not return
+			LuaTracer::Record('E', NULL, "lua", now, 0, "");
+		}
+#endif
+
+		char label[LUACPP_TRACE_LABEL_SIZE];
+		int length;
+		lua_getinfo(L, "Sn", ar);
+		if (ar->name != NULL) {
+			length = snprintf(label, sizeof(label), "%s (%s:%d)", ar->name, ar->short_src, ar->linedefined);
+		} else {
+			length = snprintf(label, sizeof(label), "%s:%d", ar->short_src, ar->linedefined);
+		}
+		if (length >= (int) sizeof(label)) {
+			// the long labels are cut, the end is marked
+			memcpy(label + sizeof(label) - 4, "...", 4);
+		}
+		LuaTracer::Record('B', NULL, "lua", now, 0, label);
+	}
+}
+
+void LuaTracer::AttachLuaCalls(LuaState &L) {
+#ifdef LUACPP_LUAJIT
+	// the hooks are not called from the compiled code
+	luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+#endif
+	lua_sethook(L, trace_hook, LUA_MASKCALL | LUA_MASKRET, 0);
+}
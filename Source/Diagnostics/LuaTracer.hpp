@@ -0,0 +1,251 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUATRACER_HPP
+#define LUACPP_LUATRACER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "../Lua.hpp"
+#include "../Engine/LuaState.hpp"
+
+/**
+ * @brief Size of the inline label stored with each trace event
+ */
+#define LUACPP_TRACE_LABEL_SIZE 64
+
+/**
+ * @brief Default number of events that each thread can buffer
+ */
+#define LUACPP_TRACE_DEFAULT_CAPACITY 65536
+
+namespace LuaCpp {
+	/**
+	 * @brief Diagnostic tools for the inspection of the LuaCpp execution
+	 */
+	namespace Diagnostics {
+
+		/**
+		 * @brief Single record in the trace buffer
+		 *
+		 * @details
+		 * The event is stored as a plain structure with inline label, so 
+		 * recording an event never allocates memory. The `name` and `category`
+		 * are expected to be string literals.
+		 */
+		struct LuaTraceEvent {
+			const char *name;
+			const char *category;
+			char phase;
+			uint64_t timestamp;
+			uint64_t duration;
+			char label[LUACPP_TRACE_LABEL_SIZE];
+		};
+
+		/**
+		 * @brief Process wide tracer producing Chrome trace-event output
+		 *
+		 * @details
+		 * The tracer records spans of the LuaCpp operations (compilation,
+		 * creation of the states, upload of the code, execution and 
+		 * registration of the libraries) in a buffer that is owned by the
+		 * thread that records the event. The recording thread is the only
+		 * writer of its buffer, so the recording is lock-free; the lock
+		 * is only taken when the buffer of the thread is created and when
+		 * the thread exits. The buffer grows in blocks up to its capacity.
+		 *
+		 * The buffers are written as Chrome trace JSON with `WriteChromeTrace()`
+		 * and the output can be loaded in `chrome://tracing` or Perfetto.
+		 *
+		 * Optionally, the entry and exit of the Lua functions can be traced with
+		 * the call hook (see `setTraceLuaCalls()`). The hook replaces the hooks
+		 * added with `LuaContext::addHook()` in the states created while the
+		 * option is active.
+		 *
+		 * The tracer is disabled by default and the cost of a span is a single
+		 * atomic load while the tracer is disabled.
+		 */
+		class LuaTracer {
+		   private:
+			static std::atomic<bool> enabled;
+			static std::atomic<bool> luaCalls;
+
+		   public:
+			/**
+			 * @brief Enables the recording of the events
+			 *
+			 * @details
+			 * Enables the recording. The `capacity` is the number of events 
+			 * that each thread can store before the events are dropped. The
+			 * capacity applies to the buffers of the threads that record their
+			 * first event after the call.
+			 *
+			 * @param capacity Number of events per thread
+			 */
+			static void Enable(size_t capacity = LUACPP_TRACE_DEFAULT_CAPACITY);
+
+			/**
+			 * @brief Disables the recording of the events
+			 *
+			 * @details
+			 * Disables the recording. The events that are already in the buffers
+			 * are kept until `Clear()` is called.
+			 */
+			static void Disable();
+
+			/**
+			 * @brief Returns true if the tracer is recording
+			 */
+			static inline bool isEnabled() {
+				return enabled.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * @brief Enables the tracing of the Lua function calls
+			 *
+			 * @details
+			 * When set, the states created by the LuaContext will have a 
+			 * call/return hook that records a span for every Lua and `C` function
+			 * called from the script.
+			 *
+			 * @param trace true to trace the Lua function calls
+			 */
+			static void setTraceLuaCalls(bool trace);
+
+			/**
+			 * @brief Returns true if the Lua function calls are traced
+			 */
+			static inline bool isTracingLuaCalls() {
+				return isEnabled() && luaCalls.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * @brief Installs the call hook on the state
+			 *
+			 * @details
+			 * Installs the call/return hook which records the Lua function
+			 * calls on the state. Any previously installed hook is replaced.
+			 *
+			 * @param L The state on which the hook will be installed
+			 */
+			static void AttachLuaCalls(Engine::LuaState &L);
+
+			/**
+			 * @brief Records an event in the buffer of the current thread
+			 *
+			 * @details
+			 * Records an event in the buffer of the calling thread. If the 
+			 * buffer is full, the event is dropped and counted. The room for
+			 * the end events of the recorded `B` events is reserved, so the
+			 * spans stay balanced: an `E` event is dropped together with its
+			 * `B` event, and an `E` event without a recorded `B` is ignored.
+			 *
+			 * @param phase Chrome trace phase (`X` complete, `B` begin, `E` end)
+			 * @param name Name of the event (string literal or NULL)
+			 * @param category Category of the event (string literal)
+			 * @param timestamp Start of the event in nanoseconds (see `Now()`)
+			 * @param duration Duration of the event in nanoseconds
+			 * @param label Optional label copied in the event
+			 */
+			static void Record(char phase, const char *name, const char *category, uint64_t timestamp, uint64_t duration, const char *label);
+
+			/**
+			 * @brief Writes the recorded events as Chrome trace JSON
+			 *
+			 * @details
+			 * Writes the events from all of the thread buffers in the JSON object
+			 * format of the Chrome trace-event specification. The threads should not
+			 * record events while the trace is written.
+			 *
+			 * @param out Stream on which the trace will be written
+			 */
+			static void WriteChromeTrace(std::ostream &out);
+
+			/**
+			 * @brief Removes the recorded events
+			 *
+			 * @details
+			 * Resets the buffers of all threads and releases the buffers of the
+			 * threads that have ended. The threads should not record events
+			 * while the buffers are cleared.
+			 */
+			static void Clear();
+
+			/**
+			 * @brief Returns the number of recorded events
+			 */
+			static size_t getEventCount();
+
+			/**
+			 * @brief Returns the number of events dropped because the buffer was full
+			 */
+			static size_t getDroppedCount();
+
+			/**
+			 * @brief Returns the time in nanoseconds since the start of the tracer
+			 */
+			static uint64_t Now();
+		};
+
+		/**
+		 * @brief Scoped span recorded in the tracer
+		 *
+		 * @details
+		 * Measures the time between the construction and destruction of the 
+		 * object and records it as a complete (`X`) event. If the tracer is
+		 * disabled when the span is created, nothing is recorded.
+		 */
+		class LuaTraceSpan {
+		   private:
+			const char *name;
+			const char *category;
+			const char *label;
+			uint64_t start;
+			bool active;
+
+		   public:
+			LuaTraceSpan(const char *_name, const char *_category) : LuaTraceSpan(_name, _category, NULL) {}
+
+			LuaTraceSpan(const char *_name, const char *_category, const char *_label) : name(_name), category(_category), label(_label), start(0), active(LuaTracer::isEnabled()) {
+				if (active) {
+					start = LuaTracer::Now();
+				}
+			}
+
+			~LuaTraceSpan() {
+				if (active) {
+					LuaTracer::Record('X', name, category, start, LuaTracer::Now() - start, label);
+				}
+			}
+
+			LuaTraceSpan(const LuaTraceSpan &) = delete;
+			LuaTraceSpan &operator=(const LuaTraceSpan &) = delete;
+		};
+	}
+}
+
+#endif // LUACPP_LUATRACER_HPP
@@ -0,0 +1,125 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include "LuaWorkloadRecorder.hpp"
+#include "../Engine/LuaCodec.hpp"
+
+using namespace LuaCpp::Diagnostics;
+using namespace LuaCpp::Engine;
+
+static uint64_t _now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::map<std::string, std::shared_ptr<LuaType>> LuaWorkloadRecord::DecodeEnvironment() const {
+	std::map<std::string, std::shared_ptr<LuaType>> env;
+	const char *pos = environment.data();
+	const char *end = pos + environment.size();
+
+	uint32_t count = LuaCodec::DecodeUInt32(pos, end);
+	for (uint32_t i = 0; i < count; i++) {
+		std::string name = LuaCodec::DecodeString(pos, end);
+		env[name] = LuaCodec::Decode(pos, end);
+	}
+	return env;
+}
+
+LuaWorkloadRecorder::LuaWorkloadRecorder(std::ostream &_out) : mutex(), out(_out), start(_now()), count(0) {
+	std::string header(MAGIC);
+	LuaCodec::EncodeUInt32(VERSION, header);
+	out.write(header.data(), header.size());
+}
+
+void LuaWorkloadRecorder::Record(const std::string &name, const std::map<std::string, std::shared_ptr<LuaType>> &env) {
+	std::string environment;
+	uint32_t recorded = 0;
+	for (const auto &var : env) {
+		size_t size = environment.size();
+		try {
+			LuaCodec::EncodeString(var.first, environment);
+			LuaCodec::Encode(*var.second, environment);
+			recorded++;
+		} catch (std::invalid_argument &e) {
+			environment.resize(size);
+		}
+	}
+
+	std::string record;
+	LuaCodec::EncodeUInt64(_now() - start, record);
+	LuaCodec::EncodeString(name, record);
+	LuaCodec::EncodeUInt32(recorded, record);
+	record.append(environment);
+
+	std::string length;
+	LuaCodec::EncodeUInt32((uint32_t) record.size(), length);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	out.write(length.data(), length.size());
+	out.write(record.data(), record.size());
+	count++;
+}
+
+uint64_t LuaWorkloadRecorder::getRecordCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return count;
+}
+
+std::vector<LuaWorkloadRecord> LuaWorkloadRecorder::Load(std::istream &in) {
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const char *pos = data.data();
+	const char *end = pos + data.size();
+
+	size_t magic = strlen(MAGIC);
+	if (data.size() < magic || data.compare(0, magic, MAGIC) != 0) {
+		throw std::invalid_argument("The stream is not a recorded workload");
+	}
+	pos += magic;
+	uint32_t version = LuaCodec::DecodeUInt32(pos, end);
+	if (version != VERSION) {
+		throw std::invalid_argument("Unsupported version " + std::to_string(version) + " of the recorded workload");
+	}
+
+	std::vector<LuaWorkloadRecord> records;
+	while (pos < end) {
+		uint32_t size = LuaCodec::DecodeUInt32(pos, end);
+		if ((size_t) (end - pos) < size) {
+			throw std::invalid_argument("The recorded workload is truncated");
+		}
+		const char *recordEnd = pos + size;
+
+		LuaWorkloadRecord record;
+		record.timestamp = LuaCodec::DecodeUInt64(pos, recordEnd);
+		record.name = LuaCodec::DecodeString(pos, recordEnd);
+		record.environment.assign(pos, recordEnd);
+		records.push_back(std::move(record));
+
+		pos = recordEnd;
+	}
+	return records;
+}
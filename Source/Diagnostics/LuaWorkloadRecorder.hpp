@@ -0,0 +1,122 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAWORKLOADRECORDER_HPP
+#define LUACPP_LUAWORKLOADRECORDER_HPP
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../Engine/LuaType.hpp"
+
+namespace LuaCpp {
+	namespace Diagnostics {
+
+		/**
+		 * @brief Recorded run of a snippet
+		 *
+		 * @details
+		 * The `timestamp` is the time of the run in nanoseconds since the
+		 * recorder was created, and the `environment` holds the variables
+		 * of the run serialised by the LuaCodec.
+		 */
+		struct LuaWorkloadRecord {
+			uint64_t timestamp;
+			std::string name;
+			std::string environment;
+
+			/**
+			 * @brief Returns new instances of the variables of the run
+			 *
+			 * @throws std::invalid_argument if the record is malformed
+			 */
+			std::map<std::string, std::shared_ptr<Engine::LuaType>> DecodeEnvironment() const;
+		};
+
+		/**
+		 * @brief Records the runs of the snippets to a stream
+		 *
+		 * @details
+		 * The recorder is set to the context with `LuaContext::setRecorder()`
+		 * and writes the name and the environment of each run, so the 
+		 * production workload can be replayed by the LuaWorkloadReplayer
+		 * or the `luacpp_loadgen` tool. The variables that can not be 
+		 * serialised (ex. userdata) are not recorded.
+		 *
+		 * The stream starts with the `LUACPPWL` magic and the version, 
+		 * followed by the records prefixed with their length.
+		 */
+		class LuaWorkloadRecorder {
+		   private:
+			std::mutex mutex;
+			std::ostream &out;
+			uint64_t start;
+			uint64_t count;
+
+		   public:
+			static constexpr const char *MAGIC = "LUACPPWL";
+			static constexpr uint32_t VERSION = 1;
+
+			/**
+			 * @brief Constructs the recorder and writes the header to the stream
+			 *
+			 * @param _out Stream receiving the records, it has to outlive the recorder
+			 */
+			explicit LuaWorkloadRecorder(std::ostream &_out);
+			~LuaWorkloadRecorder() {}
+
+			/**
+			 * @brief Records the run of the snippet
+			 *
+			 * @param name Name of the snippet
+			 * @param env Variables of the run
+			 */
+			void Record(const std::string &name, const std::map<std::string, std::shared_ptr<Engine::LuaType>> &env);
+
+			/**
+			 * @brief Returns the number of the recorded runs
+			 */
+			uint64_t getRecordCount();
+
+			/**
+			 * @brief Reads the records from the stream
+			 *
+			 * @param in Stream written by the recorder
+			 *
+			 * @return the records in the recorded order
+			 *
+			 * @throws std::invalid_argument if the stream is not a workload
+			 */
+			static std::vector<LuaWorkloadRecord> Load(std::istream &in);
+		};
+	}
+}
+
+#endif // LUACPP_LUAWORKLOADRECORDER_HPP
@@ -0,0 +1,144 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "LuaWorkloadReplayer.hpp"
+#include "../LuaContext.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Diagnostics;
+using namespace LuaCpp::Engine;
+
+static uint64_t _percentile(const std::vector<uint64_t> &sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t rank = (size_t) std::ceil(p * sorted.size());
+	if (rank > 0) {
+		rank--;
+	}
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+LuaReplayReport LuaWorkloadReplayer::Replay(LuaContext &ctx, const LuaReplayOptions &options) {
+	typedef std::chrono::steady_clock clock;
+
+	uint64_t total = options.requests > 0 ? options.requests : records.size();
+	unsigned concurrency = options.concurrency > 0 ? options.concurrency : 1;
+
+	std::atomic<uint64_t> next(0);
+	std::atomic<uint64_t> errors(0);
+	std::mutex contextMutex;
+	std::shared_ptr<LuaAllocProfiler> allocProfiler = ctx.getAllocProfiler();
+	std::vector<std::vector<uint64_t>> latencies(concurrency);
+	std::vector<std::thread> workers;
+
+	clock::time_point start = clock::now();
+
+	for (unsigned w = 0; w < concurrency && !records.empty(); w++) {
+		workers.emplace_back([&, w]() {
+			std::vector<uint64_t> &local = latencies[w];
+			for (uint64_t i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+				const LuaWorkloadRecord &record = records[i % records.size()];
+
+				LuaEnvironment env;
+				try {
+					env = record.DecodeEnvironment();
+				} catch (std::invalid_argument &e) {
+					errors.fetch_add(1);
+					continue;
+				}
+
+				clock::time_point begin = clock::now();
+				if (options.rate > 0) {
+					clock::time_point scheduled = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(i / options.rate));
+					std::this_thread::sleep_until(scheduled);
+					begin = scheduled;
+				}
+
+				// the state is owned by the worker, only its creation uses the context
+				std::unique_ptr<LuaState> L;
+				try {
+					std::lock_guard<std::mutex> lock(contextMutex);
+					L = ctx.newStateFor(record.name);
+				} catch (std::runtime_error &e) {
+					errors.fetch_add(1);
+					continue;
+				}
+
+				// the recorded variables are added to the global environment of the context, as in Run()
+				for (const auto &var : env) {
+					((std::shared_ptr<LuaType>) var.second)->PushGlobal(*L, var.first);
+				}
+				int res = lua_pcall(*L, 0, LUA_MULTRET, 0);
+				if (allocProfiler) {
+					allocProfiler->Detach(*L);
+				}
+				L.reset();
+
+				local.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - begin).count());
+				if (res != LUA_OK) {
+					errors.fetch_add(1);
+				}
+			}
+		});
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+
+	std::vector<uint64_t> all;
+	for (const auto &local : latencies) {
+		all.insert(all.end(), local.begin(), local.end());
+	}
+	std::sort(all.begin(), all.end());
+
+	LuaReplayReport report;
+	report.requests = records.empty() ? 0 : total;
+	report.errors = errors.load();
+	report.seconds = std::chrono::duration<double>(clock::now() - start).count();
+	report.throughput = report.seconds > 0 ? report.requests / report.seconds : 0;
+	report.p50 = _percentile(all, 0.50);
+	report.p99 = _percentile(all, 0.99);
+	report.p999 = _percentile(all, 0.999);
+	report.max = all.empty() ? 0 : all.back();
+	return report;
+}
+
+void LuaReplayReport::WriteReport(std::ostream &out) const {
+	out << std::fixed << std::setprecision(3);
+	out << "requests:   " << requests << " (" << errors << " errors)\n";
+	out << "duration:   " << seconds << " s\n";
+	out << "throughput: " << throughput << " runs/s\n";
+	out << "latency:    p50 " << p50 / 1000.0 << " us, p99 " << p99 / 1000.0
+	    << " us, p999 " << p999 / 1000.0 << " us, max " << max / 1000.0 << " us\n";
+}
@@ -0,0 +1,112 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAWORKLOADREPLAYER_HPP
+#define LUACPP_LUAWORKLOADREPLAYER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "LuaWorkloadRecorder.hpp"
+
+namespace LuaCpp {
+	class LuaContext;
+
+	namespace Diagnostics {
+
+		/**
+		 * @brief Options of the replay
+		 *
+		 * @details
+		 * The `rate` is the number of the runs started per second, `0` runs
+		 * them as fast as the workers allow. The `requests` is the total
+		 * number of the runs, the records are repeated when it is larger than
+		 * the number of the records, `0` replays each record once.
+		 */
+		struct LuaReplayOptions {
+			unsigned concurrency = 1;
+			double rate = 0;
+			uint64_t requests = 0;
+		};
+
+		/**
+		 * @brief Throughput and latency of the replay
+		 *
+		 * @details
+		 * The latencies are in nanoseconds. With the rate limit, the latency
+		 * is measured from the scheduled start of the run, so the runs delayed
+		 * by the slow ones are reported with the delay.
+		 */
+		struct LuaReplayReport {
+			uint64_t requests;
+			uint64_t errors;
+			double seconds;
+			double throughput;
+			uint64_t p50;
+			uint64_t p99;
+			uint64_t p999;
+			uint64_t max;
+
+			/**
+			 * @brief Writes the report in a human readable form
+			 *
+			 * @param out Stream where the report will be written
+			 */
+			void WriteReport(std::ostream &out) const;
+		};
+
+		/**
+		 * @brief Replays the recorded workload against a context
+		 *
+		 * @details
+		 * Each run is executed in a new state with new instances of the 
+		 * recorded variables. The context is not thread safe, so the workers
+		 * create the states from the context one at a time and run them in
+		 * parallel. The snippets have to be compiled in the context before 
+		 * the replay, and the context should not be changed during the replay.
+		 * The runs are not recorded by the recorder of the context.
+		 */
+		class LuaWorkloadReplayer {
+		   private:
+			std::vector<LuaWorkloadRecord> records;
+
+		   public:
+			explicit LuaWorkloadReplayer(std::vector<LuaWorkloadRecord> _records) : records(std::move(_records)) {}
+			~LuaWorkloadReplayer() {}
+
+			/**
+			 * @brief Replays the records
+			 *
+			 * @param ctx Context running the snippets
+			 * @param options Concurrency, rate and number of the runs
+			 *
+			 * @return the throughput and latency of the replay
+			 */
+			LuaReplayReport Replay(LuaContext &ctx, const LuaReplayOptions &options);
+		};
+	}
+}
+
+#endif // LUACPP_LUAWORKLOADREPLAYER_HPP
@@ -0,0 +1,329 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstring>
+#include <stdexcept>
+
+#include "LuaCodec.hpp"
+#include "LuaTNil.hpp"
+#include "LuaTBoolean.hpp"
+#include "LuaTNumber.hpp"
+#include "LuaTString.hpp"
+#include "LuaTTable.hpp"
+
+using namespace LuaCpp::Engine;
+
+#define LUACPP_CODEC_MAX_DEPTH 64
+
+static void _checkSize(const char *pos, const char *end, size_t size) {
+	if (pos > end || (size_t) (end - pos) < size) {
+		throw std::invalid_argument("The serialised value is truncated");
+	}
+}
+
+void LuaCodec::EncodeUInt32(uint32_t value, std::string &out) {
+	for (int i = 0; i < 4; i++) {
+		out.push_back((char) ((value >> (8 * i)) & 0xff));
+	}
+}
+
+uint32_t LuaCodec::DecodeUInt32(const char *&pos, const char *end) {
+	_checkSize(pos, end, 4);
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++) {
+		value |= (uint32_t) (unsigned char) pos[i] << (8 * i);
+	}
+	pos += 4;
+	return value;
+}
+
+void LuaCodec::EncodeUInt64(uint64_t value, std::string &out) {
+	for (int i = 0; i < 8; i++) {
+		out.push_back((char) ((value >> (8 * i)) & 0xff));
+	}
+}
+
+uint64_t LuaCodec::DecodeUInt64(const char *&pos, const char *end) {
+	_checkSize(pos, end, 8);
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++) {
+		value |= (uint64_t) (unsigned char) pos[i] << (8 * i);
+	}
+	pos += 8;
+	return value;
+}
+
+void LuaCodec::EncodeString(const std::string &str, std::string &out) {
+	EncodeUInt32((uint32_t) str.size(), out);
+	out.append(str);
+}
+
+std::string LuaCodec::DecodeString(const char *&pos, const char *end) {
+	uint32_t size = DecodeUInt32(pos, end);
+	_checkSize(pos, end, size);
+	std::string str(pos, size);
+	pos += size;
+	return str;
+}
+
+void LuaCodec::Encode(const LuaType &value, std::string &out) {
+	Encode(value, out, 0);
+}
+
+void LuaCodec::Encode(const LuaType &value, std::string &out, int depth) {
+	switch (value.getTypeId()) {
+		case LUA_TNIL:
+			out.push_back((char) TAG_NIL);
+			break;
+		case LUA_TBOOLEAN:
+			out.push_back((char) (((const LuaTBoolean &) value).getValue() ? TAG_TRUE : TAG_FALSE));
+			break;
+		case LUA_TNUMBER: {
+			double number = ((const LuaTNumber &) value).getValue();
+			uint64_t bits;
+			memcpy(&bits, &number, sizeof(bits));
+			out.push_back((char) TAG_NUMBER);
+			EncodeUInt64(bits, out);
+			break;
+		}
+		case LUA_TSTRING:
+			out.push_back((char) TAG_STRING);
+			EncodeString(((const LuaTString &) value).getValue(), out);
+			break;
+		case LUA_TTABLE: {
+			if (depth >= LUACPP_CODEC_MAX_DEPTH) {
+				throw std::invalid_argument("The table is nested too deep to be serialised");
+			}
+			std::map<Table::Key, std::shared_ptr<LuaType>> values = ((const LuaTTable &) value).getValues();
+			out.push_back((char) TAG_TABLE);
+			EncodeUInt32((uint32_t) values.size(), out);
+			for (const auto &entry : values) {
+				if (entry.first.isNumber()) {
+					out.push_back((char) TAG_INTEGER);
+					EncodeUInt64((uint64_t) (int64_t) entry.first.getIntValue(), out);
+				} else {
+					out.push_back((char) TAG_STRING);
+					EncodeString(entry.first.getStringValue(), out);
+				}
+				Encode(*entry.second, out, depth + 1);
+			}
+			break;
+		}
+		default:
+			throw std::invalid_argument("The value of type " + std::to_string(value.getTypeId()) + " can not be serialised");
+	}
+}
+
+std::shared_ptr<LuaType> LuaCodec::Decode(const char *&pos, const char *end) {
+	return Decode(pos, end, 0);
+}
+
+std::shared_ptr<LuaType> LuaCodec::Decode(const char *&pos, const char *end, int depth) {
+	_checkSize(pos, end, 1);
+	unsigned char tag = (unsigned char) *pos++;
+
+	switch (tag) {
+		case TAG_NIL:
+			return std::make_shared<LuaTNil>();
+		case TAG_FALSE:
+			return std::make_shared<LuaTBoolean>(false);
+		case TAG_TRUE:
+			return std::make_shared<LuaTBoolean>(true);
+		case TAG_NUMBER: {
+			uint64_t bits = DecodeUInt64(pos, end);
+			double number;
+			memcpy(&number, &bits, sizeof(number));
+			return std::make_shared<LuaTNumber>(number);
+		}
+		case TAG_INTEGER:
+			return std::make_shared<LuaTNumber>((double) (int64_t) DecodeUInt64(pos, end));
+		case TAG_STRING:
+			return std::make_shared<LuaTString>(DecodeString(pos, end));
+		case TAG_TABLE: {
+			if (depth >= LUACPP_CODEC_MAX_DEPTH) {
+				throw std::invalid_argument("The serialised table is nested too deep");
+			}
+			std::shared_ptr<LuaTTable> table = std::make_shared<LuaTTable>();
+			uint32_t count = DecodeUInt32(pos, end);
+			for (uint32_t i = 0; i < count; i++) {
+				_checkSize(pos, end, 1);
+				unsigned char keyTag = (unsigned char) *pos++;
+				if (keyTag == TAG_INTEGER) {
+					lua_Integer key = (lua_Integer) (int64_t) DecodeUInt64(pos, end);
+					table->setValue(Table::Key(key), Decode(pos, end, depth + 1));
+				} else if (keyTag == TAG_STRING) {
+					std::string key = DecodeString(pos, end);
+					table->setValue(Table::Key(key), Decode(pos, end, depth + 1));
+				} else {
+					throw std::invalid_argument("Invalid key tag " + std::to_string(keyTag) + " in the serialised table");
+				}
+			}
+			return table;
+		}
+		default:
+			throw std::invalid_argument("Invalid tag " + std::to_string(tag) + " in the serialised value");
+	}
+}
+
+static void _encodeStack(lua_State *L, int idx, std::string &out, int depth) {
+	switch (lua_type(L, idx)) {
+		case LUA_TNIL:
+			out.push_back((char) LuaCodec::TAG_NIL);
+			break;
+		case LUA_TBOOLEAN:
+			out.push_back((char) (lua_toboolean(L, idx) ? LuaCodec::TAG_TRUE : LuaCodec::TAG_FALSE));
+			break;
+		case LUA_TNUMBER: {
+			if (lua_isinteger(L, idx)) {
+				out.push_back((char) LuaCodec::TAG_INTEGER);
+				LuaCodec::EncodeUInt64((uint64_t) (int64_t) lua_tointeger(L, idx), out);
+			} else {
+				double number = (double) lua_tonumber(L, idx);
+				uint64_t bits;
+				memcpy(&bits, &number, sizeof(bits));
+				out.push_back((char) LuaCodec::TAG_NUMBER);
+				LuaCodec::EncodeUInt64(bits, out);
+			}
+			break;
+		}
+		case LUA_TSTRING: {
+			size_t len;
+			const char *str = lua_tolstring(L, idx, &len);
+			out.push_back((char) LuaCodec::TAG_STRING);
+			LuaCodec::EncodeUInt32((uint32_t) len, out);
+			out.append(str, len);
+			break;
+		}
+		case LUA_TTABLE: {
+			if (depth >= LUACPP_CODEC_MAX_DEPTH) {
+				throw std::invalid_argument("The table is nested too deep to be serialised");
+			}
+			out.push_back((char) LuaCodec::TAG_TABLE);
+			size_t countPos = out.size();
+			LuaCodec::EncodeUInt32(0, out);
+			uint32_t count = 0;
+			lua_pushnil(L);
+			while (lua_next(L, idx) != 0) {
+				if (lua_type(L, -2) == LUA_TNUMBER && lua_isinteger(L, -2)) {
+					out.push_back((char) LuaCodec::TAG_INTEGER);
+					LuaCodec::EncodeUInt64((uint64_t) (int64_t) lua_tointeger(L, -2), out);
+				} else if (lua_type(L, -2) == LUA_TSTRING) {
+					size_t len;
+					const char *key = lua_tolstring(L, -2, &len);
+					out.push_back((char) LuaCodec::TAG_STRING);
+					LuaCodec::EncodeUInt32((uint32_t) len, out);
+					out.append(key, len);
+				} else {
+					std::string type = luaL_typename(L, -2);
+					throw std::invalid_argument("The table key of type " + type + " can not be serialised");
+				}
+				_encodeStack(L, lua_gettop(L), out, depth + 1);
+				lua_pop(L, 1);
+				count++;
+			}
+			std::string counter;
+			LuaCodec::EncodeUInt32(count, counter);
+			out.replace(countPos, 4, counter);
+			break;
+		}
+		default:
+			throw std::invalid_argument("The value of type " + std::string(luaL_typename(L, idx)) + " can not be serialised");
+	}
+}
+
+void LuaCodec::Encode(lua_State *L, int idx, std::string &out) {
+	int top = lua_gettop(L);
+	size_t size = out.size();
+	try {
+		_encodeStack(L, lua_absindex(L, idx), out, 0);
+	} catch (...) {
+		lua_settop(L, top);
+		out.resize(size);
+		throw;
+	}
+}
+
+static void _pushStack(lua_State *L, const char *&pos, const char *end, int depth) {
+	_checkSize(pos, end, 1);
+	unsigned char tag = (unsigned char) *pos++;
+
+	switch (tag) {
+		case LuaCodec::TAG_NIL:
+			lua_pushnil(L);
+			break;
+		case LuaCodec::TAG_FALSE:
+			lua_pushboolean(L, 0);
+			break;
+		case LuaCodec::TAG_TRUE:
+			lua_pushboolean(L, 1);
+			break;
+		case LuaCodec::TAG_NUMBER: {
+			uint64_t bits = LuaCodec::DecodeUInt64(pos, end);
+			double number;
+			memcpy(&number, &bits, sizeof(number));
+			lua_pushnumber(L, (lua_Number) number);
+			break;
+		}
+		case LuaCodec::TAG_INTEGER:
+			lua_pushinteger(L, (lua_Integer) (int64_t) LuaCodec::DecodeUInt64(pos, end));
+			break;
+		case LuaCodec::TAG_STRING: {
+			uint32_t len = LuaCodec::DecodeUInt32(pos, end);
+			_checkSize(pos, end, len);
+			lua_pushlstring(L, pos, len);
+			pos += len;
+			break;
+		}
+		case LuaCodec::TAG_TABLE: {
+			if (depth >= LUACPP_CODEC_MAX_DEPTH) {
+				throw std::invalid_argument("The serialised table is nested too deep");
+			}
+			uint32_t count = LuaCodec::DecodeUInt32(pos, end);
+			luaL_checkstack(L, 3, "serialised table");
+			lua_createtable(L, 0, 0);
+			for (uint32_t i = 0; i < count; i++) {
+				_checkSize(pos, end, 1);
+				if (*pos != (char) LuaCodec::TAG_INTEGER && *pos != (char) LuaCodec::TAG_STRING) {
+					throw std::invalid_argument("Invalid key tag " + std::to_string((unsigned char) *pos) + " in the serialised table");
+				}
+				_pushStack(L, pos, end, depth + 1);
+				_pushStack(L, pos, end, depth + 1);
+				lua_rawset(L, -3);
+			}
+			break;
+		}
+		default:
+			throw std::invalid_argument("Invalid tag " + std::to_string(tag) + " in the serialised value");
+	}
+}
+
+void LuaCodec::Push(lua_State *L, const char *&pos, const char *end) {
+	int top = lua_gettop(L);
+	try {
+		_pushStack(L, pos, end, 0);
+	} catch (...) {
+		lua_settop(L, top);
+		throw;
+	}
+}
@@ -0,0 +1,151 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUACODEC_HPP
+#define LUACPP_LUACODEC_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../Lua.hpp"
+#include "LuaType.hpp"
+
+namespace LuaCpp {
+	namespace Engine {
+
+		/**
+		 * @brief Binary serialisation of the values
+		 *
+		 * @details
+		 * Serialises the nil, boolean, number, string and table values
+		 * to a compact binary form, which can be stored or sent to 
+		 * another process. Each value starts with a tag, the lengths
+		 * and the numbers are written in little endian byte order.
+		 * The other types (ex. userdata) can not be serialised.
+		 * The integer values are tagged with `TAG_INTEGER`, and are read
+		 * as numbers by `Decode()`.
+		 */
+		class LuaCodec {
+		   public:
+			static constexpr unsigned char TAG_NIL = 0;
+			static constexpr unsigned char TAG_FALSE = 1;
+			static constexpr unsigned char TAG_TRUE = 2;
+			static constexpr unsigned char TAG_NUMBER = 3;
+			static constexpr unsigned char TAG_STRING = 4;
+			static constexpr unsigned char TAG_TABLE = 5;
+			static constexpr unsigned char TAG_INTEGER = 6;
+
+			/**
+			 * @brief Appends the serialised value to the buffer
+			 *
+			 * @param value the value to be serialised
+			 * @param out buffer to which the value is appended
+			 *
+			 * @throws std::invalid_argument if the type can not be serialised
+			 */
+			static void Encode(const LuaType &value, std::string &out);
+
+			/**
+			 * @brief Reads the value from the buffer
+			 *
+			 * @param pos position of the value, moved after the value
+			 * @param end end of the buffer
+			 *
+			 * @return the value
+			 *
+			 * @throws std::invalid_argument if the buffer is malformed
+			 */
+			static std::shared_ptr<LuaType> Decode(const char *&pos, const char *end);
+
+			/**
+			 * @brief Appends the serialised value from the stack to the buffer
+			 *
+			 * @details
+			 * Serialises the value at the `idx` position of the stack without
+			 * converting it to a `LuaType`. The integers are kept as integers.
+			 *
+			 * @param L the state
+			 * @param idx stack position of the value
+			 * @param out buffer to which the value is appended
+			 *
+			 * @throws std::invalid_argument if the type can not be serialised
+			 */
+			static void Encode(lua_State *L, int idx, std::string &out);
+
+			/**
+			 * @brief Reads the value from the buffer and pushes it on the stack
+			 *
+			 * @param L the state
+			 * @param pos position of the value, moved after the value
+			 * @param end end of the buffer
+			 *
+			 * @throws std::invalid_argument if the buffer is malformed
+			 */
+			static void Push(lua_State *L, const char *&pos, const char *end);
+
+			/**
+			 * @brief Appends the string prefixed with the length to the buffer
+			 */
+			static void EncodeString(const std::string &str, std::string &out);
+
+			/**
+			 * @brief Reads the string prefixed with the length from the buffer
+			 *
+			 * @throws std::invalid_argument if the buffer is malformed
+			 */
+			static std::string DecodeString(const char *&pos, const char *end);
+
+			/**
+			 * @brief Appends the 32 bit unsigned integer to the buffer
+			 */
+			static void EncodeUInt32(uint32_t value, std::string &out);
+
+			/**
+			 * @brief Reads the 32 bit unsigned integer from the buffer
+			 *
+			 * @throws std::invalid_argument if the buffer is malformed
+			 */
+			static uint32_t DecodeUInt32(const char *&pos, const char *end);
+
+			/**
+			 * @brief Appends the 64 bit unsigned integer to the buffer
+			 */
+			static void EncodeUInt64(uint64_t value, std::string &out);
+
+			/**
+			 * @brief Reads the 64 bit unsigned integer from the buffer
+			 *
+			 * @throws std::invalid_argument if the buffer is malformed
+			 */
+			static uint64_t DecodeUInt64(const char *&pos, const char *end);
+
+		   private:
+			static void Encode(const LuaType &value, std::string &out, int depth);
+			static std::shared_ptr<LuaType> Decode(const char *&pos, const char *end, int depth);
+		};
+	}
+}
+
+#endif // LUACPP_LUACODEC_HPP
@@ -0,0 +1,60 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "LuaError.hpp"
+
+using namespace LuaCpp::Engine;
+
+LuaError::LuaError(int _code, const char *_message) : code(_code) {
+	if (_message == NULL) {
+		message[0] = '\0';
+		return;
+	}
+	strncpy(message, _message, LUACPP_ERROR_MESSAGE_SIZE - 1);
+	message[LUACPP_ERROR_MESSAGE_SIZE - 1] = '\0';
+}
+
+LuaError LuaError::Format(int code, const char *format, ...) {
+	LuaError error(code, NULL);
+	va_list args;
+	va_start(args, format);
+	vsnprintf(error.message, LUACPP_ERROR_MESSAGE_SIZE, format, args);
+	va_end(args);
+	return error;
+}
+
+LuaError LuaError::FromStatus(lua_State *L, int status) {
+	if (status == LUA_OK) {
+		return LuaError();
+	}
+	const char *msg = lua_tostring(L, -1);
+	if (msg == NULL) {
+		msg = "(error object is not a string)";
+	}
+	return LuaError(status, msg);
+}
@@ -0,0 +1,126 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAERROR_HPP
+#define LUACPP_LUAERROR_HPP
+
+#include "../Lua.hpp"
+
+#define LUACPP_ERROR_MESSAGE_SIZE 256
+
+namespace LuaCpp {
+	namespace Engine {
+
+		/**
+		 * @brief Error returned by the API that does not throw exceptions
+		 *
+		 * @details
+		 * The error holds the status code and a message stored in a fixed 
+		 * buffer, so creating and returning the error does not allocate. The
+		 * codes are the status codes of the Lua library (ex. `LUA_ERRRUN`,
+		 * `LUA_ERRSYNTAX`) or the codes defined by the class for the errors
+		 * detected by the library. Longer messages are truncated.
+		 */
+		class LuaError {
+		   public:
+			/**
+			 * @brief The value on the stack has a different type
+			 */
+			static constexpr int ERRTYPE = 100;
+
+			/**
+			 * @brief The code snippet is not in the registry
+			 */
+			static constexpr int ERRNOTFOUND = 101;
+
+			/**
+			 * @brief The value on the stack does not belong to the instance
+			 */
+			static constexpr int ERRDOMAIN = 102;
+
+			/**
+			 * @brief The message received from a service is malformed
+			 */
+			static constexpr int ERRPROTOCOL = 103;
+
+		   private:
+			int code;
+			char message[LUACPP_ERROR_MESSAGE_SIZE];
+
+		   public:
+			/**
+			 * @brief Constructs the result without an error
+			 */
+			LuaError() : code(LUA_OK) { message[0] = '\0'; }
+
+			/**
+			 * @brief Constructs the error with the code and the message
+			 *
+			 * @param _code the error code
+			 * @param _message the message, or `NULL`
+			 */
+			LuaError(int _code, const char *_message);
+
+			/**
+			 * @brief Constructs the error with the message formatted by `printf` rules
+			 *
+			 * @param code the error code
+			 * @param format the format of the message
+			 *
+			 * @return the error
+			 */
+			static LuaError Format(int code, const char *format, ...);
+
+			/**
+			 * @brief Constructs the error from the status of a call to the Lua library
+			 *
+			 * @details
+			 * The message is taken from the error object at the top of the stack.
+			 *
+			 * @param L the state that returned the status
+			 * @param status the status returned by the Lua library
+			 *
+			 * @return the error, without error if the status is `LUA_OK`
+			 */
+			static LuaError FromStatus(lua_State *L, int status);
+
+			/**
+			 * @brief Check if there is no error
+			 */
+			inline bool ok() const { return code == LUA_OK; }
+
+			/**
+			 * @brief Returns the error code, `LUA_OK` if there is no error
+			 */
+			inline int getCode() const { return code; }
+
+			/**
+			 * @brief Returns the error message, empty if there is no error
+			 */
+			inline const char *getMessage() const { return message; }
+		};
+	}
+}
+
+#endif // LUACPP_LUAERROR_HPP
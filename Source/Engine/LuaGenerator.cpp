@@ -0,0 +1,163 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <stdexcept>
+#include <string>
+
+#include "LuaGenerator.hpp"
+#include "LuaError.hpp"
+#include "LuaTBoolean.hpp"
+#include "LuaTNil.hpp"
+#include "LuaTNumber.hpp"
+#include "LuaTString.hpp"
+#include "LuaTTable.hpp"
+
+using namespace LuaCpp::Engine;
+
+LuaGeneratorBase::LuaGeneratorBase(lua_State *_L, int _nargs, bool coroutine) : L(_L), co(nullptr), ref(LUA_NOREF), nargs(_nargs), finished(false), current(nullptr), count(0) {
+	int function = lua_gettop(L) - _nargs;
+	if (_nargs < 0 || function < 1 || lua_type(L, function) != LUA_TFUNCTION) {
+		throw std::invalid_argument("Error: The function of the generator is not on the stack ...");
+	}
+
+	if (coroutine) {
+		// the thread is anchored in the registry until the generator is destroyed
+		co = lua_newthread(L);
+		ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		lua_xmove(L, co, _nargs + 1);
+	} else {
+		if (_nargs != 2) {
+			throw std::invalid_argument("Error: The iterator needs the function, the state and the control value ...");
+		}
+		// the function, the state and the control value are kept in a table
+		lua_createtable(L, 3, 0);
+		lua_insert(L, function);
+		lua_rawseti(L, function, 3);
+		lua_rawseti(L, function, 2);
+		lua_rawseti(L, function, 1);
+		ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+}
+
+LuaGeneratorBase::~LuaGeneratorBase() {
+	luaL_unref(L, LUA_REGISTRYINDEX, ref);
+}
+
+bool LuaGeneratorBase::Step() {
+	if (finished) {
+		return false;
+	}
+
+	if (co != nullptr) {
+		int nresults = 0;
+		int status = lua_resume(co, L, nargs, &nresults);
+		nargs = 0;
+		if (status == LUA_YIELD) {
+			current = co;
+			count = nresults;
+			return true;
+		}
+		finished = true;
+		if (status == LUA_OK) {
+			lua_settop(co, 0);
+			return false;
+		}
+		std::string message = LuaError::FromStatus(co, status).getMessage();
+		lua_settop(co, 0);
+		throw std::runtime_error(message);
+	}
+
+	int top = lua_gettop(L);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+	lua_rawgeti(L, top + 1, 1);
+	lua_rawgeti(L, top + 1, 2);
+	lua_rawgeti(L, top + 1, 3);
+	lua_remove(L, top + 1);
+
+	int status = lua_pcall(L, 2, LUA_MULTRET, 0);
+	if (status != LUA_OK) {
+		finished = true;
+		std::string message = LuaError::FromStatus(L, status).getMessage();
+		lua_settop(L, top);
+		throw std::runtime_error(message);
+	}
+
+	int nresults = lua_gettop(L) - top;
+	if (nresults == 0 || lua_isnil(L, top + 1)) {
+		finished = true;
+		lua_settop(L, top);
+		return false;
+	}
+
+	// the first value is the control value of the next call
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+	lua_pushvalue(L, top + 1);
+	lua_rawseti(L, -2, 3);
+	lua_pop(L, 1);
+
+	current = L;
+	count = nresults;
+	return true;
+}
+
+void LuaGeneratorBase::Release() {
+	if (current != nullptr) {
+		lua_pop(current, count);
+		current = nullptr;
+		count = 0;
+	}
+}
+
+std::shared_ptr<LuaType> LuaGeneratorBase::ToLuaType(lua_State *L, int idx) {
+	LuaState state(L, true);
+	std::shared_ptr<LuaType> value;
+	switch (lua_type(L, idx)) {
+		case LUA_TNONE:
+		case LUA_TNIL:
+			return std::make_shared<LuaTNil>();
+		case LUA_TSTRING:
+			value = std::make_shared<LuaTString>("");
+			break;
+		case LUA_TNUMBER:
+			value = std::make_shared<LuaTNumber>(0);
+			break;
+		case LUA_TBOOLEAN:
+			value = std::make_shared<LuaTBoolean>(false);
+			break;
+		case LUA_TTABLE:
+			value = std::make_shared<LuaTTable>();
+			break;
+		default:
+			return std::make_shared<LuaTString>(lua_typename(L, lua_type(L, idx)));
+	}
+	value->PopValue(state, idx);
+	return value;
+}
+
+std::shared_ptr<LuaType> LuaGeneratorBase::FirstValue(lua_State *L, int count) {
+	if (count == 0) {
+		return std::make_shared<LuaTNil>();
+	}
+	return ToLuaType(L, -count);
+}
@@ -0,0 +1,246 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAGENERATOR_HPP
+#define LUACPP_LUAGENERATOR_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+
+#include "../Lua.hpp"
+#include "LuaState.hpp"
+#include "LuaType.hpp"
+
+namespace LuaCpp {
+	namespace Engine {
+
+		/**
+		 * @brief Steps through the values produced by a Lua coroutine or iterator function
+		 *
+		 * @details
+		 * Keeps the source anchored in the registry of the state and runs
+		 * it one step at a time. The values of each step are left on the 
+		 * stack until `Release()`, so only one step is held in the memory.
+		 * Used by LuaGenerator, which converts the values into the items.
+		 */
+		class LuaGeneratorBase {
+		   private:
+			lua_State *L;
+			lua_State *co;
+			int ref;
+			int nargs;
+			bool finished;
+			lua_State *current;
+			int count;
+
+		   protected:
+			LuaGeneratorBase(lua_State *L, int nargs, bool coroutine);
+			~LuaGeneratorBase();
+
+			/**
+			 * @brief Runs the next step
+			 *
+			 * @details
+			 * Throws `std::runtime_error` with the message of the Lua error.
+			 *
+			 * @return `false` when the source is exhausted
+			 */
+			bool Step();
+
+			/**
+			 * @brief Removes the values of the last step from the stack
+			 */
+			void Release();
+
+			/**
+			 * @brief Returns the state holding the values of the last step
+			 */
+			inline lua_State *getValuesState() const { return current; }
+
+			/**
+			 * @brief Returns the number of the values of the last step
+			 */
+			inline int getValueCount() const { return count; }
+
+		   public:
+			LuaGeneratorBase(const LuaGeneratorBase &) = delete;
+			LuaGeneratorBase &operator=(const LuaGeneratorBase &) = delete;
+
+			/**
+			 * @brief Converts the value on the stack into the LuaType
+			 *
+			 * @details
+			 * The strings, numbers, booleans and tables are converted as by 
+			 * LuaTTable::PopValue(), `nil` becomes LuaTNil and the other 
+			 * types are represented by the names of their types.
+			 */
+			static std::shared_ptr<LuaType> ToLuaType(lua_State *L, int idx);
+
+			/**
+			 * @brief Converter taking the first value of the step as the LuaType
+			 */
+			static std::shared_ptr<LuaType> FirstValue(lua_State *L, int count);
+		};
+
+		/**
+		 * @brief Input range over the items produced lazily by Lua
+		 *
+		 * @details
+		 * The source is either a function run as a coroutine, where each 
+		 * `coroutine.yield(...)` produces an item and the return ends the
+		 * sequence, or an iterator function following the protocol of the 
+		 * generic `for`, ex. the results of `pairs(t)`, where the step 
+		 * returning `nil` as its first value ends the sequence.
+		 *
+		 * Each item is converted by the converter when the range advances
+		 * to it, from the values of the step on the top of the stack, and
+		 * the previous item is dropped; the consumer never holds more than
+		 * one item, however long the sequence.
+		 *
+		 * ```
+		 * ctx.PushSnippet(*L, "rows");
+		 * auto rows = LuaGenerator<Row>::Coroutine(*L, 0, [](lua_State *L, int n) { return ReadRow(L, -n); });
+		 * for (const Row &row : *rows) {
+		 *	out << row;
+		 * }
+		 * ```
+		 *
+		 * The range can be iterated once. The state has to outlive the 
+		 * generator, and the generator has to run on the thread of the state.
+		 *
+		 * @tparam T the type of the items
+		 */
+		template <typename T>
+		class LuaGenerator : public LuaGeneratorBase {
+		   public:
+			/**
+			 * @brief Converts the values of a step into the item
+			 *
+			 * @details
+			 * Called with the state holding the values and their number, the
+			 * values are at the indexes `-count` to `-1`. The converter must
+			 * leave the stack balanced.
+			 */
+			typedef std::function<T(lua_State *, int)> Converter;
+
+			class iterator {
+			   private:
+				LuaGenerator *generator;
+
+			   public:
+				typedef std::input_iterator_tag iterator_category;
+				typedef T value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const T *pointer;
+				typedef const T &reference;
+
+				explicit iterator(LuaGenerator *_generator = nullptr) : generator(_generator) {}
+
+				reference operator*() const { return *generator->item; }
+				pointer operator->() const { return &*generator->item; }
+
+				iterator &operator++() {
+					if (!generator->Advance()) {
+						generator = nullptr;
+					}
+					return *this;
+				}
+
+				void operator++(int) { ++*this; }
+
+				bool operator==(const iterator &other) const { return generator == other.generator; }
+				bool operator!=(const iterator &other) const { return generator != other.generator; }
+			};
+
+		   private:
+			Converter converter;
+			std::optional<T> item;
+			bool started;
+
+			LuaGenerator(lua_State *L, int nargs, bool coroutine, Converter _converter) : LuaGeneratorBase(L, nargs, coroutine), converter(std::move(_converter)), started(false) {}
+
+			bool Advance() {
+				item.reset();
+				if (!Step()) {
+					return false;
+				}
+				try {
+					item.emplace(converter(getValuesState(), getValueCount()));
+				} catch (...) {
+					Release();
+					throw;
+				}
+				Release();
+				return true;
+			}
+
+		   public:
+			/**
+			 * @brief Creates the generator running the function as a coroutine
+			 *
+			 * @details
+			 * The function and the `nargs` arguments of its first resume are
+			 * popped from the stack.
+			 */
+			static std::unique_ptr<LuaGenerator> Coroutine(LuaState &L, int nargs, Converter converter) {
+				return std::unique_ptr<LuaGenerator>(new LuaGenerator(L, nargs, true, std::move(converter)));
+			}
+
+			/**
+			 * @brief Creates the generator calling the iterator function
+			 *
+			 * @details
+			 * The function, the invariant state and the initial control 
+			 * value, as returned by `pairs()` or `ipairs()`, are popped from
+			 * the stack.
+			 */
+			static std::unique_ptr<LuaGenerator> Iterator(LuaState &L, Converter converter) {
+				return std::unique_ptr<LuaGenerator>(new LuaGenerator(L, 2, false, std::move(converter)));
+			}
+
+			/**
+			 * @brief Runs the source to the first item
+			 *
+			 * @details
+			 * Calling it again continues from the current item.
+			 */
+			iterator begin() {
+				if (!started) {
+					started = true;
+					if (!Advance()) {
+						return end();
+					}
+				}
+				return item ? iterator(this) : end();
+			}
+
+			iterator end() { return iterator(); }
+		};
+	}
+}
+
+#endif // LUACPP_LUAGENERATOR_HPP
@@ -0,0 +1,566 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LuaHeapImage.hpp"
+#include "LuaCodec.hpp"
+
+#define LUACPP_HEAP_IMAGE_MAGIC "LUACPPHI"
+#define LUACPP_HEAP_IMAGE_VERSION 1
+#define LUACPP_HEAP_PATH_DEPTH 4
+#define LUACPP_HEAP_PATH_CANDIDATES 4
+#define LUACPP_HEAP_FLUSH_SIZE 65536
+
+using namespace LuaCpp::Engine;
+
+namespace {
+
+	const unsigned char TAG_REF = 7;
+	const unsigned char TAG_JOIN = 8;
+	const unsigned char OBJ_TABLE = 1;
+	const unsigned char OBJ_FUNCTION = 2;
+	const unsigned char OBJ_CFUNCTION = 3;
+
+	// the ids of the roots of the image
+	const uint32_t GLOBALS = 1;
+	const uint32_t REGISTRY = 2;
+
+	int dump_writer(lua_State *, const void *p, size_t size, void *ud) {
+		((std::string *) ud)->append((const char *) p, size);
+		return 0;
+	}
+
+	class ImageWriter {
+	   private:
+		lua_State *L;
+		std::ostream &out;
+		std::string buffer;
+		int objects;
+		uint32_t count;
+		std::unordered_map<const void *, uint32_t> ids;
+		std::unordered_map<const void *, std::vector<std::string>> paths;
+		std::unordered_map<void *, std::pair<uint32_t, int>> upvalues;
+		std::vector<uint32_t> entries;
+
+		/*
+		 * Names the tables and the functions reachable on the string keys,
+		 * breadth first, so each object gets its shortest path first. The C
+		 * functions keep a few paths, as the shortest may be an alias created
+		 * by a script (ex. `format = string.format`).
+		 */
+		void CollectPaths(int root, const std::string &prefix) {
+			lua_newtable(L);
+			int queue = lua_gettop(L);
+			std::vector<std::pair<std::string, int>> names;
+			lua_pushvalue(L, root);
+			lua_rawseti(L, queue, 1);
+			names.push_back(std::make_pair(prefix, 0));
+
+			for (size_t i = 0; i < names.size(); i++) {
+				lua_rawgeti(L, queue, (lua_Integer) i + 1);
+				int table = lua_gettop(L);
+				if (names[i].second < LUACPP_HEAP_PATH_DEPTH) {
+					lua_pushnil(L);
+					while (lua_next(L, table) != 0) {
+						if (lua_type(L, -2) == LUA_TSTRING && (lua_istable(L, -1) || lua_iscfunction(L, -1))) {
+							const char *key = lua_tostring(L, -2);
+							const void *ptr = lua_topointer(L, -1);
+							auto known = paths.find(ptr);
+							std::string path = names[i].first.empty() ? key : names[i].first + "." + key;
+							if (strchr(key, '.') != NULL) {
+								// the path can not be resolved
+							} else if (known != paths.end()) {
+								if (lua_iscfunction(L, -1) && known->second.size() < LUACPP_HEAP_PATH_CANDIDATES) {
+									known->second.push_back(path);
+								}
+							} else {
+								paths[ptr].push_back(path);
+								if (lua_istable(L, -1)) {
+									lua_pushvalue(L, -1);
+									lua_rawseti(L, queue, (lua_Integer) names.size() + 1);
+									names.push_back(std::make_pair(path, names[i].second + 1));
+								}
+							}
+						}
+						lua_pop(L, 1);
+					}
+				}
+				lua_pop(L, 1);
+			}
+			lua_pop(L, 1);
+		}
+
+		/*
+		 * Assigns the id to the table or function on the stack. Returns
+		 * false for the values which can not be saved.
+		 */
+		bool Visit(int idx) {
+			switch (lua_type(L, idx)) {
+				case LUA_TNIL:
+				case LUA_TBOOLEAN:
+				case LUA_TNUMBER:
+				case LUA_TSTRING:
+					return true;
+				case LUA_TFUNCTION:
+					if (lua_iscfunction(L, idx) && paths.find(lua_topointer(L, idx)) == paths.end()) {
+						return false;
+					}
+					// fallthrough
+				case LUA_TTABLE: {
+					const void *ptr = lua_topointer(L, idx);
+					if (ids.find(ptr) == ids.end()) {
+						ids[ptr] = ++count;
+						entries.push_back(0);
+						lua_pushvalue(L, idx);
+						lua_rawseti(L, objects, count);
+					}
+					return true;
+				}
+				default:
+					return false;
+			}
+		}
+
+		/*
+		 * Called with the entry of the table on the top of the stack, only
+		 * the string keys of the registry are saved.
+		 */
+		bool isSaved(uint32_t id) const {
+			return id != REGISTRY || lua_type(L, -2) == LUA_TSTRING;
+		}
+
+		void Discover() {
+			for (uint32_t id = 1; id <= count; id++) {
+				lua_rawgeti(L, objects, id);
+				int obj = lua_gettop(L);
+				if (lua_istable(L, obj)) {
+					uint32_t n = 0;
+					lua_pushnil(L);
+					while (lua_next(L, obj) != 0) {
+						if (isSaved(id) && Visit(-2) && Visit(-1)) {
+							n++;
+						}
+						lua_pop(L, 1);
+					}
+					entries[id - 1] = n;
+					if (lua_getmetatable(L, obj)) {
+						Visit(-1);
+						lua_pop(L, 1);
+					}
+				} else if (!lua_iscfunction(L, obj)) {
+					for (int i = 1; lua_getupvalue(L, obj, i) != NULL; i++) {
+						Visit(-1);
+						lua_pop(L, 1);
+					}
+				}
+				lua_pop(L, 1);
+			}
+		}
+
+		void Flush() {
+			if (buffer.size() >= LUACPP_HEAP_FLUSH_SIZE) {
+				out.write(buffer.data(), (std::streamsize) buffer.size());
+				buffer.clear();
+			}
+		}
+
+		void WriteValue(int idx) {
+			switch (lua_type(L, idx)) {
+				case LUA_TTABLE:
+				case LUA_TFUNCTION:
+					buffer.push_back((char) TAG_REF);
+					LuaCodec::EncodeUInt32(ids[lua_topointer(L, idx)], buffer);
+					break;
+				default:
+					LuaCodec::Encode(L, idx, buffer);
+					break;
+			}
+		}
+
+		void WriteObjects() {
+			for (uint32_t id = 1; id <= count; id++) {
+				lua_rawgeti(L, objects, id);
+				if (lua_istable(L, -1)) {
+					auto path = paths.find(lua_topointer(L, -1));
+					uint32_t narr = (uint32_t) lua_rawlen(L, -1);
+					buffer.push_back((char) OBJ_TABLE);
+					LuaCodec::EncodeString(path == paths.end() ? "" : path->second.front(), buffer);
+					LuaCodec::EncodeUInt32(narr, buffer);
+					LuaCodec::EncodeUInt32(entries[id - 1] > narr ? entries[id - 1] - narr : 0, buffer);
+				} else if (lua_iscfunction(L, -1)) {
+					const std::vector<std::string> &candidates = paths[lua_topointer(L, -1)];
+					buffer.push_back((char) OBJ_CFUNCTION);
+					LuaCodec::EncodeUInt32((uint32_t) candidates.size(), buffer);
+					for (const std::string &path : candidates) {
+						LuaCodec::EncodeString(path, buffer);
+					}
+				} else {
+					std::string code;
+					if (lua_dump(L, dump_writer, &code, 0) != 0) {
+						throw std::runtime_error("Error dumping the function " + std::to_string(id));
+					}
+					buffer.push_back((char) OBJ_FUNCTION);
+					LuaCodec::EncodeString(code, buffer);
+				}
+				lua_pop(L, 1);
+				Flush();
+			}
+		}
+
+		void WriteContents() {
+			for (uint32_t id = 1; id <= count; id++) {
+				lua_rawgeti(L, objects, id);
+				int obj = lua_gettop(L);
+				if (lua_istable(L, obj)) {
+					LuaCodec::EncodeUInt32(entries[id - 1], buffer);
+					lua_pushnil(L);
+					while (lua_next(L, obj) != 0) {
+						if (isSaved(id) && Visit(-2) && Visit(-1)) {
+							WriteValue(-2);
+							WriteValue(-1);
+							Flush();
+						}
+						lua_pop(L, 1);
+					}
+					if (lua_getmetatable(L, obj)) {
+						WriteValue(-1);
+						lua_pop(L, 1);
+					} else {
+						buffer.push_back((char) LuaCodec::TAG_NIL);
+					}
+				} else if (lua_iscfunction(L, obj)) {
+					// resolved by the paths
+				} else {
+					int n = 0;
+					while (lua_getupvalue(L, obj, n + 1) != NULL) {
+						lua_pop(L, 1);
+						n++;
+					}
+					LuaCodec::EncodeUInt32((uint32_t) n, buffer);
+					for (int i = 1; i <= n; i++) {
+						void *upvalue = lua_upvalueid(L, obj, i);
+						auto shared = upvalues.find(upvalue);
+						if (shared != upvalues.end()) {
+							buffer.push_back((char) TAG_JOIN);
+							LuaCodec::EncodeUInt32(shared->second.first, buffer);
+							LuaCodec::EncodeUInt32((uint32_t) shared->second.second, buffer);
+							continue;
+						}
+						upvalues[upvalue] = std::make_pair(id, i);
+						lua_getupvalue(L, obj, i);
+						if (Visit(-1)) {
+							WriteValue(-1);
+						} else {
+							buffer.push_back((char) LuaCodec::TAG_NIL);
+							skipped++;
+						}
+						lua_pop(L, 1);
+					}
+				}
+				lua_pop(L, 1);
+				Flush();
+			}
+		}
+
+	   public:
+		size_t skipped;
+
+		ImageWriter(lua_State *_L, std::ostream &_out) : L(_L), out(_out), buffer(), objects(0), count(0), 
+			ids(), paths(), upvalues(), entries(), skipped(0) {}
+
+		void Write() {
+			luaL_checkstack(L, 10, "heap image");
+			lua_newtable(L);
+			objects = lua_gettop(L);
+
+			lua_pushglobaltable(L);
+			CollectPaths(lua_gettop(L), "");
+			Visit(-1);
+			lua_pop(L, 1);
+			CollectPaths(LUA_REGISTRYINDEX, "@registry");
+			Visit(LUA_REGISTRYINDEX);
+
+			Discover();
+
+			buffer.append(LUACPP_HEAP_IMAGE_MAGIC);
+			LuaCodec::EncodeUInt32(LUACPP_HEAP_IMAGE_VERSION, buffer);
+			LuaCodec::EncodeUInt32(count, buffer);
+			WriteObjects();
+			WriteContents();
+			out.write(buffer.data(), (std::streamsize) buffer.size());
+			buffer.clear();
+			lua_pop(L, 1);
+		}
+	};
+
+	class ImageReader {
+	   private:
+		lua_State *L;
+		const char *pos;
+		const char *end;
+		int objects;
+		uint32_t count;
+		std::vector<unsigned char> kinds;
+		std::vector<bool> merged;
+
+		unsigned char ReadTag() {
+			if (pos >= end) {
+				throw std::invalid_argument("The heap image is truncated");
+			}
+			return (unsigned char) *pos++;
+		}
+
+		/*
+		 * Pushes the object on the path, or nil.
+		 */
+		void Resolve(const std::string &path) {
+			size_t start = 0;
+			if (path.compare(0, 9, "@registry") == 0) {
+				lua_pushvalue(L, LUA_REGISTRYINDEX);
+				start = path.size() > 9 ? 10 : 9;
+			} else {
+				lua_pushglobaltable(L);
+			}
+			while (start < path.size()) {
+				size_t dot = path.find('.', start);
+				std::string key = path.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+				if (!lua_istable(L, -1)) {
+					lua_pop(L, 1);
+					lua_pushnil(L);
+					return;
+				}
+				lua_pushlstring(L, key.data(), key.size());
+				lua_rawget(L, -2);
+				lua_remove(L, -2);
+				start = dot == std::string::npos ? path.size() : dot + 1;
+			}
+		}
+
+		void ReadValue() {
+			unsigned char tag = ReadTag();
+			switch (tag) {
+				case TAG_REF: {
+					uint32_t id = LuaCodec::DecodeUInt32(pos, end);
+					if (id == 0 || id > count) {
+						throw std::invalid_argument("Invalid object " + std::to_string(id) + " in the heap image");
+					}
+					lua_rawgeti(L, objects, id);
+					if (lua_isboolean(L, -1)) {
+						// the C function was not found
+						lua_pop(L, 1);
+						lua_pushnil(L);
+					}
+					break;
+				}
+				case LuaCodec::TAG_TABLE:
+					throw std::invalid_argument("Unexpected inline table in the heap image");
+				default:
+					pos--;
+					LuaCodec::Push(L, pos, end);
+					break;
+			}
+		}
+
+		void ReadObjects() {
+			for (uint32_t id = 1; id <= count; id++) {
+				unsigned char tag = ReadTag();
+				if (id <= REGISTRY && tag != OBJ_TABLE) {
+					throw std::invalid_argument("The roots of the heap image are not tables");
+				}
+				if (tag == OBJ_TABLE) {
+					std::string path = LuaCodec::DecodeString(pos, end);
+					uint32_t narr = LuaCodec::DecodeUInt32(pos, end);
+					uint32_t nrec = LuaCodec::DecodeUInt32(pos, end);
+					if (id == GLOBALS) {
+						lua_pushglobaltable(L);
+					} else if (id == REGISTRY) {
+						lua_pushvalue(L, LUA_REGISTRYINDEX);
+					} else {
+						if (!path.empty()) {
+							Resolve(path);
+						} else {
+							lua_pushnil(L);
+						}
+						if (!lua_istable(L, -1)) {
+							lua_pop(L, 1);
+							lua_createtable(L, (int) narr, (int) nrec);
+							merged[id - 1] = false;
+						}
+					}
+				} else if (tag == OBJ_FUNCTION) {
+					std::string code = LuaCodec::DecodeString(pos, end);
+					int status = luaL_loadbuffer(L, code.data(), code.size(), "=heap image");
+					if (status != LUA_OK) {
+						std::string msg = lua_tostring(L, -1) == NULL ? "" : lua_tostring(L, -1);
+						lua_pop(L, 1);
+						throw std::runtime_error("Error loading the function " + std::to_string(id) + ": " + msg);
+					}
+				} else if (tag == OBJ_CFUNCTION) {
+					uint32_t n = LuaCodec::DecodeUInt32(pos, end);
+					lua_pushboolean(L, 0);
+					for (uint32_t i = 0; i < n; i++) {
+						std::string path = LuaCodec::DecodeString(pos, end);
+						if (lua_isboolean(L, -1)) {
+							Resolve(path);
+							if (lua_iscfunction(L, -1)) {
+								lua_remove(L, -2);
+							} else {
+								lua_pop(L, 1);
+							}
+						}
+					}
+					if (lua_isboolean(L, -1)) {
+						missing++;
+					}
+				} else {
+					throw std::invalid_argument("Invalid object tag " + std::to_string(tag) + " in the heap image");
+				}
+				kinds[id - 1] = tag;
+				lua_rawseti(L, objects, id);
+			}
+		}
+
+		void ReadContents() {
+			for (uint32_t id = 1; id <= count; id++) {
+				if (kinds[id - 1] == OBJ_CFUNCTION) {
+					continue;
+				}
+				lua_rawgeti(L, objects, id);
+				int obj = lua_gettop(L);
+				uint32_t n = LuaCodec::DecodeUInt32(pos, end);
+				if (kinds[id - 1] == OBJ_TABLE) {
+					for (uint32_t i = 0; i < n; i++) {
+						ReadValue();
+						ReadValue();
+						if (lua_isnil(L, -2) || (lua_type(L, -2) == LUA_TNUMBER && std::isnan((double) lua_tonumber(L, -2)))) {
+							lua_pop(L, 2);
+						} else {
+							lua_rawset(L, obj);
+						}
+					}
+					ReadValue();
+					// the merged tables keep the metatables set by the libraries
+					bool keep = false;
+					if (merged[id - 1] && lua_getmetatable(L, obj)) {
+						lua_pop(L, 1);
+						keep = true;
+					}
+					if (!keep && lua_istable(L, -1)) {
+						lua_setmetatable(L, obj);
+					} else {
+						lua_pop(L, 1);
+					}
+				} else {
+					for (uint32_t i = 1; i <= n; i++) {
+						if (pos < end && (unsigned char) *pos == TAG_JOIN) {
+							pos++;
+							uint32_t fid = LuaCodec::DecodeUInt32(pos, end);
+							int fn = (int) LuaCodec::DecodeUInt32(pos, end);
+							if (fid == 0 || fid >= id || kinds[fid - 1] != OBJ_FUNCTION) {
+								throw std::invalid_argument("Invalid shared upvalue in the heap image");
+							}
+							lua_rawgeti(L, objects, fid);
+							if (lua_getupvalue(L, -1, fn) == NULL || lua_getupvalue(L, obj, (int) i) == NULL) {
+								throw std::invalid_argument("Invalid shared upvalue in the heap image");
+							}
+							lua_pop(L, 2);
+							lua_upvaluejoin(L, obj, (int) i, -1, fn);
+							lua_pop(L, 1);
+						} else {
+							ReadValue();
+							if (lua_setupvalue(L, obj, (int) i) == NULL) {
+								lua_pop(L, 1);
+							}
+						}
+					}
+				}
+				lua_pop(L, 1);
+			}
+		}
+
+	   public:
+		size_t missing;
+
+		ImageReader(lua_State *_L, const std::string &data) : L(_L), pos(data.data()), end(data.data() + data.size()),
+			objects(0), count(0), kinds(), merged(), missing(0) {}
+
+		void Read() {
+			size_t magic = strlen(LUACPP_HEAP_IMAGE_MAGIC);
+			if ((size_t) (end - pos) < magic || memcmp(pos, LUACPP_HEAP_IMAGE_MAGIC, magic) != 0) {
+				throw std::invalid_argument("The stream is not a heap image");
+			}
+			pos += magic;
+			uint32_t version = LuaCodec::DecodeUInt32(pos, end);
+			if (version != LUACPP_HEAP_IMAGE_VERSION) {
+				throw std::invalid_argument("Unsupported heap image version " + std::to_string(version));
+			}
+			count = LuaCodec::DecodeUInt32(pos, end);
+			if (count < REGISTRY) {
+				throw std::invalid_argument("The heap image has no roots");
+			}
+			kinds.assign(count, 0);
+			merged.assign(count, true);
+
+			luaL_checkstack(L, 10, "heap image");
+			lua_createtable(L, (int) count, 0);
+			objects = lua_gettop(L);
+			ReadObjects();
+			ReadContents();
+			lua_pop(L, 1);
+		}
+	};
+}
+
+size_t LuaHeapImage::Save(lua_State *L, std::ostream &out) {
+	int top = lua_gettop(L);
+	ImageWriter writer(L, out);
+	try {
+		writer.Write();
+	} catch (...) {
+		lua_settop(L, top);
+		throw;
+	}
+	return writer.skipped;
+}
+
+size_t LuaHeapImage::Restore(lua_State *L, std::istream &in) {
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	int top = lua_gettop(L);
+	ImageReader reader(L, data);
+	try {
+		reader.Read();
+	} catch (...) {
+		lua_settop(L, top);
+		throw;
+	}
+	return reader.missing;
+}
@@ -0,0 +1,94 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAHEAPIMAGE_HPP
+#define LUACPP_LUAHEAPIMAGE_HPP
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+#include "../Lua.hpp"
+
+namespace LuaCpp {
+	namespace Engine {
+
+		/**
+		 * @brief Persists the initialised heap of a state
+		 *
+		 * @details
+		 * Saves the objects reachable from the globals and from the string
+		 * keys of the registry: the tables with their metatables, and the
+		 * Lua functions as bytecode with their upvalues, including the
+		 * upvalues shared by the closures. The shared and cyclic references
+		 * are kept.
+		 *
+		 * The C functions are saved by the path on which they are reachable
+		 * from the globals or the registry (ex. `string.format`), and are
+		 * looked up on the same path when restored, so the state restored into
+		 * has to be created with the same libraries. The tables reachable on
+		 * a path existing in the restored state (ex. `package.loaded`) are 
+		 * merged into the existing tables.
+		 *
+		 * The userdata, the threads, the C functions without a path and the
+		 * references held by integer keys of the registry are not saved.
+		 *
+		 * The image contains bytecode, it should be restored only from
+		 * trusted sources.
+		 */
+		class LuaHeapImage {
+		   public:
+			/**
+			 * @brief Writes the heap of the state to the stream
+			 *
+			 * @param L the state
+			 * @param out the binary stream
+			 *
+			 * @return the number of the values that were not saved
+			 *
+			 * @throws std::runtime_error if a function can not be dumped
+			 */
+			static size_t Save(lua_State *L, std::ostream &out);
+
+			/**
+			 * @brief Restores the heap from the stream into the state
+			 *
+			 * @details
+			 * The globals and the registry of the image are merged into the
+			 * globals and the registry of the state.
+			 *
+			 * @param L the state, with the libraries of the saved state
+			 * @param in the binary stream
+			 *
+			 * @return the number of the C functions that were not found
+			 *
+			 * @throws std::invalid_argument if the image is malformed
+			 * @throws std::runtime_error if a function can not be loaded
+			 */
+			static size_t Restore(lua_State *L, std::istream &in);
+		};
+	}
+}
+
+#endif // LUACPP_LUAHEAPIMAGE_HPP
@@ -0,0 +1,332 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+#include <unordered_set>
+
+#include "LuaHeapReport.hpp"
+
+using namespace LuaCpp::Engine;
+
+namespace {
+
+	// approximate sizes of the objects in the Lua library on 64 bit platforms
+	const uint64_t TABLE_BYTES = 56;
+	const uint64_t TABLE_ENTRY_BYTES = 32;
+	const uint64_t STRING_BYTES = 25;
+	const uint64_t LUA_CLOSURE_BYTES = 32;
+	const uint64_t LUA_UPVALUE_BYTES = 8;
+	const uint64_t C_CLOSURE_BYTES = 32;
+	const uint64_t C_UPVALUE_BYTES = 16;
+	const uint64_t USERDATA_BYTES = 40;
+	const uint64_t THREAD_BYTES = 208;
+
+	bool isIdentifier(const char *str, size_t len) {
+		if (len == 0 || std::isdigit((unsigned char) str[0])) {
+			return false;
+		}
+		for (size_t i = 0; i < len; i++) {
+			if (!std::isalnum((unsigned char) str[i]) && str[i] != '_') {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::string keyPath(lua_State *L, const std::string &parent, int key) {
+		switch (lua_type(L, key)) {
+			case LUA_TSTRING: {
+				size_t len;
+				const char *str = lua_tolstring(L, key, &len);
+				if (isIdentifier(str, len)) {
+					return parent + "." + std::string(str, len);
+				}
+				return parent + "[\"" + std::string(str, len) + "\"]";
+			}
+			case LUA_TNUMBER: {
+				std::ostringstream str;
+				if (lua_isinteger(L, key)) {
+					str << lua_tointeger(L, key);
+				} else {
+					str << lua_tonumber(L, key);
+				}
+				return parent + "[" + str.str() + "]";
+			}
+			default:
+				return parent + "[" + lua_typename(L, lua_type(L, key)) + "]";
+		}
+	}
+
+	void writeString(std::ostream &out, const std::string &str) {
+		out << '"';
+		for (char c : str) {
+			switch (c) {
+				case '"': out << "\\\""; break;
+				case '\\': out << "\\\\"; break;
+				case '\n': out << "\\n"; break;
+				case '\r': out << "\\r"; break;
+				case '\t': out << "\\t"; break;
+				default:
+					if ((unsigned char) c < 0x20) {
+						char buf[8];
+						snprintf(buf, sizeof(buf), "\\u%04x", c);
+						out << buf;
+					} else {
+						out << c;
+					}
+			}
+		}
+		out << '"';
+	}
+
+	/**
+	 * Walks the objects breadth first. The objects waiting for the
+	 * inspection are kept in a table on the stack, so they are not
+	 * collected and the stack does not grow with the heap.
+	 */
+	class HeapWalker {
+	   public:
+		lua_State *L;
+		int queue;
+		lua_Integer tail;
+		std::vector<std::string> paths;
+		std::unordered_set<const void *> visited;
+		std::map<std::string, LuaHeapTypeStats> &types;
+		std::vector<LuaHeapTable> &tables;
+
+		HeapWalker(lua_State *_L, std::map<std::string, LuaHeapTypeStats> &_types, std::vector<LuaHeapTable> &_tables)
+		    : L(_L), queue(0), tail(0), paths(), visited(), types(_types), tables(_tables) {}
+
+		void Account(int type, uint64_t bytes) {
+			LuaHeapTypeStats &stats = types[lua_typename(L, type)];
+			stats.count++;
+			stats.bytes += bytes;
+		}
+
+		void Enqueue(int idx, const std::string &path) {
+			idx = lua_absindex(L, idx);
+			int type = lua_type(L, idx);
+			switch (type) {
+				case LUA_TSTRING: {
+					size_t len;
+					const char *str = lua_tolstring(L, idx, &len);
+					if (visited.insert(str).second) {
+						Account(type, STRING_BYTES + len);
+					}
+					return;
+				}
+				case LUA_TFUNCTION:
+					// functions without upvalues are not allocated on the heap
+					if (lua_iscfunction(L, idx)) {
+						if (lua_getupvalue(L, idx, 1) == NULL) {
+							return;
+						}
+						lua_pop(L, 1);
+					}
+					break;
+				case LUA_TTABLE:
+				case LUA_TUSERDATA:
+				case LUA_TTHREAD:
+					break;
+				default:
+					return;
+			}
+			if (!visited.insert(lua_topointer(L, idx)).second) {
+				return;
+			}
+			lua_pushvalue(L, idx);
+			lua_rawseti(L, queue, ++tail);
+			paths.push_back(path);
+		}
+
+		void VisitTable(int obj, const std::string &path) {
+			uint64_t entries = 0;
+			lua_pushnil(L);
+			while (lua_next(L, obj) != 0) {
+				entries++;
+				Enqueue(-1, keyPath(L, path, -2));
+				Enqueue(-2, path + ".<key>");
+				lua_pop(L, 1);
+			}
+			uint64_t bytes = TABLE_BYTES + entries * TABLE_ENTRY_BYTES;
+			Account(LUA_TTABLE, bytes);
+			tables.push_back(LuaHeapTable{path, entries, bytes});
+		}
+
+		void VisitFunction(int obj, const std::string &path) {
+			int n = 1;
+			const char *name;
+			while ((name = lua_getupvalue(L, obj, n)) != NULL) {
+				Enqueue(-1, path + ".<upvalue " + (*name ? name : std::to_string(n)) + ">");
+				lua_pop(L, 1);
+				n++;
+			}
+			if (lua_iscfunction(L, obj)) {
+				Account(LUA_TFUNCTION, C_CLOSURE_BYTES + (n - 1) * C_UPVALUE_BYTES);
+			} else {
+				Account(LUA_TFUNCTION, LUA_CLOSURE_BYTES + (n - 1) * LUA_UPVALUE_BYTES);
+			}
+		}
+
+		void VisitUserData(int obj, const std::string &path) {
+#if LUA_VERSION_NUM >= 504
+			for (int n = 1; lua_getiuservalue(L, obj, n) != LUA_TNONE; n++) {
+				Enqueue(-1, path + ".<uservalue " + std::to_string(n) + ">");
+				lua_pop(L, 1);
+			}
+			lua_pop(L, 1);
+#else
+			lua_getuservalue(L, obj);
+			Enqueue(-1, path + ".<uservalue>");
+			lua_pop(L, 1);
+#endif
+			Account(LUA_TUSERDATA, USERDATA_BYTES + lua_rawlen(L, obj));
+		}
+
+		void Walk() {
+			int base = lua_gettop(L);
+			lua_newtable(L);
+			queue = lua_gettop(L);
+
+			lua_pushglobaltable(L);
+			Enqueue(-1, "_G");
+			lua_pop(L, 1);
+			lua_pushvalue(L, LUA_REGISTRYINDEX);
+			Enqueue(-1, "registry");
+			lua_pop(L, 1);
+
+			for (lua_Integer head = 1; head <= tail; head++) {
+				luaL_checkstack(L, 8, "heap inspection");
+				lua_rawgeti(L, queue, head);
+				int obj = lua_gettop(L);
+				const std::string path = paths[head - 1];
+
+				switch (lua_type(L, obj)) {
+					case LUA_TTABLE:
+						VisitTable(obj, path);
+						break;
+					case LUA_TFUNCTION:
+						VisitFunction(obj, path);
+						break;
+					case LUA_TUSERDATA:
+						VisitUserData(obj, path);
+						break;
+					default:
+						Account(LUA_TTHREAD, THREAD_BYTES);
+						break;
+				}
+				if (lua_getmetatable(L, obj)) {
+					Enqueue(-1, path + ".<metatable>");
+					lua_pop(L, 1);
+				}
+				lua_settop(L, obj - 1);
+			}
+			lua_settop(L, base);
+		}
+	};
+}
+
+LuaHeapReport LuaHeapReport::Inspect(lua_State *L, size_t largest) {
+	LuaHeapReport report;
+	std::vector<LuaHeapTable> tables;
+
+	HeapWalker walker(L, report.types, tables);
+	walker.Walk();
+
+	std::sort(tables.begin(), tables.end(), [](const LuaHeapTable &a, const LuaHeapTable &b) {
+		return a.bytes > b.bytes;
+	});
+	if (tables.size() > largest) {
+		tables.resize(largest);
+	}
+	report.largestTables = std::move(tables);
+	report.heapBytes = (uint64_t) lua_gc(L, LUA_GCCOUNT, 0) * 1024 + (uint64_t) lua_gc(L, LUA_GCCOUNTB, 0);
+
+	return report;
+}
+
+const std::map<std::string, LuaHeapTypeStats> &LuaHeapReport::getTypes() const {
+	return types;
+}
+
+const std::vector<LuaHeapTable> &LuaHeapReport::getLargestTables() const {
+	return largestTables;
+}
+
+uint64_t LuaHeapReport::getObjectCount() const {
+	uint64_t count = 0;
+	for (const auto &type : types) {
+		count += type.second.count;
+	}
+	return count;
+}
+
+uint64_t LuaHeapReport::getObjectBytes() const {
+	uint64_t bytes = 0;
+	for (const auto &type : types) {
+		bytes += type.second.bytes;
+	}
+	return bytes;
+}
+
+uint64_t LuaHeapReport::getHeapBytes() const {
+	return heapBytes;
+}
+
+void LuaHeapReport::WriteJSON(std::ostream &out) const {
+	out << "{\"heapBytes\":" << heapBytes
+	    << ",\"objects\":" << getObjectCount()
+	    << ",\"objectBytes\":" << getObjectBytes()
+	    << ",\"types\":{";
+	bool first = true;
+	for (const auto &type : types) {
+		if (!first) {
+			out << ",";
+		}
+		first = false;
+		writeString(out, type.first);
+		out << ":{\"count\":" << type.second.count << ",\"bytes\":" << type.second.bytes << "}";
+	}
+	out << "},\"largestTables\":[";
+	first = true;
+	for (const auto &table : largestTables) {
+		if (!first) {
+			out << ",";
+		}
+		first = false;
+		out << "{\"path\":";
+		writeString(out, table.path);
+		out << ",\"entries\":" << table.entries << ",\"bytes\":" << table.bytes << "}";
+	}
+	out << "]}";
+}
+
+std::string LuaHeapReport::ToJSON() const {
+	std::ostringstream out;
+	WriteJSON(out);
+	return out.str();
+}
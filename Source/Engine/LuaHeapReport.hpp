@@ -0,0 +1,136 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAHEAPREPORT_HPP
+#define LUACPP_LUAHEAPREPORT_HPP
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../Lua.hpp"
+
+namespace LuaCpp {
+	namespace Engine {
+
+		/**
+		 * @brief Number and approximate size of the objects of a type
+		 */
+		struct LuaHeapTypeStats {
+			uint64_t count;
+			uint64_t bytes;
+		};
+
+		/**
+		 * @brief Table found during the inspection of the heap
+		 *
+		 * @details
+		 * The `path` is the first path on which the table was reached, ex.
+		 * `_G.cache.users`. The `bytes` is the approximate size of the table
+		 * itself, without the keys and values it references.
+		 */
+		struct LuaHeapTable {
+			std::string path;
+			uint64_t entries;
+			uint64_t bytes;
+		};
+
+		/**
+		 * @brief Report of the objects reachable in a state
+		 *
+		 * @details
+		 * The report is generated by walking the objects reachable from
+		 * the globals and the registry, including the metatables, upvalues
+		 * and user values. The sizes are approximations based on the layout
+		 * of the objects in the Lua library, and are meant to compare the
+		 * reports of the same state over the time.
+		 */
+		class LuaHeapReport {
+		   private:
+			std::map<std::string, LuaHeapTypeStats> types;
+			std::vector<LuaHeapTable> largestTables;
+			uint64_t heapBytes;
+
+		   public:
+			LuaHeapReport() : types(), largestTables(), heapBytes(0) {}
+			~LuaHeapReport() {}
+
+			/**
+			 * @brief Walks the objects reachable in the state
+			 *
+			 * @details
+			 * The objects are walked breadth first, starting with the
+			 * globals and then the registry, so the tables are named by
+			 * the shortest path from the globals when possible.
+			 *
+			 * @param L State that will be inspected
+			 * @param largest Number of the largest tables kept in the report
+			 *
+			 * @return the report of the state
+			 */
+			static LuaHeapReport Inspect(lua_State *L, size_t largest);
+
+			/**
+			 * @brief Returns the statistics per type name
+			 */
+			const std::map<std::string, LuaHeapTypeStats> &getTypes() const;
+
+			/**
+			 * @brief Returns the largest tables, sorted by the size
+			 */
+			const std::vector<LuaHeapTable> &getLargestTables() const;
+
+			/**
+			 * @brief Returns the number of reachable objects
+			 */
+			uint64_t getObjectCount() const;
+
+			/**
+			 * @brief Returns the approximate size of the reachable objects
+			 */
+			uint64_t getObjectBytes() const;
+
+			/**
+			 * @brief Returns the size of the heap as reported by the garbage collector
+			 */
+			uint64_t getHeapBytes() const;
+
+			/**
+			 * @brief Writes the report as JSON
+			 *
+			 * @param out Stream where the report will be written
+			 */
+			void WriteJSON(std::ostream &out) const;
+
+			/**
+			 * @brief Returns the report as JSON
+			 */
+			std::string ToJSON() const;
+		};
+	}
+}
+
+#endif // LUACPP_LUAHEAPREPORT_HPP
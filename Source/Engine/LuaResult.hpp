@@ -0,0 +1,95 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUARESULT_HPP
+#define LUACPP_LUARESULT_HPP
+
+#include <utility>
+
+#include "LuaError.hpp"
+
+namespace LuaCpp {
+	namespace Engine {
+
+		/**
+		 * @brief Value or error returned by the API that does not throw exceptions
+		 *
+		 * @details
+		 * Holds the value when the call succeeded, or the LuaError when it
+		 * failed. The value is default constructed in case of the error.
+		 *
+		 * @code
+		 * LuaResult<void> res = ctx.TryRun("validate");
+		 * if (!res) {
+		 *	std::cout << res.getError().getMessage() << std::endl;
+		 * }
+		 * @endcode
+		 */
+		template <typename T>
+		class LuaResult {
+		   private:
+			T value;
+			LuaError error;
+
+		   public:
+			LuaResult(T _value) : value(std::move(_value)), error() {}
+			LuaResult(const LuaError &_error) : value(), error(_error) {}
+
+			/**
+			 * @brief Check if the call succeeded
+			 */
+			inline bool ok() const { return error.ok(); }
+			inline explicit operator bool() const { return error.ok(); }
+
+			/**
+			 * @brief Returns the value, valid only if the call succeeded
+			 */
+			inline T &getValue() { return value; }
+
+			/**
+			 * @brief Returns the error of the call
+			 */
+			inline const LuaError &getError() const { return error; }
+		};
+
+		/**
+		 * @brief Result of the call without a value
+		 */
+		template <>
+		class LuaResult<void> {
+		   private:
+			LuaError error;
+
+		   public:
+			LuaResult() : error() {}
+			LuaResult(const LuaError &_error) : error(_error) {}
+
+			inline bool ok() const { return error.ok(); }
+			inline explicit operator bool() const { return error.ok(); }
+			inline const LuaError &getError() const { return error; }
+		};
+	}
+}
+
+#endif // LUACPP_LUARESULT_HPP
@@ -59,3 +59,15 @@ void LuaState::PrintStack(std::ostream &out) {
 		out <<  "\n";
 	}
 }
+
+LuaHeapReport LuaState::InspectHeap(size_t largestTables) {
+	return LuaHeapReport::Inspect(L, largestTables);
+}
+
+size_t LuaState::SaveHeap(std::ostream &out) {
+	return LuaHeapImage::Save(L, out);
+}
+
+size_t LuaState::RestoreHeap(std::istream &in) {
+	return LuaHeapImage::Restore(L, in);
+}
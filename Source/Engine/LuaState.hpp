@@ -29,6 +29,8 @@
 #include <ostream>
 
 #include "../Lua.hpp"
+#include "LuaHeapReport.hpp"
+#include "LuaHeapImage.hpp"
 
 namespace LuaCpp {
 	/**
@@ -123,6 +125,40 @@ namespace LuaCpp {
 			 * @param out Stram on which the stack will be printed
 			 */
 			void PrintStack(std::ostream &out); 
+
+			/**
+			 * @brief Reports the objects reachable in the state
+			 *
+			 * @details
+			 * Walks the objects reachable from the globals and the 
+			 * registry and reports their counts and approximate sizes
+			 * per type, with the largest tables identified by their path
+			 * (ex. `_G.cache.users`). The report can be exported as JSON
+			 * to compare the state over the time.
+			 *
+			 * @param largestTables Number of the largest tables in the report
+			 *
+			 * @return the report of the reachable objects
+			 */
+			LuaHeapReport InspectHeap(size_t largestTables = 10);
+
+			/**
+			 * @brief Saves the heap of the state to the stream
+			 *
+			 * @see LuaHeapImage::Save()
+			 *
+			 * @return the number of the values that were not saved
+			 */
+			size_t SaveHeap(std::ostream &out);
+
+			/**
+			 * @brief Restores the heap saved by `SaveHeap()` into the state
+			 *
+			 * @see LuaHeapImage::Restore()
+			 *
+			 * @return the number of the C functions that were not found
+			 */
+			size_t RestoreHeap(std::istream &in);
 		};
 	}
 }
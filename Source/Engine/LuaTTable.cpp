@@ -82,7 +82,7 @@ std::string Key::getStringValue() const {
 	return str_val;
 }
 
-int Key::getIntValue() const {
+lua_Integer Key::getIntValue() const {
 	return int_val;
 }
 
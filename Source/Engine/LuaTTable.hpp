@@ -48,16 +48,16 @@ namespace LuaCpp {
 			  private:
 				bool _isNumber;
 				std::string str_val;
-				int int_val;
+				lua_Integer int_val;
 			  public:
-				explicit Key(int value) : _isNumber(true), str_val(), int_val(value) {}
+				explicit Key(lua_Integer value) : _isNumber(true), str_val(), int_val(value) {}
 				explicit Key(std::string value) : _isNumber(false), str_val(std::move(value)), int_val(0) {}
 				explicit Key(const char *value) : _isNumber(false), str_val(std::string(value)), int_val(0) {}
 
 				bool isNumber() const;
 
 				std::string getStringValue() const;
-				int getIntValue() const;
+				lua_Integer getIntValue() const;
 
 				std::string ToString() const;
 
@@ -62,6 +62,17 @@ void LuaTUserData::PopValue(LuaState &L, int idx) {
 	}
 }
 
+LuaError LuaTUserData::TryPopValue(LuaState &L, int idx) {
+	if (lua_type(L, idx) != LUA_TUSERDATA) {
+		return LuaError::Format(LuaError::ERRTYPE, "The value at the stack position %d is %s, expected userdata", idx, lua_typename(L, lua_type(L, idx)));
+	}
+	if (lua_touserdata(L, idx) != userdata) {
+		return LuaError::Format(LuaError::ERRDOMAIN, "The value on the stack %d has different pointer to the userdata buffer.", idx);
+	}
+	_retreiveData();
+	return LuaError();
+}
+
 std::string LuaTUserData::ToString() const {
 	return "userdata";
 }
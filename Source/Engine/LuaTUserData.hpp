@@ -150,6 +150,18 @@ namespace LuaCpp {
 			using LuaType::PopValue;
 			void PopValue(LuaState &L, int idx);
 
+			/**
+			 * @brief Reads the value from the stack without throwing exceptions
+			 *
+			 * @details
+			 * Same as `PopValue()`, returns `LuaError::ERRTYPE` if the value is not
+			 * LUA_TUSERDATA and `LuaError::ERRDOMAIN` if the value is a different
+			 * userdata.
+			 *
+			 * @see LuaType.TryPopValue()
+			 */
+			LuaError TryPopValue(LuaState &L, int idx);
+
 			/**
 			 * @brief Returns the `userdata` from the value
 			 *
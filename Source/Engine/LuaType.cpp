@@ -37,6 +37,15 @@ void LuaType::PopValue(LuaState &L) {
 	PopValue(L, -1);
 }
 
+LuaError LuaType::TryPopValue(LuaState &L, int idx) {
+	int type = lua_type(L, idx);
+	if (type != getTypeId()) {
+		return LuaError::Format(LuaError::ERRTYPE, "The value at the stack position %d is %s, expected %s", idx, lua_typename(L, type), lua_typename(L, getTypeId()));
+	}
+	PopValue(L, idx);
+	return LuaError();
+}
+
 void LuaType::PushGlobal(LuaState &L, std::string _globalName) {
 	PushValue(L);
 	globalName = std::move(_globalName);
@@ -59,6 +68,16 @@ void LuaType::PopGlobal(LuaState &L, std::string _global_name) {
 	PopGlobal(L);
 }
 
+LuaError LuaType::TryPopGlobal(LuaState &L) {
+	if (!global) {
+		return LuaError();
+	}
+	lua_getglobal(L, globalName.c_str());
+	LuaError error = TryPopValue(L, -1);
+	lua_pop(L,1);
+	return error;
+}
+
 bool LuaType::isGlobal() const {
 	return global;
 }
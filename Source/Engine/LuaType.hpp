@@ -28,6 +28,7 @@
 
 #include "../Lua.hpp"
 #include "LuaState.hpp"
+#include "LuaError.hpp"
 
 namespace LuaCpp {
 	namespace Engine {
@@ -140,6 +141,24 @@ namespace LuaCpp {
 			 */
 			virtual void PopValue(LuaState &L, int idx) = 0;
 
+			/**
+			 * @brief Reads the value from the stack without throwing exceptions
+			 *
+			 * @details
+			 * Checks the type of the value at the index and reads it with
+			 * `PopValue()` when the type matches the type of the instance.
+			 * On mismatch, the error `LuaError::ERRTYPE` is returned and
+			 * the instance remains unchanged.
+			 *
+			 * The stack will remain unchanged after the call.
+			 *
+			 * @param L LuaState representing the instance of the engine
+			 * @param idx the relative or absolute position of the variable on the stack
+			 *
+			 * @return the error, or no error if the value was read
+			 */
+			virtual LuaError TryPopValue(LuaState &L, int idx);
+
 			/**
 			 * @brief Provides a string representation of the value
 			 *
@@ -212,6 +231,18 @@ namespace LuaCpp {
 			 */
 			void PopGlobal(LuaState &L, std::string global_name);
 
+			/**
+			 * @brief Reads the value from the global variable without throwing exceptions
+			 *
+			 * @details
+			 * Same as `PopGlobal(LuaState &L)`, with the value read by `TryPopValue()`.
+			 *
+			 * @param L LuaState in from which the global variable will be read.
+			 *
+			 * @return the error, or no error if the value was read
+			 */
+			LuaError TryPopGlobal(LuaState &L);
+
 			/**
 			 * @brief ture if the instance is a global variable in a `lua` context
 			 *
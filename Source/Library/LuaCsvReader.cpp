@@ -0,0 +1,579 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "LuaCsvReader.hpp"
+#include "LuaStringOps.hpp"
+#include "../Async/LuaBindingHelpers.hpp"
+
+using namespace LuaCpp::Library;
+using LuaCpp::Async::Catch;
+
+namespace {
+
+	/**
+	 * @brief Skips the spaces around the number
+	 */
+	void Trim(const char *&str, size_t &length) {
+		while (length > 0 && (*str == ' ' || *str == '\t')) {
+			str++;
+			length--;
+		}
+		while (length > 0 && (str[length - 1] == ' ' || str[length - 1] == '\t')) {
+			length--;
+		}
+	}
+
+	bool ParseInteger(const char *str, size_t length, int64_t &value) {
+		Trim(str, length);
+		bool negative = false;
+		if (length > 0 && (*str == '-' || *str == '+')) {
+			negative = (*str == '-');
+			str++;
+			length--;
+		}
+		if (length == 0 || length > 19) {
+			return false;
+		}
+
+		uint64_t result = 0;
+		for (size_t i = 0; i < length; i++) {
+			unsigned digit = (unsigned char) str[i] - '0';
+			if (digit > 9) {
+				return false;
+			}
+			result = result * 10 + digit;
+		}
+		// 19 digits do not overflow 64 bits, only the range of the sign is checked
+		uint64_t limit = negative ? (uint64_t) std::numeric_limits<int64_t>::max() + 1 : (uint64_t) std::numeric_limits<int64_t>::max();
+		if (result > limit) {
+			return false;
+		}
+		value = negative ? (int64_t) (0 - result) : (int64_t) result;
+		return true;
+	}
+
+	bool ParseNumber(const char *str, size_t length, double &value) {
+		int64_t integer;
+		if (ParseInteger(str, length, integer)) {
+			value = (double) integer;
+			return true;
+		}
+
+		Trim(str, length);
+		char buff[64];
+		if (length == 0 || length >= sizeof(buff)) {
+			return false;
+		}
+		memcpy(buff, str, length);
+		buff[length] = '\0';
+		char *end;
+		value = strtod(buff, &end);
+		return end == buff + length;
+	}
+}
+
+LuaCsvReader::LuaCsvReader(const std::string &path, char _delimiter) : file(new LuaMappedFile(path)), data(file->data()), size(file->size()), position(0), delimiter(_delimiter), row(0) {
+	Init();
+}
+
+LuaCsvReader::LuaCsvReader(const char *content, size_t length, char _delimiter) : owned(content, length), data(nullptr), size(length), position(0), delimiter(_delimiter), row(0) {
+	data = owned.data();
+	Init();
+}
+
+void LuaCsvReader::Init() {
+	if (delimiter == '"' || delimiter == '\n' || delimiter == '\r') {
+		throw std::invalid_argument("Error: The delimiter can not be a quote or an end of the line");
+	}
+	set[0] = delimiter;
+	set[1] = '\n';
+	set[2] = '\r';
+}
+
+bool LuaCsvReader::Next() {
+	fields.clear();
+	while (position < size && (data[position] == '\n' || data[position] == '\r')) {
+		position++;
+	}
+	if (position >= size) {
+		return false;
+	}
+	row++;
+
+	while (true) {
+		Field field;
+		if (position < size && data[position] == '"') {
+			size_t start = position + 1;
+			size_t pos = start;
+			field.escaped = false;
+			while (true) {
+				size_t quote = pos + LuaStringOps::FindByte(data + pos, size - pos, '"');
+				if (quote + 1 < size && data[quote + 1] == '"') {
+					field.escaped = true;
+					pos = quote + 2;
+					continue;
+				}
+				// the quote that is not closed ends at the end of the content
+				field.offset = start;
+				field.length = (quote < size ? quote : size) - start;
+				position = quote < size ? quote + 1 : size;
+				break;
+			}
+			// the text between the closing quote and the delimiter is ignored
+			position += LuaStringOps::FindAnyOf(data + position, size - position, set, sizeof(set));
+		} else {
+			size_t length = LuaStringOps::FindAnyOf(data + position, size - position, set, sizeof(set));
+			field.offset = position;
+			field.length = length;
+			field.escaped = false;
+			position += length;
+		}
+		fields.push_back(field);
+
+		if (position >= size || data[position++] != delimiter) {
+			return true;
+		}
+	}
+}
+
+bool LuaCsvReader::ReadHeader() {
+	if (!Next()) {
+		return false;
+	}
+	header.clear();
+	for (size_t i = 0; i < fields.size(); i++) {
+		size_t length;
+		const char *name = getField(i, length);
+		header.emplace_back(name, length);
+	}
+	return true;
+}
+
+long LuaCsvReader::FindColumn(const char *name, size_t length) const {
+	for (size_t i = 0; i < header.size(); i++) {
+		if (header[i].size() == length && memcmp(header[i].data(), name, length) == 0) {
+			return (long) i;
+		}
+	}
+	return -1;
+}
+
+const char *LuaCsvReader::getField(size_t index, size_t &length) {
+	if (index >= fields.size()) {
+		length = 0;
+		return nullptr;
+	}
+
+	const Field &field = fields[index];
+	if (!field.escaped) {
+		length = field.length;
+		return data + field.offset;
+	}
+
+	scratch.clear();
+	const char *str = data + field.offset;
+	for (size_t i = 0; i < field.length; i++) {
+		scratch.push_back(str[i]);
+		if (str[i] == '"' && i + 1 < field.length && str[i + 1] == '"') {
+			i++;
+		}
+	}
+	length = scratch.size();
+	return scratch.data();
+}
+
+bool LuaCsvReader::getNumber(size_t index, double &value) {
+	size_t length;
+	const char *str = getField(index, length);
+	return str != nullptr && ParseNumber(str, length, value);
+}
+
+bool LuaCsvReader::getInteger(size_t index, int64_t &value) {
+	size_t length;
+	const char *str = getField(index, length);
+	return str != nullptr && ParseInteger(str, length, value);
+}
+
+size_t LuaCsvReader::ReadColumn(size_t index, std::vector<double> &values) {
+	size_t count = 0;
+	while (Next()) {
+		double value;
+		values.push_back(getNumber(index, value) ? value : std::numeric_limits<double>::quiet_NaN());
+		count++;
+	}
+	return count;
+}
+
+size_t LuaCsvReader::ReadColumn(size_t index, std::vector<int64_t> &values) {
+	size_t count = 0;
+	while (Next()) {
+		int64_t value;
+		if (!getInteger(index, value)) {
+			throw std::invalid_argument("Error: The field " + std::to_string(index + 1) + " of the record " + std::to_string(row) + " is not an integer");
+		}
+		values.push_back(value);
+		count++;
+	}
+	return count;
+}
+
+namespace {
+
+	const char *COLUMN_METATABLE = "csv.column";
+
+	/**
+	 * @brief Numbers of a column, stored after the header in the same userdata
+	 */
+	struct Column {
+		bool integer;
+		size_t count;
+
+		inline double *numbers() { return (double *) (this + 1); }
+		inline int64_t *integers() { return (int64_t *) (this + 1); }
+	};
+
+	LuaCsvReader *Check(lua_State *L) {
+		LuaCsvReader *reader = *(LuaCsvReader **) luaL_checkudata(L, 1, LuaCsvReader::METATABLE);
+		if (reader == nullptr) {
+			luaL_error(L, "the reader is closed");
+		}
+		return reader;
+	}
+
+	/**
+	 * @brief Returns the index of the column at the position of the stack, from 0
+	 */
+	size_t CheckColumn(lua_State *L, LuaCsvReader *reader, int arg) {
+		if (lua_type(L, arg) == LUA_TSTRING) {
+			size_t length;
+			const char *name = lua_tolstring(L, arg, &length);
+			long index = reader->FindColumn(name, length);
+			if (index < 0) {
+				luaL_argerror(L, arg, "unknown column");
+			}
+			return (size_t) index;
+		}
+		lua_Integer index = luaL_checkinteger(L, arg);
+		luaL_argcheck(L, index >= 1, arg, "the column is counted from 1");
+		return (size_t) (index - 1);
+	}
+
+	void PushNumber(lua_State *L, LuaCsvReader *reader, size_t index) {
+		int64_t integer;
+		double number;
+		if (reader->getInteger(index, integer)) {
+			lua_pushinteger(L, (lua_Integer) integer);
+		} else if (reader->getNumber(index, number)) {
+			lua_pushnumber(L, (lua_Number) number);
+		} else {
+			lua_pushnil(L);
+		}
+	}
+
+	/**
+	 * @brief Creates the reader in the userdata on the top, returns `false` with the message and the code of the error
+	 */
+	bool Open(LuaCsvReader **slot, const char *path, const char *content, size_t length, char delimiter, bool header, char *error, int &code) {
+		return Catch([=]() {
+			*slot = content != nullptr ? new LuaCsvReader(content, length, delimiter) : new LuaCsvReader(path, delimiter);
+			if (header) {
+				(*slot)->ReadHeader();
+			}
+		}, error, &code);
+	}
+
+	int PushReader(lua_State *L, const char *path, const char *content, size_t length) {
+		char delimiter = ',';
+		bool header = false;
+		if (!lua_isnoneornil(L, 2)) {
+			luaL_checktype(L, 2, LUA_TTABLE);
+			lua_getfield(L, 2, "delimiter");
+			if (!lua_isnil(L, -1)) {
+				size_t len;
+				const char *str = luaL_checklstring(L, -1, &len);
+				luaL_argcheck(L, len == 1, 2, "the delimiter must be one character");
+				delimiter = str[0];
+			}
+			lua_getfield(L, 2, "header");
+			header = lua_toboolean(L, -1);
+			lua_pop(L, 2);
+		}
+
+		LuaCsvReader **slot = (LuaCsvReader **) lua_newuserdata(L, sizeof(LuaCsvReader *));
+		*slot = nullptr;
+		luaL_getmetatable(L, LuaCsvReader::METATABLE);
+		lua_setmetatable(L, -2);
+
+		char error[LUACPP_ERROR_MESSAGE_SIZE];
+		int code = 0;
+		if (!Open(slot, path, content, length, delimiter, header, error, code)) {
+			if (content != nullptr) {
+				return luaL_error(L, "%s", error);
+			}
+			lua_pushnil(L);
+			lua_pushstring(L, error);
+			lua_pushinteger(L, code);
+			return 3;
+		}
+		return 1;
+	}
+
+	int OpenFile(lua_State *L) {
+		return PushReader(L, luaL_checkstring(L, 1), nullptr, 0);
+	}
+
+	int ParseString(lua_State *L) {
+		size_t length;
+		const char *content = luaL_checklstring(L, 1, &length);
+		return PushReader(L, nullptr, content, length);
+	}
+
+	int Next(lua_State *L) {
+		lua_pushboolean(L, Check(L)->Next());
+		return 1;
+	}
+
+	int RowsIterator(lua_State *L) {
+		if (!Check(L)->Next()) {
+			return 0;
+		}
+		lua_pushvalue(L, 1);
+		return 1;
+	}
+
+	int Rows(lua_State *L) {
+		Check(L);
+		lua_pushcfunction(L, RowsIterator);
+		lua_pushvalue(L, 1);
+		return 2;
+	}
+
+	int Get(lua_State *L) {
+		LuaCsvReader *reader = Check(L);
+		size_t length;
+		const char *field = reader->getField(CheckColumn(L, reader, 2), length);
+		if (field == nullptr) {
+			lua_pushnil(L);
+		} else {
+			lua_pushlstring(L, field, length);
+		}
+		return 1;
+	}
+
+	int Number(lua_State *L) {
+		LuaCsvReader *reader = Check(L);
+		PushNumber(L, reader, CheckColumn(L, reader, 2));
+		return 1;
+	}
+
+	int Integer(lua_State *L) {
+		LuaCsvReader *reader = Check(L);
+		int64_t value;
+		if (reader->getInteger(CheckColumn(L, reader, 2), value)) {
+			lua_pushinteger(L, (lua_Integer) value);
+		} else {
+			lua_pushnil(L);
+		}
+		return 1;
+	}
+
+	int Fields(lua_State *L) {
+		LuaCsvReader *reader = Check(L);
+		int count = (int) reader->getFieldCount();
+		luaL_checkstack(L, count, "too many fields");
+		for (int i = 0; i < count; i++) {
+			size_t length;
+			const char *field = reader->getField((size_t) i, length);
+			lua_pushlstring(L, field, length);
+		}
+		return count;
+	}
+
+	int Count(lua_State *L) {
+		lua_pushinteger(L, (lua_Integer) Check(L)->getFieldCount());
+		return 1;
+	}
+
+	int Row(lua_State *L) {
+		lua_pushinteger(L, (lua_Integer) Check(L)->getRow());
+		return 1;
+	}
+
+	int Header(lua_State *L) {
+		LuaCsvReader *reader = Check(L);
+		const std::vector<std::string> &header = reader->getHeader();
+		if (header.empty()) {
+			lua_pushnil(L);
+			return 1;
+		}
+		lua_createtable(L, (int) header.size(), 0);
+		for (size_t i = 0; i < header.size(); i++) {
+			lua_pushlstring(L, header[i].data(), header[i].size());
+			lua_rawseti(L, -2, (int) i + 1);
+		}
+		return 1;
+	}
+
+	Column *CheckColumnBuffer(lua_State *L) {
+		return (Column *) luaL_checkudata(L, 1, COLUMN_METATABLE);
+	}
+
+	int ColumnGet(lua_State *L) {
+		Column *column = CheckColumnBuffer(L);
+		lua_Integer index = luaL_checkinteger(L, 2);
+		if (index < 1 || (size_t) index > column->count) {
+			lua_pushnil(L);
+		} else if (column->integer) {
+			lua_pushinteger(L, (lua_Integer) column->integers()[index - 1]);
+		} else {
+			lua_pushnumber(L, (lua_Number) column->numbers()[index - 1]);
+		}
+		return 1;
+	}
+
+	int ColumnSum(lua_State *L) {
+		Column *column = CheckColumnBuffer(L);
+		if (column->integer) {
+			int64_t sum = 0;
+			for (size_t i = 0; i < column->count; i++) {
+				sum += column->integers()[i];
+			}
+			lua_pushinteger(L, (lua_Integer) sum);
+		} else {
+			double sum = 0;
+			for (size_t i = 0; i < column->count; i++) {
+				if (!std::isnan(column->numbers()[i])) {
+					sum += column->numbers()[i];
+				}
+			}
+			lua_pushnumber(L, (lua_Number) sum);
+		}
+		return 1;
+	}
+
+	int ColumnLength(lua_State *L) {
+		lua_pushinteger(L, (lua_Integer) CheckColumnBuffer(L)->count);
+		return 1;
+	}
+
+	void PushColumnMetatable(lua_State *L) {
+		if (luaL_newmetatable(L, COLUMN_METATABLE)) {
+			lua_newtable(L);
+			lua_pushcfunction(L, ColumnGet);
+			lua_setfield(L, -2, "get");
+			lua_pushcfunction(L, ColumnSum);
+			lua_setfield(L, -2, "sum");
+			lua_setfield(L, -2, "__index");
+			lua_pushcfunction(L, ColumnLength);
+			lua_setfield(L, -2, "__len");
+		}
+	}
+
+	/**
+	 * @brief Reads the column into the vectors, returns `false` with the message
+	 */
+	bool ReadColumn(LuaCsvReader *reader, size_t index, bool integer, std::vector<double> &numbers, std::vector<int64_t> &integers, char *error) {
+		return Catch([&]() {
+			if (integer) {
+				reader->ReadColumn(index, integers);
+			} else {
+				reader->ReadColumn(index, numbers);
+			}
+		}, error);
+	}
+
+	/**
+	 * @brief Copies the numbers into the new buffer on the top of the stack
+	 */
+	void PushColumn(lua_State *L, bool integer, const void *values, size_t count) {
+		Column *column = (Column *) lua_newuserdata(L, sizeof(Column) + count * sizeof(double));
+		column->integer = integer;
+		column->count = count;
+		if (count > 0) {
+			memcpy(column + 1, values, count * sizeof(double));
+		}
+		PushColumnMetatable(L);
+		lua_setmetatable(L, -2);
+	}
+
+	int ExtractColumn(lua_State *L) {
+		LuaCsvReader *reader = Check(L);
+		size_t index = CheckColumn(L, reader, 2);
+		const char *type = luaL_optstring(L, 3, "number");
+		bool integer = strcmp(type, "integer") == 0;
+		luaL_argcheck(L, integer || strcmp(type, "number") == 0, 3, "the type is 'number' or 'integer'");
+		PushColumnMetatable(L);
+		lua_pop(L, 1);
+
+		char error[LUACPP_ERROR_MESSAGE_SIZE];
+		bool read;
+		{
+			std::vector<double> numbers;
+			std::vector<int64_t> integers;
+			read = ReadColumn(reader, index, integer, numbers, integers, error);
+			if (read) {
+				// the buffer is the only allocation of the state while the vectors are alive
+				PushColumn(L, integer, integer ? (const void *) integers.data() : (const void *) numbers.data(), integer ? integers.size() : numbers.size());
+			}
+		}
+		if (!read) {
+			return luaL_error(L, "%s", error);
+		}
+		return 1;
+	}
+
+	int Close(lua_State *L) {
+		LuaCsvReader **slot = (LuaCsvReader **) luaL_checkudata(L, 1, LuaCsvReader::METATABLE);
+		delete *slot;
+		*slot = nullptr;
+		return 0;
+	}
+}
+
+static_assert(sizeof(double) == sizeof(int64_t), "the column stores the numbers and the integers in the same slots");
+
+LuaCsvLibrary::LuaCsvLibrary() : LuaLibrary("csv", LuaCsvReader::METATABLE) {
+	AddCFunction("open", OpenFile);
+	AddCFunction("parse", ParseString);
+
+	AddCMethod("next", Next);
+	AddCMethod("rows", Rows);
+	AddCMethod("get", Get);
+	AddCMethod("number", Number);
+	AddCMethod("integer", Integer);
+	AddCMethod("fields", Fields);
+	AddCMethod("count", Count);
+	AddCMethod("row", Row);
+	AddCMethod("header", Header);
+	AddCMethod("column", ExtractColumn);
+	AddCMethod("close", Close);
+
+	AddCMetaMethod("__gc", Close);
+}
@@ -0,0 +1,206 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUACSVREADER_HPP
+#define LUACPP_LUACSVREADER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Lua.hpp"
+#include "../Registry/LuaLibrary.hpp"
+#include "LuaMappedFile.hpp"
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief Reader of the CSV records, one at a time
+		 *
+		 * @details
+		 * The reader parses the content in place, each record is kept as the
+		 * positions of its fields, and only the fields with the escaped quotes
+		 * are copied when read. The delimiters, the quotes and the ends of 
+		 * the lines are found by the LuaStringOps::FindAnyOf().
+		 *
+		 * The fields may be quoted with `"`, the quote in a quoted field is
+		 * doubled. The lines end with `\n` or `\r\n`, and the empty lines
+		 * are skipped.
+		 */
+		class LuaCsvReader {
+		   private:
+			struct Field {
+				size_t offset;
+				size_t length;
+				bool escaped;
+			};
+
+			std::unique_ptr<LuaMappedFile> file;
+			std::string owned;
+			const char *data;
+			size_t size;
+			size_t position;
+			char delimiter;
+			char set[3];
+			uint64_t row;
+			std::vector<Field> fields;
+			std::vector<std::string> header;
+			std::string scratch;
+
+			void Init();
+
+		   public:
+			static constexpr const char *METATABLE = "csv.reader";
+
+			/**
+			 * @brief Creates the reader of the memory mapped file
+			 *
+			 * @details
+			 * Throws `std::system_error` if the file can not be mapped.
+			 */
+			LuaCsvReader(const std::string &path, char delimiter);
+
+			/**
+			 * @brief Creates the reader of a copy of the content
+			 */
+			LuaCsvReader(const char *content, size_t length, char delimiter);
+
+			/**
+			 * @brief Moves to the next record
+			 *
+			 * @return `false` at the end of the content
+			 */
+			bool Next();
+
+			/**
+			 * @brief Reads the next record as the names of the columns
+			 *
+			 * @return `false` if the content is empty
+			 */
+			bool ReadHeader();
+
+			/**
+			 * @brief Returns the names of the columns read by ReadHeader()
+			 */
+			inline const std::vector<std::string> &getHeader() const { return header; }
+
+			/**
+			 * @brief Returns the index of the named column, `-1` if there is none
+			 */
+			long FindColumn(const char *name, size_t length) const;
+
+			/**
+			 * @brief Returns the number of the fields of the current record
+			 */
+			inline size_t getFieldCount() const { return fields.size(); }
+
+			/**
+			 * @brief Returns the number of the current record, counted from 1
+			 */
+			inline uint64_t getRow() const { return row; }
+
+			/**
+			 * @brief Returns the field of the current record
+			 *
+			 * @details
+			 * The pointer is valid until the next call, or until the next
+			 * record for the fields without the escaped quotes.
+			 *
+			 * @param index the index of the field, from 0
+			 * @param length the length of the field
+			 * @return the field, `nullptr` if the index is out of the range
+			 */
+			const char *getField(size_t index, size_t &length);
+
+			/**
+			 * @brief Parses the field as a number
+			 *
+			 * @return `false` if the field is missing or is not a number
+			 */
+			bool getNumber(size_t index, double &value);
+
+			/**
+			 * @brief Parses the field as an integer
+			 *
+			 * @return `false` if the field is missing or is not an integer
+			 */
+			bool getInteger(size_t index, int64_t &value);
+
+			/**
+			 * @brief Reads the column of the remaining records as the numbers
+			 *
+			 * @details
+			 * The fields that are missing or are not numbers are stored as NaN.
+			 *
+			 * @return the number of the records read
+			 */
+			size_t ReadColumn(size_t index, std::vector<double> &values);
+
+			/**
+			 * @brief Reads the column of the remaining records as the integers
+			 *
+			 * @details
+			 * Throws `std::invalid_argument` if a field is not an integer, 
+			 * the records before it are consumed.
+			 *
+			 * @return the number of the records read
+			 */
+			size_t ReadColumn(size_t index, std::vector<int64_t> &values);
+		};
+
+		/**
+		 * @brief Library `csv` reading the CSV files
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `csv.open(path [, options])` maps the file and returns the reader,
+		 *    or `nil`, the message and the code of the error
+		 *  - `csv.parse(s [, options])` returns the reader of the string
+		 *
+		 * The options are `delimiter`, one character, `,` by default, and 
+		 * `header`, which reads the first record as the names of the columns.
+		 *
+		 * The reader is a cursor, which is moved by `reader:next()` or by
+		 * `for r in reader:rows() do ... end`. The fields of the current 
+		 * record are read by the index, from 1, or by the name of the column
+		 * with `r:get(col)`, `r:number(col)` and `r:integer(col)`, which return
+		 * `nil` for the missing fields and the invalid numbers, and 
+		 * `r:fields()`, which returns all of them. No table is created for 
+		 * the records.
+		 *
+		 * The `reader:column(col [, "integer"])` reads the column of the 
+		 * remaining records into a buffer of the numbers, with the methods
+		 * `get(i)`, `sum()` and the length operator.
+		 */
+		class LuaCsvLibrary : public Registry::LuaLibrary {
+		   public:
+			LuaCsvLibrary();
+		};
+	}
+}
+
+#endif // LUACPP_LUACSVREADER_HPP
@@ -0,0 +1,192 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "LuaLogLibrary.hpp"
+
+using namespace LuaCpp::Library;
+using namespace LuaCpp::Diagnostics;
+
+namespace {
+
+	/**
+	 * @brief Joins the arguments of `print` with tabs into the buffer, returns the length
+	 *
+	 * @details
+	 * The arguments are converted as by `print`, with `__tostring`. The
+	 * strings replace the arguments, so they can not be collected while
+	 * they are copied.
+	 */
+	size_t JoinArguments(lua_State *L, char *buff, size_t size) {
+		size_t length = 0;
+		int top = lua_gettop(L);
+		for (int i = 1; i <= top && length < size; i++) {
+			if (i > 1) {
+				buff[length++] = '\t';
+			}
+
+			size_t len;
+			const char *str = luaL_tolstring(L, i, &len);
+			lua_replace(L, i);
+
+			if (len > size - length) {
+				len = size - length;
+			}
+			memcpy(buff + length, str, len);
+			length += len;
+		}
+		return length;
+	}
+
+	std::shared_ptr<LuaLogger> Resolve(const std::shared_ptr<LuaLogger> &logger) {
+		return logger ? logger : LuaLogger::getDefault();
+	}
+
+	/**
+	 * @brief Writes the arguments to the logger, or to the standard output
+	 *
+	 * @details
+	 * The logger is resolved after the calls to the Lua API, which could
+	 * raise an error skipping the destructors.
+	 */
+	int PrintTo(lua_State *L, const std::shared_ptr<LuaLogger> &owner) {
+		char buff[LUACPP_LOG_RECORD_SIZE];
+		size_t length = JoinArguments(L, buff, sizeof(buff));
+		std::shared_ptr<LuaLogger> logger = Resolve(owner);
+		if (logger) {
+			logger->Log(LuaLogLevel::Info, buff, length);
+		} else {
+			fwrite(buff, 1, length, stdout);
+			fputc('\n', stdout);
+			fflush(stdout);
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief Logs the message at the index 1 with the fields of the table at the index 2
+	 *
+	 * @details
+	 * The values are kept on the stack until the record is written, so the 
+	 * strings converted from the numbers can not be collected.
+	 */
+	int LogAt(lua_State *L, const std::shared_ptr<LuaLogger> &owner, LuaLogLevel level) {
+		{
+			std::shared_ptr<LuaLogger> logger = Resolve(owner);
+			if (!logger || !logger->isEnabled(level)) {
+				return 0;
+			}
+		}
+
+		size_t length;
+		const char *message = luaL_checklstring(L, 1, &length);
+		LuaLogField fields[LuaLogLibrary::MAX_FIELDS];
+		size_t count = 0;
+
+		if (!lua_isnoneornil(L, 2)) {
+			luaL_checktype(L, 2, LUA_TTABLE);
+			lua_settop(L, 2);
+			luaL_checkstack(L, LuaLogLibrary::MAX_FIELDS + 2, "too many fields");
+			lua_pushnil(L);
+			while (count < (size_t) LuaLogLibrary::MAX_FIELDS && lua_next(L, 2) != 0) {
+				if (lua_type(L, -2) != LUA_TSTRING) {
+					lua_pop(L, 1);
+					continue;
+				}
+
+				LuaLogField &field = fields[count++];
+				field.key = lua_tostring(L, -2);
+				switch (lua_type(L, -1)) {
+					case LUA_TSTRING:
+					case LUA_TNUMBER:
+						field.value = lua_tolstring(L, -1, &field.length);
+						break;
+					case LUA_TBOOLEAN:
+						field.value = lua_toboolean(L, -1) ? "true" : "false";
+						field.length = strlen(field.value);
+						break;
+					default:
+						field.value = luaL_typename(L, -1);
+						field.length = strlen(field.value);
+				}
+				// keeps the value below the key, which continues the traversal
+				lua_insert(L, -2);
+			}
+		}
+
+		std::shared_ptr<LuaLogger> logger = Resolve(owner);
+		if (logger) {
+			logger->Log(level, message, length, fields, count);
+		}
+		return 0;
+	}
+
+	bool IsEnabled(const std::shared_ptr<LuaLogger> &owner, LuaLogLevel level) {
+		std::shared_ptr<LuaLogger> logger = Resolve(owner);
+		return logger && logger->isEnabled(level);
+	}
+}
+
+LuaLogLibrary::LuaLogLibrary(std::shared_ptr<LuaLogger> logger) : LuaLibrary("log") {
+	const struct {
+		const char *name;
+		LuaLogLevel level;
+	} levels[] = {
+		{"trace", LuaLogLevel::Trace},
+		{"debug", LuaLogLevel::Debug},
+		{"info", LuaLogLevel::Info},
+		{"warn", LuaLogLevel::Warn},
+		{"error", LuaLogLevel::Error}
+	};
+
+	for (const auto &entry : levels) {
+		LuaLogLevel level = entry.level;
+		AddFunction(entry.name, [logger, level](lua_State *L) -> int {
+			return LogAt(L, logger, level);
+		});
+	}
+
+	AddFunction("print", [logger](lua_State *L) -> int {
+		return PrintTo(L, logger);
+	});
+
+	AddFunction("enabled", [logger](lua_State *L) -> int {
+		LuaLogLevel level;
+		if (!LuaLogger::ParseLevel(luaL_checkstring(L, 1), level)) {
+			return luaL_argerror(L, 1, "unknown level");
+		}
+		bool enabled = IsEnabled(logger, level);
+		lua_pushboolean(L, enabled);
+		return 1;
+	});
+}
+
+int LuaLogLibrary::Print(lua_State *L) {
+	// nothing to destroy if a `__tostring` raises the error
+	static const std::shared_ptr<LuaLogger> none;
+	return PrintTo(L, none);
+}
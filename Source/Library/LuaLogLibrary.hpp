@@ -0,0 +1,85 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUALOGLIBRARY_HPP
+#define LUACPP_LUALOGLIBRARY_HPP
+
+#include <memory>
+
+#include "../Lua.hpp"
+#include "../Registry/LuaLibrary.hpp"
+#include "../Diagnostics/LuaLogger.hpp"
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief Library `log` writing to a LuaLogger
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `log.trace(msg [, fields])`, `log.debug`, `log.info`, `log.warn` 
+		 *    and `log.error` log the message with the fields of the table,
+		 *    ex. `log.info("served", {path = p, ms = 12})`
+		 *  - `log.print(...)` logs the arguments like `print` at the `INFO` level
+		 *  - `log.enabled(level)` checks if the level, ex. `"debug"`, is logged
+		 *
+		 * Only the string keys of the table are logged, at most 16 of them. 
+		 * The calls return immediately, the record is written by the thread
+		 * of the logger, or dropped when the buffer of the calling thread is
+		 * full.
+		 */
+		class LuaLogLibrary : public Registry::LuaLibrary {
+		   public:
+			/**
+			 * @brief Maximum number of the fields of a record
+			 */
+			static const int MAX_FIELDS = 16;
+
+			/**
+			 * @brief Creates the library
+			 *
+			 * @param logger the logger, the default logger if `nullptr`
+			 */
+			explicit LuaLogLibrary(std::shared_ptr<Diagnostics::LuaLogger> logger = nullptr);
+
+			/**
+			 * @brief Replacement of `print` writing to the default logger
+			 *
+			 * @details
+			 * Writes the arguments to the standard output, as `print`, when 
+			 * the default logger is not set. Replaces the `print` of the new
+			 * states with
+			 *
+			 * ```
+			 * ctx.setBuiltInFnc("print", LuaLogLibrary::Print, true);
+			 * ```
+			 */
+			static int Print(lua_State *L);
+		};
+	}
+}
+
+#endif // LUACPP_LUALOGLIBRARY_HPP
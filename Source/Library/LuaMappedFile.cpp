@@ -0,0 +1,125 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cerrno>
+#include <system_error>
+
+#include "LuaMappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace LuaCpp::Library;
+
+#ifdef _WIN32
+
+LuaMappedFile::LuaMappedFile(const std::string &path) : content(nullptr), length(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (handle == INVALID_HANDLE_VALUE) {
+		throw std::system_error((int) GetLastError(), std::system_category(), path);
+	}
+	file = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize)) {
+		DWORD error = GetLastError();
+		CloseHandle(handle);
+		throw std::system_error((int) error, std::system_category(), path);
+	}
+	length = (size_t) fileSize.QuadPart;
+	if (length == 0) {
+		return;
+	}
+
+	mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != nullptr) {
+		content = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (content == nullptr) {
+		DWORD error = GetLastError();
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(handle);
+		throw std::system_error((int) error, std::system_category(), path);
+	}
+}
+
+LuaMappedFile::~LuaMappedFile() {
+	if (content != nullptr) {
+		UnmapViewOfFile(content);
+	}
+	if (mapping != nullptr) {
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+}
+
+#else
+
+LuaMappedFile::LuaMappedFile(const std::string &path) : content(nullptr), length(0) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::system_error(errno, std::generic_category(), path);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int error = errno;
+		close(fd);
+		throw std::system_error(error, std::generic_category(), path);
+	}
+	length = (size_t) st.st_size;
+
+	if (length > 0) {
+		void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) {
+			int error = errno;
+			close(fd);
+			throw std::system_error(error, std::generic_category(), path);
+		}
+		// the file is read once from the start to the end
+		madvise(addr, length, MADV_SEQUENTIAL);
+		content = (const char *) addr;
+	}
+	// the mapping stays valid after the descriptor is closed
+	close(fd);
+}
+
+LuaMappedFile::~LuaMappedFile() {
+	if (content != nullptr) {
+		munmap((void *) content, length);
+	}
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAMAPPEDFILE_HPP
+#define LUACPP_LUAMAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief Read only memory mapping of a whole file
+		 *
+		 * @details
+		 * The content is mapped when the object is created and unmapped 
+		 * when it is destroyed. The empty files are not mapped, `data()` 
+		 * returns `nullptr` for them. Throws `std::system_error` with the
+		 * code of the system if the file can not be opened or mapped.
+		 */
+		class LuaMappedFile {
+		   private:
+			const char *content;
+			size_t length;
+#ifdef _WIN32
+			void *file;
+			void *mapping;
+#endif
+
+		   public:
+			/**
+			 * @brief Maps the file
+			 *
+			 * @param path the path of the file
+			 */
+			explicit LuaMappedFile(const std::string &path);
+
+			LuaMappedFile(const LuaMappedFile &) = delete;
+			LuaMappedFile &operator=(const LuaMappedFile &) = delete;
+
+			~LuaMappedFile();
+
+			/**
+			 * @brief Returns the mapped content
+			 */
+			inline const char *data() const { return content; }
+
+			/**
+			 * @brief Returns the size of the file
+			 */
+			inline size_t size() const { return length; }
+		};
+	}
+}
+
+#endif // LUACPP_LUAMAPPEDFILE_HPP
@@ -0,0 +1,495 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#ifdef LUACPP_HAS_RE2
+#include <re2/re2.h>
+#else
+#include <regex>
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+#endif
+
+#include "LuaRegexLibrary.hpp"
+#include "../Async/LuaBindingHelpers.hpp"
+
+using namespace LuaCpp::Library;
+using LuaCpp::Async::Guarded;
+
+#ifndef LUACPP_HAS_RE2
+// std::regex uses about 256 bytes of the stack for each character searched by a repetition
+#ifndef LUACPP_REGEX_STACK_PER_CHAR
+#define LUACPP_REGEX_STACK_PER_CHAR 256
+#endif
+
+// the longest text searched by a repetition when the stack of the thread is not known
+#ifndef LUACPP_REGEX_MAX_SUBJECT
+#define LUACPP_REGEX_MAX_SUBJECT 2048
+#endif
+#endif
+
+#ifdef LUACPP_HAS_RE2
+struct LuaRegexCache::Pattern {
+	std::unique_ptr<re2::RE2> regex;
+};
+#else
+struct LuaRegexCache::Pattern {
+	std::regex regex;
+	size_t cost;
+};
+#endif
+
+namespace {
+
+	/**
+	 * @brief Key of the cache in the registry of the state
+	 */
+	char cacheKey = 0;
+
+	/**
+	 * @brief Maximum number of the groups, as for the Lua patterns
+	 */
+	const unsigned MAX_CAPTURES = 32;
+
+	struct Slice {
+		size_t start;
+		size_t length;
+		bool matched;
+	};
+
+	/**
+	 * @brief Positions of the match, kept without the C++ objects so the Lua errors can not leak them
+	 */
+	struct Match {
+		bool found;
+		unsigned count;
+		Slice slices[MAX_CAPTURES + 1];
+	};
+
+#ifndef LUACPP_HAS_RE2
+	/**
+	 * @brief Skips the quantifier `{n}`, `{n,}` or `{n,m}`, returns `false` if the brace is a literal
+	 */
+	bool SkipBraces(const char *pattern, size_t length, size_t &i, bool &unbounded) {
+		size_t j = i + 1;
+		while (j < length && pattern[j] >= '0' && pattern[j] <= '9') {
+			j++;
+		}
+		if (j == i + 1) {
+			return false;
+		}
+		unbounded = false;
+		if (j < length && pattern[j] == ',') {
+			j++;
+			unbounded = j < length && pattern[j] == '}';
+			while (j < length && pattern[j] >= '0' && pattern[j] <= '9') {
+				j++;
+			}
+		}
+		if (j >= length || pattern[j] != '}') {
+			return false;
+		}
+		i = j;
+		return true;
+	}
+
+	/**
+	 * @brief Returns the stack used for each searched character, 0 without the repetitions
+	 *
+	 * @details
+	 * The repeated atoms cost 1 and the repeated groups 2. Throws 
+	 * `std::invalid_argument` for an unbounded repetition of a group that 
+	 * contains an unbounded repetition, which backtracks exponentially.
+	 */
+	size_t RepetitionCost(const char *pattern, size_t length) {
+		// the groups that are open, true when they contain an unbounded repetition
+		std::vector<bool> groups(1, false);
+		size_t cost = 0;
+		bool group = false;
+		bool groupUnbounded = false;
+
+		for (size_t i = 0; i < length; i++) {
+			bool unbounded = true;
+			switch (pattern[i]) {
+				case '\\':
+					i++;
+					group = false;
+					break;
+				case '[':
+					// the closing bracket is literal at the start of the class
+					i++;
+					if (i < length && pattern[i] == '^') {
+						i++;
+					}
+					if (i < length && pattern[i] == ']') {
+						i++;
+					}
+					while (i < length && pattern[i] != ']') {
+						i += pattern[i] == '\\' ? 2 : 1;
+					}
+					group = false;
+					break;
+				case '(':
+					groups.push_back(false);
+					if (i + 1 < length && pattern[i + 1] == '?') {
+						i += 2;
+					}
+					group = false;
+					break;
+				case ')':
+					groupUnbounded = groups.back();
+					if (groups.size() > 1) {
+						groups.pop_back();
+					}
+					if (groupUnbounded) {
+						groups.back() = true;
+					}
+					group = true;
+					break;
+				case '{':
+					if (!SkipBraces(pattern, length, i, unbounded)) {
+						group = false;
+						break;
+					}
+					// fall through
+				case '*':
+				case '+':
+					if (group && groupUnbounded && unbounded) {
+						throw std::invalid_argument("invalid pattern: nested repetition");
+					}
+					cost = std::max(cost, group ? (size_t) 2 : (size_t) 1);
+					if (unbounded) {
+						groups.back() = true;
+					}
+					// the lazy quantifiers
+					if (i + 1 < length && pattern[i + 1] == '?') {
+						i++;
+					}
+					group = false;
+					break;
+				default:
+					group = false;
+					break;
+			}
+		}
+		return cost;
+	}
+
+	/**
+	 * @brief Returns the stack left below the caller, 0 when it is not known
+	 */
+	size_t StackLeft() {
+#if defined(__linux__)
+		pthread_attr_t attr;
+		if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+			return 0;
+		}
+		void *base = nullptr;
+		size_t size = 0;
+		int status = pthread_attr_getstack(&attr, &base, &size);
+		pthread_attr_destroy(&attr);
+		char here = 0;
+		uintptr_t top = (uintptr_t) &here;
+		if (status != 0 || top <= (uintptr_t) base) {
+			return 0;
+		}
+		return top - (uintptr_t) base;
+#else
+		return 0;
+#endif
+	}
+
+	/**
+	 * @brief Returns the longest text a pattern of the cost may search on this thread
+	 *
+	 * @details
+	 * Half of the stack left is kept for the frames of the caller and of Lua.
+	 */
+	size_t SubjectLimit(size_t cost) {
+		if (cost == 0) {
+			return SIZE_MAX;
+		}
+		size_t left = StackLeft();
+		if (left == 0) {
+			return LUACPP_REGEX_MAX_SUBJECT / cost;
+		}
+		return left / 2 / (LUACPP_REGEX_STACK_PER_CHAR * cost);
+	}
+#endif
+
+	int CollectCache(lua_State *L) {
+		((LuaRegexCache *) lua_touserdata(L, 1))->~LuaRegexCache();
+		return 0;
+	}
+
+	/**
+	 * @brief Searches the subject, throws if the pattern is not valid or can not search it
+	 */
+	void Search(LuaRegexCache &cache, const char *subject, size_t length, size_t from, const char *pattern, size_t patternLength, const char *flags, Match &match) {
+		const LuaRegexCache::Pattern &compiled = cache.Get(pattern, patternLength, flags);
+#ifdef LUACPP_HAS_RE2
+		const re2::RE2 &regex = *compiled.regex;
+		int groups = regex.NumberOfCapturingGroups();
+		if (groups < 0 || (unsigned) groups > MAX_CAPTURES) {
+			throw std::length_error("too many captures");
+		}
+
+		// the whole subject is the context, so the text before the start is visible to the anchors and the word boundaries
+		re2::StringPiece result[MAX_CAPTURES + 1];
+		match.found = regex.Match(re2::StringPiece(subject, length), from, length, re2::RE2::UNANCHORED, result, groups + 1);
+		match.count = match.found ? (unsigned) groups + 1 : 0;
+		for (unsigned i = 0; i < match.count; i++) {
+			match.slices[i].matched = result[i].data() != nullptr;
+			match.slices[i].start = match.slices[i].matched ? (size_t) (result[i].data() - subject) : 0;
+			match.slices[i].length = match.slices[i].matched ? (size_t) result[i].size() : 0;
+		}
+#else
+		const std::regex &regex = compiled.regex;
+		if (regex.mark_count() > MAX_CAPTURES) {
+			throw std::length_error("too many captures");
+		}
+		size_t limit = SubjectLimit(compiled.cost);
+		if (length - from > limit) {
+			char message[LUACPP_ERROR_MESSAGE_SIZE];
+			snprintf(message, sizeof(message), "subject too long for the repetition (%lu bytes, limit %lu)", (unsigned long) (length - from), (unsigned long) limit);
+			throw std::length_error(message);
+		}
+
+		// the text before the start is visible to the anchors and the word boundaries
+		std::cmatch result;
+		std::regex_constants::match_flag_type matchFlags = from > 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+		match.found = std::regex_search(subject + from, subject + length, result, regex, matchFlags);
+		match.count = match.found ? (unsigned) result.size() : 0;
+		for (unsigned i = 0; i < match.count; i++) {
+			match.slices[i].matched = result[i].matched;
+			match.slices[i].start = result[i].matched ? (size_t) (result[i].first - subject) : 0;
+			match.slices[i].length = result[i].matched ? (size_t) result[i].length() : 0;
+		}
+#endif
+	}
+
+	int PushCaptures(lua_State *L, const char *subject, const Match &match, bool whole) {
+		if (match.count == 1) {
+			if (!whole) {
+				return 0;
+			}
+			lua_pushlstring(L, subject + match.slices[0].start, match.slices[0].length);
+			return 1;
+		}
+		luaL_checkstack(L, (int) match.count, "too many captures");
+		for (unsigned i = 1; i < match.count; i++) {
+			if (match.slices[i].matched) {
+				lua_pushlstring(L, subject + match.slices[i].start, match.slices[i].length);
+			} else {
+				lua_pushboolean(L, 0);
+			}
+		}
+		return (int) match.count - 1;
+	}
+
+	int Run(lua_State *L, size_t capacity, bool find) {
+		size_t length = 0;
+		size_t patternLength = 0;
+		const char *subject = luaL_checklstring(L, 1, &length);
+		const char *pattern = luaL_checklstring(L, 2, &patternLength);
+		lua_Integer init = luaL_optinteger(L, 3, 1);
+		const char *flags = luaL_optstring(L, 4, "");
+		LuaRegexCache *cache = LuaRegexCache::Create(L, capacity);
+
+		// the negative positions count from the end, as for string.find
+		if (init < 0) {
+			init = (lua_Integer) length + init + 1;
+		}
+		if (init < 1) {
+			init = 1;
+		}
+		if ((size_t) init > length + 1) {
+			lua_pushnil(L);
+			return 1;
+		}
+
+		Match match;
+		Guarded(L, [&]() {
+			Search(*cache, subject, length, (size_t) init - 1, pattern, patternLength, flags, match);
+		});
+		if (!match.found) {
+			lua_pushnil(L);
+			return 1;
+		}
+		if (!find) {
+			return PushCaptures(L, subject, match, true);
+		}
+		lua_pushinteger(L, (lua_Integer) match.slices[0].start + 1);
+		lua_pushinteger(L, (lua_Integer) (match.slices[0].start + match.slices[0].length));
+		return 2 + PushCaptures(L, subject, match, false);
+	}
+
+	int Iterate(lua_State *L) {
+		size_t length = 0;
+		size_t patternLength = 0;
+		const char *subject = lua_tolstring(L, lua_upvalueindex(1), &length);
+		const char *pattern = lua_tolstring(L, lua_upvalueindex(2), &patternLength);
+		const char *flags = lua_tostring(L, lua_upvalueindex(3));
+		size_t from = (size_t) lua_tointeger(L, lua_upvalueindex(4));
+		LuaRegexCache *cache = LuaRegexCache::From(L);
+		if (from > length || cache == nullptr) {
+			return 0;
+		}
+
+		Match match;
+		Guarded(L, [&]() {
+			Search(*cache, subject, length, from, pattern, patternLength, flags, match);
+		});
+		if (!match.found) {
+			lua_pushinteger(L, (lua_Integer) length + 1);
+			lua_replace(L, lua_upvalueindex(4));
+			return 0;
+		}
+
+		// the empty matches move the search forward by one byte
+		size_t end = match.slices[0].start + match.slices[0].length;
+		lua_pushinteger(L, (lua_Integer) (match.slices[0].length == 0 ? end + 1 : end));
+		lua_replace(L, lua_upvalueindex(4));
+		return PushCaptures(L, subject, match, true);
+	}
+
+	int GMatch(lua_State *L, size_t capacity) {
+		luaL_checkstring(L, 1);
+		luaL_checkstring(L, 2);
+		if (lua_isnoneornil(L, 3)) {
+			lua_settop(L, 2);
+			lua_pushstring(L, "");
+		} else {
+			luaL_checkstring(L, 3);
+			lua_settop(L, 3);
+		}
+		LuaRegexCache::Create(L, capacity);
+		lua_pushinteger(L, 0);
+		lua_pushcclosure(L, Iterate, 4);
+		return 1;
+	}
+}
+
+LuaRegexCache::LuaRegexCache(size_t _capacity) : capacity(_capacity > 0 ? _capacity : 1), hits(0), misses(0) {}
+
+const LuaRegexCache::Pattern &LuaRegexCache::Get(const char *pattern, size_t length, const char *flags) {
+	// the key is built in the reused buffer, so the hits do not allocate
+	lookup.assign(flags);
+	lookup.push_back('/');
+	lookup.append(pattern, length);
+
+	auto it = index.find(lookup);
+	if (it != index.end()) {
+		hits++;
+		entries.splice(entries.begin(), entries, it->second);
+		return *it->second->pattern;
+	}
+
+	bool icase = false;
+	for (const char *flag = flags; *flag != '\0'; flag++) {
+		if (*flag != 'i') {
+			throw std::invalid_argument(std::string("invalid regex flag '") + *flag + "'");
+		}
+		icase = true;
+	}
+
+	std::shared_ptr<Pattern> compiled = std::make_shared<Pattern>();
+#ifdef LUACPP_HAS_RE2
+	// the subjects are bytes, as the Lua strings
+	re2::RE2::Options options;
+	options.set_encoding(re2::RE2::Options::EncodingLatin1);
+	options.set_log_errors(false);
+	options.set_case_sensitive(!icase);
+	compiled->regex.reset(new re2::RE2(re2::StringPiece(pattern, length), options));
+	if (!compiled->regex->ok()) {
+		throw std::invalid_argument("invalid pattern: " + compiled->regex->error());
+	}
+#else
+	std::regex::flag_type syntax = std::regex::ECMAScript | std::regex::optimize;
+	if (icase) {
+		syntax |= std::regex::icase;
+	}
+	try {
+		compiled->regex.assign(pattern, pattern + length, syntax);
+	} catch (const std::regex_error &e) {
+		throw std::invalid_argument(std::string("invalid pattern: ") + e.what());
+	}
+	compiled->cost = RepetitionCost(pattern, length);
+#endif
+
+	misses++;
+	entries.push_front(Entry{lookup, std::move(compiled)});
+	index[lookup] = entries.begin();
+	if (entries.size() > capacity) {
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+	return *entries.front().pattern;
+}
+
+LuaRegexCache *LuaRegexCache::From(lua_State *L) {
+	lua_pushlightuserdata(L, &cacheKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	LuaRegexCache *cache = (LuaRegexCache *) lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return cache;
+}
+
+LuaRegexCache *LuaRegexCache::Create(lua_State *L, size_t capacity) {
+	LuaRegexCache *cache = From(L);
+	if (cache != nullptr) {
+		return cache;
+	}
+
+	void *storage = lua_newuserdata(L, sizeof(LuaRegexCache));
+	lua_createtable(L, 0, 1);
+	lua_pushcfunction(L, CollectCache);
+	lua_setfield(L, -2, "__gc");
+	cache = new (storage) LuaRegexCache(capacity);
+	lua_setmetatable(L, -2);
+
+	lua_pushlightuserdata(L, &cacheKey);
+	lua_insert(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	return cache;
+}
+
+LuaRegexLibrary::LuaRegexLibrary(size_t cacheSize) : LuaLibrary("re") {
+	AddFunction("match", [cacheSize](lua_State *L) {
+		return Run(L, cacheSize, false);
+	});
+	AddFunction("find", [cacheSize](lua_State *L) {
+		return Run(L, cacheSize, true);
+	});
+	AddFunction("gmatch", [cacheSize](lua_State *L) {
+		return GMatch(L, cacheSize);
+	});
+}
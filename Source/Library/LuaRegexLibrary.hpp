@@ -0,0 +1,166 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAREGEXLIBRARY_HPP
+#define LUACPP_LUAREGEXLIBRARY_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../Lua.hpp"
+#include "../Registry/LuaLibrary.hpp"
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief Compiled regular expressions of a state, the least recently used are dropped
+		 *
+		 * @details
+		 * The expressions are keyed by the flags and the text of the pattern.
+		 * The cache is created in the state by the first call to the `re` 
+		 * library and destroyed with the state.
+		 */
+		class LuaRegexCache {
+		   public:
+			/**
+			 * @brief Compiled expression, defined by the engine of the build
+			 */
+			struct Pattern;
+
+		   private:
+			struct Entry {
+				std::string key;
+				std::shared_ptr<Pattern> pattern;
+			};
+
+			size_t capacity;
+			std::list<Entry> entries;
+			std::unordered_map<std::string, std::list<Entry>::iterator> index;
+			std::string lookup;
+			uint64_t hits;
+			uint64_t misses;
+
+		   public:
+			/**
+			 * @brief Creates the cache
+			 *
+			 * @param capacity the maximum number of the compiled expressions
+			 */
+			explicit LuaRegexCache(size_t capacity);
+
+			/**
+			 * @brief Returns the compiled expression, compiling it on a miss
+			 *
+			 * @details
+			 * The reference is valid until the next call. Throws 
+			 * `std::invalid_argument` if the pattern is not valid or a flag
+			 * is not known. Without RE2, `std::regex` also rejects a
+			 * repetition nested in another unbounded repetition.
+			 *
+			 * @param pattern the pattern
+			 * @param length the length of the pattern
+			 * @param flags the flags, `i` ignores the case
+			 * @return the compiled expression
+			 */
+			const Pattern &Get(const char *pattern, size_t length, const char *flags);
+
+			/**
+			 * @brief Returns the number of the cached expressions
+			 */
+			inline size_t size() const { return entries.size(); }
+
+			/**
+			 * @brief Returns the maximum number of the cached expressions
+			 */
+			inline size_t getCapacity() const { return capacity; }
+
+			/**
+			 * @brief Returns the number of the lookups that found the compiled expression
+			 */
+			inline uint64_t getHits() const { return hits; }
+
+			/**
+			 * @brief Returns the number of the lookups that compiled the expression
+			 */
+			inline uint64_t getMisses() const { return misses; }
+
+			/**
+			 * @brief Returns the cache of the state
+			 *
+			 * @return the cache, `nullptr` if the `re` library has not been used in the state
+			 */
+			static LuaRegexCache *From(lua_State *L);
+
+			/**
+			 * @brief Returns the cache of the state, creating it with the capacity
+			 */
+			static LuaRegexCache *Create(lua_State *L, size_t capacity);
+		};
+
+		/**
+		 * @brief Library `re` of the regular expressions
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `re.match(s, pattern [, init [, flags]])` returns the captures of the
+		 *    first match, or the whole match if the pattern has no groups
+		 *  - `re.find(s, pattern [, init [, flags]])` returns the start and the end
+		 *    of the first match, followed by the captures
+		 *  - `re.gmatch(s, pattern [, flags])` returns the iterator over the matches,
+		 *    like `string.gmatch`
+		 *
+		 * The expressions are run by RE2 when the library is built with it
+		 * (`LUACPP_HAS_RE2`), in linear time and without the recursion. 
+		 * Otherwise the ECMAScript grammar of `std::regex` is used, which 
+		 * recurses for each repeated character: the text searched by a 
+		 * pattern with the repetitions is bounded by the stack left to the
+		 * thread, a longer text raises the error instead of overflowing the
+		 * stack, and the nested unbounded repetitions are rejected.
+		 *
+		 * The flag `i` ignores the case. All functions return `nil` when there 
+		 * is no match, and `false` for the groups that did not participate in
+		 * the match. The subject is searched in place, only the captured parts
+		 * are copied into the new strings, and `find` returns the positions 
+		 * alone when the pattern has no groups.
+		 *
+		 * The compiled patterns are kept in the LuaRegexCache of the state.
+		 */
+		class LuaRegexLibrary : public Registry::LuaLibrary {
+		   public:
+			/**
+			 * @brief Creates the library
+			 *
+			 * @param cacheSize the number of the compiled patterns cached by each state
+			 */
+			explicit LuaRegexLibrary(size_t cacheSize = 64);
+		};
+	}
+}
+
+#endif // LUACPP_LUAREGEXLIBRARY_HPP
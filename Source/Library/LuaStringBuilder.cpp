@@ -0,0 +1,224 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#include "LuaStringBuilder.hpp"
+#include "../Async/LuaBindingHelpers.hpp"
+
+using namespace LuaCpp::Library;
+using LuaCpp::Async::Guarded;
+
+void LuaStringBuilder::Append(const char *data, size_t length) {
+	if (sink && flushSize > 0 && buffer.size() + length >= flushSize) {
+		Flush();
+		// the large pieces go to the sink without passing through the buffer
+		if (length >= flushSize) {
+			sink(data, length);
+			return;
+		}
+	}
+	buffer.append(data, length);
+}
+
+void LuaStringBuilder::Flush() {
+	if (!sink || buffer.empty()) {
+		return;
+	}
+	sink(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+std::string LuaStringBuilder::Take() {
+	std::string content;
+	content.swap(buffer);
+	return content;
+}
+
+void LuaStringBuilder::setSink(Sink _sink, size_t _flushSize) {
+	sink = std::move(_sink);
+	flushSize = _flushSize;
+}
+
+LuaStringBuilder *LuaStringBuilder::Push(lua_State *L) {
+	void *storage = lua_newuserdata(L, sizeof(LuaStringBuilder));
+	luaL_getmetatable(L, METATABLE);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 2);
+		throw std::runtime_error("Error: The strbuf library is not registered in the state ...");
+	}
+	LuaStringBuilder *builder = new (storage) LuaStringBuilder();
+	lua_setmetatable(L, -2);
+	return builder;
+}
+
+LuaStringBuilder *LuaStringBuilder::To(lua_State *L, int idx) {
+	void *storage = lua_touserdata(L, idx);
+	if (storage == nullptr || !lua_getmetatable(L, idx)) {
+		return nullptr;
+	}
+	luaL_getmetatable(L, METATABLE);
+	bool builder = lua_rawequal(L, -1, -2);
+	lua_pop(L, 2);
+	return builder ? (LuaStringBuilder *) storage : nullptr;
+}
+
+namespace {
+
+	LuaStringBuilder *Check(lua_State *L) {
+		return (LuaStringBuilder *) luaL_checkudata(L, 1, LuaStringBuilder::METATABLE);
+	}
+
+	int New(lua_State *L) {
+		lua_Integer capacity = luaL_optinteger(L, 1, 0);
+		luaL_argcheck(L, capacity >= 0, 1, "negative capacity");
+		LuaStringBuilder *builder = LuaStringBuilder::Push(L);
+		Guarded(L, [builder, capacity] { builder->Reserve((size_t) capacity); });
+		return 1;
+	}
+
+	int Append(lua_State *L) {
+		LuaStringBuilder *builder = Check(L);
+		int top = lua_gettop(L);
+		for (int i = 2; i <= top; i++) {
+			int type = lua_type(L, i);
+			if (type != LUA_TSTRING && type != LUA_TNUMBER) {
+				return luaL_argerror(L, i, "string or number expected");
+			}
+		}
+		Guarded(L, [L, builder, top] {
+			for (int i = 2; i <= top; i++) {
+				size_t length = 0;
+				const char *data = lua_tolstring(L, i, &length);
+				builder->Append(data, length);
+			}
+		});
+		lua_settop(L, 1);
+		return 1;
+	}
+
+	int AppendFormatted(lua_State *L) {
+		LuaStringBuilder *builder = Check(L);
+		luaL_checkstring(L, 2);
+		lua_getglobal(L, "string");
+		if (lua_istable(L, -1)) {
+			lua_getfield(L, -1, "format");
+			lua_remove(L, -2);
+		}
+		if (!lua_isfunction(L, -1)) {
+			return luaL_error(L, "appendf needs string.format");
+		}
+		lua_insert(L, 2);
+		lua_call(L, lua_gettop(L) - 2, 1);
+
+		size_t length = 0;
+		const char *data = lua_tolstring(L, -1, &length);
+		Guarded(L, [builder, data, length] { builder->Append(data, length); });
+		lua_settop(L, 1);
+		return 1;
+	}
+
+	int Repeat(lua_State *L) {
+		LuaStringBuilder *builder = Check(L);
+		size_t length = 0;
+		size_t separatorLength = 0;
+		const char *data = luaL_checklstring(L, 2, &length);
+		lua_Integer count = luaL_checkinteger(L, 3);
+		const char *separator = luaL_optlstring(L, 4, "", &separatorLength);
+		if (count > 0) {
+			size_t step = length + separatorLength;
+			if (step > 0 && (size_t) count > std::numeric_limits<size_t>::max() / step) {
+				return luaL_error(L, "resulting string too large");
+			}
+			Guarded(L, [=] {
+				builder->Reserve(step * (size_t) count);
+				for (lua_Integer i = 0; i < count; i++) {
+					if (i > 0) {
+						builder->Append(separator, separatorLength);
+					}
+					builder->Append(data, length);
+				}
+			});
+		}
+		lua_settop(L, 1);
+		return 1;
+	}
+
+	int Reserve(lua_State *L) {
+		LuaStringBuilder *builder = Check(L);
+		lua_Integer length = luaL_checkinteger(L, 2);
+		luaL_argcheck(L, length >= 0, 2, "negative size");
+		Guarded(L, [builder, length] { builder->Reserve((size_t) length); });
+		lua_settop(L, 1);
+		return 1;
+	}
+
+	int Clear(lua_State *L) {
+		Check(L)->Clear();
+		lua_settop(L, 1);
+		return 1;
+	}
+
+	int Flush(lua_State *L) {
+		LuaStringBuilder *builder = Check(L);
+		Guarded(L, [builder] { builder->Flush(); });
+		lua_settop(L, 1);
+		return 1;
+	}
+
+	int Length(lua_State *L) {
+		lua_pushinteger(L, (lua_Integer) Check(L)->getString().size());
+		return 1;
+	}
+
+	int ToString(lua_State *L) {
+		const std::string &content = Check(L)->getString();
+		lua_pushlstring(L, content.data(), content.size());
+		return 1;
+	}
+
+	int Collect(lua_State *L) {
+		Check(L)->~LuaStringBuilder();
+		return 0;
+	}
+}
+
+LuaStringBuilderLibrary::LuaStringBuilderLibrary() : LuaLibrary("strbuf", LuaStringBuilder::METATABLE) {
+	AddCFunction("new", New);
+
+	AddCMethod("append", Append);
+	AddCMethod("appendf", AppendFormatted);
+	AddCMethod("rep", Repeat);
+	AddCMethod("reserve", Reserve);
+	AddCMethod("clear", Clear);
+	AddCMethod("flush", Flush);
+	AddCMethod("len", Length);
+	AddCMethod("tostring", ToString);
+
+	AddCMetaMethod("__len", Length);
+	AddCMetaMethod("__tostring", ToString);
+	AddCMetaMethod("__gc", Collect);
+}
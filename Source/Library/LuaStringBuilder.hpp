@@ -0,0 +1,153 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASTRINGBUILDER_HPP
+#define LUACPP_LUASTRINGBUILDER_HPP
+
+#include <functional>
+#include <string>
+
+#include "../Lua.hpp"
+#include "../Engine/LuaError.hpp"
+#include "../Registry/LuaLibrary.hpp"
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief Growable buffer building a string from many pieces
+		 *
+		 * @details
+		 * The scripts create the builders with `strbuf.new([capacity])` and 
+		 * append to them with the methods
+		 *
+		 *  - `sb:append(...)` appends the strings and the numbers
+		 *  - `sb:appendf(fmt, ...)` appends the arguments formatted by `string.format`
+		 *  - `sb:rep(s, n [, sep])` appends the string `n` times
+		 *  - `sb:reserve(n)` makes room for `n` more bytes
+		 *  - `sb:clear()` empties the buffer
+		 *  - `sb:flush()` writes the buffer to the sink and empties it
+		 *  - `sb:len()` and `#sb` return the length of the buffer
+		 *  - `sb:tostring()` and `tostring(sb)` return the content
+		 *
+		 * The appending methods return the builder, so the calls can be
+		 * chained. The buffer grows geometrically, so building a string of 
+		 * `n` bytes is `O(n)`, unlike the concatenation in a loop.
+		 *
+		 * The C++ code can take the content of a builder returned by a script
+		 * with `Take()`, which moves the buffer out without copying it, or 
+		 * attach a sink to a builder it passes to a script, which receives
+		 * the content on `flush()` and whenever the buffer reaches the flush 
+		 * size.
+		 */
+		class LuaStringBuilder {
+		   public:
+			/**
+			 * @brief Receives the content of the builder
+			 */
+			typedef std::function<void(const char *, size_t)> Sink;
+
+			/**
+			 * @brief Name of the meta-table of the builders
+			 */
+			static constexpr const char *METATABLE = "strbuf";
+
+		   private:
+			std::string buffer;
+			Sink sink;
+			size_t flushSize;
+
+		   public:
+			LuaStringBuilder() : flushSize(0) {}
+
+			/**
+			 * @brief Appends the bytes, writing to the sink when the buffer reaches the flush size
+			 */
+			void Append(const char *data, size_t length);
+
+			/**
+			 * @brief Writes the buffer to the sink and empties it, does nothing without a sink
+			 */
+			void Flush();
+
+			/**
+			 * @brief Moves the content out of the builder, leaving it empty
+			 */
+			std::string Take();
+
+			/**
+			 * @brief Makes room for more bytes
+			 */
+			inline void Reserve(size_t length) { buffer.reserve(buffer.size() + length); }
+
+			/**
+			 * @brief Empties the buffer, keeping its capacity
+			 */
+			inline void Clear() { buffer.clear(); }
+
+			/**
+			 * @brief Returns the content of the buffer
+			 */
+			inline const std::string &getString() const { return buffer; }
+
+			/**
+			 * @brief Attaches the sink
+			 *
+			 * @param sink the sink receiving the content
+			 * @param flushSize the size of the buffer written to the sink without `flush()`, `0` waits for `flush()`
+			 */
+			void setSink(Sink sink, size_t flushSize = 0);
+
+			/**
+			 * @brief Pushes a new builder on the stack
+			 *
+			 * @details
+			 * The library has to be registered in the state.
+			 *
+			 * @param L the state
+			 * @return the builder owned by the state
+			 */
+			static LuaStringBuilder *Push(lua_State *L);
+
+			/**
+			 * @brief Returns the builder at the index of the stack
+			 *
+			 * @param L the state
+			 * @param idx the index of the builder
+			 * @return the builder, `nullptr` if the value is not a builder
+			 */
+			static LuaStringBuilder *To(lua_State *L, int idx);
+		};
+
+		/**
+		 * @brief Library `strbuf` creating the LuaStringBuilder objects
+		 */
+		class LuaStringBuilderLibrary : public Registry::LuaLibrary {
+		   public:
+			LuaStringBuilderLibrary();
+		};
+	}
+}
+
+#endif // LUACPP_LUASTRINGBUILDER_HPP
@@ -0,0 +1,237 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstring>
+
+#include "LuaStringLibrary.hpp"
+#include "LuaStringOps.hpp"
+
+using namespace LuaCpp::Library;
+
+namespace {
+
+	const char WHITE_SPACE[] = " \t\r\n\v\f";
+
+	/**
+	 * @brief Returns the memory of the result string, written directly by the encoders
+	 */
+	char *BeginResult(lua_State *L, luaL_Buffer *buffer, size_t length) {
+#if LUA_VERSION_NUM >= 502
+		return luaL_buffinitsize(L, buffer, length);
+#else
+		(void) buffer;
+		return (char *) lua_newuserdata(L, length);
+#endif
+	}
+
+	/**
+	 * @brief Pushes the result string of the length
+	 */
+	void EndResult(lua_State *L, luaL_Buffer *buffer, size_t length) {
+#if LUA_VERSION_NUM >= 502
+		(void) L;
+		luaL_pushresultsize(buffer, length);
+#else
+		(void) buffer;
+		lua_pushlstring(L, (const char *) lua_touserdata(L, -1), length);
+		lua_remove(L, -2);
+#endif
+	}
+
+	int PushInvalid(lua_State *L, const char *message) {
+		lua_pushnil(L);
+		lua_pushstring(L, message);
+		return 2;
+	}
+
+	size_t FindSeparator(const char *data, size_t length, const char *separator, size_t separatorLength) {
+		size_t pos = 0;
+		while (pos + separatorLength <= length) {
+			size_t found = pos + LuaStringOps::FindByte(data + pos, length - pos, separator[0]);
+			if (found + separatorLength > length) {
+				break;
+			}
+			if (memcmp(data + found, separator, separatorLength) == 0) {
+				return found;
+			}
+			pos = found + 1;
+		}
+		return length;
+	}
+
+	int Split(lua_State *L) {
+		size_t length = 0;
+		size_t separatorLength = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		const char *separator = luaL_checklstring(L, 2, &separatorLength);
+		lua_Integer max = luaL_optinteger(L, 3, 0);
+		luaL_argcheck(L, separatorLength > 0, 2, "empty separator");
+
+		lua_newtable(L);
+		int count = 0;
+		size_t pos = 0;
+		while (max <= 0 || count + 1 < max) {
+			size_t found = FindSeparator(data + pos, length - pos, separator, separatorLength);
+			if (found == length - pos) {
+				break;
+			}
+			lua_pushlstring(L, data + pos, found);
+			lua_rawseti(L, -2, ++count);
+			pos += found + separatorLength;
+		}
+		lua_pushlstring(L, data + pos, length - pos);
+		lua_rawseti(L, -2, ++count);
+		return 1;
+	}
+
+	int FindAny(lua_State *L) {
+		size_t length = 0;
+		size_t setLength = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		const char *set = luaL_checklstring(L, 2, &setLength);
+		lua_Integer init = luaL_optinteger(L, 3, 1);
+		luaL_argcheck(L, init >= 1, 3, "initial position must be positive");
+
+		size_t from = (size_t) init - 1;
+		if (setLength > 0 && from < length) {
+			size_t found = from + LuaStringOps::FindAnyOf(data + from, length - from, set, setLength);
+			if (found < length) {
+				lua_pushinteger(L, (lua_Integer) found + 1);
+				return 1;
+			}
+		}
+		lua_pushnil(L);
+		return 1;
+	}
+
+	int Trim(lua_State *L) {
+		size_t length = 0;
+		size_t setLength = sizeof(WHITE_SPACE) - 1;
+		const char *data = luaL_checklstring(L, 1, &length);
+		const char *set = luaL_optlstring(L, 2, WHITE_SPACE, &setLength);
+
+		size_t first = 0;
+		while (first < length && memchr(set, data[first], setLength) != nullptr) {
+			first++;
+		}
+		size_t last = length;
+		while (last > first && memchr(set, data[last - 1], setLength) != nullptr) {
+			last--;
+		}
+		lua_pushlstring(L, data + first, last - first);
+		return 1;
+	}
+
+	int Lower(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		luaL_Buffer buffer;
+		LuaStringOps::ToLower(data, length, BeginResult(L, &buffer, length));
+		EndResult(L, &buffer, length);
+		return 1;
+	}
+
+	int Upper(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		luaL_Buffer buffer;
+		LuaStringOps::ToUpper(data, length, BeginResult(L, &buffer, length));
+		EndResult(L, &buffer, length);
+		return 1;
+	}
+
+	int Hex(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		luaL_Buffer buffer;
+		LuaStringOps::HexEncode(data, length, BeginResult(L, &buffer, 2 * length));
+		EndResult(L, &buffer, 2 * length);
+		return 1;
+	}
+
+	int Unhex(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		luaL_Buffer buffer;
+		char *out = BeginResult(L, &buffer, length / 2);
+		if (!LuaStringOps::HexDecode(data, length, out)) {
+			return PushInvalid(L, "invalid hexadecimal string");
+		}
+		EndResult(L, &buffer, length / 2);
+		return 1;
+	}
+
+	int Base64(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		size_t encoded = LuaStringOps::Base64EncodedLength(length);
+		luaL_Buffer buffer;
+		LuaStringOps::Base64Encode(data, length, BeginResult(L, &buffer, encoded));
+		EndResult(L, &buffer, encoded);
+		return 1;
+	}
+
+	int Unbase64(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		luaL_Buffer buffer;
+		char *out = BeginResult(L, &buffer, length / 4 * 3 + 2);
+		size_t decoded = LuaStringOps::Base64Decode(data, length, out);
+		if (decoded == SIZE_MAX) {
+			return PushInvalid(L, "invalid base64 string");
+		}
+		EndResult(L, &buffer, decoded);
+		return 1;
+	}
+
+	int Crc32c(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		uint32_t crc = (uint32_t) luaL_optinteger(L, 2, 0);
+		lua_pushinteger(L, (lua_Integer) LuaStringOps::Crc32c(data, length, crc));
+		return 1;
+	}
+
+	int Hash(lua_State *L) {
+		size_t length = 0;
+		const char *data = luaL_checklstring(L, 1, &length);
+		uint64_t seed = (uint64_t) luaL_optinteger(L, 2, 0);
+		lua_pushinteger(L, (lua_Integer) LuaStringOps::Hash64(data, length, seed));
+		return 1;
+	}
+}
+
+LuaStringLibrary::LuaStringLibrary() : LuaLibrary("strx") {
+	AddCFunction("split", Split);
+	AddCFunction("find_any", FindAny);
+	AddCFunction("trim", Trim);
+	AddCFunction("lower", Lower);
+	AddCFunction("upper", Upper);
+	AddCFunction("hex", Hex);
+	AddCFunction("unhex", Unhex);
+	AddCFunction("base64", Base64);
+	AddCFunction("unbase64", Unbase64);
+	AddCFunction("crc32c", Crc32c);
+	AddCFunction("hash", Hash);
+}
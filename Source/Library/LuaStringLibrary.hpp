@@ -0,0 +1,64 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASTRINGLIBRARY_HPP
+#define LUACPP_LUASTRINGLIBRARY_HPP
+
+#include "../Lua.hpp"
+#include "../Registry/LuaLibrary.hpp"
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief Library `strx` of the native string primitives
+		 *
+		 * @details
+		 * Provides the functions
+		 *
+		 *  - `strx.split(s, sep [, max])` returns the table of the fields separated
+		 *    by the plain separator, at most `max` fields
+		 *  - `strx.find_any(s, set [, init])` returns the position of the first byte
+		 *    of the set, or `nil`
+		 *  - `strx.trim(s [, set])` removes the bytes of the set, the white space by
+		 *    default, from both ends
+		 *  - `strx.lower(s)` and `strx.upper(s)` convert the ASCII letters
+		 *  - `strx.hex(s)` and `strx.unhex(s)` encode and decode the hexadecimal digits
+		 *  - `strx.base64(s)` and `strx.unbase64(s)` encode and decode base64
+		 *  - `strx.crc32c(s [, crc])` returns the CRC32C checksum
+		 *  - `strx.hash(s [, seed])` returns the 64-bit XXH64 hash
+		 *
+		 * The decoders return `nil` and the message for the invalid input.
+		 * The work is done by LuaStringOps, so a single call replaces the 
+		 * `string.gsub` or `string.gmatch` loop of the script. The 64-bit
+		 * hash is exact with the integers of Lua 5.3 and later.
+		 */
+		class LuaStringLibrary : public Registry::LuaLibrary {
+		   public:
+			LuaStringLibrary();
+		};
+	}
+}
+
+#endif // LUACPP_LUASTRINGLIBRARY_HPP
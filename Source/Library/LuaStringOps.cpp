@@ -0,0 +1,492 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstring>
+
+#include "LuaStringOps.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LUACPP_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+// the AVX2 and SSE4.2 functions are compiled for their targets and selected at run time
+#if defined(__GNUC__) || defined(__clang__)
+#define LUACPP_AVX2 1
+#include <immintrin.h>
+#include <nmmintrin.h>
+#endif
+#endif
+
+using namespace LuaCpp::Library;
+
+namespace {
+
+	struct Features {
+		bool avx2 = false;
+		bool sse42 = false;
+	};
+
+	const Features &getFeatures() {
+		static const Features features = [] {
+			Features detected;
+#ifdef LUACPP_AVX2
+			__builtin_cpu_init();
+			detected.avx2 = __builtin_cpu_supports("avx2");
+			detected.sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+			return detected;
+		}();
+		return features;
+	}
+
+	/**
+	 * @brief Table of the bytes of the set
+	 */
+	struct ByteSet {
+		bool member[256];
+
+		ByteSet(const char *set, size_t length) {
+			memset(member, 0, sizeof(member));
+			for (size_t i = 0; i < length; i++) {
+				member[(unsigned char) set[i]] = true;
+			}
+		}
+	};
+
+	size_t FindAnyOfScalar(const char *data, size_t from, size_t length, const ByteSet &set) {
+		for (size_t i = from; i < length; i++) {
+			if (set.member[(unsigned char) data[i]]) {
+				return i;
+			}
+		}
+		return length;
+	}
+
+	void ChangeCaseScalar(const char *data, size_t from, size_t length, char *out, char first, char last) {
+		for (size_t i = from; i < length; i++) {
+			char c = data[i];
+			out[i] = (c >= first && c <= last) ? (char) (c ^ 0x20) : c;
+		}
+	}
+
+#ifdef LUACPP_SSE2
+	inline unsigned CountTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return (unsigned) index;
+#else
+		return (unsigned) __builtin_ctz(value);
+#endif
+	}
+
+	size_t FindByteSse2(const char *data, size_t length, char byte) {
+		__m128i needle = _mm_set1_epi8(byte);
+		size_t i = 0;
+		for (; i + 16 <= length; i += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i *) (data + i));
+			uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+			if (mask != 0) {
+				return i + CountTrailingZeros(mask);
+			}
+		}
+		const void *found = memchr(data + i, byte, length - i);
+		return found == nullptr ? length : (const char *) found - data;
+	}
+
+	size_t FindAnyOfSse2(const char *data, size_t length, const char *set, size_t setLength, const ByteSet &table) {
+		size_t i = 0;
+		for (; i + 16 <= length; i += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i *) (data + i));
+			__m128i hits = _mm_setzero_si128();
+			for (size_t j = 0; j < setLength; j++) {
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(set[j])));
+			}
+			uint32_t mask = (uint32_t) _mm_movemask_epi8(hits);
+			if (mask != 0) {
+				return i + CountTrailingZeros(mask);
+			}
+		}
+		return FindAnyOfScalar(data, i, length, table);
+	}
+
+	void ChangeCaseSse2(const char *data, size_t length, char *out, char first, char last) {
+		// the bytes above 0x7f are negative and never in the range
+		__m128i below = _mm_set1_epi8((char) (first - 1));
+		__m128i above = _mm_set1_epi8((char) (last + 1));
+		__m128i flip = _mm_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 16 <= length; i += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i *) (data + i));
+			__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(chunk, below), _mm_cmplt_epi8(chunk, above));
+			_mm_storeu_si128((__m128i *) (out + i), _mm_xor_si128(chunk, _mm_and_si128(letters, flip)));
+		}
+		ChangeCaseScalar(data, i, length, out, first, last);
+	}
+#endif
+
+#ifdef LUACPP_AVX2
+	__attribute__((target("avx2")))
+	size_t FindByteAvx2(const char *data, size_t length, char byte) {
+		__m256i needle = _mm256_set1_epi8(byte);
+		size_t i = 0;
+		for (; i + 32 <= length; i += 32) {
+			__m256i chunk = _mm256_loadu_si256((const __m256i *) (data + i));
+			uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+			if (mask != 0) {
+				return i + CountTrailingZeros(mask);
+			}
+		}
+		size_t rest = FindByteSse2(data + i, length - i, byte);
+		return i + rest;
+	}
+
+	__attribute__((target("avx2")))
+	size_t FindAnyOfAvx2(const char *data, size_t length, const char *set, size_t setLength, const ByteSet &table) {
+		size_t i = 0;
+		for (; i + 32 <= length; i += 32) {
+			__m256i chunk = _mm256_loadu_si256((const __m256i *) (data + i));
+			__m256i hits = _mm256_setzero_si256();
+			for (size_t j = 0; j < setLength; j++) {
+				hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(set[j])));
+			}
+			uint32_t mask = (uint32_t) _mm256_movemask_epi8(hits);
+			if (mask != 0) {
+				return i + CountTrailingZeros(mask);
+			}
+		}
+		return FindAnyOfScalar(data, i, length, table);
+	}
+
+	__attribute__((target("avx2")))
+	void ChangeCaseAvx2(const char *data, size_t length, char *out, char first, char last) {
+		__m256i below = _mm256_set1_epi8((char) (first - 1));
+		__m256i above = _mm256_set1_epi8((char) (last + 1));
+		__m256i flip = _mm256_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 32 <= length; i += 32) {
+			__m256i chunk = _mm256_loadu_si256((const __m256i *) (data + i));
+			__m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, below), _mm256_cmpgt_epi8(above, chunk));
+			_mm256_storeu_si256((__m256i *) (out + i), _mm256_xor_si256(chunk, _mm256_and_si256(letters, flip)));
+		}
+		ChangeCaseSse2(data + i, length - i, out + i, first, last);
+	}
+
+	__attribute__((target("sse4.2")))
+	uint32_t Crc32cSse42(const char *data, size_t length, uint32_t crc) {
+		uint64_t crc64 = crc;
+		size_t i = 0;
+		for (; i + 8 <= length; i += 8) {
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			crc64 = _mm_crc32_u64(crc64, word);
+		}
+		crc = (uint32_t) crc64;
+		for (; i < length; i++) {
+			crc = _mm_crc32_u8(crc, (unsigned char) data[i]);
+		}
+		return crc;
+	}
+#endif
+
+	void ChangeCase(const char *data, size_t length, char *out, char first, char last) {
+#ifdef LUACPP_AVX2
+		if (getFeatures().avx2) {
+			ChangeCaseAvx2(data, length, out, first, last);
+			return;
+		}
+#endif
+#ifdef LUACPP_SSE2
+		ChangeCaseSse2(data, length, out, first, last);
+#else
+		ChangeCaseScalar(data, 0, length, out, first, last);
+#endif
+	}
+
+	const char HEX_DIGITS[] = "0123456789abcdef";
+	const char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	int HexValue(char c) {
+		if (c >= '0' && c <= '9') {
+			return c - '0';
+		}
+		if (c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		}
+		if (c >= 'A' && c <= 'F') {
+			return c - 'A' + 10;
+		}
+		return -1;
+	}
+
+	struct Base64Table {
+		signed char value[256];
+
+		Base64Table() {
+			memset(value, -1, sizeof(value));
+			for (int i = 0; i < 64; i++) {
+				value[(unsigned char) BASE64_DIGITS[i]] = (signed char) i;
+			}
+		}
+	};
+
+	struct Crc32cTable {
+		uint32_t value[256];
+
+		Crc32cTable() {
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++) {
+					crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+				}
+				value[i] = crc;
+			}
+		}
+	};
+
+	const uint64_t PRIME64_1 = 11400714785074694791ULL;
+	const uint64_t PRIME64_2 = 14029467366897019727ULL;
+	const uint64_t PRIME64_3 = 1609587929392839161ULL;
+	const uint64_t PRIME64_4 = 9650029242287828579ULL;
+	const uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits) {
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline uint64_t Read64(const char *data) {
+		uint64_t value;
+		memcpy(&value, data, 8);
+		return value;
+	}
+
+	inline uint32_t Read32(const char *data) {
+		uint32_t value;
+		memcpy(&value, data, 4);
+		return value;
+	}
+
+	inline uint64_t HashRound(uint64_t acc, uint64_t input) {
+		acc += input * PRIME64_2;
+		acc = RotateLeft(acc, 31);
+		return acc * PRIME64_1;
+	}
+
+	inline uint64_t HashMerge(uint64_t acc, uint64_t value) {
+		acc ^= HashRound(0, value);
+		return acc * PRIME64_1 + PRIME64_4;
+	}
+}
+
+size_t LuaStringOps::FindByte(const char *data, size_t length, char byte) {
+#ifdef LUACPP_AVX2
+	if (getFeatures().avx2) {
+		return FindByteAvx2(data, length, byte);
+	}
+#endif
+#ifdef LUACPP_SSE2
+	return FindByteSse2(data, length, byte);
+#else
+	const void *found = memchr(data, byte, length);
+	return found == nullptr ? length : (const char *) found - data;
+#endif
+}
+
+size_t LuaStringOps::FindAnyOf(const char *data, size_t length, const char *set, size_t setLength) {
+	if (setLength == 1) {
+		return FindByte(data, length, set[0]);
+	}
+	ByteSet table(set, setLength);
+	// the vector compares each byte of the set, the larger sets use the table
+	if (setLength <= 16) {
+#ifdef LUACPP_AVX2
+		if (getFeatures().avx2) {
+			return FindAnyOfAvx2(data, length, set, setLength, table);
+		}
+#endif
+#ifdef LUACPP_SSE2
+		return FindAnyOfSse2(data, length, set, setLength, table);
+#endif
+	}
+	return FindAnyOfScalar(data, 0, length, table);
+}
+
+void LuaStringOps::ToLower(const char *data, size_t length, char *out) {
+	ChangeCase(data, length, out, 'A', 'Z');
+}
+
+void LuaStringOps::ToUpper(const char *data, size_t length, char *out) {
+	ChangeCase(data, length, out, 'a', 'z');
+}
+
+void LuaStringOps::HexEncode(const char *data, size_t length, char *out) {
+	for (size_t i = 0; i < length; i++) {
+		unsigned char byte = (unsigned char) data[i];
+		out[2 * i] = HEX_DIGITS[byte >> 4];
+		out[2 * i + 1] = HEX_DIGITS[byte & 0x0f];
+	}
+}
+
+bool LuaStringOps::HexDecode(const char *data, size_t length, char *out) {
+	if (length % 2 != 0) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i += 2) {
+		int high = HexValue(data[i]);
+		int low = HexValue(data[i + 1]);
+		if (high < 0 || low < 0) {
+			return false;
+		}
+		out[i / 2] = (char) ((high << 4) | low);
+	}
+	return true;
+}
+
+size_t LuaStringOps::Base64EncodedLength(size_t length) {
+	return (length + 2) / 3 * 4;
+}
+
+void LuaStringOps::Base64Encode(const char *data, size_t length, char *out) {
+	const unsigned char *in = (const unsigned char *) data;
+	size_t i = 0;
+	for (; i + 3 <= length; i += 3) {
+		uint32_t group = (uint32_t) in[i] << 16 | (uint32_t) in[i + 1] << 8 | in[i + 2];
+		*out++ = BASE64_DIGITS[group >> 18];
+		*out++ = BASE64_DIGITS[(group >> 12) & 63];
+		*out++ = BASE64_DIGITS[(group >> 6) & 63];
+		*out++ = BASE64_DIGITS[group & 63];
+	}
+	if (i < length) {
+		uint32_t group = (uint32_t) in[i] << 16 | (i + 1 < length ? (uint32_t) in[i + 1] << 8 : 0);
+		*out++ = BASE64_DIGITS[group >> 18];
+		*out++ = BASE64_DIGITS[(group >> 12) & 63];
+		*out++ = i + 1 < length ? BASE64_DIGITS[(group >> 6) & 63] : '=';
+		*out++ = '=';
+	}
+}
+
+size_t LuaStringOps::Base64Decode(const char *data, size_t length, char *out) {
+	static const Base64Table table;
+
+	// the padding is optional, but only at the end of the full group
+	if (length % 4 == 0 && length > 0 && data[length - 1] == '=') {
+		length -= data[length - 2] == '=' ? 2 : 1;
+	}
+	if (length % 4 == 1) {
+		return SIZE_MAX;
+	}
+
+	size_t written = 0;
+	uint32_t group = 0;
+	int bits = 0;
+	for (size_t i = 0; i < length; i++) {
+		int value = table.value[(unsigned char) data[i]];
+		if (value < 0) {
+			return SIZE_MAX;
+		}
+		group = (group << 6) | (uint32_t) value;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			out[written++] = (char) (group >> bits);
+		}
+	}
+	return written;
+}
+
+uint32_t LuaStringOps::Crc32c(const char *data, size_t length, uint32_t crc) {
+	crc = ~crc;
+#ifdef LUACPP_AVX2
+	if (getFeatures().sse42) {
+		return ~Crc32cSse42(data, length, crc);
+	}
+#endif
+	static const Crc32cTable table;
+	for (size_t i = 0; i < length; i++) {
+		crc = table.value[(crc ^ (unsigned char) data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+uint64_t LuaStringOps::Hash64(const char *data, size_t length, uint64_t seed) {
+	const char *end = data + length;
+	uint64_t hash;
+
+	if (length >= 32) {
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+		for (; data + 32 <= end; data += 32) {
+			v1 = HashRound(v1, Read64(data));
+			v2 = HashRound(v2, Read64(data + 8));
+			v3 = HashRound(v3, Read64(data + 16));
+			v4 = HashRound(v4, Read64(data + 24));
+		}
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = HashMerge(hash, v1);
+		hash = HashMerge(hash, v2);
+		hash = HashMerge(hash, v3);
+		hash = HashMerge(hash, v4);
+	} else {
+		hash = seed + PRIME64_5;
+	}
+
+	hash += (uint64_t) length;
+	for (; data + 8 <= end; data += 8) {
+		hash ^= HashRound(0, Read64(data));
+		hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (data + 4 <= end) {
+		hash ^= (uint64_t) Read32(data) * PRIME64_1;
+		hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+		data += 4;
+	}
+	for (; data < end; data++) {
+		hash ^= (uint64_t) (unsigned char) *data * PRIME64_5;
+		hash = RotateLeft(hash, 11) * PRIME64_1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+const char *LuaStringOps::getInstructionSet() {
+#ifdef LUACPP_AVX2
+	if (getFeatures().avx2) {
+		return "avx2";
+	}
+#endif
+#ifdef LUACPP_SSE2
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
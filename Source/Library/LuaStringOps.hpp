@@ -0,0 +1,128 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASTRINGOPS_HPP
+#define LUACPP_LUASTRINGOPS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LuaCpp {
+	namespace Library {
+
+		/**
+		 * @brief String primitives with the vectorised implementations
+		 *
+		 * @details
+		 * On x86-64 the searches and the case conversions use SSE2, or 
+		 * AVX2 when the processor supports it, and the CRC32C uses the
+		 * SSE4.2 instruction; the choice is made at run time, once. The 
+		 * other platforms, and the compilers without the support for the 
+		 * run time selection, use the scalar implementations, which give 
+		 * the same results.
+		 *
+		 * The functions work on the bytes, the case conversions change only
+		 * the ASCII letters.
+		 */
+		class LuaStringOps {
+		   public:
+			/**
+			 * @brief Returns the position of the first occurrence of the byte, `length` if not found
+			 */
+			static size_t FindByte(const char *data, size_t length, char byte);
+
+			/**
+			 * @brief Returns the position of the first byte of the set, `length` if not found
+			 */
+			static size_t FindAnyOf(const char *data, size_t length, const char *set, size_t setLength);
+
+			/**
+			 * @brief Writes the bytes with the ASCII letters converted to the lower case
+			 *
+			 * @details
+			 * The output can be the input.
+			 */
+			static void ToLower(const char *data, size_t length, char *out);
+
+			/**
+			 * @brief Writes the bytes with the ASCII letters converted to the upper case
+			 *
+			 * @details
+			 * The output can be the input.
+			 */
+			static void ToUpper(const char *data, size_t length, char *out);
+
+			/**
+			 * @brief Writes the `2 * length` lower case hexadecimal digits of the bytes
+			 */
+			static void HexEncode(const char *data, size_t length, char *out);
+
+			/**
+			 * @brief Writes the `length / 2` bytes of the hexadecimal digits
+			 *
+			 * @return `false` if the length is odd or there is a character that is not a digit
+			 */
+			static bool HexDecode(const char *data, size_t length, char *out);
+
+			/**
+			 * @brief Returns the length of the padded base64 encoding
+			 */
+			static size_t Base64EncodedLength(size_t length);
+
+			/**
+			 * @brief Writes the padded base64 encoding of the bytes
+			 */
+			static void Base64Encode(const char *data, size_t length, char *out);
+
+			/**
+			 * @brief Decodes the base64 text, with or without the padding
+			 *
+			 * @details
+			 * The output has to hold `length / 4 * 3 + 2` bytes.
+			 *
+			 * @return the number of the decoded bytes, `SIZE_MAX` if the text is not valid base64
+			 */
+			static size_t Base64Decode(const char *data, size_t length, char *out);
+
+			/**
+			 * @brief Computes the CRC32C (Castagnoli) checksum
+			 *
+			 * @param crc the checksum of the preceding data, to compute the checksum in pieces
+			 */
+			static uint32_t Crc32c(const char *data, size_t length, uint32_t crc = 0);
+
+			/**
+			 * @brief Computes the 64-bit XXH64 hash
+			 */
+			static uint64_t Hash64(const char *data, size_t length, uint64_t seed = 0);
+
+			/**
+			 * @brief Returns the instruction set used by the searches, `avx2`, `sse2` or `scalar`
+			 */
+			static const char *getInstructionSet();
+		};
+	}
+}
+
+#endif // LUACPP_LUASTRINGOPS_HPP
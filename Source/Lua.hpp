@@ -35,7 +35,88 @@
      #include "lua.h"
      #include "lualib.h"
      #include "lauxlib.h"
+#ifdef LUACPP_LUAJIT
+     #include "luajit.h"
+#endif
   }
 #endif //__cplusplus
 
+#if LUA_VERSION_NUM < 502
+// LuaJIT implements the API of Lua 5.1 with a few extensions of 5.2. The functions of
+// the later versions, which are used by the library, are emulated here.
+
+#ifndef LUA_OK
+#define LUA_OK 0
+#endif
+
+#define lua_rawlen(L, idx) lua_objlen(L, idx)
+#define lua_pushglobaltable(L) lua_pushvalue(L, LUA_GLOBALSINDEX)
+#define lua_getuservalue(L, idx) lua_getfenv(L, idx)
+#define lua_dump(L, writer, data, strip) (lua_dump)(L, writer, data)
+#define lua_load(L, reader, data, chunkname, mode) (lua_load)(L, reader, data, chunkname)
+
+inline int lua_absindex(lua_State *L, int idx) {
+	return (idx > 0 || idx <= LUA_REGISTRYINDEX) ? idx : lua_gettop(L) + idx + 1;
+}
+
+inline void lua_seti(lua_State *L, int idx, lua_Integer n) {
+	idx = lua_absindex(L, idx);
+	lua_pushinteger(L, n);
+	lua_insert(L, -2);
+	lua_settable(L, idx);
+}
+
+// Converts the value as the `tostring` of Lua 5.2, pushes and returns the string
+inline const char *luaL_tolstring(lua_State *L, int idx, size_t *len) {
+	idx = lua_absindex(L, idx);
+	if (luaL_callmeta(L, idx, "__tostring")) {
+		if (!lua_isstring(L, -1)) {
+			luaL_error(L, "'__tostring' must return a string");
+		}
+	} else {
+		switch (lua_type(L, idx)) {
+			case LUA_TNUMBER:
+			case LUA_TSTRING:
+				lua_pushvalue(L, idx);
+				break;
+			case LUA_TBOOLEAN:
+				lua_pushstring(L, lua_toboolean(L, idx) ? "true" : "false");
+				break;
+			case LUA_TNIL:
+				lua_pushliteral(L, "nil");
+				break;
+			default:
+				lua_pushfstring(L, "%s: %p", luaL_typename(L, idx), lua_topointer(L, idx));
+		}
+	}
+	return lua_tolstring(L, -1, len);
+}
+
+// There is no integer subtype, the numbers with integral values are reported as integers
+inline int lua_isinteger(lua_State *L, int idx) {
+	if (lua_type(L, idx) != LUA_TNUMBER) {
+		return 0;
+	}
+	lua_Number n = lua_tonumber(L, idx);
+	// 2^63 is not representable, the cast of it is undefined
+	return n >= -9223372036854775808.0 && n < 9223372036854775808.0 && n == (lua_Number) (lua_Integer) n;
+}
+#endif // LUA_VERSION_NUM < 502
+
+#if LUA_VERSION_NUM < 504
+// The resume of Lua 5.4 reports the number of the results, the earlier versions leave
+// only the results on the stack of the coroutine.
+inline int luacpp_resume(lua_State *L, lua_State *from, int nargs, int *nresults) {
+#if LUA_VERSION_NUM < 502
+	(void) from;
+	int status = (lua_resume)(L, nargs);
+#else
+	int status = (lua_resume)(L, from, nargs);
+#endif
+	*nresults = lua_gettop(L);
+	return status;
+}
+#define lua_resume(L, from, nargs, nresults) luacpp_resume(L, from, nargs, nresults)
+#endif // LUA_VERSION_NUM < 504
+
 #endif // LUACPP_LUA_HPP
@@ -28,10 +28,13 @@
 
 #include "LuaContext.hpp"
 #include "LuaVersion.hpp"
+#include "Diagnostics/LuaLogger.hpp"
+#include "Diagnostics/LuaTracer.hpp"
 
 using namespace LuaCpp;
 using namespace LuaCpp::Engine;
 using namespace LuaCpp::Registry;
+using namespace LuaCpp::Diagnostics;
 
 
 std::unique_ptr<LuaState> LuaContext::newState() {
@@ -39,6 +42,7 @@ std::unique_ptr<LuaState> LuaContext::newState() {
 }
 
 std::unique_ptr<LuaState> LuaContext::newState(const LuaEnvironment &env) {
+	LuaTraceSpan span("newState", "state");
 	std::unique_ptr<LuaState> L = std::make_unique<LuaState>();
 	luaL_openlibs(*L);
 
@@ -46,8 +50,16 @@ std::unique_ptr<LuaState> LuaContext::newState(const LuaEnvironment &env) {
 		((std::shared_ptr<LuaLibrary>) lib.second)->RegisterFunctions(*L);
 	}
 
+	for(const auto &lib : staticLibraries ) {
+		lib.second.RegisterFunctions(*L);
+	}
+
 	registerHooks(*L);
 
+	if (LuaTracer::isTracingLuaCalls()) {
+		LuaTracer::AttachLuaCalls(*L);
+	}
+
 	for(const auto &var : env) {
 		((std::shared_ptr<LuaType>) var.second)->PushGlobal(*L, var.first);
 	}
@@ -74,11 +86,34 @@ std::unique_ptr<LuaState> LuaContext::newStateFor(const std::string &name, const
 		std::unique_ptr<LuaCodeSnippet> cs = registry.getByName(name);
 		std::unique_ptr<LuaState> L = newState(env);
 		cs->UploadCode(*L);
+		if (profiler) {
+			profiler->Attach(*L, name);
+		}
+		if (allocProfiler) {
+			allocProfiler->Attach(*L);
+		}
 		return L;	
 	}	
 	throw std::runtime_error("Error: The code snipped not found ...");
 }
 
+std::unique_ptr<LuaState> LuaContext::newStateFromHeap(std::istream &image) {
+	std::unique_ptr<LuaState> L = newState();
+	L->RestoreHeap(image);
+	return L;
+}
+
+void LuaContext::PushSnippet(LuaState &L, const std::string &name) {
+	if (!registry.Exists(name)) {
+		throw std::runtime_error("Error: The code snipped not found ...");
+	}
+	registry.getByName(name)->UploadCode(L);
+}
+
+std::vector<std::string> LuaContext::getSnippetNames() const {
+	return registry.getNames();
+}
+
 void LuaContext::CompileString(const std::string &name, const std::string &code) {
 	registry.CompileAndAddString(name, code);
 }
@@ -136,31 +171,119 @@ void LuaContext::Run(const std::string &name) {
 }
 
 void LuaContext::RunWithEnvironment(const std::string &name, const LuaEnvironment &env) {
+	runSnippet(name, env, true);
+}
+
+LuaState &LuaContext::getIntrospectionState() {
+	CheckIntrospection();
+	if (!introspectionState) {
+		introspectionState = newState(globalEnvironment);
+	}
+	return *introspectionState;
+}
+
+void LuaContext::CheckIntrospection() {
+	// the versions only grow, so any change of a library changes the sum
+	uint64_t version = 0;
+	for (const auto &library : libraries) {
+		version += library.second->getVersion();
+	}
+	if (version != introspectionVersion) {
+		InvalidateIntrospection();
+		introspectionVersion = version;
+	}
+}
+
+void LuaContext::InvalidateIntrospection() {
+	introspectionState.reset();
+	stdLibraryCache.clear();
+	builtInFncCache.clear();
+}
+
+LuaResult<void> LuaContext::TryCompileString(const std::string &name, const std::string &code, bool recompile) {
+	return registry.TryCompileAndAddString(name, code, recompile);
+}
+
+LuaResult<void> LuaContext::TryCompileFile(const std::string &name, const std::string &fname, bool recompile) {
+	return registry.TryCompileAndAddFile(name, fname, recompile);
+}
+
+LuaResult<void> LuaContext::TryRun(const std::string &name) {
+	return TryRunWithEnvironment(name, globalEnvironment);
+}
+
+LuaResult<void> LuaContext::TryRunWithEnvironment(const std::string &name, const LuaEnvironment &env) {
+	return runSnippet(name, env, false);
+}
+
+LuaResult<void> LuaContext::runSnippet(const std::string &name, const LuaEnvironment &env, bool raise) {
+	if (recorder) {
+		recorder->Record(name, env);
+	}
+	if (!registry.Exists(name)) {
+		if (raise) {
+			throw std::runtime_error("The code snippet " + name + " not found");
+		}
+		return LuaError::Format(LuaError::ERRNOTFOUND, "The code snippet %s not found", name.c_str());
+	}
 	std::unique_ptr<LuaState> L = newStateFor(name);
-	
+
 	for(const auto &var : env) {
 		((std::shared_ptr<LuaType>) var.second)->PushGlobal(*L, var.first);
 	}
 
-	int res = lua_pcall(*L, 0, LUA_MULTRET, 0);
-	if (res != LUA_OK ) {
-		L->PrintStack(std::cout);
-		throw std::runtime_error(lua_tostring(*L,1));
+	int res;
+	{
+		LuaTraceSpan span("lua_pcall", "run", name.c_str());
+		res = lua_pcall(*L, 0, LUA_MULTRET, 0);
+	}
+	if (profiler) {
+		profiler->Detach(*L);
+	}
+	if (allocProfiler) {
+		allocProfiler->Detach(*L);
+	}
+	if (res != LUA_OK) {
+		if (raise) {
+			size_t len = 0;
+			const char *msg = lua_tolstring(*L, -1, &len);
+			std::shared_ptr<LuaLogger> logger = LuaLogger::getDefault();
+			if (logger) {
+				LuaLogField fields[] = {{"snippet", name.c_str(), name.size()}, {"error", msg != NULL ? msg : "", len}};
+				logger->Log(LuaLogLevel::Error, "script failed", sizeof("script failed") - 1, fields, sizeof(fields) / sizeof(fields[0]));
+			} else {
+				L->PrintStack(std::cout);
+			}
+			// the exception holds the whole message, LuaError would truncate it
+			throw std::runtime_error(msg != NULL ? std::string(msg, len) : std::string("(error object is not a string)"));
+		}
+		return LuaError::FromStatus(*L, res);
 	}
 
+	if (raise) {
+		for(const auto &var : env) {
+			((std::shared_ptr<LuaType>) var.second)->PopGlobal(*L);
+		}
+		return LuaResult<void>();
+	}
 	for(const auto &var : env) {
-		((std::shared_ptr<LuaType>) var.second)->PopGlobal(*L);
+		LuaError error = ((std::shared_ptr<LuaType>) var.second)->TryPopGlobal(*L);
+		if (!error.ok()) {
+			return error;
+		}
 	}
-
+	return LuaResult<void>();
 }
 
-std::shared_ptr<Registry::LuaLibrary> LuaContext::getStdLibrary(const std::string &libName)
+std::shared_ptr<Registry::LuaLibrary> LuaContext::findStdLibrary(const std::string &libName)
 {
 	std::shared_ptr<LuaLibrary> foundLibrary = NULL;
-	std::unique_ptr<LuaCpp::Engine::LuaState> L = newState(globalEnvironment);
-	lua_getglobal(*L, libName.c_str());
+	LuaState &L = getIntrospectionState();
+	int top = lua_gettop(L);
 
-	if(lua_istable(*L, 1))
+	lua_getglobal(L, libName.c_str());
+
+	if(lua_istable(L, -1))
 	{
 		// get metatable-name for corresponding standard-library:
 		if(libName == "io")
@@ -173,66 +296,114 @@ std::shared_ptr<Registry::LuaLibrary> LuaContext::getStdLibrary(const std::strin
 			foundLibrary = std::make_shared<LuaLibrary>(libName);
 		}
 
-		lua_pushnil(*L);
+		lua_pushnil(L);
 
-		while(lua_next(*L, -2) != 0)
+		while(lua_next(L, -2) != 0)
 		{
-			foundLibrary->AddCFunction(lua_tostring(*L, -2), lua_tocfunction(*L, -1));
+			foundLibrary->AddCFunction(lua_tostring(L, -2), lua_tocfunction(L, -1));
 
-			lua_pop(*L, 1);
+			lua_pop(L, 1);
 		}
 
 		// check, if for this library a metatable exists at all:
-		if(luaL_getmetatable(*L, foundLibrary->getMetaTableName().c_str()))
+		if(luaL_getmetatable(L, foundLibrary->getMetaTableName().c_str()))
 		{
 			// get meta-methods of library:
 			// ============================
-			lua_pushnil(*L);
+			lua_pushnil(L);
 
-			while(lua_next(*L, -2) != 0)
+			while(lua_next(L, -2) != 0)
 			{
 				// check, if it is a meta-method:
-				if(lua_iscfunction(*L, -1))
+				if(lua_iscfunction(L, -1))
 				{
-					foundLibrary->AddCMethod(lua_tostring(*L, -2), lua_tocfunction(*L, -1));
+					foundLibrary->AddCMethod(lua_tostring(L, -2), lua_tocfunction(L, -1));
 				}
 
-				lua_pop(*L, 1);
+				lua_pop(L, 1);
 			}
 
 			// get methods of library:
 			// =======================
-			lua_getfield(*L, -1, "__index");
-			lua_pushnil(*L);
+			lua_getfield(L, -1, "__index");
+			lua_pushnil(L);
 
-			while(lua_next(*L, -2) != 0)
+			while(lua_next(L, -2) != 0)
 			{
-				foundLibrary->AddCMethod(lua_tostring(*L, -2), lua_tocfunction(*L, -1));
+				foundLibrary->AddCMethod(lua_tostring(L, -2), lua_tocfunction(L, -1));
 
-				lua_pop(*L, 1);
+				lua_pop(L, 1);
 			}
 		}
 	}
 
+	lua_settop(L, top);
 	return foundLibrary;
 }
 
-std::shared_ptr<Registry::LuaCFunction> LuaContext::getBuiltInFnc(const std::string &fncName)
+std::shared_ptr<Registry::LuaLibrary> LuaContext::getStdLibrary(const std::string &libName)
+{
+	CheckIntrospection();
+	auto it = stdLibraryCache.find(libName);
+	if (it == stdLibraryCache.end()) {
+		it = stdLibraryCache.emplace(libName, findStdLibrary(libName)).first;
+	}
+
+	if (!it->second) {
+		return NULL;
+	}
+	return std::make_shared<LuaLibrary>(*it->second);
+}
+
+std::map<std::string, std::shared_ptr<Registry::LuaLibrary>> LuaContext::getStdLibraries(const std::vector<std::string> &libNames)
+{
+	std::map<std::string, std::shared_ptr<Registry::LuaLibrary>> found;
+	for (const auto &libName : libNames) {
+		found[libName] = getStdLibrary(libName);
+	}
+	return found;
+}
+
+std::shared_ptr<Registry::LuaCFunction> LuaContext::findBuiltInFnc(const std::string &fncName)
 {
 	std::shared_ptr<Registry::LuaCFunction> builtInFnc = NULL;
-	std::unique_ptr<LuaCpp::Engine::LuaState> L = newState(globalEnvironment);
+	LuaState &L = getIntrospectionState();
 
-	lua_getglobal(*L, fncName.c_str());
+	lua_getglobal(L, fncName.c_str());
 
 	// check, if it is a function at all:
-	if(lua_iscfunction(*L, 1))
+	if(lua_iscfunction(L, -1))
 	{
-		builtInFnc = std::shared_ptr<Registry::LuaCFunction>(new Registry::LuaCFunction(lua_tocfunction(*L, 1)));
+		builtInFnc = std::shared_ptr<Registry::LuaCFunction>(new Registry::LuaCFunction(lua_tocfunction(L, -1)));
 	}
 
+	lua_pop(L, 1);
 	return builtInFnc;
 }
 
+std::shared_ptr<Registry::LuaCFunction> LuaContext::getBuiltInFnc(const std::string &fncName)
+{
+	CheckIntrospection();
+	auto it = builtInFncCache.find(fncName);
+	if (it == builtInFncCache.end()) {
+		it = builtInFncCache.emplace(fncName, findBuiltInFnc(fncName)).first;
+	}
+
+	if (!it->second) {
+		return NULL;
+	}
+	return std::make_shared<Registry::LuaCFunction>(*it->second);
+}
+
+std::map<std::string, std::shared_ptr<Registry::LuaCFunction>> LuaContext::getBuiltInFncs(const std::vector<std::string> &fncNames)
+{
+	std::map<std::string, std::shared_ptr<Registry::LuaCFunction>> found;
+	for (const auto &fncName : fncNames) {
+		found[fncName] = getBuiltInFnc(fncName);
+	}
+	return found;
+}
+
 void LuaContext::setBuiltInFnc(const std::string &fncName, lua_CFunction cfunction)
 {
 	setBuiltInFnc(fncName, cfunction, false);
@@ -240,28 +411,29 @@ void LuaContext::setBuiltInFnc(const std::string &fncName, lua_CFunction cfuncti
 
 void LuaContext::setBuiltInFnc(const std::string &fncName, lua_CFunction cfunction, bool replace)
 {
-	std::unique_ptr<LuaCpp::Engine::LuaState> L = newState(globalEnvironment);
-
 	// if we want to replace already existing function, we have to remove old one from list first:
 	if(replace)
 	{
 		builtInFunctions.erase(fncName);
+	}
+	// check, if function already exists:
+	else
+	{
+		LuaState &L = getIntrospectionState();
+		bool exists = Exists_buildInFnc(L, fncName);
+		lua_pop(L, 1);
 
-		// check, if function still exists in global environment, so we delete it there:
-		if(Exists_buildInFnc(*L, fncName))
+		if (exists)
 		{
-			lua_pushnil(*L);
-			lua_setglobal(*L, fncName.c_str());
+			return;
 		}
 	}
 
-	// check, if function already exists:
-	if(!Exists_buildInFnc(*L, fncName))
-	{
-		std::unique_ptr<LuaCFunction> func = std::make_unique<LuaCFunction>(cfunction);
-		func->setName(fncName);
-		builtInFunctions.insert(std::make_pair(fncName, std::move(*func)));
-	}
+	std::unique_ptr<LuaCFunction> func = std::make_unique<LuaCFunction>(cfunction);
+	func->setName(fncName);
+	builtInFunctions.insert(std::make_pair(fncName, std::move(*func)));
+
+	InvalidateIntrospection();
 }
 
 bool LuaContext::Exists_buildInFnc(Engine::LuaState &L, const std::string &fncName) 
@@ -273,13 +445,23 @@ bool LuaContext::Exists_buildInFnc(Engine::LuaState &L, const std::string &fncNa
 		
 void LuaContext::AddLibrary(std::shared_ptr<Registry::LuaLibrary> &library) {
 	libraries[library->getName()] = std::move(library);
+	InvalidateIntrospection();
+}
+
+void LuaContext::AddLibrary(const Registry::LuaStaticLibrary &library) {
+	staticLibraries.erase(library.getName());
+	staticLibraries.emplace(library.getName(), library);
+	InvalidateIntrospection();
 }
 
 void LuaContext::AddGlobalVariable(const std::string &name, std::shared_ptr<Engine::LuaType> var) {
 	globalEnvironment[name] = std::move(var);
+	InvalidateIntrospection();
 }
 
 std::shared_ptr<Engine::LuaType> &LuaContext::getGlobalVariable(const std::string &name) {
+	// the variable may be changed through the reference
+	InvalidateIntrospection();
 	return globalEnvironment[name];
 }
 
@@ -288,6 +470,30 @@ void LuaContext::addHook(lua_Hook hookFunc, const std::string &hookType, const i
 	hooks.push_back(std::tuple<std::string, int, lua_Hook>(hookType, count, hookFunc));
 }
 
+void LuaContext::setProfiler(std::shared_ptr<Diagnostics::LuaProfiler> _profiler) {
+	profiler = std::move(_profiler);
+}
+
+std::shared_ptr<Diagnostics::LuaProfiler> LuaContext::getProfiler() {
+	return profiler;
+}
+
+void LuaContext::setAllocProfiler(std::shared_ptr<Diagnostics::LuaAllocProfiler> _allocProfiler) {
+	allocProfiler = std::move(_allocProfiler);
+}
+
+std::shared_ptr<Diagnostics::LuaAllocProfiler> LuaContext::getAllocProfiler() {
+	return allocProfiler;
+}
+
+void LuaContext::setRecorder(std::shared_ptr<Diagnostics::LuaWorkloadRecorder> _recorder) {
+	recorder = std::move(_recorder);
+}
+
+std::shared_ptr<Diagnostics::LuaWorkloadRecorder> LuaContext::getRecorder() {
+	return recorder;
+}
+
 void LuaContext::registerHooks(LuaCpp::Engine::LuaState &L)
 {
 	for(const auto &hook : hooks) 
@@ -315,6 +521,10 @@ void LuaContext::registerHooks(LuaCpp::Engine::LuaState &L)
 			mask = LUA_MASKCOUNT;
 		}
 
+#ifdef LUACPP_LUAJIT
+		// the hooks are not called from the compiled code
+		luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+#endif
 		lua_sethook(L, std::get<2>(hook), mask, count);
 	}
 }
\ No newline at end of file
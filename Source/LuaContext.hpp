@@ -29,8 +29,12 @@
 
 #include "Registry/LuaRegistry.hpp"
 #include "Registry/LuaLibrary.hpp"
+#include "Registry/LuaStaticLibrary.hpp"
 #include "Engine/LuaState.hpp"
 #include "Engine/LuaType.hpp"
+#include "Diagnostics/LuaProfiler.hpp"
+#include "Diagnostics/LuaAllocProfiler.hpp"
+#include "Diagnostics/LuaWorkloadRecorder.hpp"
 
 namespace LuaCpp {
 	/**
@@ -62,6 +66,11 @@ namespace LuaCpp {
 		 */
 		std::map<std::string, std::shared_ptr<Registry::LuaLibrary>> libraries;
 
+		/**
+		 * Libraries of `C` functions defined at compile time
+		 */
+		std::map<std::string, Registry::LuaStaticLibrary> staticLibraries;
+
 		/**
 		 * @brief Array, which will keep the added hooks.
 		 * 
@@ -78,6 +87,80 @@ namespace LuaCpp {
 		 */
 		std::map<std::string, LuaCpp::Registry::LuaCFunction> builtInFunctions;
 
+		/**
+		 * @brief Profiler attached to the states created for the snippets
+		 */
+		std::shared_ptr<Diagnostics::LuaProfiler> profiler;
+
+		/**
+		 * @brief Allocation profiler attached to the states created for the snippets
+		 */
+		std::shared_ptr<Diagnostics::LuaAllocProfiler> allocProfiler;
+
+		/**
+		 * @brief Recorder of the runs of the snippets
+		 */
+		std::shared_ptr<Diagnostics::LuaWorkloadRecorder> recorder;
+
+		/**
+		 * @brief State used to look up the standard libraries and built-in functions
+		 *
+		 * @details
+		 * The state is created on the first look up and dropped, together with 
+		 * the cached results, when the libraries, built-in functions or 
+		 * global variables of the context change.
+		 */
+		std::unique_ptr<Engine::LuaState> introspectionState;
+
+		/**
+		 * @brief Sum of the versions of the libraries when the introspection state was created
+		 */
+		uint64_t introspectionVersion;
+
+		/**
+		 * @brief Cached results of getStdLibrary(), `NULL` when the library is not found
+		 */
+		std::map<std::string, std::shared_ptr<Registry::LuaLibrary>> stdLibraryCache;
+
+		/**
+		 * @brief Cached results of getBuiltInFnc(), `NULL` when the function is not found
+		 */
+		std::map<std::string, std::shared_ptr<Registry::LuaCFunction>> builtInFncCache;
+
+		/**
+		 * @brief Returns the state used for the look ups, creating it when needed
+		 */
+		Engine::LuaState &getIntrospectionState();
+
+		/**
+		 * @brief Drops the introspection state and the cached results
+		 */
+		void InvalidateIntrospection();
+
+		/**
+		 * @brief Drops the introspection state when a library was changed after it was added
+		 */
+		void CheckIntrospection();
+
+		/**
+		 * @brief Looks up the standard library in the introspection state
+		 */
+		std::shared_ptr<Registry::LuaLibrary> findStdLibrary(const std::string &libName);
+
+		/**
+		 * @brief Looks up the built-in function in the introspection state
+		 */
+		std::shared_ptr<Registry::LuaCFunction> findBuiltInFnc(const std::string &fncName);
+
+		/**
+		 * @brief Runs the snippet in a new state, shared by `RunWithEnvironment()` and `TryRunWithEnvironment()`
+		 * @details
+		 * With `raise` set, the error is logged to the default logger, or
+		 * the stack of the state is printed, and thrown as the exception 
+		 * with the whole message. Otherwise it is returned as `LuaError`.
+		 */
+		Engine::LuaResult<void> runSnippet(const std::string &name, const LuaEnvironment &env, bool raise);
+
 	public:
 
 		/**
@@ -88,7 +171,7 @@ namespace LuaCpp {
 		 * for the communication with the Lua virtual machine
 		 * from the high level APIs.
 		 */
-		LuaContext() : registry(), libraries(), globalEnvironment(), builtInFunctions() {};
+		LuaContext() : registry(), libraries(), staticLibraries(), globalEnvironment(), builtInFunctions(), profiler(), allocProfiler(), recorder(), introspectionState(), introspectionVersion(0), stdLibraryCache(), builtInFncCache() {};
 		~LuaContext() {};
 
 		/**
@@ -164,6 +247,43 @@ namespace LuaCpp {
 		 */
 	        std::unique_ptr<Engine::LuaState> newStateFor(const std::string &name, const LuaEnvironment &env);
 
+		/**
+		 * @brief Creates new Lua execution state from the context and restores a heap image
+		 *
+		 * @details
+		 * Creates new Lua execution state from the context, with the libraries
+		 * that are registered in the context, and restores the heap saved by
+		 * `LuaState::SaveHeap()` on top of it. Restoring the heap of an
+		 * initialised state is faster than running the initialisation again.
+		 *
+		 * @param image the stream with the heap image
+		 *
+		 * @return Pointer to the LuaState object holding the pointer of the lua_State
+		 *
+		 * @throws std::invalid_argument if the image is malformed
+		 */
+		std::unique_ptr<Engine::LuaState> newStateFromHeap(std::istream &image);
+
+		/**
+		 * @brief Loads a compiled snippet on the top of the stack
+		 *
+		 * @details
+		 * Loads the snippet from the registry as a function on the top
+		 * of the stack of the given state, without running it. Can be used
+		 * to preload several snippets into one state.
+		 *
+		 * If the name is not found, the method will throw exception
+		 *
+		 * @param L the state
+		 * @param name Name of the snippet to be loaded
+		 */
+		void PushSnippet(Engine::LuaState &L, const std::string &name);
+
+		/**
+		 * @brief Returns the names of the compiled snippets
+		 */
+		std::vector<std::string> getSnippetNames() const;
+
 		/**
 		 * @brief Compiles a string containing Lua code and adds it to the repository
 		 *
@@ -379,6 +499,66 @@ namespace LuaCpp {
 		 */
 		void RunWithEnvironment(const std::string &name, const LuaEnvironment &env);
 
+		/**
+		 * @brief Compiles a code snippet without throwing exceptions
+		 *
+		 * @details
+		 * Same as `CompileString()`, the compilation error is returned 
+		 * as LuaError instead of an exception.
+		 *
+		 * @param name Name under which the snippet will be registered
+		 * @param code Lua code
+		 * @param recompile if `true` the existing snippet will be replaced
+		 *
+		 * @return the compilation error, or no error
+		 */
+		Engine::LuaResult<void> TryCompileString(const std::string &name, const std::string &code, bool recompile = false);
+
+		/**
+		 * @brief Compiles a file without throwing exceptions
+		 *
+		 * @details
+		 * Same as `CompileFile()`, the compilation error is returned 
+		 * as LuaError instead of an exception.
+		 *
+		 * @param name Name under which the snippet will be registered
+		 * @param fname Name of the file
+		 * @param recompile if `true` the existing snippet will be replaced
+		 *
+		 * @return the compilation error, or no error
+		 */
+		Engine::LuaResult<void> TryCompileFile(const std::string &name, const std::string &fname, bool recompile = false);
+
+		/**
+		 * @brief Run a code snippet without throwing exceptions
+		 *
+		 * @details
+		 * Same as `Run()`, for the scripts that are expected to fail. The
+		 * errors are returned as LuaError holding the status code and the 
+		 * message in a fixed buffer, so the failed run costs no exception
+		 * and no string allocation. The stack is not printed on error.
+		 *
+		 * @param name Name under which the snippet is registered
+		 *
+		 * @return the error of the run, or no error
+		 */
+		Engine::LuaResult<void> TryRun(const std::string &name);
+
+		/**
+		 * @brief Run a code snippet with a given `lua` global table without throwing exceptions
+		 *
+		 * @details
+		 * Same as `RunWithEnvironment()`, with the errors returned as in `TryRun()`.
+		 * The values of the environment which changed their type in the script
+		 * are reported as `LuaError::ERRTYPE`.
+		 *
+		 * @param name Name under which the snippet is registered
+		 * @param env the global variables of the run
+		 *
+		 * @return the error of the run, or no error
+		 */
+		Engine::LuaResult<void> TryRunWithEnvironment(const std::string &name, const LuaEnvironment &env);
+
 		/**
 		* @brief Get a LUA standard library
 		*
@@ -387,10 +567,29 @@ namespace LuaCpp {
 		*
 		* @param libName The name of the standard LUA library
 		*
+		* The libraries are looked up in a state that is created once and
+		* cached together with the results, until the libraries, built-in 
+		* functions or global variables of the context change. Each call returns
+		* a copy of the cached library, which can be modified by the caller.
+		*
 		* @return pointer to the found standard LUA library with the respective name.
 		*/
 		std::shared_ptr<Registry::LuaLibrary> getStdLibrary(const std::string &libName);
 
+		/**
+		* @brief Get several standard LUA libraries
+		*
+		* @details
+		* Returns the standard libraries with the given names, looked up in the 
+		* same cached state as getStdLibrary(). The libraries which are not found
+		* are set to `NULL`.
+		*
+		* @param libNames The names of the standard LUA libraries
+		*
+		* @return map of the library names and the found libraries
+		*/
+		std::map<std::string, std::shared_ptr<Registry::LuaLibrary>> getStdLibraries(const std::vector<std::string> &libNames);
+
 		/**
 		* @brief Get a LUA built-in function
 		*
@@ -399,10 +598,25 @@ namespace LuaCpp {
 		*
 		* @param fncName The name of the built-in LUA function
 		*
+		* The function is looked up in the same cached state as getStdLibrary().
+		*
 		* @return pointer to the found LUA built-in function with the respective name.
 		*/
 		std::shared_ptr<Registry::LuaCFunction> getBuiltInFnc(const std::string &fncName);
 
+		/**
+		* @brief Get several LUA built-in functions
+		*
+		* @details
+		* Returns the built-in functions with the given names. The functions which 
+		* are not found are set to `NULL`.
+		*
+		* @param fncNames The names of the built-in LUA functions
+		*
+		* @return map of the function names and the found functions
+		*/
+		std::map<std::string, std::shared_ptr<Registry::LuaCFunction>> getBuiltInFncs(const std::vector<std::string> &fncNames);
+
 		/**
 		* @brief Set a LUA built-in function
 		*
@@ -447,6 +661,19 @@ namespace LuaCpp {
 		*/
 		void AddLibrary(std::shared_ptr<Registry::LuaLibrary> &library);
 
+		/**
+		* @brief Add a `C` library defined at compile time to the context
+		*
+		* @details
+		* Adds a static library to the context. The library will be registered
+		* whenever a new state is created from the context, after the libraries
+		* added as LuaLibrary. The arrays of the library have to outlive the 
+		* context.
+		*
+		* @param library The library referring to the `luaL_Reg` arrays
+		*/
+		void AddLibrary(const Registry::LuaStaticLibrary &library);
+
 		/**
 		 * @brief Add a global variable
 		 *
@@ -470,6 +697,11 @@ namespace LuaCpp {
 		 * Returns a shared pointer to the global variable. The variable
 		 * should be reinterpreted as the proper type.
 		 *
+		 * The variable can be changed through the returned reference, so
+		 * the cached look ups of getStdLibrary() and getBuiltInFnc() are
+		 * dropped. Change the variable before the next look up, or call
+		 * the method again after the change.
+		 *
 		 * @param name Name of the global variable
 		 *
 		 * @returns
@@ -479,6 +711,64 @@ namespace LuaCpp {
 
 		void addHook(lua_Hook hookFunc, const std::string &hookType, const int count = 0);
 
+		/**
+		 * @brief Sets the call-graph profiler for the context
+		 *
+		 * @details
+		 * The profiler will be attached to the states created by `newStateFor()`
+		 * under the name of the snippet, and the calls made during `Run()` will be
+		 * added to the call tree of the snippet. The profiler replaces the hooks
+		 * added with `addHook()`. Use `NULL` to stop the profiling.
+		 *
+		 * @param profiler The profiler collecting the call trees
+		 */
+		void setProfiler(std::shared_ptr<Diagnostics::LuaProfiler> profiler);
+
+		/**
+		 * @brief Returns the profiler of the context
+		 *
+		 * @return the profiler or `NULL` if the context is not profiled
+		 */
+		std::shared_ptr<Diagnostics::LuaProfiler> getProfiler();
+
+		/**
+		 * @brief Sets the allocation profiler for the context
+		 *
+		 * @details
+		 * The profiler will be attached to the states created by `newStateFor()`
+		 * and the allocations made during `Run()` will be attributed to the 
+		 * lines of the snippet. Use `NULL` to stop the profiling.
+		 *
+		 * @param allocProfiler The profiler collecting the allocation sites
+		 */
+		void setAllocProfiler(std::shared_ptr<Diagnostics::LuaAllocProfiler> allocProfiler);
+
+		/**
+		 * @brief Returns the allocation profiler of the context
+		 *
+		 * @return the profiler or `NULL` if the allocations are not profiled
+		 */
+		std::shared_ptr<Diagnostics::LuaAllocProfiler> getAllocProfiler();
+
+		/**
+		 * @brief Sets the recorder of the runs
+		 *
+		 * @details
+		 * The name and the environment of each `Run()` and `TryRun()` will
+		 * be written by the recorder, so the workload can be replayed later
+		 * by the LuaWorkloadReplayer. Use `NULL` to stop the recording.
+		 *
+		 * @param recorder The recorder of the runs
+		 */
+		void setRecorder(std::shared_ptr<Diagnostics::LuaWorkloadRecorder> recorder);
+
+		/**
+		 * @brief Returns the recorder of the runs
+		 *
+		 * @return the recorder or `NULL` if the runs are not recorded
+		 */
+		std::shared_ptr<Diagnostics::LuaWorkloadRecorder> getRecorder();
+
 		void registerHooks(LuaCpp::Engine::LuaState &L);
 	};
 }
@@ -38,11 +38,53 @@
 #include "Engine/LuaTNumber.hpp"
 #include "Engine/LuaTTable.hpp"
 #include "Engine/LuaTUserData.hpp"
+#include "Engine/LuaError.hpp"
+#include "Engine/LuaResult.hpp"
+#include "Engine/LuaCodec.hpp"
+#include "Engine/LuaGenerator.hpp"
+#include "Engine/LuaHeapImage.hpp"
 
 #include "Registry/LuaCompiler.hpp"
 #include "Registry/LuaRegistry.hpp"
 #include "Registry/LuaCodeSnippet.hpp"
 #include "Registry/LuaLibrary.hpp"
+#include "Registry/LuaStaticLibrary.hpp"
 #include "Registry/LuaCFunction.hpp"
+#include "Registry/LuaCClosure.hpp"
+
+#include "Diagnostics/LuaLogger.hpp"
+#include "Diagnostics/LuaTracer.hpp"
+#include "Diagnostics/LuaProfiler.hpp"
+#include "Diagnostics/LuaAllocProfiler.hpp"
+#include "Diagnostics/LuaWorkloadRecorder.hpp"
+#include "Diagnostics/LuaWorkloadReplayer.hpp"
+
+#include "Async/LuaThreadPool.hpp"
+#include "Async/LuaTimerWheel.hpp"
+#include "Async/LuaScheduler.hpp"
+#include "Async/LuaTimerLibrary.hpp"
+#include "Async/LuaFileIO.hpp"
+#include "Async/LuaAioLibrary.hpp"
+#include "Async/LuaParallel.hpp"
+#include "Async/LuaParallelLibrary.hpp"
+#include "Async/LuaCoroutine.hpp"
+
+#include "Library/LuaStringBuilder.hpp"
+#include "Library/LuaStringOps.hpp"
+#include "Library/LuaStringLibrary.hpp"
+#include "Library/LuaLogLibrary.hpp"
+#include "Library/LuaRegexLibrary.hpp"
+#include "Library/LuaMappedFile.hpp"
+#include "Library/LuaCsvReader.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include "Service/LuaServiceProtocol.hpp"
+#include "Service/LuaServiceClient.hpp"
+#include "Service/LuaForkServer.hpp"
+#endif
+
+#ifdef __linux__
+#include "Service/LuaScriptServer.hpp"
+#endif
 
 #endif //LUACPP_LUACPP_HPP
@@ -0,0 +1,139 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUACCLOSURE_HPP
+#define LUACPP_LUACCLOSURE_HPP
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../Lua.hpp"
+
+namespace LuaCpp {
+	namespace Registry {
+
+		/**
+		 * @brief `C` closure holding a C++ callable in the upvalue
+		 *
+		 * @details
+		 * The callable `F` is invoked as `int (lua_State *)` and follows
+		 * the `lua_CFunction` interface. A copy of the callable is stored in a
+		 * userdata which is the first upvalue of the closure, so the state of
+		 * the callable is owned by the Lua state.
+		 *
+		 * The trivially copyable callables are copied into the userdata and
+		 * need no finalizer. Other callables are constructed in place and 
+		 * destroyed by the `__gc` meta-method, with the meta-table shared
+		 * by all the closures of the same type.
+		 *
+		 * The trampoline `Invoke` is instantiated for each type, so the 
+		 * callable is called directly, without the type erasure of 
+		 * `std::function`, unless the callable is a `std::function` itself.
+		 * The Lua errors raised by the callable do not unwind the C++ stack, 
+		 * so the callable should not hold objects with destructors when it
+		 * calls `lua_error`.
+		 */
+		template <typename F>
+		class LuaCClosure {
+			static_assert(alignof(F) <= alignof(void *) || alignof(F) <= alignof(lua_Number),
+			              "the callable is not aligned by the Lua userdata");
+
+		   private:
+			/**
+			 * @brief Key of the shared meta-table in the registry
+			 */
+			static char metaTableKey;
+
+			static int Collect(lua_State *L) {
+				F *callable = (F *) lua_touserdata(L, 1);
+				callable->~F();
+				return 0;
+			}
+
+		   public:
+			/**
+			 * @brief Calls the callable stored in the first upvalue
+			 */
+			static int Invoke(lua_State *L) {
+				F *callable = (F *) lua_touserdata(L, lua_upvalueindex(1));
+				return (*callable)(L);
+			}
+
+			/**
+			 * @brief Pushes the userdata holding a copy of the callable
+			 *
+			 * @param L State on which the userdata will be pushed
+			 * @param callable The callable that will be copied
+			 */
+			static void PushUpvalue(lua_State *L, const F &callable) {
+				void *storage = lua_newuserdata(L, sizeof(F));
+				new (storage) F(callable);
+
+				// the trivially copyable callables need no finalizer
+				if (!std::is_trivially_destructible<F>::value) {
+					lua_pushlightuserdata(L, &metaTableKey);
+					lua_rawget(L, LUA_REGISTRYINDEX);
+					if (lua_isnil(L, -1)) {
+						lua_pop(L, 1);
+						lua_createtable(L, 0, 1);
+						lua_pushcfunction(L, Collect);
+						lua_setfield(L, -2, "__gc");
+						lua_pushlightuserdata(L, &metaTableKey);
+						lua_pushvalue(L, -2);
+						lua_rawset(L, LUA_REGISTRYINDEX);
+					}
+					lua_setmetatable(L, -2);
+				}
+			}
+
+			/**
+			 * @brief Pushes the closure calling a copy of the callable
+			 *
+			 * @param L State on which the closure will be pushed
+			 * @param callable The callable that will be copied
+			 */
+			static void Push(lua_State *L, const F &callable) {
+				PushUpvalue(L, callable);
+				lua_pushcclosure(L, Invoke, 1);
+			}
+		};
+
+		template <typename F>
+		char LuaCClosure<F>::metaTableKey = 0;
+
+		/**
+		 * @brief Pushes the closure calling a copy of the callable
+		 *
+		 * @param L State on which the closure will be pushed
+		 * @param callable The callable implementing `int (lua_State *)`
+		 */
+		template <typename F>
+		void PushCClosure(lua_State *L, F &&callable) {
+			LuaCClosure<typename std::decay<F>::type>::Push(L, callable);
+		}
+	}
+}
+
+#endif // LUACPP_LUACCLOSURE_HPP
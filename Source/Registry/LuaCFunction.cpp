@@ -22,10 +22,40 @@
    SOFTWARE.
    */
 
+#include <chrono>
+
 #include "LuaCFunction.hpp"
 
 using namespace LuaCpp::Registry;
 
+extern "C" {
+	static int instrumented_trampoline(lua_State *L) {
+		LuaCFunction::Counters *counters = (LuaCFunction::Counters *) lua_touserdata(L, lua_upvalueindex(1));
+		lua_CFunction cfunction = lua_tocfunction(L, lua_upvalueindex(2));
+		counters->calls.fetch_add(1, std::memory_order_relaxed);
+
+		auto start = std::chrono::steady_clock::now();
+		int res = cfunction(L);
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		counters->nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+		return res;
+	}
+
+	static int instrumented_closure_trampoline(lua_State *L) {
+		LuaCFunction::Counters *counters = (LuaCFunction::Counters *) lua_touserdata(L, lua_upvalueindex(2));
+		lua_CFunction invoke = lua_tocfunction(L, lua_upvalueindex(3));
+		counters->calls.fetch_add(1, std::memory_order_relaxed);
+
+		auto start = std::chrono::steady_clock::now();
+		int res = invoke(L);
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		counters->nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+		return res;
+	}
+}
+
 void LuaCFunction::setName(std::string _name) {
 	name = std::move(_name);
 }
@@ -43,3 +73,42 @@ lua_CFunction LuaCFunction::getCFunction() {
 	return cfunction;
 }
 
+bool LuaCFunction::isClosure() {
+	return (bool) closure;
+}
+
+void LuaCFunction::Push(lua_State *L) {
+	if (closure) {
+		lua_CFunction invoke = closure(L);
+		lua_pushcclosure(L, invoke, 1);
+		return;
+	}
+	lua_pushcfunction(L, cfunction);
+}
+
+void LuaCFunction::PushInstrumented(lua_State *L) {
+	// the called function is an upvalue, the counters are shared by the states
+	if (closure) {
+		lua_CFunction invoke = closure(L);
+		lua_pushlightuserdata(L, counters.get());
+		lua_pushcfunction(L, invoke);
+		lua_pushcclosure(L, instrumented_closure_trampoline, 3);
+		return;
+	}
+	lua_pushlightuserdata(L, counters.get());
+	lua_pushcfunction(L, cfunction);
+	lua_pushcclosure(L, instrumented_trampoline, 2);
+}
+
+uint64_t LuaCFunction::getCalls() {
+	return counters->calls.load();
+}
+
+uint64_t LuaCFunction::getNanoseconds() {
+	return counters->nanoseconds.load();
+}
+
+void LuaCFunction::ResetStats() {
+	counters->calls.store(0);
+	counters->nanoseconds.store(0);
+}
@@ -25,13 +25,32 @@
 #ifndef LUACPP_LUACFUNCTION_HPP
 #define LUACPP_LUACFUNCTION_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 
 #include "../Lua.hpp"
+#include "LuaCClosure.hpp"
 
 namespace LuaCpp {
 	namespace Registry {
 
+		/**
+		 * @brief Snapshot of the calls of a binding
+		 *
+		 * @details
+		 * The `kind` is one of `function`, `method` or `metamethod`, and
+		 * `nanoseconds` is the time spent in the calls that returned to Lua.
+		 */
+		struct LuaBindingStats {
+			std::string kind;
+			std::string name;
+			uint64_t calls;
+			uint64_t nanoseconds;
+		};
+
 		/**
 		 * @brief Wrapper for a `C` function implementing the lua_CFunction interface
 		 *
@@ -39,20 +58,105 @@ namespace LuaCpp {
 		 * Wrapper for the lua_CFunction that will be added to the LuaLibrary.
 		 */
 		class LuaCFunction {
+		   public:
+			/**
+			 * @brief Counters updated by the instrumented trampoline
+			 *
+			 * @details
+			 * The counters are shared by the copies of the function, so 
+			 * the address passed to the trampoline remains valid while
+			 * the library holding the function exists.
+			 */
+			struct Counters {
+				std::atomic<uint64_t> calls{0};
+				std::atomic<uint64_t> nanoseconds{0};
+			};
+
+			/**
+			 * @brief Pushes the upvalue of a closure and returns the function using it
+			 */
+			typedef std::function<lua_CFunction(lua_State *)> UpvaluePusher;
+
 		   private:
 			std::string name;
 			lua_CFunction cfunction;
+			std::shared_ptr<Counters> counters;
+			UpvaluePusher closure;
 
 	           public:
-			LuaCFunction() {};
-			explicit LuaCFunction(lua_CFunction _cfunction) : cfunction(_cfunction) {};
+			LuaCFunction() : name(), cfunction(NULL), counters(std::make_shared<Counters>()), closure() {};
+			explicit LuaCFunction(lua_CFunction _cfunction) : name(), cfunction(_cfunction), counters(std::make_shared<Counters>()), closure() {};
 			~LuaCFunction() {};
 
+			/**
+			 * @brief Creates the function calling a copy of the callable
+			 *
+			 * @details
+			 * The callable implements `int (lua_State *)`. Each state in which the
+			 * function is pushed gets its own copy of the callable, stored in the
+			 * upvalue of the closure as described in LuaCClosure.
+			 *
+			 * @param callable The callable or `std::function`
+			 *
+			 * @return the function wrapping the callable
+			 */
+			template <typename F>
+			static LuaCFunction Closure(F &&callable) {
+				typedef typename std::decay<F>::type T;
+				LuaCFunction func;
+				func.closure = [stored = T(std::forward<F>(callable))](lua_State *L) {
+					LuaCClosure<T>::PushUpvalue(L, stored);
+					return &LuaCClosure<T>::Invoke;
+				};
+				return func;
+			}
+
+			/**
+			 * @brief Check if the function is a closure over a callable
+			 */
+			bool isClosure();
+
 			void setName(std::string name);
 			std::string getName();
 		
 			void setCFunction(lua_CFunction cfunction);
 			lua_CFunction getCFunction();
+
+			/**
+			 * @brief Pushes the function or the closure on the stack
+			 *
+			 * @param L State on which the function will be pushed
+			 */
+			void Push(lua_State *L);
+
+			/**
+			 * @brief Pushes the function wrapped in the instrumented trampoline
+			 *
+			 * @details
+			 * Pushes a `C` closure that counts the calls and the time spent
+			 * in the function. The time of the calls that raise a Lua error
+			 * is not accumulated. The upvalue of a closure is kept as the first
+			 * upvalue and the counters are the second one, the called function
+			 * is the last upvalue, so the states do not share it.
+			 *
+			 * @param L State on which the closure will be pushed
+			 */
+			void PushInstrumented(lua_State *L);
+
+			/**
+			 * @brief Returns the number of the instrumented calls
+			 */
+			uint64_t getCalls();
+
+			/**
+			 * @brief Returns the time spent in the instrumented calls in nanoseconds
+			 */
+			uint64_t getNanoseconds();
+
+			/**
+			 * @brief Resets the counters of the instrumented calls
+			 */
+			void ResetStats();
 		};
 	}
 }
@@ -23,9 +23,11 @@
    */
 
 #include "LuaCodeSnippet.hpp"
+#include "../Diagnostics/LuaTracer.hpp"
 
 using namespace LuaCpp::Registry;
 using namespace LuaCpp::Engine;
+using namespace LuaCpp::Diagnostics;
 
 LuaCodeSnippet::LuaCodeSnippet() : code() {
 	code.clear();
@@ -58,6 +60,7 @@ const char *LuaCodeSnippet::getBuffer() {
 }
 
 void LuaCodeSnippet::UploadCode(LuaState &L) {
+	LuaTraceSpan span("UploadCode", "state", name.c_str());
 	lua_load(L, code_reader, this, (const char *)name.c_str(), NULL);
 }
 
@@ -26,55 +26,91 @@
 
 #include "LuaCompiler.hpp"
 #include "../Engine/LuaState.hpp"
+#include "../Diagnostics/LuaTracer.hpp"
 
 using namespace LuaCpp::Registry;
 using namespace LuaCpp::Engine;
+using namespace LuaCpp::Diagnostics;
 
-void inline _checkErrorAndThrow(LuaState &L, int error) {
-	if (error != LUA_OK) {
-		switch (error) {
-			case LUA_ERRMEM:
-				throw std::runtime_error("Out of memory");
-				break;
-#if LUA_VERSION_NUM < 504
-			case LUA_ERRGCMM:
-				throw std::out_of_range("GC Error while loading");
-				break;
+static void _throwError(int code, const std::string &message) {
+	switch (code) {
+		case LUA_ERRMEM:
+			throw std::runtime_error("Out of memory");
+#ifdef LUA_ERRGCMM
+		case LUA_ERRGCMM:
+			throw std::out_of_range("GC Error while loading");
 #endif
-			case LUA_ERRSYNTAX:
-				throw std::logic_error(lua_tostring(L,1));
-				break;
-			default:
-				throw std::runtime_error("Unknown error code "+ std::to_string(error) + " :" +lua_tostring(L,1));
+		case LUA_ERRSYNTAX:
+			throw std::logic_error(message);
+		default:
+			throw std::runtime_error("Unknown error code " + std::to_string(code) + " :" + message);
+	}
+}
+
+void _checkErrorAndThrow(LuaState &L, int error) {
+	if (error != LUA_OK) {
+		// the exception holds the whole message, LuaError would truncate it
+		size_t len = 0;
+		const char *msg = lua_gettop(L) > 0 ? lua_tolstring(L, -1, &len) : NULL;
+		if (msg == NULL) {
+			_throwError(error, "(error object is not a string)");
 		}
+		_throwError(error, std::string(msg, len));
 	}
 }
 
-std::unique_ptr<LuaCodeSnippet> LuaCompiler::CompileString(std::string name, std::string code) {
+static LuaResult<std::unique_ptr<LuaCodeSnippet>> _dumpLoaded(LuaState &L, int res, const std::string &name) {
+	if (res != LUA_OK) {
+		return LuaError::FromStatus(L, res);
+	}
+
 	std::unique_ptr<LuaCodeSnippet> cb_ptr = std::make_unique<LuaCodeSnippet>();
+	res = lua_dump(L, code_writer, (void*) cb_ptr.get(), 0);
+	if (res != 0) {
+		return LuaError::Format(LUA_ERRERR, "Error %d while dumping the code of %s", res, name.c_str());
+	}
 
-	LuaState L;
-	int res = luaL_loadstring(L.getState(), code.c_str());
-	_checkErrorAndThrow(L, res);
+	cb_ptr->setName(name);
+	return LuaResult<std::unique_ptr<LuaCodeSnippet>>(std::move(cb_ptr));
+}
 
-	res = lua_dump(L.getState(), code_writer, (void*) cb_ptr.get(), 0);
+static std::unique_ptr<LuaCodeSnippet> _dumpOrThrow(LuaState &L, int res, const std::string &name) {
 	_checkErrorAndThrow(L, res);
+	LuaResult<std::unique_ptr<LuaCodeSnippet>> dumped = _dumpLoaded(L, res, name);
+	if (!dumped) {
+		_throwError(dumped.getError().getCode(), dumped.getError().getMessage());
+	}
+	return std::move(dumped.getValue());
+}
 
-	cb_ptr->setName(name);
-	return cb_ptr;
+std::unique_ptr<LuaCodeSnippet> LuaCompiler::CompileString(std::string name, std::string code) {
+	LuaTraceSpan span("CompileString", "compile", name.c_str());
+
+	LuaState L;
+	int res = luaL_loadstring(L, code.c_str());
+	return _dumpOrThrow(L, res, name);
 }
 
 std::unique_ptr<LuaCodeSnippet> LuaCompiler::CompileFile(std::string name, std::string fname) {
-	std::unique_ptr<LuaCodeSnippet> cb_ptr = std::make_unique<LuaCodeSnippet>();
+	LuaTraceSpan span("CompileFile", "compile", name.c_str());
 
 	LuaState L;
 	int res = luaL_loadfile(L, fname.c_str());
-	_checkErrorAndThrow(L, res);
-	
-	res = lua_dump(L, code_writer, (void*) cb_ptr.get(), 0);
-	_checkErrorAndThrow(L, res);
+	return _dumpOrThrow(L, res, name);
+}
 
-	cb_ptr->setName(name);
-	return cb_ptr;
+LuaResult<std::unique_ptr<LuaCodeSnippet>> LuaCompiler::TryCompileString(const std::string &name, const std::string &code) {
+	LuaTraceSpan span("CompileString", "compile", name.c_str());
+
+	LuaState L;
+	int res = luaL_loadstring(L, code.c_str());
+	return _dumpLoaded(L, res, name);
 }
 
+LuaResult<std::unique_ptr<LuaCodeSnippet>> LuaCompiler::TryCompileFile(const std::string &name, const std::string &fname) {
+	LuaTraceSpan span("CompileFile", "compile", name.c_str());
+
+	LuaState L;
+	int res = luaL_loadfile(L, fname.c_str());
+	return _dumpLoaded(L, res, name);
+}
@@ -28,6 +28,7 @@
 #include <memory>
 
 #include "LuaCodeSnippet.hpp"
+#include "../Engine/LuaResult.hpp"
 
 namespace LuaCpp {
 	namespace Registry {
@@ -79,6 +80,34 @@ namespace LuaCpp {
 			 * @return LuaCodeSippet containing te binary form of the code
 			 */
 			std::unique_ptr<LuaCodeSnippet> CompileFile(std::string name, std::string fname);
+
+			/**
+			 * @brief Compiles a lua code given by a string without throwing exceptions
+			 *
+			 * @details
+			 * Same as `CompileString()`, the compilation errors are returned
+			 * with the status code of the Lua library (ex. `LUA_ERRSYNTAX`).
+			 *
+			 * @param name Name of the generated LuaCodeSnippet
+			 * @param code Lua code
+			 *
+			 * @return LuaCodeSnippet containing the binray form of the code, or the error
+			 */
+			Engine::LuaResult<std::unique_ptr<LuaCodeSnippet>> TryCompileString(const std::string &name, const std::string &code);
+
+			/**
+			 * @brief Compiles a lua file without throwing exceptions
+			 *
+			 * @details
+			 * Same as `CompileFile()`, the errors are returned with the status
+			 * code of the Lua library (ex. `LUA_ERRFILE`).
+			 *
+			 * @param name Name of the generated LuaCodeSnippet
+			 * @param fname Name of the file 
+			 *
+			 * @return LuaCodeSippet containing te binary form of the code, or the error
+			 */
+			Engine::LuaResult<std::unique_ptr<LuaCodeSnippet>> TryCompileFile(const std::string &name, const std::string &fname);
 		};
 	}
 }
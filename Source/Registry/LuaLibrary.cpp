@@ -26,9 +26,11 @@
 #include <iostream>
 
 #include "LuaLibrary.hpp"
+#include "../Diagnostics/LuaTracer.hpp"
 
 using namespace LuaCpp::Registry;
 using namespace LuaCpp::Engine;
+using namespace LuaCpp::Diagnostics;
 
 std::string LuaLibrary::getName() {
 	return name;
@@ -39,8 +41,13 @@ std::string LuaLibrary::getMetaTableName()
 	return metaTableName;
 }
 
+uint64_t LuaLibrary::getVersion() {
+	return version;
+}
+
 void LuaLibrary::setName(const std::string &_name) {
 	name = std::move(_name);
+	version++;
 }
 
 void LuaLibrary::AddCMetaMethod(const std::string &name, lua_CFunction cfunction) {
@@ -61,6 +68,7 @@ void LuaLibrary::AddCMetaMethod(const std::string &name, lua_CFunction cfunction
 		func->setName(name);
 		metaMethods.insert(std::make_pair(name, std::move(*func)));
 	}
+	version++;
 }
 
 void LuaLibrary::AddCMethod(const std::string &name, lua_CFunction cfunction) {
@@ -81,6 +89,7 @@ void LuaLibrary::AddCMethod(const std::string &name, lua_CFunction cfunction, bo
 		func->setName(name);
 		methods.insert(std::make_pair(name, std::move(*func)));
 	}
+	version++;
 }
 
 void LuaLibrary::AddCFunction(const std::string &name, lua_CFunction cfunction) {
@@ -101,6 +110,22 @@ void LuaLibrary::AddCFunction(const std::string &name, lua_CFunction cfunction,
 		func->setName(name);
 		functions.insert(std::make_pair(name, std::move(*func)));
 	}
+	version++;
+}
+
+void LuaLibrary::AddToMap(std::map<std::string, LuaCFunction> &map, const std::string &name, LuaCFunction func, bool replace)
+{
+	if (replace)
+	{
+		map.erase(name);
+	}
+
+	if (map.find(name) == map.end())
+	{
+		func.setName(name);
+		map.insert(std::make_pair(name, std::move(func)));
+	}
+	version++;
 }
 
 lua_CFunction LuaLibrary::getLibMethod(const std::string &name)
@@ -114,73 +139,99 @@ lua_CFunction LuaLibrary::getLibFunction(const std::string &name)
 	return functions.at(name).getCFunction();
 }
 
+namespace {
+
+	/**
+	 * Sets the functions to the table on the top of the stack
+	 */
+	void setFunctions(lua_State *L, std::map<std::string, LuaCFunction> &functions, bool instrumented) {
+		if (instrumented) {
+			for (auto &x : functions) {
+				x.second.PushInstrumented(L);
+				lua_setfield(L, -2, x.first.c_str());
+			}
+			return;
+		}
+
+		std::vector<luaL_Reg> array(functions.size() + 1);
+		int count = 0;
+
+		for (auto &x : functions) {
+			// the closures carry the upvalue and can not be set with luaL_setfuncs
+			if (x.second.isClosure()) {
+				x.second.Push(L);
+				lua_setfield(L, -2, x.first.c_str());
+				continue;
+			}
+			array[count].name = x.first.c_str();
+			array[count].func = x.second.getCFunction();
+			count++;
+		}
+
+		array[count].name = NULL;
+		array[count].func = NULL;
+
+		luaL_setfuncs(L, array.data(), 0);
+	}
+
+	void appendStats(std::vector<LuaBindingStats> &stats, const char *kind, std::map<std::string, LuaCFunction> &functions) {
+		for (auto &x : functions) {
+			stats.push_back(LuaBindingStats{kind, x.first, x.second.getCalls(), x.second.getNanoseconds()});
+		}
+	}
+}
+
 int LuaLibrary::RegisterFunctions(LuaState &L) 
 {
+	LuaTraceSpan span("RegisterFunctions", "library", name.c_str());
+
 	// delete potentially already existing library:
 	lua_pushnil(L);
 	lua_setglobal(L, name.c_str());
 
 	// Create the metatable and put it on the stack:
-    luaL_newmetatable(L, metaTableName.c_str());
-
-	// create table of all meta-methods:
-    std::vector<luaL_Reg> arrayMetaMeth(metaMethods.size() + 1);
-	int count = 0;
-
-	for (auto & x : metaMethods) {
-		LuaCFunction& lcf = x.second;
-		arrayMetaMeth[count].name = x.first.c_str();
-		arrayMetaMeth[count].func = lcf.getCFunction();
-		count++;
-	}
-	
-	arrayMetaMeth[count].name = NULL;
-	arrayMetaMeth[count].func = NULL;
-
-	// create table of all functions:
-    std::vector<luaL_Reg> arraylib_f(functions.size() + 1);
-	count = 0;
-
-	for (auto & x : functions) {
-		LuaCFunction& lcf = x.second;
-		arraylib_f[count].name = x.first.c_str();
-		arraylib_f[count].func = lcf.getCFunction();
-		count++;
-	}
-	
-	arraylib_f[count].name = NULL;
-	arraylib_f[count].func = NULL;
-
-	// create table of all methods:
-    std::vector<luaL_Reg> arraylib_m(methods.size()+1);
-	count = 0;
-
-	for (auto & x : methods) {
-		LuaCFunction& lcf = x.second;
-		arraylib_m[count].name = x.first.c_str();
-		arraylib_m[count].func = lcf.getCFunction();
-		count++;
-	}
-	
-	arraylib_m[count].name = NULL;
-	arraylib_m[count].func = NULL;
+	luaL_newmetatable(L, metaTableName.c_str());
 
 	// add metamethods to new metatable:
-	luaL_setfuncs(L, arrayMetaMeth.data(), 0);
-
-	// create method table:
-	luaL_newlibtable(L, arraylib_m);
+	setFunctions(L, metaMethods, instrumented);
 
-	// Set the methods to the metatable that should be accessed via object:func:
-    luaL_setfuncs(L, arraylib_m.data(), 0);
+	// create method table and set the methods that should be accessed via object:func:
+	lua_createtable(L, 0, (int) methods.size());
+	setFunctions(L, methods, instrumented);
 
 	// Pop the first metatable off the stack and assign it to __index of the second one:
 	lua_setfield(L, -2, "__index");
 	lua_pop(L, 1);  /* pop metatable */
 
 	// Register the object.func functions into the table that is at the top of the stack:
-	luaL_newlib(L, arraylib_f.data());
+	lua_createtable(L, 0, (int) functions.size());
+	setFunctions(L, functions, instrumented);
 	lua_setglobal(L,name.c_str());
 
 	return 0;
 }
+
+void LuaLibrary::setInstrumented(bool _instrumented) {
+	instrumented = _instrumented;
+	version++;
+}
+
+bool LuaLibrary::isInstrumented() {
+	return instrumented;
+}
+
+std::vector<LuaBindingStats> LuaLibrary::getBindingStats() {
+	std::vector<LuaBindingStats> stats;
+	appendStats(stats, "function", functions);
+	appendStats(stats, "method", methods);
+	appendStats(stats, "metamethod", metaMethods);
+	return stats;
+}
+
+void LuaLibrary::ResetBindingStats() {
+	for (auto *map : {&functions, &methods, &metaMethods}) {
+		for (auto &x : *map) {
+			x.second.ResetStats();
+		}
+	}
+}
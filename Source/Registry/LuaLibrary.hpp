@@ -25,8 +25,11 @@
 #ifndef LUACPP_LUALIBRARY_HPP
 #define LUACPP_LUALIBRARY_HPP
 
+#include <cstdint>
 #include <string>
 #include <map>
+#include <utility>
+#include <vector>
 
 #include "../Lua.hpp"
 #include "LuaCFunction.hpp"
@@ -73,6 +76,21 @@ namespace LuaCpp {
 			 */
 			std::string metaTableName;
 
+			/**
+			 * @brief register the functions wrapped in the instrumented trampoline
+			 */
+			bool instrumented = false;
+
+			/**
+			 * @brief incremented on every change of the library
+			 */
+			uint64_t version = 0;
+
+			/**
+			 * @brief add the function to the map unless the name exists
+			 */
+			void AddToMap(std::map<std::string, LuaCFunction> &map, const std::string &name, LuaCFunction func, bool replace);
+
 		   protected:
 			/**
 			 * @brief protected constructor
@@ -127,6 +145,18 @@ namespace LuaCpp {
 			 */
 			std::string getMetaTableName();
 
+			/**
+			 * @brief get the version of the library
+			 *
+			 * @details
+			 * The version changes whenever the functions, the name or the
+			 * instrumentation of the library change, so the users caching a
+			 * view of the library can tell that it is stale.
+			 *
+			 * @return library version
+			 */
+			uint64_t getVersion();
+
 			/**
 			 * @brief set the name of the library
 			 *
@@ -244,6 +274,56 @@ namespace LuaCpp {
 			 */
 			void AddCFunction(const std::string &name, lua_CFunction cfunction, bool replace);
 
+			/**
+			 * @brief Add function calling a C++ callable to the library
+			 *
+			 * @details
+			 * Add a function to the library under the specified name. The 
+			 * callable implements `int (lua_State *)`, ex. a lambda with 
+			 * captures or a `std::function`, and is copied into each state
+			 * as the upvalue of a `C` closure (see LuaCClosure).
+			 *
+			 * @param name the name of the function in the lua context
+			 * @param callable the callable implementing the lua_CFunction interface
+			 * @param replace replaces the function if already exits
+			 */
+			template <typename F>
+			void AddFunction(const std::string &name, F &&callable, bool replace = false) {
+				AddToMap(functions, name, LuaCFunction::Closure(std::forward<F>(callable)), replace);
+			}
+
+			/**
+			 * @brief Add method calling a C++ callable to the library
+			 *
+			 * @details
+			 * Same as AddFunction(), the method will be available 
+			 * under the name `object:method_name`
+			 *
+			 * @param name the name of the method in the lua context
+			 * @param callable the callable implementing the lua_CFunction interface
+			 * @param replace replaces the method if already exits
+			 */
+			template <typename F>
+			void AddMethod(const std::string &name, F &&callable, bool replace = false) {
+				AddToMap(methods, name, LuaCFunction::Closure(std::forward<F>(callable)), replace);
+			}
+
+			/**
+			 * @brief Add meta-method calling a C++ callable to the library
+			 *
+			 * @details
+			 * Same as AddFunction(), the meta-method is set to the meta-table
+			 * of the library.
+			 *
+			 * @param name the name of the meta-method in the lua context
+			 * @param callable the callable implementing the lua_CFunction interface
+			 * @param replace replaces the meta-method if already exits
+			 */
+			template <typename F>
+			void AddMetaMethod(const std::string &name, F &&callable, bool replace = false) {
+				AddToMap(metaMethods, name, LuaCFunction::Closure(std::forward<F>(callable)), replace);
+			}
+
 
 			lua_CFunction getLibMethod(const std::string &name);
 
@@ -261,6 +341,44 @@ namespace LuaCpp {
 			 */
 			int RegisterFunctions(Engine::LuaState &L);
 
+			/**
+			 * @brief Enables the call counters of the library
+			 *
+			 * @details
+			 * When enabled, the functions, methods and meta-methods registered
+			 * by `RegisterFunctions()` are wrapped in a trampoline that counts
+			 * the calls and the time spent in the binding. The choice is made at
+			 * registration, so the states created before the change keep the
+			 * original functions. The library has to exist as long as the states
+			 * in which the instrumented functions are registered.
+			 *
+			 * @param instrumented true to register the instrumented functions
+			 */
+			void setInstrumented(bool instrumented);
+
+			/**
+			 * @brief Check if the library registers the instrumented functions
+			 *
+			 * @return true if the functions are instrumented
+			 */
+			bool isInstrumented();
+
+			/**
+			 * @brief Returns the calls and time spent in the bindings
+			 *
+			 * @details
+			 * The statistics are accumulated over all the states in which the
+			 * library was registered with the instrumentation enabled.
+			 *
+			 * @return the snapshot of the statistics of each binding
+			 */
+			std::vector<LuaBindingStats> getBindingStats();
+
+			/**
+			 * @brief Resets the statistics of the bindings
+			 */
+			void ResetBindingStats();
+
 		};
 	}
 }
@@ -29,6 +29,7 @@
 
 
 using namespace LuaCpp::Registry;
+using namespace LuaCpp::Engine;
 
 void LuaRegistry::CompileAndAddString(const std::string &name, const std::string &code) {
 	CompileAndAddString(name, code, false);
@@ -58,6 +59,42 @@ void LuaRegistry::CompileAndAddFile(const std::string &name, const std::string &
 	}
 }
 
+LuaResult<void> LuaRegistry::TryCompileAndAddString(const std::string &name, const std::string &code, bool recompile) {
+
+	if ( !Exists(name) || recompile ) {
+		LuaCompiler cmp;
+		LuaResult<std::unique_ptr<LuaCodeSnippet>> snp = cmp.TryCompileString(name, code);
+		if (!snp) {
+			return snp.getError();
+		}
+
+		registry[name] = std::move(*snp.getValue());
+	}
+	return LuaResult<void>();
+}
+
+LuaResult<void> LuaRegistry::TryCompileAndAddFile(const std::string &name, const std::string &fname, bool recompile) {
+
+	if ( !Exists(name) || recompile ) {
+		LuaCompiler cmp;
+		LuaResult<std::unique_ptr<LuaCodeSnippet>> snp = cmp.TryCompileFile(name, fname);
+		if (!snp) {
+			return snp.getError();
+		}
+
+		registry[name] = std::move(*snp.getValue());
+	}
+	return LuaResult<void>();
+}
+
 std::unique_ptr<LuaCodeSnippet> LuaRegistry::getByName(const std::string &name) {
 	return std::make_unique<LuaCodeSnippet>(registry[name]);
-}
\ No newline at end of file
+}
+std::vector<std::string> LuaRegistry::getNames() const {
+	std::vector<std::string> names;
+	names.reserve(registry.size());
+	for (const auto &entry : registry) {
+		names.push_back(entry.first);
+	}
+	return names;
+}
@@ -28,9 +28,11 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "../Lua.hpp"
 #include "LuaCodeSnippet.hpp"
+#include "../Engine/LuaResult.hpp"
 
 namespace LuaCpp {
 	namespace Registry {
@@ -129,6 +131,36 @@ namespace LuaCpp {
 			 */
 			void CompileAndAddFile(const std::string &name, const std::string &fname, bool recompile);
 
+			/**
+			 * @brief Compiles a string and adds it to the registry without throwing exceptions
+			 *
+			 * @details
+			 * Same as `CompileAndAddString()`, the compilation error is returned
+			 * and the registry remains unchanged.
+			 *
+			 * @param name Name under which the code will be registered
+			 * @param code Lua code
+			 * @param recompile if set to `true` the code will be recompiled, if already exists.
+			 *
+			 * @return the compilation error, or no error
+			 */
+			Engine::LuaResult<void> TryCompileAndAddString(const std::string &name, const std::string &code, bool recompile = false);
+
+			/**
+			 * @brief Compiles a file and adds it to the registry without throwing exceptions
+			 *
+			 * @details
+			 * Same as `CompileAndAddFile()`, the compilation error is returned
+			 * and the registry remains unchanged.
+			 *
+			 * @param name Name under which the code will be registered
+			 * @param fname Name of the file
+			 * @param recompile if set to `true` the code will be recompiled, if already exists.
+			 *
+			 * @return the compilation error, or no error
+			 */
+			Engine::LuaResult<void> TryCompileAndAddFile(const std::string &name, const std::string &fname, bool recompile = false);
+
 			/**
 			 * @brief Checks if the snippet exists in the registry
 			 *
@@ -153,6 +185,13 @@ namespace LuaCpp {
 			 * @return unique_ptr to the LuaCodeSnippet associatd with the name
 			 */
 			std::unique_ptr<LuaCodeSnippet> getByName(const std::string &name);
+
+			/**
+			 * @brief Returns the names of the registered snippets
+			 *
+			 * @return the names in the alphabetical order
+			 */
+			std::vector<std::string> getNames() const;
 		};
 	}
 }
@@ -0,0 +1,55 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include "LuaStaticLibrary.hpp"
+#include "../Diagnostics/LuaTracer.hpp"
+
+using namespace LuaCpp::Registry;
+using namespace LuaCpp::Diagnostics;
+
+int LuaStaticLibrary::RegisterFunctions(lua_State *L) const {
+	LuaTraceSpan span("RegisterFunctions", "library", name);
+
+	if (methods != nullptr || metaMethods != nullptr) {
+		luaL_newmetatable(L, metaTableName);
+		if (metaMethods != nullptr) {
+			luaL_setfuncs(L, metaMethods, 0);
+		}
+
+		lua_createtable(L, 0, getMethodCount());
+		if (methods != nullptr) {
+			luaL_setfuncs(L, methods, 0);
+		}
+		lua_setfield(L, -2, "__index");
+		lua_pop(L, 1);
+	}
+
+	lua_createtable(L, 0, getFunctionCount());
+	if (functions != nullptr) {
+		luaL_setfuncs(L, functions, 0);
+	}
+	lua_setglobal(L, name);
+
+	return 0;
+}
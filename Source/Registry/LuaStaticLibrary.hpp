@@ -0,0 +1,120 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASTATICLIBRARY_HPP
+#define LUACPP_LUASTATICLIBRARY_HPP
+
+#include "../Lua.hpp"
+
+namespace LuaCpp {
+	namespace Registry {
+
+		/**
+		 * @brief Library of `C` functions defined at compile time
+		 *
+		 * @details
+		 * The library refers to `NULL` terminated arrays of `luaL_Reg`
+		 * with the functions, methods and meta-methods, which can be defined
+		 * as `constexpr`. The arrays are passed directly to `luaL_setfuncs`
+		 * when the library is registered, so no maps, strings or vectors are 
+		 * built for the state. The arrays and the names have to outlive
+		 * the library.
+		 *
+		 * @code
+		 * static constexpr luaL_Reg foo_functions[] = {{"foo", foo}, {NULL, NULL}};
+		 * static constexpr LuaStaticLibrary foolib("foolib", foo_functions);
+		 * @endcode
+		 */
+		class LuaStaticLibrary {
+		   private:
+			const char *name;
+			const char *metaTableName;
+			const luaL_Reg *functions;
+			const luaL_Reg *methods;
+			const luaL_Reg *metaMethods;
+
+			static constexpr int count(const luaL_Reg *reg) {
+				int n = 0;
+				while (reg != nullptr && reg[n].name != nullptr) {
+					n++;
+				}
+				return n;
+			}
+
+		   public:
+			/**
+			 * @brief Constructs the library with the meta-table named after the library
+			 *
+			 * @param _name the name of the library
+			 * @param _functions the functions available as `library_name.function_name`
+			 * @param _methods the methods available as `object:method_name` or `NULL`
+			 * @param _metaMethods the meta-methods of the objects or `NULL`
+			 */
+			constexpr LuaStaticLibrary(const char *_name, const luaL_Reg *_functions, const luaL_Reg *_methods = nullptr, const luaL_Reg *_metaMethods = nullptr)
+			    : name(_name), metaTableName(_name), functions(_functions), methods(_methods), metaMethods(_metaMethods) {}
+
+			/**
+			 * @brief Constructs the library with a separate name of the meta-table
+			 *
+			 * @param _name the name of the library
+			 * @param _metaTableName the name of the meta-table in the registry
+			 * @param _functions the functions available as `library_name.function_name`
+			 * @param _methods the methods available as `object:method_name` or `NULL`
+			 * @param _metaMethods the meta-methods of the objects or `NULL`
+			 */
+			constexpr LuaStaticLibrary(const char *_name, const char *_metaTableName, const luaL_Reg *_functions, const luaL_Reg *_methods, const luaL_Reg *_metaMethods)
+			    : name(_name), metaTableName(_metaTableName), functions(_functions), methods(_methods), metaMethods(_metaMethods) {}
+
+			constexpr const char *getName() const { return name; }
+			constexpr const char *getMetaTableName() const { return metaTableName; }
+			constexpr const luaL_Reg *getFunctions() const { return functions; }
+			constexpr const luaL_Reg *getMethods() const { return methods; }
+			constexpr const luaL_Reg *getMetaMethods() const { return metaMethods; }
+
+			/**
+			 * @brief Returns the number of the functions in the library
+			 */
+			constexpr int getFunctionCount() const { return count(functions); }
+
+			/**
+			 * @brief Returns the number of the methods in the library
+			 */
+			constexpr int getMethodCount() const { return count(methods); }
+
+			/**
+			 * @brief Register the library in the state
+			 *
+			 * @details
+			 * Registers the functions under the name of the library. The 
+			 * meta-table is created only when the library has methods or 
+			 * meta-methods.
+			 *
+			 * @return error codes from the lua machine
+			 */
+			int RegisterFunctions(lua_State *L) const;
+		};
+	}
+}
+
+#endif // LUACPP_LUASTATICLIBRARY_HPP
@@ -0,0 +1,172 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "LuaForkServer.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Service;
+
+LuaForkServer::LuaForkServer(LuaContext &ctx, const std::string &_path, size_t _maxWorkers) 
+	: context(ctx), path(_path), maxWorkers(_maxWorkers), listenFd(-1), templateState(), snippets(0), workers(), running(false) {
+}
+
+LuaForkServer::~LuaForkServer() {
+	Stop();
+	for (pid_t pid : workers) {
+		kill(pid, SIGTERM);
+	}
+	for (pid_t pid : workers) {
+		waitpid(pid, NULL, 0);
+	}
+	if (listenFd >= 0) {
+		close(listenFd);
+		unlink(path.c_str());
+	}
+}
+
+void LuaForkServer::Prepare() {
+	std::unique_ptr<LuaState> L = context.newState();
+	snippets = LuaServiceProtocol::LoadSnippets(context, *L);
+	// compact the heap, so the workers share as many pages as possible
+	lua_gc(*L, LUA_GCCOLLECT, 0);
+	templateState = std::move(L);
+}
+
+void LuaForkServer::Listen() {
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	if (path.size() >= sizeof(addr.sun_path)) {
+		throw std::runtime_error("The socket path '" + path + "' is too long");
+	}
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		throw std::runtime_error(std::string("Error creating the socket: ") + strerror(errno));
+	}
+	unlink(path.c_str());
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+		int err = errno;
+		close(fd);
+		throw std::runtime_error("Error listening on '" + path + "': " + strerror(err));
+	}
+	listenFd = fd;
+}
+
+bool LuaForkServer::Accept(int timeoutMs) {
+	if (!templateState || listenFd < 0) {
+		throw std::runtime_error("The fork server is not prepared and listening");
+	}
+	if (Reap() >= maxWorkers) {
+		return false;
+	}
+
+	struct pollfd pfd;
+	pfd.fd = listenFd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, timeoutMs) <= 0) {
+		return false;
+	}
+	int fd = accept(listenFd, NULL, NULL);
+	if (fd < 0) {
+		return false;
+	}
+
+	// the child has only this thread, see the requirements in LuaForkServer.hpp
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(listenFd);
+		Work(fd);
+		_exit(0);
+	}
+	close(fd);
+	if (pid < 0) {
+		return false;
+	}
+	workers.insert(pid);
+	return true;
+}
+
+void LuaForkServer::Work(int fd) {
+	std::string request;
+	std::string reply;
+	try {
+		while (LuaServiceProtocol::ReadFrame(fd, request)) {
+			reply.clear();
+			// the worker serves a single connection, its globals are kept
+			LuaServiceProtocol::Execute(*templateState, snippets, request.data(), request.size(), reply, false);
+			LuaServiceProtocol::WriteFrame(fd, reply);
+		}
+	} catch (std::exception &e) {
+		// the connection is broken, the worker ends
+	}
+	close(fd);
+}
+
+void LuaForkServer::Serve() {
+	running = true;
+	while (running) {
+		if (!Accept(100) && Reap() >= maxWorkers) {
+			// all of the workers are busy, wait for one to finish
+			usleep(10000);
+		}
+	}
+}
+
+void LuaForkServer::Stop() {
+	running = false;
+}
+
+size_t LuaForkServer::Reap() {
+	for (auto it = workers.begin(); it != workers.end(); ) {
+		if (waitpid(*it, NULL, WNOHANG) != 0) {
+			it = workers.erase(it);
+		} else {
+			++it;
+		}
+	}
+	return workers.size();
+}
+
+size_t LuaForkServer::getWorkerCount() const {
+	return workers.size();
+}
+
+const std::string &LuaForkServer::getPath() const {
+	return path;
+}
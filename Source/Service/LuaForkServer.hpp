@@ -0,0 +1,166 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUAFORKSERVER_HPP
+#define LUACPP_LUAFORKSERVER_HPP
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <sys/types.h>
+
+#include "../LuaContext.hpp"
+#include "../Engine/LuaState.hpp"
+#include "LuaServiceProtocol.hpp"
+
+namespace LuaCpp {
+	namespace Service {
+
+		/**
+		 * @brief Runs the snippets in pre-initialised worker processes
+		 *
+		 * @details
+		 * `Prepare()` builds a template state once: the state is created by
+		 * the context, with the libraries and the global variables, and all
+		 * of the snippets in the registry are loaded into it. For each
+		 * connection accepted on the Unix socket, the server forks a worker,
+		 * which inherits the warm state through copy-on-write and runs the
+		 * requests received on the connection (see `LuaServiceProtocol`).
+		 *
+		 * Starting a worker costs a `fork()` instead of creating the state,
+		 * the pages of the template are shared by the workers until they are
+		 * written, and a crash of a script takes only its worker down.
+		 *
+		 * The requests on the same connection are run by the same worker, so
+		 * they see the globals left by the previous requests; the template
+		 * and the other workers are not affected. The hooks and the profilers
+		 * of the context are not attached to the template.
+		 *
+		 * The child of `fork()` has only the thread that called it, and in a
+		 * process with more threads only the async-signal-safe functions 
+		 * may be called in the child: a lock held by another thread at the
+		 * fork, ex. of `malloc()` or of a logger, stays locked forever in the
+		 * worker, which runs the Lua state and allocates. The server must 
+		 * therefore be started before any thread of the library, and the
+		 * process must not start them while it serves: the writer of a 
+		 * LuaLogger (including the default logger), the workers of 
+		 * LuaThreadPool and LuaParallel, the threads and the io_uring reaper
+		 * of LuaFileIO, the LuaScriptServer. The template state must not use
+		 * the libraries backed by them.
+		 *
+		 * Available on POSIX systems only.
+		 */
+		class LuaForkServer {
+		   private:
+			LuaContext &context;
+			std::string path;
+			size_t maxWorkers;
+			int listenFd;
+			std::unique_ptr<Engine::LuaState> templateState;
+			int snippets;
+			std::set<pid_t> workers;
+			std::atomic<bool> running;
+
+			void Work(int fd);
+
+		   public:
+			/**
+			 * @brief Constructs the server of the context
+			 *
+			 * @param ctx context with the compiled snippets, must outlive the server
+			 * @param _path path of the Unix socket
+			 * @param _maxWorkers maximal number of the workers running at once
+			 */
+			LuaForkServer(LuaContext &ctx, const std::string &_path, size_t _maxWorkers = 64);
+
+			/**
+			 * @brief Stops the workers and removes the socket
+			 */
+			~LuaForkServer();
+
+			LuaForkServer(const LuaForkServer &) = delete;
+			LuaForkServer &operator=(const LuaForkServer &) = delete;
+
+			/**
+			 * @brief Builds the template state
+			 *
+			 * @details
+			 * Can be called again to pick up the snippets compiled later, the
+			 * running workers keep their copy of the previous template.
+			 *
+			 * @throws std::runtime_error if a snippet can not be loaded
+			 */
+			void Prepare();
+
+			/**
+			 * @brief Creates the socket and starts listening
+			 *
+			 * @throws std::runtime_error if the socket can not be created
+			 */
+			void Listen();
+
+			/**
+			 * @brief Accepts one connection and forks its worker
+			 *
+			 * @param timeoutMs how long to wait for the connection, -1 to wait forever
+			 *
+			 * @return true if a worker was started
+			 *
+			 * @throws std::runtime_error if the server is not prepared and listening
+			 */
+			bool Accept(int timeoutMs);
+
+			/**
+			 * @brief Accepts the connections until `Stop()` is called
+			 */
+			void Serve();
+
+			/**
+			 * @brief Stops `Serve()`, can be called from another thread
+			 */
+			void Stop();
+
+			/**
+			 * @brief Collects the finished workers
+			 *
+			 * @return the number of the running workers
+			 */
+			size_t Reap();
+
+			/**
+			 * @brief Returns the number of the workers not collected yet
+			 */
+			size_t getWorkerCount() const;
+
+			/**
+			 * @brief Returns the path of the socket
+			 */
+			const std::string &getPath() const;
+		};
+	}
+}
+
+#endif // LUACPP_LUAFORKSERVER_HPP
@@ -0,0 +1,403 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "LuaScriptServer.hpp"
+#include "../Engine/LuaCodec.hpp"
+
+#define LUACPP_SERVER_READ_SIZE 65536
+#define LUACPP_SERVER_MAX_EVENTS 64
+// the limits above which a connection is not read, the requests
+// waiting to run and the bytes of the replies not yet sent
+#define LUACPP_SERVER_MAX_PENDING 64
+#define LUACPP_SERVER_MAX_OUTPUT (1024 * 1024)
+
+using namespace LuaCpp;
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Service;
+
+// the ids of the descriptors in the epoll events, the connections follow
+static const uint64_t LISTEN_ID = 0;
+static const uint64_t EVENT_ID = 1;
+
+LuaScriptServer::LuaScriptServer(LuaContext &ctx, const std::string &_path, unsigned _workers) 
+	: context(ctx), path(_path), workerCount(_workers), listenFd(-1), epollFd(-1), eventFd(-1),
+	  running(false), requests(0), states(), snippets(), loop(), workers(), jobsMutex(), jobsReady(), jobs(),
+	  repliesMutex(), replies(), connections(), nextConnection(EVENT_ID + 1) {
+	if (workerCount == 0) {
+		workerCount = std::thread::hardware_concurrency();
+	}
+	if (workerCount == 0) {
+		workerCount = 1;
+	}
+}
+
+LuaScriptServer::~LuaScriptServer() {
+	Stop();
+}
+
+void LuaScriptServer::Start() {
+	if (running) {
+		return;
+	}
+	states.clear();
+	snippets.clear();
+	for (unsigned i = 0; i < workerCount; i++) {
+		states.push_back(context.newState());
+		snippets.push_back(LuaServiceProtocol::LoadSnippets(context, *states.back()));
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	if (path.size() >= sizeof(addr.sun_path)) {
+		throw std::runtime_error("The socket path '" + path + "' is too long");
+	}
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (listenFd < 0 || epollFd < 0 || eventFd < 0) {
+		int err = errno;
+		Cleanup();
+		throw std::runtime_error(std::string("Error creating the server: ") + strerror(err));
+	}
+	unlink(path.c_str());
+	if (bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listenFd, SOMAXCONN) != 0) {
+		int err = errno;
+		Cleanup();
+		throw std::runtime_error("Error listening on '" + path + "': " + strerror(err));
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = LISTEN_ID;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+	ev.data.u64 = EVENT_ID;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &ev);
+
+	running = true;
+	for (unsigned i = 0; i < workerCount; i++) {
+		workers.emplace_back(&LuaScriptServer::Work, this, i);
+	}
+	loop = std::thread(&LuaScriptServer::Loop, this);
+}
+
+void LuaScriptServer::Stop() {
+	if (!running) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		running = false;
+	}
+	jobsReady.notify_all();
+	uint64_t one = 1;
+	if (write(eventFd, &one, sizeof(one)) < 0) {
+		// the loop wakes up on the timeout
+	}
+	loop.join();
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	Cleanup();
+}
+
+void LuaScriptServer::Cleanup() {
+	for (auto &conn : connections) {
+		close(conn.second.fd);
+	}
+	connections.clear();
+	jobs.clear();
+	replies.clear();
+	if (listenFd >= 0) {
+		close(listenFd);
+		unlink(path.c_str());
+		listenFd = -1;
+	}
+	if (epollFd >= 0) {
+		close(epollFd);
+		epollFd = -1;
+	}
+	if (eventFd >= 0) {
+		close(eventFd);
+		eventFd = -1;
+	}
+}
+
+void LuaScriptServer::Loop() {
+	struct epoll_event events[LUACPP_SERVER_MAX_EVENTS];
+	while (running) {
+		int n = epoll_wait(epollFd, events, LUACPP_SERVER_MAX_EVENTS, 1000);
+		for (int i = 0; i < n && running; i++) {
+			uint64_t id = events[i].data.u64;
+			if (id == LISTEN_ID) {
+				Accept();
+			} else if (id == EVENT_ID) {
+				uint64_t count;
+				while (read(eventFd, &count, sizeof(count)) > 0) {
+				}
+				Deliver();
+			} else {
+				if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+					// reported also while the reading is stopped, the
+					// replies can not be delivered anymore
+					Close(id);
+					continue;
+				}
+				if (events[i].events & EPOLLIN) {
+					Read(id);
+				}
+				if (events[i].events & EPOLLOUT) {
+					Write(id);
+				}
+			}
+		}
+	}
+}
+
+void LuaScriptServer::Accept() {
+	while (true) {
+		int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+		uint64_t id = nextConnection++;
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = id;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			close(fd);
+			continue;
+		}
+		Connection &conn = connections[id];
+		conn.fd = fd;
+		conn.written = 0;
+		conn.busy = false;
+		conn.events = EPOLLIN;
+	}
+}
+
+void LuaScriptServer::Read(uint64_t id) {
+	auto it = connections.find(id);
+	if (it == connections.end()) {
+		return;
+	}
+	Connection &conn = it->second;
+	char buffer[LUACPP_SERVER_READ_SIZE];
+	// stop once the limit is reached, the rest is read when the
+	// connection catches up
+	while (conn.pending.size() < LUACPP_SERVER_MAX_PENDING) {
+		ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
+		if (n <= 0) {
+			// closed by the peer or failed, the reply in progress is dropped
+			Close(id);
+			return;
+		}
+		conn.input.append(buffer, (size_t) n);
+
+		size_t consumed = 0;
+		while (conn.input.size() - consumed >= 4) {
+			const char *pos = conn.input.data() + consumed;
+			uint32_t size = LuaCodec::DecodeUInt32(pos, pos + 4);
+			if (size > LuaServiceProtocol::MAX_FRAME_SIZE) {
+				Close(id);
+				return;
+			}
+			if (conn.input.size() - consumed - 4 < size) {
+				break;
+			}
+			conn.pending.emplace_back(conn.input, consumed + 4, size);
+			consumed += 4 + size;
+		}
+		conn.input.erase(0, consumed);
+	}
+	Dispatch(id);
+	Update(id);
+}
+
+void LuaScriptServer::Dispatch(uint64_t id) {
+	auto it = connections.find(id);
+	if (it == connections.end()) {
+		return;
+	}
+	Connection &conn = it->second;
+	if (conn.busy || conn.pending.empty()) {
+		return;
+	}
+	conn.busy = true;
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		jobs.push_back(Job{id, std::move(conn.pending.front())});
+	}
+	conn.pending.pop_front();
+	jobsReady.notify_one();
+}
+
+void LuaScriptServer::Work(unsigned worker) {
+	LuaState &L = *states[worker];
+	std::string reply;
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(jobsMutex);
+			jobsReady.wait(lock, [this] { return !running || !jobs.empty(); });
+			if (!running) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		reply.clear();
+		LuaCodec::EncodeUInt32(0, reply);
+		LuaServiceProtocol::Execute(L, snippets[worker], job.request.data(), job.request.size(), reply, true);
+		// the header of the frame
+		std::string header;
+		LuaCodec::EncodeUInt32((uint32_t) (reply.size() - 4), header);
+		reply.replace(0, 4, header);
+		requests++;
+		{
+			std::lock_guard<std::mutex> lock(repliesMutex);
+			replies.push_back(Reply{job.connection, reply});
+		}
+		uint64_t one = 1;
+		if (write(eventFd, &one, sizeof(one)) < 0) {
+			// the counter is full, the loop is woken up already
+		}
+	}
+}
+
+void LuaScriptServer::Deliver() {
+	std::deque<Reply> ready;
+	{
+		std::lock_guard<std::mutex> lock(repliesMutex);
+		ready.swap(replies);
+	}
+	for (Reply &reply : ready) {
+		auto it = connections.find(reply.connection);
+		if (it == connections.end()) {
+			continue;
+		}
+		it->second.output.append(reply.reply);
+		it->second.busy = false;
+		Write(reply.connection);
+		Dispatch(reply.connection);
+		Update(reply.connection);
+	}
+}
+
+void LuaScriptServer::Write(uint64_t id) {
+	auto it = connections.find(id);
+	if (it == connections.end()) {
+		return;
+	}
+	Connection &conn = it->second;
+	while (conn.written < conn.output.size()) {
+		ssize_t n = send(conn.fd, conn.output.data() + conn.written, conn.output.size() - conn.written, MSG_NOSIGNAL);
+		if (n > 0) {
+			conn.written += (size_t) n;
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		} else {
+			Close(id);
+			return;
+		}
+	}
+
+	if (conn.written == conn.output.size()) {
+		conn.output.clear();
+		conn.written = 0;
+	}
+	Update(id);
+}
+
+void LuaScriptServer::Update(uint64_t id) {
+	auto it = connections.find(id);
+	if (it == connections.end()) {
+		return;
+	}
+	Connection &conn = it->second;
+	uint32_t events = 0;
+	// read only while the connection is under the limits
+	if (conn.pending.size() < LUACPP_SERVER_MAX_PENDING
+		&& conn.output.size() - conn.written < LUACPP_SERVER_MAX_OUTPUT) {
+		events |= EPOLLIN;
+	}
+	// wait for the socket to be writable only while there is output left
+	if (conn.written < conn.output.size()) {
+		events |= EPOLLOUT;
+	}
+	if (events != conn.events) {
+		struct epoll_event ev;
+		ev.data.u64 = id;
+		ev.events = events;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+		conn.events = events;
+	}
+}
+
+void LuaScriptServer::Close(uint64_t id) {
+	auto it = connections.find(id);
+	if (it == connections.end()) {
+		return;
+	}
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.fd, NULL);
+	close(it->second.fd);
+	connections.erase(it);
+}
+
+bool LuaScriptServer::isRunning() const {
+	return running;
+}
+
+uint64_t LuaScriptServer::getRequestCount() const {
+	return requests;
+}
+
+unsigned LuaScriptServer::getWorkerCount() const {
+	return workerCount;
+}
+
+const std::string &LuaScriptServer::getPath() const {
+	return path;
+}
@@ -0,0 +1,179 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASCRIPTSERVER_HPP
+#define LUACPP_LUASCRIPTSERVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../LuaContext.hpp"
+#include "../Engine/LuaState.hpp"
+#include "LuaServiceProtocol.hpp"
+
+namespace LuaCpp {
+	namespace Service {
+
+		/**
+		 * @brief Runs the snippets for the local clients on a pool of warm states
+		 *
+		 * @details
+		 * `Start()` creates a state for each worker thread, with the
+		 * libraries, the global variables and all of the snippets of the
+		 * context loaded, and starts accepting the connections on the Unix
+		 * socket. The sockets are served by a single thread with epoll and 
+		 * non-blocking I/O; the complete requests are queued to the workers,
+		 * and the replies are sent back as soon as they are ready.
+		 *
+		 * The requests of one connection are run one at a time and answered
+		 * in order, the requests of different connections run in parallel.
+		 * A connection is not read while it has too many requests waiting
+		 * or too many replies not yet sent, so a client that pipelines
+		 * faster than it reads the replies is held back by the socket.
+		 * The globals set by a request are dropped after the run, see
+		 * `LuaServiceProtocol::Execute()`. The hooks and the profilers of
+		 * the context are not attached to the states of the workers.
+		 *
+		 * Available on Linux only.
+		 */
+		class LuaScriptServer {
+		   private:
+			struct Connection {
+				int fd;
+				std::string input;
+				std::string output;
+				size_t written;
+				bool busy;
+				uint32_t events;
+				std::deque<std::string> pending;
+			};
+
+			struct Job {
+				uint64_t connection;
+				std::string request;
+			};
+
+			struct Reply {
+				uint64_t connection;
+				std::string reply;
+			};
+
+			LuaContext &context;
+			std::string path;
+			unsigned workerCount;
+			int listenFd;
+			int epollFd;
+			int eventFd;
+			std::atomic<bool> running;
+			std::atomic<uint64_t> requests;
+
+			std::vector<std::unique_ptr<Engine::LuaState>> states;
+			std::vector<int> snippets;
+			std::thread loop;
+			std::vector<std::thread> workers;
+
+			std::mutex jobsMutex;
+			std::condition_variable jobsReady;
+			std::deque<Job> jobs;
+
+			std::mutex repliesMutex;
+			std::deque<Reply> replies;
+
+			// owned by the thread of the loop
+			std::unordered_map<uint64_t, Connection> connections;
+			uint64_t nextConnection;
+
+			void Loop();
+			void Work(unsigned worker);
+			void Accept();
+			void Read(uint64_t id);
+			void Write(uint64_t id);
+			void Close(uint64_t id);
+			void Dispatch(uint64_t id);
+			void Update(uint64_t id);
+			void Deliver();
+			void Cleanup();
+
+		   public:
+			/**
+			 * @brief Constructs the server of the context
+			 *
+			 * @param ctx context with the compiled snippets, must outlive the server
+			 * @param _path path of the Unix socket
+			 * @param _workers number of the worker threads, 0 for the number of the cores
+			 */
+			LuaScriptServer(LuaContext &ctx, const std::string &_path, unsigned _workers = 0);
+
+			/**
+			 * @brief Stops the server
+			 */
+			~LuaScriptServer();
+
+			LuaScriptServer(const LuaScriptServer &) = delete;
+			LuaScriptServer &operator=(const LuaScriptServer &) = delete;
+
+			/**
+			 * @brief Prepares the states and starts serving in the background
+			 *
+			 * @throws std::runtime_error if the socket can not be created or a snippet can not be loaded
+			 */
+			void Start();
+
+			/**
+			 * @brief Stops serving, closes the connections and removes the socket
+			 */
+			void Stop();
+
+			/**
+			 * @brief Check if the server is serving
+			 */
+			bool isRunning() const;
+
+			/**
+			 * @brief Returns the number of the requests run since the start
+			 */
+			uint64_t getRequestCount() const;
+
+			/**
+			 * @brief Returns the number of the worker threads
+			 */
+			unsigned getWorkerCount() const;
+
+			/**
+			 * @brief Returns the path of the socket
+			 */
+			const std::string &getPath() const;
+		};
+	}
+}
+
+#endif // LUACPP_LUASCRIPTSERVER_HPP
@@ -0,0 +1,88 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "LuaServiceClient.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Service;
+
+LuaServiceClient::~LuaServiceClient() {
+	Close();
+}
+
+void LuaServiceClient::Connect() {
+	Close();
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	if (path.size() >= sizeof(addr.sun_path)) {
+		throw std::runtime_error("The socket path '" + path + "' is too long");
+	}
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		throw std::runtime_error(std::string("Error creating the socket: ") + strerror(errno));
+	}
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		int err = errno;
+		Close();
+		throw std::runtime_error("Error connecting to '" + path + "': " + strerror(err));
+	}
+}
+
+void LuaServiceClient::Close() {
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+LuaResult<LuaServiceResults> LuaServiceClient::Run(const std::string &name, const LuaEnvironment &env, const LuaServiceArguments &args) {
+	if (fd < 0) {
+		throw std::runtime_error("The client is not connected");
+	}
+	std::string request;
+	LuaServiceProtocol::EncodeRequest(name, env, args, request);
+	std::string reply;
+	try {
+		LuaServiceProtocol::WriteFrame(fd, request);
+		if (!LuaServiceProtocol::ReadFrame(fd, reply)) {
+			throw std::runtime_error("The service closed the connection");
+		}
+	} catch (...) {
+		Close();
+		throw;
+	}
+	return LuaServiceProtocol::DecodeReply(reply);
+}
@@ -0,0 +1,97 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASERVICECLIENT_HPP
+#define LUACPP_LUASERVICECLIENT_HPP
+
+#include <string>
+
+#include "LuaServiceProtocol.hpp"
+
+namespace LuaCpp {
+	namespace Service {
+
+		/**
+		 * @brief Client of the services listening on a Unix socket
+		 *
+		 * @details
+		 * Sends the requests to run the snippets and waits for the replies,
+		 * using the `LuaServiceProtocol`. The client is not thread safe, each
+		 * thread should use its own connection.
+		 */
+		class LuaServiceClient {
+		   private:
+			std::string path;
+			int fd;
+
+		   public:
+			/**
+			 * @brief Constructs the client of the service listening on the path
+			 */
+			explicit LuaServiceClient(const std::string &_path) : path(_path), fd(-1) {}
+			~LuaServiceClient();
+
+			LuaServiceClient(const LuaServiceClient &) = delete;
+			LuaServiceClient &operator=(const LuaServiceClient &) = delete;
+
+			/**
+			 * @brief Connects to the service
+			 *
+			 * @throws std::runtime_error if the connection fails
+			 */
+			void Connect();
+
+			/**
+			 * @brief Closes the connection
+			 */
+			void Close();
+
+			/**
+			 * @brief Check if the client is connected
+			 */
+			inline bool isConnected() const { return fd >= 0; }
+
+			/**
+			 * @brief Runs the snippet in the service
+			 *
+			 * @details
+			 * The variables of the environment are set as globals in the
+			 * state of the service before the snippet runs, the arguments are
+			 * available to the snippet as `...`. The errors of the snippet are
+			 * returned in the result.
+			 *
+			 * @param name name of the snippet
+			 * @param env variables of the run
+			 * @param args arguments of the snippet
+			 *
+			 * @return the values returned by the snippet, or the error
+			 *
+			 * @throws std::runtime_error if the connection fails
+			 */
+			Engine::LuaResult<LuaServiceResults> Run(const std::string &name, const LuaEnvironment &env = LuaEnvironment(), const LuaServiceArguments &args = LuaServiceArguments());
+		};
+	}
+}
+
+#endif // LUACPP_LUASERVICECLIENT_HPP
@@ -0,0 +1,262 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "LuaServiceProtocol.hpp"
+#include "../Engine/LuaCodec.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Service;
+
+void LuaServiceProtocol::EncodeRequest(const std::string &name, const LuaEnvironment &env, const LuaServiceArguments &args, std::string &out) {
+	LuaCodec::EncodeString(name, out);
+	LuaCodec::EncodeUInt32((uint32_t) env.size(), out);
+	for (const auto &var : env) {
+		LuaCodec::EncodeString(var.first, out);
+		LuaCodec::Encode(*var.second, out);
+	}
+	LuaCodec::EncodeUInt32((uint32_t) args.size(), out);
+	for (const auto &arg : args) {
+		LuaCodec::Encode(*arg, out);
+	}
+}
+
+int LuaServiceProtocol::LoadSnippets(LuaContext &ctx, LuaState &L) {
+	lua_newtable(L);
+	for (const std::string &name : ctx.getSnippetNames()) {
+		ctx.PushSnippet(L, name);
+		if (!lua_isfunction(L, -1)) {
+			lua_pop(L, 2);
+			throw std::runtime_error("Error loading the code snippet '" + name + "'");
+		}
+		lua_setfield(L, -2, name.c_str());
+	}
+	return lua_gettop(L);
+}
+
+LuaResult<LuaServiceResults> LuaServiceProtocol::DecodeReply(const std::string &payload) {
+	const char *pos = payload.data();
+	const char *end = pos + payload.size();
+	try {
+		int code = (int) LuaCodec::DecodeUInt32(pos, end);
+		std::string message = LuaCodec::DecodeString(pos, end);
+		if (code != LUA_OK) {
+			return LuaError(code, message.c_str());
+		}
+		uint32_t count = LuaCodec::DecodeUInt32(pos, end);
+		LuaServiceResults results;
+		for (uint32_t i = 0; i < count; i++) {
+			results.push_back(LuaCodec::Decode(pos, end));
+		}
+		return results;
+	} catch (std::invalid_argument &e) {
+		return LuaError(LuaError::ERRPROTOCOL, e.what());
+	}
+}
+
+void LuaServiceProtocol::EncodeError(const LuaError &error, std::string &reply) {
+	LuaCodec::EncodeUInt32((uint32_t) error.getCode(), reply);
+	LuaCodec::EncodeString(error.getMessage(), reply);
+}
+
+// Sets the table on the top of the stack as the environment of the function, pops the table
+static void _setEnvironment(lua_State *L, int fn) {
+	fn = lua_absindex(L, fn);
+#if LUA_VERSION_NUM < 502
+	lua_setfenv(L, fn);
+#else
+	// the first upvalue of a main chunk is _ENV. The function is joined to
+	// the _ENV of a new empty chunk instead of changing the shared one, so
+	// the closures created by the earlier runs keep their environment.
+	if (luaL_loadbuffer(L, "", 0, "=(env)") != LUA_OK) {
+		lua_pop(L, 2);
+		return;
+	}
+	lua_insert(L, -2);
+	lua_setupvalue(L, -2, 1);
+	lua_upvaluejoin(L, fn, 1, -1, 1);
+	lua_pop(L, 1);
+#endif
+}
+
+// Sets the globals of the state back as the environment of the snippet
+static void _restoreEnvironment(lua_State *L, int snippets, const char *name) {
+	lua_getfield(L, snippets, name);
+	lua_pushglobaltable(L);
+	_setEnvironment(L, -2);
+	lua_pop(L, 1);
+}
+
+void LuaServiceProtocol::Execute(lua_State *L, int snippets, const char *payload, size_t size, std::string &reply, bool isolate) {
+	int top = lua_gettop(L);
+	snippets = lua_absindex(L, snippets);
+	const char *pos = payload;
+	const char *end = payload + size;
+	size_t start = reply.size();
+	std::string name;
+	bool isolated = false;
+	try {
+		name = LuaCodec::DecodeString(pos, end);
+		lua_getfield(L, snippets, name.c_str());
+		if (!lua_isfunction(L, -1)) {
+			lua_settop(L, top);
+			EncodeError(LuaError::Format(LuaError::ERRNOTFOUND, "The code snippet '%s' not found", name.c_str()), reply);
+			return;
+		}
+		if (isolate) {
+			// the request runs in its own environment, which reads through
+			// to the globals of the state and is dropped after the run
+			lua_newtable(L);
+			lua_createtable(L, 0, 1);
+			lua_pushglobaltable(L);
+			lua_setfield(L, -2, "__index");
+			lua_setmetatable(L, -2);
+		}
+		uint32_t count = LuaCodec::DecodeUInt32(pos, end);
+		for (uint32_t i = 0; i < count; i++) {
+			std::string var = LuaCodec::DecodeString(pos, end);
+			LuaCodec::Push(L, pos, end);
+			if (isolate) {
+				lua_setfield(L, -2, var.c_str());
+			} else {
+				lua_setglobal(L, var.c_str());
+			}
+		}
+		if (isolate) {
+			_setEnvironment(L, -2);
+			isolated = true;
+		}
+		uint32_t nargs = LuaCodec::DecodeUInt32(pos, end);
+		if (nargs > (uint32_t) (end - pos) || !lua_checkstack(L, (int) nargs + 1)) {
+			throw std::invalid_argument("Too many arguments in the request");
+		}
+		for (uint32_t i = 0; i < nargs; i++) {
+			LuaCodec::Push(L, pos, end);
+		}
+
+		int status = lua_pcall(L, (int) nargs, LUA_MULTRET, 0);
+		if (isolated) {
+			_restoreEnvironment(L, snippets, name.c_str());
+			isolated = false;
+		}
+		if (status != LUA_OK) {
+			LuaError error = LuaError::FromStatus(L, status);
+			lua_settop(L, top);
+			EncodeError(error, reply);
+			return;
+		}
+
+		int results = lua_gettop(L) - top;
+		EncodeError(LuaError(), reply);
+		LuaCodec::EncodeUInt32((uint32_t) results, reply);
+		try {
+			for (int i = top + 1; i <= top + results; i++) {
+				LuaCodec::Encode(L, i, reply);
+			}
+		} catch (std::invalid_argument &e) {
+			lua_settop(L, top);
+			reply.resize(start);
+			EncodeError(LuaError(LuaError::ERRTYPE, e.what()), reply);
+			return;
+		}
+		lua_settop(L, top);
+	} catch (std::invalid_argument &e) {
+		lua_settop(L, top);
+		if (isolated) {
+			_restoreEnvironment(L, snippets, name.c_str());
+		}
+		reply.resize(start);
+		EncodeError(LuaError(LuaError::ERRPROTOCOL, e.what()), reply);
+	}
+}
+
+bool LuaServiceProtocol::ReadFrame(int fd, std::string &payload) {
+	unsigned char header[4];
+	size_t got = 0;
+	while (got < sizeof(header)) {
+		ssize_t n = read(fd, header + got, sizeof(header) - got);
+		if (n == 0 && got == 0) {
+			return false;
+		}
+		if (n == 0) {
+			throw std::runtime_error("The frame header is truncated");
+		}
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::string("Error reading the frame: ") + strerror(errno));
+		}
+		got += (size_t) n;
+	}
+	uint32_t size = (uint32_t) header[0] | (uint32_t) header[1] << 8 | (uint32_t) header[2] << 16 | (uint32_t) header[3] << 24;
+	if (size > MAX_FRAME_SIZE) {
+		throw std::runtime_error("The frame of " + std::to_string(size) + " bytes is too large");
+	}
+	payload.resize(size);
+	got = 0;
+	while (got < size) {
+		ssize_t n = read(fd, &payload[got], size - got);
+		if (n == 0) {
+			throw std::runtime_error("The frame is truncated");
+		}
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::string("Error reading the frame: ") + strerror(errno));
+		}
+		got += (size_t) n;
+	}
+	return true;
+}
+
+void LuaServiceProtocol::WriteFrame(int fd, const std::string &payload) {
+	std::string frame;
+	frame.reserve(payload.size() + 4);
+	LuaCodec::EncodeUInt32((uint32_t) payload.size(), frame);
+	frame.append(payload);
+	size_t sent = 0;
+	while (sent < frame.size()) {
+#ifdef MSG_NOSIGNAL
+		ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+#else
+		ssize_t n = write(fd, frame.data() + sent, frame.size() - sent);
+#endif
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::string("Error writing the frame: ") + strerror(errno));
+		}
+		sent += (size_t) n;
+	}
+}
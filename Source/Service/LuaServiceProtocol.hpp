@@ -0,0 +1,155 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_LUASERVICEPROTOCOL_HPP
+#define LUACPP_LUASERVICEPROTOCOL_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Lua.hpp"
+#include "../LuaContext.hpp"
+#include "../Engine/LuaType.hpp"
+#include "../Engine/LuaResult.hpp"
+
+namespace LuaCpp {
+	namespace Service {
+
+		/**
+		 * @brief Values returned by a snippet run by a service
+		 */
+		typedef std::vector<std::shared_ptr<Engine::LuaType>> LuaServiceResults;
+
+		/**
+		 * @brief Values passed to a snippet run by a service, available as `...`
+		 */
+		typedef std::vector<std::shared_ptr<Engine::LuaType>> LuaServiceArguments;
+
+		/**
+		 * @brief Messages exchanged with the services running the snippets
+		 *
+		 * @details
+		 * Each message is a frame, a 32 bit length followed by the payload.
+		 * The values are serialised by `LuaCodec`.
+		 *
+		 * The request holds the name of the snippet, the variables to be
+		 * set as globals before the snippet runs and the arguments passed to
+		 * the snippet. The reply holds the error
+		 * code (`LUA_OK` on success), the error message and the values 
+		 * returned by the snippet.
+		 */
+		class LuaServiceProtocol {
+		   public:
+			/**
+			 * @brief The largest payload accepted in a frame
+			 */
+			static constexpr uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+			/**
+			 * @brief Serialises the request
+			 *
+			 * @param name name of the snippet
+			 * @param env variables set as globals before the run
+			 * @param args arguments of the snippet
+			 * @param out buffer to which the payload is appended
+			 *
+			 * @throws std::invalid_argument if a value can not be serialised
+			 */
+			static void EncodeRequest(const std::string &name, const LuaEnvironment &env, const LuaServiceArguments &args, std::string &out);
+
+			/**
+			 * @brief Reads the reply
+			 *
+			 * @param payload the payload of the reply frame
+			 *
+			 * @return the values returned by the snippet, or the error
+			 */
+			static Engine::LuaResult<LuaServiceResults> DecodeReply(const std::string &payload);
+
+			/**
+			 * @brief Loads the snippets of the context into the state
+			 *
+			 * @details
+			 * Pushes a table holding the compiled snippets of the context by
+			 * their names, to be passed to `Execute()`.
+			 *
+			 * @param ctx context with the compiled snippets
+			 * @param L the state
+			 *
+			 * @return stack position of the table
+			 *
+			 * @throws std::runtime_error if a snippet can not be loaded
+			 */
+			static int LoadSnippets(LuaContext &ctx, Engine::LuaState &L);
+
+			/**
+			 * @brief Runs the request in the state and serialises the reply
+			 *
+			 * @details
+			 * Looks up the snippet in the table at the `snippets` stack position,
+			 * sets the variables of the request as globals and calls the snippet
+			 * with the arguments of the request.
+			 * With `isolate` the snippet runs in a new environment, which reads
+			 * through to the globals of the state; the variables of the request
+			 * and the globals set by the snippet are dropped after the run, so
+			 * the requests sharing the state do not see each other's globals.
+			 * The errors, including the malformed requests, are returned in the
+			 * reply. The stack is left as it was.
+			 *
+			 * @param L the state with the preloaded snippets
+			 * @param snippets stack position of the table of the snippets
+			 * @param payload payload of the request frame
+			 * @param size size of the payload
+			 * @param reply buffer to which the reply payload is appended
+			 * @param isolate run the request in its own environment
+			 */
+			static void Execute(lua_State *L, int snippets, const char *payload, size_t size, std::string &reply, bool isolate);
+
+			/**
+			 * @brief Serialises the error reply
+			 */
+			static void EncodeError(const Engine::LuaError &error, std::string &reply);
+
+			/**
+			 * @brief Reads a frame from the blocking descriptor
+			 *
+			 * @return false if the peer closed the connection before the frame
+			 *
+			 * @throws std::runtime_error on read errors and truncated or oversized frames
+			 */
+			static bool ReadFrame(int fd, std::string &payload);
+
+			/**
+			 * @brief Writes a frame to the blocking socket
+			 *
+			 * @throws std::runtime_error on write errors
+			 */
+			static void WriteFrame(int fd, const std::string &payload);
+		};
+	}
+}
+
+#endif // LUACPP_LUASERVICEPROTOCOL_HPP
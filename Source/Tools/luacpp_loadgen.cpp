@@ -0,0 +1,103 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "../LuaCpp.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Diagnostics;
+
+/**
+ * Replays a workload recorded by the LuaWorkloadRecorder against the
+ * snippets compiled from a folder, and reports the throughput and latency.
+ */
+
+static void usage(const char *name) {
+	std::cerr << "Usage: " << name << " [options] <workload> <scripts folder>\n"
+	          << "\n"
+	          << "Options:\n"
+	          << "  -c <concurrency>  number of the worker threads (default 1)\n"
+	          << "  -r <rate>         runs started per second, 0 for no limit (default 0)\n"
+	          << "  -n <requests>     total number of the runs, 0 to replay each record once (default 0)\n"
+	          << "  -p <prefix>       prefix of the snippet names compiled from the folder\n";
+}
+
+int main(int argc, char **argv) {
+	LuaReplayOptions options;
+	std::string prefix;
+	std::string workload;
+	std::string folder;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if ((arg == "-c" || arg == "-r" || arg == "-n" || arg == "-p") && i + 1 < argc) {
+			std::string value(argv[++i]);
+			if (arg == "-c") {
+				options.concurrency = (unsigned) std::strtoul(value.c_str(), NULL, 10);
+			} else if (arg == "-r") {
+				options.rate = std::strtod(value.c_str(), NULL);
+			} else if (arg == "-n") {
+				options.requests = std::strtoull(value.c_str(), NULL, 10);
+			} else {
+				prefix = value;
+			}
+		} else if (workload.empty()) {
+			workload = arg;
+		} else if (folder.empty()) {
+			folder = arg;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (workload.empty() || folder.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::ifstream in(workload, std::ios::binary);
+	if (!in) {
+		std::cerr << "Can not open the workload " << workload << "\n";
+		return 1;
+	}
+
+	try {
+		LuaWorkloadReplayer replayer(LuaWorkloadRecorder::Load(in));
+
+		LuaContext ctx;
+		ctx.CompileFolder(folder, prefix);
+
+		LuaReplayReport report = replayer.Replay(ctx, options);
+		report.WriteReport(std::cout);
+		return report.errors > 0 ? 2 : 0;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,106 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <pthread.h>
+
+#include "../LuaCpp.hpp"
+
+using namespace LuaCpp;
+using namespace LuaCpp::Service;
+
+/**
+ * Serves the snippets compiled from a folder to the local clients over
+ * a Unix socket, until it is interrupted.
+ */
+
+static void usage(const char *name) {
+	std::cerr << "Usage: " << name << " [options] <socket path> <scripts folder>\n"
+	          << "\n"
+	          << "Options:\n"
+	          << "  -w <workers>  number of the worker threads and states, 0 for the number of the cores (default 0)\n"
+	          << "  -p <prefix>   prefix of the snippet names compiled from the folder\n";
+}
+
+int main(int argc, char **argv) {
+	unsigned workers = 0;
+	std::string prefix;
+	std::string socketPath;
+	std::string folder;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if ((arg == "-w" || arg == "-p") && i + 1 < argc) {
+			std::string value(argv[++i]);
+			if (arg == "-w") {
+				workers = (unsigned) std::strtoul(value.c_str(), NULL, 10);
+			} else {
+				prefix = value;
+			}
+		} else if (socketPath.empty()) {
+			socketPath = arg;
+		} else if (folder.empty()) {
+			folder = arg;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (socketPath.empty() || folder.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// the signals are taken by sigwait, the threads of the server inherit the mask
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	try {
+		LuaContext ctx;
+		ctx.CompileFolder(folder, prefix);
+
+		LuaScriptServer server(ctx, socketPath, workers);
+		server.Start();
+		std::cerr << "Serving " << ctx.getSnippetNames().size() << " snippets on " << socketPath 
+		          << " with " << server.getWorkerCount() << " workers\n";
+
+		int sig;
+		sigwait(&signals, &sig);
+
+		server.Stop();
+		std::cerr << "Served " << server.getRequestCount() << " requests\n";
+		return 0;
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,132 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.hpp"
+
+using namespace LuaCpp::Test;
+
+static thread_local uint64_t newCount = 0;
+static thread_local uint64_t reallocCount = 0;
+
+#ifdef __GLIBC__
+/*
+ * The default allocator of the Lua library allocates through `realloc`,
+ * so counting its calls counts the allocations of the states created 
+ * with `luaL_newstate`, their creation included.
+ */
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *realloc(void *ptr, size_t size) {
+	if (size > 0) {
+		reallocCount++;
+	}
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+static void *countedNew(std::size_t size) {
+	newCount++;
+	if (size == 0) {
+		size = 1;
+	}
+	void *ptr = std::malloc(size);
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new(std::size_t size) {
+	return countedNew(size);
+}
+
+void *operator new[](std::size_t size) {
+	return countedNew(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	newCount++;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+	newCount++;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+AllocationCounter::AllocationCounter() : startNew(newCount), startRealloc(reallocCount), luaAllocations(0), L(NULL), allocf(NULL), ud(NULL) {
+}
+
+AllocationCounter::AllocationCounter(lua_State *_L) : startNew(newCount), startRealloc(reallocCount), luaAllocations(0), L(_L), allocf(NULL), ud(NULL) {
+	allocf = lua_getallocf(L, &ud);
+	lua_setallocf(L, CountingAlloc, this);
+}
+
+AllocationCounter::~AllocationCounter() {
+	if (L != NULL) {
+		lua_setallocf(L, allocf, ud);
+	}
+}
+
+void *AllocationCounter::CountingAlloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+	AllocationCounter *counter = (AllocationCounter *) ud;
+	if (nsize > 0) {
+		counter->luaAllocations++;
+	}
+	return counter->allocf(counter->ud, ptr, osize, nsize);
+}
+
+uint64_t AllocationCounter::getNewCount() const {
+	return newCount - startNew;
+}
+
+uint64_t AllocationCounter::getLuaCount() const {
+	if (L == NULL) {
+		return reallocCount - startRealloc;
+	}
+	return luaAllocations;
+}
+
+uint64_t AllocationCounter::getTotal() const {
+	return getNewCount() + getLuaCount();
+}
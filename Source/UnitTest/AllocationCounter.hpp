@@ -0,0 +1,88 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#ifndef LUACPP_ALLOCATIONCOUNTER_HPP
+#define LUACPP_ALLOCATIONCOUNTER_HPP
+
+#include <cstdint>
+
+#include "../Lua.hpp"
+
+namespace LuaCpp {
+	namespace Test {
+
+		/**
+		 * @brief Counts the allocations made within a scope
+		 *
+		 * @details
+		 * Counts the calls of the global `operator new` made by the current
+		 * thread since the counter was constructed. When a state is attached,
+		 * the allocations requested by the Lua library for the state are 
+		 * counted too, until the counter is destroyed. Without an attached
+		 * state, the `realloc` calls of the current thread are counted 
+		 * instead, which covers every state created with the default 
+		 * allocator of the Lua library, from its creation on (glibc only).
+		 *
+		 * The replacements of the global `operator new` and of `realloc` are defined in 
+		 * `AllocationCounter.cpp`, which has to be linked to the test.
+		 */
+		class AllocationCounter {
+		   private:
+			uint64_t startNew;
+			uint64_t startRealloc;
+			uint64_t luaAllocations;
+			lua_State *L;
+			lua_Alloc allocf;
+			void *ud;
+
+			static void *CountingAlloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+		   public:
+			AllocationCounter();
+			explicit AllocationCounter(lua_State *_L);
+			~AllocationCounter();
+
+			AllocationCounter(const AllocationCounter &) = delete;
+			AllocationCounter &operator=(const AllocationCounter &) = delete;
+
+			/**
+			 * @brief Returns the number of the `operator new` calls in the scope
+			 */
+			uint64_t getNewCount() const;
+
+			/**
+			 * @brief Returns the number of the allocations and reallocations of the state,
+			 * or of the `realloc` calls in the scope when no state is attached
+			 */
+			uint64_t getLuaCount() const;
+
+			/**
+			 * @brief Returns the total number of the counted allocations
+			 */
+			uint64_t getTotal() const;
+		};
+	}
+}
+
+#endif // LUACPP_ALLOCATIONCOUNTER_HPP
@@ -0,0 +1,193 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <map>
+#include <string>
+
+#include "../LuaCpp.hpp"
+#include "AllocationCounter.hpp"
+#include "gtest/gtest.h"
+
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Test;
+
+namespace LuaCpp {
+
+	/*
+	 * The allocation budgets of the hot paths. A test fails when a change
+	 * makes the path allocate more than declared here; lower the budget
+	 * when a path is made cheaper.
+	 */
+	static const uint64_t RUN_TRIVIAL_NEW = 3;     // the per-run state and its bookkeeping
+	static const uint64_t RUN_TRIVIAL_STATE = 292; // the Lua allocations of the whole run, the state and its libraries included
+	static const uint64_t RUN_TRIVIAL_LUA = 0;     // the run of the uploaded snippet, without the state creation
+	static const uint64_t SCALAR_PUSH_POP = 0;
+	static const uint64_t TABLE_PUSH = 5;          // the table and the growth of its array part
+	static const uint64_t TABLE_POP = 16;          // a value and a map node per field
+	static const uint64_t META_OBJECT_FIELD = 0;
+
+	class AllocMetaMap : public LuaMetaObject {
+	   public:
+		std::map<std::string, std::shared_ptr<LuaType>> values;
+		AllocMetaMap() : values() {}
+
+		std::shared_ptr<LuaType> getValue(int key) {
+			std::string name = std::to_string(key);
+			return getValue(name);
+		}
+
+		std::shared_ptr<LuaType> getValue(std::string &key) {
+			auto it = values.find(key);
+			if (it == values.end()) {
+				return std::make_shared<LuaTNil>();
+			}
+			return it->second;
+		}
+
+		void setValue(int key, std::shared_ptr<LuaType> val) {
+			values[std::to_string(key)] = val;
+		}
+
+		void setValue(std::string &key, std::shared_ptr<LuaType> val) {
+			values[key] = val;
+		}
+	};
+
+	class TestLuaAllocations : public ::testing::Test {
+	  protected:
+		virtual void SetUp() {
+		}
+	};
+
+	TEST_F(TestLuaAllocations, RunTrivialSnippet) {
+		LuaContext ctx;
+		ctx.CompileString("trivial", "local a = 1");
+
+		// warm up, so one-time initializations are not counted
+		ctx.Run("trivial");
+
+		uint64_t news;
+		uint64_t lua;
+		{
+			AllocationCounter counter;
+			ctx.Run("trivial");
+			news = counter.getNewCount();
+			lua = counter.getLuaCount();
+		}
+		EXPECT_LE(news, RUN_TRIVIAL_NEW);
+		EXPECT_LE(lua, RUN_TRIVIAL_STATE);
+
+		// the allocator of the state is replaced once the snippet is uploaded
+		std::shared_ptr<Diagnostics::LuaAllocProfiler> profiler = std::make_shared<Diagnostics::LuaAllocProfiler>(1);
+		ctx.setAllocProfiler(profiler);
+		ctx.Run("trivial");
+		profiler->Clear();
+		ctx.Run("trivial");
+		EXPECT_LE(profiler->getTotalAllocations(), RUN_TRIVIAL_LUA);
+	}
+
+	TEST_F(TestLuaAllocations, ScalarPushPop) {
+		LuaState L;
+		LuaTNumber num(3.5);
+		LuaTBoolean flag(true);
+		LuaTNil nil;
+
+		num.PushValue(L);
+		num.PopValue(L, -1);
+		lua_pop(L, 1);
+
+		AllocationCounter counter(L);
+		for (int i = 0; i < 100; i++) {
+			num.PushValue(L);
+			flag.PushValue(L);
+			nil.PushValue(L);
+			nil.PopValue(L, -1);
+			flag.PopValue(L, -2);
+			num.PopValue(L, -3);
+			lua_pop(L, 3);
+		}
+		EXPECT_LE(counter.getTotal(), SCALAR_PUSH_POP);
+		EXPECT_EQ(3.5, num.getValue());
+	}
+
+	TEST_F(TestLuaAllocations, TableRoundTrip) {
+		LuaState L;
+		LuaTTable table;
+		for (int i = 1; i <= 8; i++) {
+			table.setValue(Table::Key(i), std::make_shared<LuaTNumber>(i));
+		}
+
+		table.PushValue(L);
+		lua_pop(L, 1);
+
+		uint64_t pushed;
+		{
+			AllocationCounter counter(L);
+			table.PushValue(L);
+			pushed = counter.getTotal();
+		}
+
+		LuaTTable copy;
+		uint64_t popped;
+		{
+			AllocationCounter counter(L);
+			copy.PopValue(L, -1);
+			popped = counter.getTotal();
+		}
+		lua_pop(L, 1);
+
+#if LUA_VERSION_NUM >= 503
+		// the tables of LuaJIT grow in different steps
+		EXPECT_LE(pushed, TABLE_PUSH);
+#endif
+		EXPECT_LE(popped, TABLE_POP);
+		EXPECT_EQ(8, (int) copy.getValues().size());
+	}
+
+	TEST_F(TestLuaAllocations, MetaObjectFieldAccess) {
+		LuaState L;
+		AllocMetaMap mm;
+		mm.values["1"] = std::make_shared<LuaTNumber>(42);
+		mm.PushGlobal(L, "mm");
+
+		ASSERT_EQ(LUA_OK, luaL_loadstring(L, "return mm['1']"));
+		int fnc = lua_gettop(L);
+
+		lua_pushvalue(L, fnc);
+		ASSERT_EQ(LUA_OK, lua_pcall(L, 0, 1, 0));
+		lua_pop(L, 1);
+
+		uint64_t total;
+		{
+			AllocationCounter counter(L);
+			lua_pushvalue(L, fnc);
+			ASSERT_EQ(LUA_OK, lua_pcall(L, 0, 1, 0));
+			total = counter.getTotal();
+		}
+		EXPECT_EQ(42, lua_tointeger(L, -1));
+		lua_pop(L, 2);
+
+		EXPECT_LE(total, META_OBJECT_FIELD);
+	}
+}
@@ -0,0 +1,325 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "../LuaCpp.hpp"
+#include "gtest/gtest.h"
+
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Async;
+
+namespace LuaCpp {
+
+	class TestLuaAsync : public ::testing::Test {
+	  protected:
+		std::string path;
+
+		virtual void SetUp() {
+			path = std::string(::testing::TempDir()) + "luacpp_aio_" +
+			       ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".txt";
+		}
+
+		virtual void TearDown() {
+			std::remove(path.c_str());
+		}
+
+		static std::string getString(lua_State *L, const char *name) {
+			lua_getglobal(L, name);
+			std::string value = lua_isstring(L, -1) ? lua_tostring(L, -1) : "<not a string>";
+			lua_pop(L, 1);
+			return value;
+		}
+	};
+
+	TEST_F(TestLuaAsync, SchedulerInterleavesTasks) {
+		LuaState L;
+		luaL_openlibs(L);
+		LuaScheduler scheduler(L);
+
+		ASSERT_EQ(0, luaL_loadstring(L, "local name = ... for i = 1, 3 do trace = (trace or '') .. name .. i coroutine.yield() end"));
+		lua_pushvalue(L, -1);
+		lua_pushstring(L, "a");
+		scheduler.Spawn(1);
+		lua_pushstring(L, "b");
+		scheduler.Spawn(1);
+		ASSERT_EQ(0, luaL_loadstring(L, "error('expected failure')"));
+		scheduler.Spawn();
+		EXPECT_EQ(0, lua_gettop(L));
+		EXPECT_EQ(3u, scheduler.getTaskCount());
+
+		scheduler.Run();
+		EXPECT_EQ(0u, scheduler.getTaskCount());
+		EXPECT_EQ("a1b1a2b2a3b3", getString(L, "trace"));
+		ASSERT_EQ(1u, scheduler.getErrors().size());
+		EXPECT_EQ(LUA_ERRRUN, scheduler.getErrors()[0].getCode());
+		EXPECT_NE(nullptr, strstr(scheduler.getErrors()[0].getMessage(), "expected failure"));
+
+		EXPECT_EQ(&scheduler, LuaScheduler::From(L));
+		EXPECT_THROW(LuaScheduler second(L), std::logic_error);
+	}
+
+	TEST_F(TestLuaAsync, AioSuspendsTheTask) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaAioLibrary>();
+		ctx.AddLibrary(lib);
+		ctx.CompileString("writer", "local path = ... "
+		                            "assert(aio.write(path, 'hello ') == 6) "
+		                            "assert(aio.append(path, 'world') == 5) "
+		                            "content = aio.read(path) "
+		                            "part = aio.read(path, 3, 6)");
+		ctx.CompileString("ticker", "for i = 1, 100 do ticks = (ticks or 0) + 1 coroutine.yield() end");
+
+		std::unique_ptr<LuaState> L = ctx.newState();
+		LuaScheduler scheduler(*L);
+
+		ctx.PushSnippet(*L, "writer");
+		lua_pushstring(*L, path.c_str());
+		scheduler.Spawn(1);
+		scheduler.Spawn(ctx, "ticker");
+
+		// the first round starts the write and suspends the writer, the write may complete in the same round
+		EXPECT_LE(2u, scheduler.RunOnce(0));
+		EXPECT_EQ(2u, scheduler.getTaskCount());
+
+		scheduler.Run();
+		EXPECT_TRUE(scheduler.getErrors().empty()) << scheduler.getErrors()[0].getMessage();
+		EXPECT_EQ("hello world", getString(*L, "content"));
+		EXPECT_EQ("wor", getString(*L, "part"));
+
+		std::ifstream file(path, std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		EXPECT_EQ("hello world", content);
+	}
+
+	TEST_F(TestLuaAsync, AioBlocksOutsideScheduler) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaAioLibrary>(LuaFileIO::Create(2, false));
+		ctx.AddLibrary(lib);
+
+		LuaEnvironment env;
+		env["path"] = std::make_shared<LuaTString>(path);
+		ctx.CompileString("blocking", "assert(aio.backend() == 'threads') "
+		                        "assert(aio.write(path, '0123456789') == 10) "
+		                        "assert(aio.write(path, 'ab', 4) == 2) "
+		                        "assert(aio.read(path) == '0123ab6789') "
+		                        "local data, message, code = aio.read(path .. '.missing') "
+		                        "assert(data == nil and message:find('missing', 1, true) and code > 0)");
+		EXPECT_NO_THROW(ctx.RunWithEnvironment("blocking", env));
+	}
+
+	TEST_F(TestLuaAsync, TimerWheelExpiresInOrder) {
+		LuaTimerWheel wheel;
+		std::vector<uint64_t> deadlines = {5, 1, 64, 63, 65, 4096, 4097, 300000, (uint64_t) 1 << 25, 2, 1000};
+		for (size_t i = 0; i < deadlines.size(); i++) {
+			wheel.Schedule(i, deadlines[i]);
+		}
+		EXPECT_TRUE(wheel.Cancel(9));
+		EXPECT_FALSE(wheel.Cancel(9));
+		EXPECT_EQ(deadlines.size() - 1, wheel.size());
+
+		// moving the timer leaves a stale entry which must not fire
+		wheel.Schedule(10, 70);
+		EXPECT_LE(wheel.getNextTick(), 1u);
+
+		std::vector<uint64_t> expired;
+		EXPECT_EQ(1u, wheel.Advance(4, expired));
+		EXPECT_EQ(std::vector<uint64_t>({1}), expired);
+
+		expired.clear();
+		uint64_t now = 4;
+		while (!wheel.empty()) {
+			uint64_t next = wheel.getNextTick();
+			ASSERT_GT(next, now);
+			now = next;
+			wheel.Advance(now, expired);
+		}
+		EXPECT_EQ(std::vector<uint64_t>({0, 3, 2, 4, 10, 5, 6, 7, 8}), expired);
+		EXPECT_EQ((uint64_t) 1 << 25, wheel.getCurrentTick());
+
+		// the timers in the past expire on the next advance
+		wheel.Schedule(42, 3);
+		expired.clear();
+		EXPECT_EQ(1u, wheel.Advance(wheel.getCurrentTick(), expired));
+		EXPECT_EQ(42u, expired[0]);
+
+		// the timers expire at the first advance reaching their deadlines
+		std::mt19937_64 random(42);
+		std::vector<uint64_t> random_deadlines;
+		uint64_t start = wheel.getCurrentTick();
+		for (uint64_t id = 100; id < 2100; id++) {
+			random_deadlines.push_back(start + 1 + random() % (id % 2 ? 5000 : 20000000));
+			wheel.Schedule(id, random_deadlines.back());
+		}
+		now = start;
+		while (!wheel.empty()) {
+			uint64_t previous = now;
+			now += 1 + random() % 50000;
+			expired.clear();
+			wheel.Advance(now, expired);
+			for (uint64_t id : expired) {
+				ASSERT_GT(random_deadlines[id - 100], previous);
+				ASSERT_LE(random_deadlines[id - 100], now);
+				random_deadlines[id - 100] = 0;
+			}
+		}
+		EXPECT_EQ((size_t) 2000, (size_t) std::count(random_deadlines.begin(), random_deadlines.end(), 0));
+	}
+
+	TEST_F(TestLuaAsync, TimersRunScripts) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaTimerLibrary>();
+		ctx.AddLibrary(lib);
+		ctx.CompileString("slow", "timer.sleep(40) trace = (trace or '') .. 'slow;'");
+		ctx.CompileString("fast", "timer.sleep(10) trace = (trace or '') .. 'fast;' "
+		                          "timer.after(5, function() trace = trace .. 'after;' end) "
+		                          "local n = 0 local id "
+		                          "id = timer.every(3, function() n = n + 1 ticks = n if n == 4 then timer.cancel(id) end end)");
+
+		std::unique_ptr<LuaState> L = ctx.newState();
+		LuaScheduler scheduler(*L);
+		scheduler.Spawn(ctx, "slow");
+		scheduler.Spawn(ctx, "fast");
+
+		auto start = std::chrono::steady_clock::now();
+		scheduler.Run();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		EXPECT_TRUE(scheduler.getErrors().empty()) << scheduler.getErrors()[0].getMessage();
+		EXPECT_EQ("fast;after;slow;", getString(*L, "trace"));
+		lua_getglobal(*L, "ticks");
+		EXPECT_EQ(4, (int) lua_tointeger(*L, -1));
+		lua_pop(*L, 1);
+		EXPECT_GE(elapsed, std::chrono::milliseconds(40));
+		EXPECT_EQ(0u, scheduler.getTimerCount());
+	}
+
+	TEST_F(TestLuaAsync, TimerRoundsUpShortPeriods) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaTimerLibrary>();
+		ctx.AddLibrary(lib);
+		ctx.CompileString("ticks", "local n = 0 local id "
+		                           "id = timer.every(0.5, function() n = n + 1 ticks = n if n == 3 then timer.cancel(id) end end)");
+		ctx.CompileString("zero", "timer.every(0, function() end)");
+		ctx.CompileString("huge", "assert(not pcall(timer.after, math.huge, print) and not pcall(timer.every, 0/0, print)) "
+		                          "assert(not pcall(timer.sleep, -math.huge)) "
+		                          "timer.cancel(timer.after(1e300, print)) timer.cancel(timer.every(2^64, print))");
+
+		std::unique_ptr<LuaState> L = ctx.newState();
+		LuaScheduler scheduler(*L);
+		scheduler.Spawn(ctx, "ticks");
+		scheduler.Run();
+
+		EXPECT_TRUE(scheduler.getErrors().empty()) << scheduler.getErrors()[0].getMessage();
+		lua_getglobal(*L, "ticks");
+		EXPECT_EQ(3, (int) lua_tointeger(*L, -1));
+		lua_pop(*L, 1);
+		EXPECT_EQ(0u, scheduler.getTimerCount());
+
+		scheduler.Spawn(ctx, "zero");
+		scheduler.Run();
+		ASSERT_EQ(1u, scheduler.getErrors().size());
+		EXPECT_NE(nullptr, strstr(scheduler.getErrors()[0].getMessage(), "period must be positive"));
+
+		// the delays that are not finite are rejected, the very long ones are clamped
+		scheduler.Spawn(ctx, "huge");
+		scheduler.Run();
+		EXPECT_EQ(1u, scheduler.getErrors().size());
+		EXPECT_EQ(0u, scheduler.getTimerCount());
+	}
+
+	TEST_F(TestLuaAsync, ParallelMapAndReduce) {
+		LuaContext ctx;
+		std::shared_ptr<LuaParallelLibrary> parallel = std::make_shared<LuaParallelLibrary>(ctx, 3);
+		std::shared_ptr<Registry::LuaLibrary> lib = parallel;
+		ctx.AddLibrary(lib);
+		ctx.CompileString("square", "local x = ... return { n = x.n * x.n, tag = x.tag }");
+		ctx.CompileString("add", "local a, b = ... return a + b");
+		ctx.CompileString("concat", "local a, b = ... return a .. b");
+		ctx.CompileString("fails", "local x = ... if x == 3 then error('bad item ' .. x, 0) end return x");
+		ctx.CompileString("nested", "local x = ... return parallel.reduce('add', { x, x, x })");
+
+		std::unique_ptr<LuaState> L = ctx.newState();
+		ASSERT_EQ(LUA_OK, luaL_dostring(*L,
+			"local items = {} "
+			"for i = 1, 1000 do items[i] = { n = i, tag = 't' .. i } end "
+			"local squares = parallel.map('square', items) "
+			"assert(#squares == 1000 and squares[10].n == 100 and squares[1000].tag == 't1000') "
+			"local numbers = {} for i = 1, 1000 do numbers[i] = i end "
+			"sum = parallel.reduce('add', numbers) "
+			"with_init = parallel.reduce('add', numbers, 1000) "
+			"local letters = {} for i = 1, 26 do letters[i] = string.char(96 + i) end "
+			"word = parallel.reduce('concat', letters) "
+			"assert(#parallel.map('square', {}) == 0 and parallel.reduce('add', {}, 5) == 5) "
+			"local none, message = parallel.map('fails', { 1, 2, 3, 4 }) "
+			"assert(none == nil and message == 'bad item 3') "
+			"assert(parallel.map('missing', { 1 }) == nil) "
+			"assert(parallel.map('square', { print }) == nil) "
+			"nested = parallel.map('nested', { 1, 2 }) "
+			"workers = parallel.workers()")) << lua_tostring(*L, -1);
+
+		lua_getglobal(*L, "sum");
+		EXPECT_EQ(500500, lua_tointeger(*L, -1));
+		lua_getglobal(*L, "with_init");
+		EXPECT_EQ(501500, lua_tointeger(*L, -1));
+		lua_getglobal(*L, "workers");
+		EXPECT_EQ(3, lua_tointeger(*L, -1));
+		lua_pop(*L, 3);
+		EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", getString(*L, "word"));
+		ASSERT_EQ(LUA_OK, luaL_dostring(*L, "return nested[1] == 3 and nested[2] == 6"));
+		EXPECT_TRUE(lua_toboolean(*L, -1));
+		lua_pop(*L, 1);
+
+		// one state per thread, and the states made by the nested calls
+		EXPECT_GE(parallel->getParallel()->getStateCount(), 1u);
+		EXPECT_LE(parallel->getParallel()->getStateCount(), 6u);
+	}
+
+	TEST_F(TestLuaAsync, ParallelSuspendsTask) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaParallelLibrary>(ctx, 2);
+		ctx.AddLibrary(lib);
+		ctx.CompileString("slow", "local x = ... local t = os.clock() while os.clock() - t < 0.01 do end return x * 2");
+		ctx.CompileString("fanout", "doubled = parallel.map('slow', { 1, 2, 3, 4 })");
+		ctx.CompileString("other", "for i = 1, 3 do coroutine.yield() end other_done = not doubled");
+
+		std::unique_ptr<LuaState> L = ctx.newState();
+		LuaScheduler scheduler(*L);
+		scheduler.Spawn(ctx, "fanout");
+		scheduler.Spawn(ctx, "other");
+		scheduler.Run();
+
+		EXPECT_TRUE(scheduler.getErrors().empty()) << scheduler.getErrors()[0].getMessage();
+		ASSERT_EQ(LUA_OK, luaL_dostring(*L, "return other_done and doubled[4] == 8"));
+		EXPECT_TRUE(lua_toboolean(*L, -1));
+		lua_pop(*L, 1);
+	}
+}
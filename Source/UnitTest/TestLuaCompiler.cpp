@@ -22,6 +22,7 @@
    SOFTWARE.
    */
 
+#include <cstring>
 #include <fstream>
 
 #include "../LuaCpp.hpp"
@@ -75,7 +76,7 @@ namespace LuaCpp {
 		EXPECT_NO_THROW(_checkErrorAndThrow(*L, LUA_OK));
 		EXPECT_THROW(_checkErrorAndThrow(*L, LUA_ERRMEM), std::runtime_error);
 		lua_pushstring(*L, "some error");
-#if LUA_VERSION_NUM < 504
+#ifdef LUA_ERRGCMM
 		EXPECT_THROW(_checkErrorAndThrow(*L, LUA_ERRGCMM), std::out_of_range);
 #endif
 		EXPECT_THROW(_checkErrorAndThrow(*L, LUA_ERRSYNTAX), std::logic_error);
@@ -137,6 +138,22 @@ namespace LuaCpp {
 
 	}
 
-}
+	TEST_F(TestLuaCompiler, TestTryCompile) {
+		LuaCompiler cmp;
+
+		LuaResult<std::unique_ptr<LuaCodeSnippet>> res = cmp.TryCompileString("test", "print('test')");
+		ASSERT_TRUE(res.ok());
+		EXPECT_EQ("test", res.getValue()->getName());
+		EXPECT_GT(res.getValue()->getSize(), 0);
 
+		res = cmp.TryCompileString("test", "while {}[1]");
+		EXPECT_FALSE(res);
+		EXPECT_EQ(LUA_ERRSYNTAX, res.getError().getCode());
+		EXPECT_NE((const char *) NULL, strstr(res.getError().getMessage(), "[string \"while {}[1]\"]"));
+		EXPECT_EQ(nullptr, res.getValue());
 
+		res = cmp.TryCompileFile("test", "not_existing_file.lua");
+		EXPECT_EQ(LUA_ERRFILE, res.getError().getCode());
+	}
+
+}
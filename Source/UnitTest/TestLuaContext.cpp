@@ -436,6 +436,269 @@ namespace LuaCpp {
 
 
 
+	TEST_F(TestLuaContext, RegisterInstrumentedCLibrary) {
+		/**
+		 * Register the library with the instrumented functions
+		 * and check the counted calls of each binding.
+		 */
+		LuaContext ctx;
+
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("foolib");
+		lib->AddCFunction("foo", foo);
+		lib->AddCMethod("bar", bar);
+		lib->AddCMetaMethod("__len", bar);
+		lib->setInstrumented(true);
+		EXPECT_TRUE(lib->isInstrumented());
+
+		// the context takes the library over
+		std::shared_ptr<Registry::LuaLibrary> stats_lib = lib;
+
+		testing::internal::CaptureStdout();
+
+		EXPECT_NO_THROW(ctx.AddLibrary(lib));
+		EXPECT_NO_THROW(ctx.CompileString("test",
+			"local o = setmetatable({}, debug.getregistry()['foolib'])\n"
+			"for i = 1, 3 do foolib.foo(1, 2) end\n"
+			"print(o:bar(), #o)"));
+
+		EXPECT_NO_THROW(ctx.Run("test"));
+		EXPECT_NO_THROW(ctx.Run("test"));
+
+		std::string output = testing::internal::GetCapturedStdout();
+
+		EXPECT_EQ("4.2\t4.2\n4.2\t4.2\n", output);
+
+		std::map<std::string, Registry::LuaBindingStats> stats;
+		for (const auto &binding : stats_lib->getBindingStats()) {
+			stats[binding.kind + ":" + binding.name] = binding;
+		}
+		EXPECT_EQ(6u, stats["function:foo"].calls);
+		EXPECT_EQ(2u, stats["method:bar"].calls);
+		EXPECT_EQ(2u, stats["metamethod:__len"].calls);
+
+		stats_lib->ResetBindingStats();
+		EXPECT_EQ(0u, stats_lib->getBindingStats()[0].calls);
+	}
+
+	TEST_F(TestLuaContext, RegisterStaticCLibrary) {
+		/**
+		 * Register the library defined at compile time and call 
+		 * the function, method and meta-method.
+		 */
+		static constexpr luaL_Reg functions[] = {{"foo", foo}, {NULL, NULL}};
+		static constexpr luaL_Reg methods[] = {{"bar", bar}, {NULL, NULL}};
+		static constexpr luaL_Reg metaMethods[] = {{"__len", bar}, {NULL, NULL}};
+		static constexpr Registry::LuaStaticLibrary lib("foolib", functions, methods, metaMethods);
+		static_assert(lib.getFunctionCount() == 1, "the functions are counted at compile time");
+
+		LuaContext ctx;
+
+		testing::internal::CaptureStdout();
+
+		EXPECT_NO_THROW(ctx.AddLibrary(lib));
+		EXPECT_NO_THROW(ctx.CompileString("test",
+			"local o = setmetatable({}, debug.getregistry()['foolib'])\n"
+			"print(foolib.foo(1,2,3,4), o:bar(), #o)"));
+
+		EXPECT_NO_THROW(ctx.Run("test"));
+
+		std::string output = testing::internal::GetCapturedStdout();
+
+		EXPECT_EQ("2.5\t4.2\t4.2\n", output);
+	}
+
+	TEST_F(TestLuaContext, RegisterClosures) {
+		/**
+		 * Register the callables with the state stored in the
+		 * upvalues of the closures.
+		 */
+		LuaContext ctx;
+
+		int calls = 0;
+		int *counter = &calls;
+		std::string prefix = "prefix: ";
+		std::function<int(lua_State *)> twice = [](lua_State *L) {
+			lua_pushinteger(L, lua_tointeger(L, 1) * 2);
+			return 1;
+		};
+
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("closures");
+		// trivially copyable capture
+		lib->AddFunction("count", [counter](lua_State *L) {
+			(*counter)++;
+			lua_pushinteger(L, *counter);
+			return 1;
+		});
+		// capture destroyed by the __gc of the upvalue
+		lib->AddFunction("prefix", [prefix](lua_State *L) {
+			lua_pushstring(L, (prefix + lua_tostring(L, 1)).c_str());
+			return 1;
+		});
+		lib->AddFunction("twice", twice);
+		lib->AddMethod("count", [counter](lua_State *) {
+			(*counter) += 10;
+			return 0;
+		});
+		lib->setInstrumented(true);
+		std::shared_ptr<Registry::LuaLibrary> stats_lib = lib;
+
+		testing::internal::CaptureStdout();
+
+		EXPECT_NO_THROW(ctx.AddLibrary(lib));
+		EXPECT_NO_THROW(ctx.CompileString("test",
+			"local o = setmetatable({}, debug.getregistry()['closures'])\n"
+			"o:count()\n"
+			"print(closures.count(), closures.count(), closures.prefix('x'), closures.twice(21))"));
+
+		EXPECT_NO_THROW(ctx.Run("test"));
+
+		std::string output = testing::internal::GetCapturedStdout();
+
+		EXPECT_EQ("11\t12\tprefix: x\t42\n", output);
+		EXPECT_EQ(12, calls);
+
+		std::map<std::string, Registry::LuaBindingStats> stats;
+		for (const auto &binding : stats_lib->getBindingStats()) {
+			stats[binding.kind + ":" + binding.name] = binding;
+		}
+		EXPECT_EQ(2u, stats["function:count"].calls);
+		EXPECT_EQ(1u, stats["method:count"].calls);
+		EXPECT_EQ(1u, stats["function:twice"].calls);
+
+		// each state keeps the function it pushed, the counters are shared
+		std::unique_ptr<Engine::LuaState> first = ctx.newState();
+		std::unique_ptr<Engine::LuaState> second = ctx.newState();
+		for (lua_State *state : {first->getState(), second->getState()}) {
+			ASSERT_EQ(LUA_OK, luaL_dostring(state, "assert(closures.twice(2) == 4)"));
+		}
+		for (const auto &binding : stats_lib->getBindingStats()) {
+			if (binding.kind == "function" && binding.name == "twice") {
+				EXPECT_EQ(3u, binding.calls);
+			}
+		}
+
+		// the closures can be pushed directly
+		Engine::LuaState L;
+		Registry::PushCClosure(L, [prefix](lua_State *L) {
+			lua_pushstring(L, prefix.c_str());
+			return 1;
+		});
+		ASSERT_EQ(LUA_OK, lua_pcall(L, 0, 1, 0));
+		EXPECT_EQ(prefix, lua_tostring(L, -1));
+	}
+
+	TEST_F(TestLuaContext, CachedStdLibraryAndBuiltInFnc) {
+		LuaContext ctx;
+
+		std::shared_ptr<Registry::LuaLibrary> str1 = ctx.getStdLibrary("string");
+		std::shared_ptr<Registry::LuaLibrary> str2 = ctx.getStdLibrary("string");
+		ASSERT_NE(nullptr, str1);
+		ASSERT_NE(nullptr, str2);
+		EXPECT_NE(str1.get(), str2.get());
+		EXPECT_EQ(str1->getLibFunction("rep"), str2->getLibFunction("rep"));
+
+		std::map<std::string, std::shared_ptr<Registry::LuaLibrary>> libs = ctx.getStdLibraries({"math", "table", "not_a_library"});
+		EXPECT_EQ(3u, libs.size());
+		EXPECT_NE(nullptr, libs["math"]);
+		EXPECT_NE(nullptr, libs["table"]);
+		EXPECT_EQ(nullptr, libs["not_a_library"]);
+
+		std::shared_ptr<Registry::LuaCFunction> print = ctx.getBuiltInFnc("print");
+		ASSERT_NE(nullptr, print);
+		EXPECT_EQ(nullptr, ctx.getBuiltInFnc("not_a_function"));
+
+		// existing functions are kept unless replaced
+		ctx.setBuiltInFnc("print", bar);
+		EXPECT_EQ(print->getCFunction(), ctx.getBuiltInFnc("print")->getCFunction());
+		ctx.setBuiltInFnc("print", bar, true);
+		EXPECT_EQ(bar, ctx.getBuiltInFnc("print")->getCFunction());
+
+		std::map<std::string, std::shared_ptr<Registry::LuaCFunction>> fncs = ctx.getBuiltInFncs({"print", "pairs"});
+		EXPECT_EQ(bar, fncs["print"]->getCFunction());
+		EXPECT_NE(nullptr, fncs["pairs"]);
+
+		// the cache is invalidated by the new libraries
+		EXPECT_EQ(nullptr, ctx.getStdLibrary("foolib"));
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("foolib");
+		lib->AddCFunction("foo", foo);
+		ctx.AddLibrary(lib);
+		std::shared_ptr<Registry::LuaLibrary> foolib = ctx.getStdLibrary("foolib");
+		ASSERT_NE(nullptr, foolib);
+		EXPECT_EQ(foo, foolib->getLibFunction("foo"));
+	}
+
+	TEST_F(TestLuaContext, StdLibraryAndBuiltInFncFollowChanges) {
+		LuaContext ctx;
+
+		// the library changed after it was added
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("foolib");
+		std::shared_ptr<Registry::LuaLibrary> kept = lib;
+		lib->AddCFunction("foo", foo);
+		ctx.AddLibrary(lib);
+		EXPECT_FALSE(ctx.getStdLibrary("foolib")->Exists_f("bar"));
+		kept->AddCFunction("bar", bar);
+		EXPECT_EQ(bar, ctx.getStdLibrary("foolib")->getLibFunction("bar"));
+
+		// the global changed after the look up
+		ASSERT_NE(nullptr, ctx.getBuiltInFnc("print"));
+		ctx.AddGlobalVariable("shadow", std::make_shared<Engine::LuaTNumber>(1));
+		EXPECT_EQ(nullptr, ctx.getBuiltInFnc("shadow"));
+		ctx.getGlobalVariable("print") = std::make_shared<Engine::LuaTNumber>(1);
+		EXPECT_EQ(nullptr, ctx.getBuiltInFnc("print"));
+	}
+
+	TEST_F(TestLuaContext, TryRunReturnsErrors) {
+		LuaContext ctx;
+
+		EXPECT_TRUE(ctx.TryCompileString("ok", "result = value * 2").ok());
+		EXPECT_TRUE(ctx.TryCompileString("fails", "error('invalid input', 0)").ok());
+		Engine::LuaResult<void> compiled = ctx.TryCompileString("syntax", "while {}[1]");
+		EXPECT_EQ(LUA_ERRSYNTAX, compiled.getError().getCode());
+
+		std::shared_ptr<Engine::LuaTNumber> value = std::make_shared<Engine::LuaTNumber>(21);
+		std::shared_ptr<Engine::LuaTNumber> result = std::make_shared<Engine::LuaTNumber>(0);
+		LuaEnvironment env;
+		env["value"] = value;
+		env["result"] = result;
+
+		Engine::LuaResult<void> res = ctx.TryRunWithEnvironment("ok", env);
+		EXPECT_TRUE(res.ok());
+		EXPECT_EQ(42, result->getValue());
+
+		res = ctx.TryRun("fails");
+		EXPECT_FALSE(res);
+		EXPECT_EQ(LUA_ERRRUN, res.getError().getCode());
+		EXPECT_STREQ("invalid input", res.getError().getMessage());
+
+		res = ctx.TryRun("syntax");
+		EXPECT_EQ(Engine::LuaError::ERRNOTFOUND, res.getError().getCode());
+
+		EXPECT_TRUE(ctx.TryCompileString("retype", "result = 'text'").ok());
+		res = ctx.TryRunWithEnvironment("retype", env);
+		EXPECT_EQ(Engine::LuaError::ERRTYPE, res.getError().getCode());
+	}
+
+	TEST_F(TestLuaContext, RunThrowsWholeMessages) {
+		LuaContext ctx;
+		std::string token(600, 'a');
+
+		// the exceptions are not limited to the buffer of LuaError
+		try {
+			ctx.CompileString("syntax", "local '" + token + "'");
+			FAIL() << "the syntax error is not thrown";
+		} catch (std::logic_error &e) {
+			EXPECT_NE(std::string::npos, std::string(e.what()).find(token));
+		}
+
+		ctx.CompileString("fails", "error(string.rep('x', 1000), 0)");
+		try {
+			ctx.Run("fails");
+			FAIL() << "the runtime error is not thrown";
+		} catch (std::runtime_error &e) {
+			EXPECT_EQ(std::string(1000, 'x'), e.what());
+		}
+	}
+
 	TEST_F(TestLuaContext, TestGlobalVariables) {
 		LuaContext ctx;
 
@@ -480,4 +743,39 @@ namespace LuaCpp {
 
 	}
 
+	TEST_F(TestLuaContext, SaveAndRestoreHeap) {
+		LuaContext ctx;
+		std::stringstream image;
+		{
+			std::unique_ptr<Engine::LuaState> L = ctx.newState();
+			ASSERT_EQ(LUA_OK, luaL_dostring(*L,
+				"lookup = {}\n"
+				"for i = 1, 1000 do lookup[i] = { id = i, name = 'item' .. i } end\n"
+				"lookup.self = lookup\n"
+				"local count = 0\n"
+				"counter = { inc = function() count = count + 1 return count end, get = function() return count end }\n"
+				"counter.inc()\n"
+				"fmt = string.format\n"
+				"proto = setmetatable({}, { __index = function(t, k) return k .. '!' end })\n"
+				"string.shout = function(s) return s:upper() end\n"
+				"local co = coroutine.create(function() end)\n"
+				"function getThread() return co end"));
+			EXPECT_EQ(1u, L->SaveHeap(image));
+		}
+
+		std::unique_ptr<Engine::LuaState> R = ctx.newStateFromHeap(image);
+		ASSERT_EQ(LUA_OK, luaL_dostring(*R,
+			"assert(#lookup == 1000 and lookup[500].name == 'item500')\n"
+			"assert(lookup.self == lookup)\n"
+			"assert(counter.inc() == 2 and counter.get() == 2)\n"
+			"assert(fmt == string.format and fmt('%d', 5) == '5')\n"
+			"assert(proto.x == 'x!')\n"
+			"assert(('a'):shout() == 'A')\n"
+			"assert(getThread() == nil)\n"
+			"assert(type(io.write) == 'function' and package.loaded.string == string)")) << lua_tostring(*R, -1);
+
+		std::stringstream broken("LUACPPHI");
+		EXPECT_THROW(ctx.newStateFromHeap(broken), std::invalid_argument);
+	}
+
 }
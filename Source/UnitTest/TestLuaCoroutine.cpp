@@ -0,0 +1,183 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "../LuaCpp.hpp"
+#include "gtest/gtest.h"
+
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Async;
+
+#ifdef LUACPP_HAS_COROUTINES
+
+namespace {
+	LuaThreadPool *pool = nullptr;
+
+	LuaExecutor poolExecutor() {
+		return [](std::function<void()> work) { pool->Submit(std::move(work)); };
+	}
+
+	LuaExecutor inlineExecutor() {
+		return [](std::function<void()> work) { work(); };
+	}
+
+	int readInteger(lua_State *co, int nresults) {
+		if (nresults < 1 || !lua_isinteger(co, -nresults)) {
+			throw std::invalid_argument("the result is not an integer");
+		}
+		return (int) lua_tointeger(co, -nresults);
+	}
+
+	LuaCpp::Async::LuaDetachedTask callChunk(LuaScheduler &scheduler, const char *code, int &result, std::string &error, bool &done) {
+		try {
+			result = co_await LuaCall<int>(scheduler, inlineExecutor(), [code](lua_State *L) {
+				if (luaL_loadstring(L, code) != LUA_OK) {
+					throw std::runtime_error(lua_tostring(L, -1));
+				}
+				lua_pushinteger(L, 2);
+				lua_pushinteger(L, 3);
+				return 2;
+			}, readInteger);
+		} catch (std::exception &e) {
+			error = e.what();
+		}
+		done = true;
+	}
+
+	LuaCpp::Async::LuaDetachedTask callSnippet(LuaScheduler &scheduler, LuaCpp::LuaContext &ctx, int &result, std::atomic<bool> &done) {
+		result = co_await LuaCall<int>(scheduler, poolExecutor(), ctx, "answer", readInteger);
+		done = true;
+	}
+
+	int square(lua_State *L) {
+		lua_Integer n = luaL_checkinteger(L, 1);
+		bool suspended = LuaAwait(L, LuaFutureAwaitable<lua_Integer>(std::async(std::launch::async, [n]() {
+			if (n < 0) {
+				throw std::domain_error("negative");
+			}
+			return n * n;
+		}), poolExecutor()), [](lua_State *L, lua_Integer &value) {
+			lua_pushinteger(L, value);
+			return 1;
+		});
+		if (!suspended) {
+			return luaL_error(L, "square needs a scheduler task");
+		}
+		return lua_yield(L, 0);
+	}
+}
+
+namespace LuaCpp {
+
+	class TestLuaCoroutine : public ::testing::Test {
+	  protected:
+		LuaThreadPool threads{2};
+
+		virtual void SetUp() {
+			pool = &threads;
+		}
+
+		virtual void TearDown() {
+			pool = nullptr;
+		}
+	};
+
+	TEST_F(TestLuaCoroutine, AwaitsLuaCall) {
+		LuaContext ctx;
+		std::unique_ptr<LuaState> L = ctx.newState();
+		LuaScheduler scheduler(*L);
+
+		int result = 0;
+		std::string error;
+		bool done = false;
+		callChunk(scheduler, "local a, b = ... coroutine.yield() return a * b", result, error, done);
+		EXPECT_FALSE(done);
+		for (int i = 0; i < 100 && !done; i++) {
+			scheduler.RunOnce(10);
+		}
+		ASSERT_TRUE(done);
+		EXPECT_EQ(6, result);
+		EXPECT_TRUE(error.empty());
+
+		done = false;
+		callChunk(scheduler, "local a = ... error('failed ' .. a, 0)", result, error, done);
+		for (int i = 0; i < 100 && !done; i++) {
+			scheduler.RunOnce(10);
+		}
+		ASSERT_TRUE(done);
+		EXPECT_EQ("failed 2", error);
+		EXPECT_TRUE(scheduler.getErrors().empty());
+		EXPECT_EQ(0u, scheduler.getTaskCount());
+	}
+
+	TEST_F(TestLuaCoroutine, AwaitsSnippetOnExecutor) {
+		LuaContext ctx;
+		ctx.CompileString("answer", "return 42");
+		std::unique_ptr<LuaState> L = ctx.newState();
+		LuaScheduler scheduler(*L);
+
+		int result = 0;
+		std::atomic<bool> done(false);
+		callSnippet(scheduler, ctx, result, done);
+
+		// the coroutine is resumed on a thread of the pool
+		for (int i = 0; i < 1000 && !done; i++) {
+			scheduler.RunOnce(1);
+		}
+		ASSERT_TRUE(done);
+		EXPECT_EQ(42, result);
+	}
+
+	TEST_F(TestLuaCoroutine, LuaAwaitsFuture) {
+		LuaContext ctx;
+		std::unique_ptr<LuaState> L = ctx.newState();
+		lua_register(*L, "square", square);
+		LuaScheduler scheduler(*L);
+
+		ASSERT_EQ(LUA_OK, luaL_loadstring(*L, "result = square(7) + square(3) "
+		                                      "missing, message = square(-1)"));
+		scheduler.Spawn(0);
+		scheduler.Run();
+		EXPECT_TRUE(scheduler.getErrors().empty());
+
+		lua_getglobal(*L, "result");
+		EXPECT_EQ(58, lua_tointeger(*L, -1));
+		lua_getglobal(*L, "missing");
+		EXPECT_TRUE(lua_isnil(*L, -1));
+		lua_getglobal(*L, "message");
+		EXPECT_STREQ("negative", lua_tostring(*L, -1));
+		lua_pop(*L, 3);
+
+		ASSERT_EQ(LUA_OK, luaL_loadstring(*L, "return square(2)"));
+		EXPECT_NE(LUA_OK, lua_pcall(*L, 0, 1, 0));
+		EXPECT_NE(std::string::npos, std::string(lua_tostring(*L, -1)).find("needs a scheduler task"));
+	}
+}
+
+#endif // LUACPP_HAS_COROUTINES
@@ -0,0 +1,592 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../LuaCpp.hpp"
+#include "gtest/gtest.h"
+
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Diagnostics;
+
+extern "C" {
+	static int spin(lua_State *L) {
+		volatile double sum = 0;
+		for (int i = 0; i < 10000; i++) {
+			sum = sum + i;
+		}
+		lua_pushnumber(L, sum);
+		return 1;
+	}
+
+	static void line_hook(lua_State *, lua_Debug *) {
+	}
+}
+
+namespace LuaCpp {
+
+	class TestLuaDiagnostics : public ::testing::Test {
+	  protected:
+		virtual void SetUp() {
+			LuaTracer::Clear();
+		}
+
+		virtual void TearDown() {
+			LuaTracer::Disable();
+			LuaTracer::setTraceLuaCalls(false);
+			LuaTracer::Clear();
+		}
+	};
+
+	TEST_F(TestLuaDiagnostics, TracerDisabledRecordsNothing) {
+		LuaContext ctx;
+
+		testing::internal::CaptureStdout();
+		EXPECT_NO_THROW(ctx.CompileStringAndRun("print('trace')"));
+		testing::internal::GetCapturedStdout();
+
+		EXPECT_EQ(0u, LuaTracer::getEventCount());
+	}
+
+	TEST_F(TestLuaDiagnostics, TracerRecordsCompileAndRunSpans) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("tracelib");
+		ctx.AddLibrary(lib);
+
+		LuaTracer::Enable();
+		EXPECT_NO_THROW(ctx.CompileString("traced", "local a = 1"));
+		EXPECT_NO_THROW(ctx.Run("traced"));
+		LuaTracer::Disable();
+
+		std::stringstream out;
+		LuaTracer::WriteChromeTrace(out);
+		std::string trace = out.str();
+
+		EXPECT_NE(std::string::npos, trace.find("\"traceEvents\""));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"CompileString\""));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"newState\""));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"UploadCode\""));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"lua_pcall\""));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"RegisterFunctions\""));
+		EXPECT_NE(std::string::npos, trace.find("\"detail\":\"traced\""));
+	}
+
+	TEST_F(TestLuaDiagnostics, TracerRecordsLuaCalls) {
+		LuaContext ctx;
+
+		LuaTracer::Enable();
+		LuaTracer::setTraceLuaCalls(true);
+		EXPECT_NO_THROW(ctx.CompileString("calls", "function traced_fn() return 1 end traced_fn() traced_fn()"));
+		EXPECT_NO_THROW(ctx.Run("calls"));
+		LuaTracer::Disable();
+
+		std::stringstream out;
+		LuaTracer::WriteChromeTrace(out);
+		std::string trace = out.str();
+
+		size_t first = trace.find("traced_fn");
+		EXPECT_NE(std::string::npos, first);
+		EXPECT_NE(std::string::npos, trace.find("traced_fn", first + 1));
+		EXPECT_NE(std::string::npos, trace.find("\"ph\":\"B\""));
+		EXPECT_NE(std::string::npos, trace.find("\"ph\":\"E\""));
+	}
+
+	TEST_F(TestLuaDiagnostics, TracerUsesBufferPerThread) {
+		LuaTracer::Enable();
+		std::thread worker([]() {
+			LuaTraceSpan span("worker", "test");
+		});
+		worker.join();
+		{
+			LuaTraceSpan span("main", "test");
+		}
+		LuaTracer::Disable();
+
+		EXPECT_EQ(2u, LuaTracer::getEventCount());
+
+		std::stringstream out;
+		LuaTracer::WriteChromeTrace(out);
+		std::string trace = out.str();
+		size_t worker_pos = trace.find("\"name\":\"worker\"");
+		size_t main_pos = trace.find("\"name\":\"main\"");
+		ASSERT_NE(std::string::npos, worker_pos);
+		ASSERT_NE(std::string::npos, main_pos);
+		EXPECT_NE(trace.substr(trace.find("\"tid\":", worker_pos), 9), trace.substr(trace.find("\"tid\":", main_pos), 9));
+	}
+
+	TEST_F(TestLuaDiagnostics, TracerKeepsSpansBalanced) {
+		LuaTracer::Enable(4);
+		std::thread worker([]() {
+			// begun before the recording
+			LuaTracer::Record('E', NULL, "test", LuaTracer::Now(), 0, "");
+			LuaTracer::Record('B', NULL, "test", LuaTracer::Now(), 0, "outer");
+			LuaTracer::Record('B', NULL, "test", LuaTracer::Now(), 0, "middle");
+			// no room left for the begin and its end
+			LuaTracer::Record('B', NULL, "test", LuaTracer::Now(), 0, "inner");
+			LuaTracer::Record('E', NULL, "test", LuaTracer::Now(), 0, "");
+			LuaTracer::Record('E', NULL, "test", LuaTracer::Now(), 0, "");
+			LuaTracer::Record('E', NULL, "test", LuaTracer::Now(), 0, "");
+		});
+		worker.join();
+		LuaTracer::Disable();
+
+		EXPECT_EQ(4u, LuaTracer::getEventCount());
+		EXPECT_EQ(2u, LuaTracer::getDroppedCount());
+
+		std::stringstream out;
+		LuaTracer::WriteChromeTrace(out);
+		std::string trace = out.str();
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"middle\""));
+		EXPECT_EQ(std::string::npos, trace.find("\"name\":\"inner\""));
+
+		// the buffer of the ended thread is released
+		LuaTracer::Clear();
+		EXPECT_EQ(0u, LuaTracer::getEventCount());
+		std::stringstream empty;
+		LuaTracer::WriteChromeTrace(empty);
+		EXPECT_EQ(std::string::npos, empty.str().find("\"tid\""));
+	}
+
+	TEST_F(TestLuaDiagnostics, ProfilerBuildsCallTree) {
+		LuaContext ctx;
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("proflib");
+		lib->AddCFunction("spin", spin);
+		ctx.AddLibrary(lib);
+
+		std::shared_ptr<LuaProfiler> profiler = std::make_shared<LuaProfiler>();
+		ctx.setProfiler(profiler);
+
+		EXPECT_NO_THROW(ctx.CompileString("prof",
+			"local function inner() return proflib.spin() end\n"
+			"local function outer()\n"
+			"  for i = 1, 3 do inner() end\n"
+			"end\n"
+			"outer() outer()"));
+		EXPECT_NO_THROW(ctx.Run("prof"));
+		EXPECT_NO_THROW(ctx.Run("prof"));
+
+		std::vector<LuaProfileEntry> entries = profiler->getEntries("prof");
+		ASSERT_FALSE(entries.empty());
+
+		std::map<std::string, LuaProfileEntry> byName;
+		for (const auto &entry : entries) {
+			byName[entry.name] = entry;
+			EXPECT_LE(entry.exclusive, entry.inclusive);
+		}
+		ASSERT_EQ(1u, byName.count("outer"));
+		ASSERT_EQ(1u, byName.count("inner"));
+		ASSERT_EQ(1u, byName.count("spin"));
+		EXPECT_EQ(4, byName["outer"].calls);
+		EXPECT_EQ(12, byName["inner"].calls);
+		EXPECT_EQ(12, byName["spin"].calls);
+		EXPECT_EQ("[C]", byName["spin"].source);
+		EXPECT_EQ(2, byName["outer"].line);
+		EXPECT_GE(byName["outer"].inclusive, byName["inner"].inclusive);
+
+		for (size_t i = 1; i < entries.size(); i++) {
+			EXPECT_GE(entries[i - 1].exclusive, entries[i].exclusive);
+		}
+
+		std::stringstream report;
+		profiler->WriteReport(report);
+		EXPECT_NE(std::string::npos, report.str().find("Snippet: prof"));
+
+		std::stringstream callgrind;
+		profiler->WriteCallgrind(callgrind, "prof");
+		EXPECT_NE(std::string::npos, callgrind.str().find("events: Nanoseconds"));
+		EXPECT_NE(std::string::npos, callgrind.str().find("fn=outer"));
+		EXPECT_NE(std::string::npos, callgrind.str().find("cfn=spin"));
+		EXPECT_NE(std::string::npos, callgrind.str().find("calls=12 0"));
+	}
+
+	TEST_F(TestLuaDiagnostics, ProfilerSeparatesInstrumentedBindings) {
+		LuaContext ctx;
+		// the bindings share the C function and the trampoline of the instrumentation
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<Registry::LuaLibrary>("proflib");
+		lib->AddCFunction("spin", spin);
+		lib->AddCFunction("twirl", spin);
+		lib->setInstrumented(true);
+		ctx.AddLibrary(lib);
+
+		std::shared_ptr<LuaProfiler> profiler = std::make_shared<LuaProfiler>();
+		ctx.setProfiler(profiler);
+
+		EXPECT_NO_THROW(ctx.CompileString("prof", "for i = 1, 3 do proflib.spin() end proflib.twirl()"));
+		EXPECT_NO_THROW(ctx.Run("prof"));
+		EXPECT_NO_THROW(ctx.Run("prof"));
+
+		std::map<std::string, LuaProfileEntry> byName;
+		for (const auto &entry : profiler->getEntries("prof")) {
+			byName[entry.name] = entry;
+		}
+		ASSERT_EQ(1u, byName.count("spin"));
+		ASSERT_EQ(1u, byName.count("twirl"));
+		EXPECT_EQ(6, byName["spin"].calls);
+		EXPECT_EQ(2, byName["twirl"].calls);
+	}
+
+	TEST_F(TestLuaDiagnostics, ProfilerRestoresPreviousHook) {
+		LuaProfiler profiler;
+		LuaState L;
+		lua_sethook(L, line_hook, LUA_MASKLINE, 0);
+
+		// the hook from before the first attach survives a restart
+		profiler.Attach(L, "hooked");
+		profiler.Attach(L, "hooked");
+		EXPECT_TRUE(lua_gethook(L) != line_hook);
+		profiler.Detach(L);
+		EXPECT_TRUE(lua_gethook(L) == line_hook);
+		EXPECT_EQ(LUA_MASKLINE, lua_gethookmask(L));
+
+		lua_sethook(L, NULL, 0, 0);
+		profiler.Attach(L, "plain");
+		profiler.Detach(L);
+		EXPECT_TRUE(lua_gethook(L) == NULL);
+	}
+
+	TEST_F(TestLuaDiagnostics, ProfilerFinishesWithState) {
+		LuaContext ctx;
+		std::shared_ptr<LuaProfiler> profiler = std::make_shared<LuaProfiler>();
+		ctx.setProfiler(profiler);
+
+		EXPECT_NO_THROW(ctx.CompileString("owned",
+			"local function step() return 1 end\n"
+			"for i = 1, 5 do step() end"));
+
+		// the state is run by the host and closed without detaching the profiler
+		{
+			std::unique_ptr<LuaState> L = ctx.newStateFor("owned");
+			ASSERT_EQ(LUA_OK, lua_pcall(*L, 0, 0, 0));
+			EXPECT_TRUE(profiler->getEntries("owned").empty());
+		}
+
+		bool found = false;
+		for (const auto &entry : profiler->getEntries("owned")) {
+			if (entry.line == 1 && entry.source != "[C]") {
+				EXPECT_EQ(5u, entry.calls);
+				found = true;
+			}
+		}
+		EXPECT_TRUE(found);
+
+		// the states attached before the clear are not reported
+		std::unique_ptr<LuaState> L = ctx.newStateFor("owned");
+		profiler->Clear();
+		ASSERT_EQ(LUA_OK, lua_pcall(*L, 0, 0, 0));
+		profiler->Detach(*L);
+		EXPECT_TRUE(profiler->getEntries("owned").empty());
+	}
+
+	TEST_F(TestLuaDiagnostics, ProfilerSurvivesErrors) {
+		LuaContext ctx;
+		std::shared_ptr<LuaProfiler> profiler = std::make_shared<LuaProfiler>();
+		ctx.setProfiler(profiler);
+
+		EXPECT_NO_THROW(ctx.CompileString("fail",
+			"local function boom() error('boom') end\n"
+			"local function guarded() return pcall(boom) end\n"
+			"guarded() guarded()"));
+		EXPECT_NO_THROW(ctx.Run("fail"));
+
+		std::map<int, LuaProfileEntry> byLine;
+		for (const auto &entry : profiler->getEntries("fail")) {
+			if (entry.source != "[C]") {
+				byLine[entry.line] = entry;
+			}
+		}
+		// boom is called from pcall, so it is reported under its source and line
+		EXPECT_EQ(2, byLine[1].calls);
+		EXPECT_EQ("guarded", byLine[2].name);
+		EXPECT_EQ(2, byLine[2].calls);
+	}
+
+	TEST_F(TestLuaDiagnostics, AllocProfilerAttributesLines) {
+		LuaContext ctx;
+		std::shared_ptr<LuaAllocProfiler> profiler = std::make_shared<LuaAllocProfiler>(64);
+		ctx.setAllocProfiler(profiler);
+
+		EXPECT_NO_THROW(ctx.CompileString("alloc",
+			"local keep = {}\n"
+			"for i = 1, 2000 do keep[#keep + 1] = { i, i * 2, tostring(i) } end\n"
+			"local small = {}"));
+		EXPECT_NO_THROW(ctx.Run("alloc"));
+
+		std::vector<LuaAllocSite> sites = profiler->getSites();
+		ASSERT_FALSE(sites.empty());
+		EXPECT_EQ(2, sites[0].line);
+		EXPECT_EQ("main chunk", sites[0].function);
+		EXPECT_EQ(sites[0].samples * 64, sites[0].bytes);
+		EXPECT_GT(profiler->getTotalAllocations(), 2000u);
+		EXPECT_GE(profiler->getTotalBytes(), sites[0].bytes);
+
+		std::ostringstream report;
+		profiler->WriteReport(report);
+		EXPECT_NE(std::string::npos, report.str().find(":2 (main chunk)"));
+
+		profiler->Clear();
+		EXPECT_TRUE(profiler->getSites().empty());
+		EXPECT_EQ(0u, profiler->getTotalBytes());
+	}
+
+	TEST_F(TestLuaDiagnostics, AllocProfilerExactSizes) {
+		LuaContext ctx;
+		std::shared_ptr<LuaAllocProfiler> profiler = std::make_shared<LuaAllocProfiler>(1);
+		ctx.setAllocProfiler(profiler);
+
+		EXPECT_NO_THROW(ctx.CompileString("exact",
+			"local function build(n)\n"
+			"  return string.rep('x', n)\n"
+			"end\n"
+			"local s = build(100000)"));
+		EXPECT_NO_THROW(ctx.Run("exact"));
+
+		std::vector<LuaAllocSite> sites = profiler->getSites();
+		ASSERT_FALSE(sites.empty());
+		// the C function string.rep is attributed to the calling Lua line
+		EXPECT_EQ("build", sites[0].function);
+		EXPECT_EQ(2, sites[0].line);
+		EXPECT_GE(sites[0].bytes, 100000u);
+	}
+
+	TEST_F(TestLuaDiagnostics, HeapReportFindsLargestTables) {
+		LuaState L;
+		luaL_openlibs(L);
+		ASSERT_EQ(LUA_OK, luaL_dostring(L,
+			"cache = { users = {}, empty = {} }\n"
+			"for i = 1, 500 do cache.users[i] = { name = 'user' .. i } end\n"
+			"local hidden = setmetatable({}, { __index = { 1, 2, 3 } })\n"
+			"function getHidden() return hidden end"));
+
+		LuaHeapReport report = L.InspectHeap(3);
+
+		ASSERT_EQ(3u, report.getLargestTables().size());
+		EXPECT_EQ("_G.cache.users", report.getLargestTables()[0].path);
+		EXPECT_EQ(500u, report.getLargestTables()[0].entries);
+		EXPECT_GE(report.getTypes().at("table").count, 503u);
+		EXPECT_GE(report.getTypes().at("string").count, 500u);
+		EXPECT_GT(report.getObjectBytes(), 0u);
+		EXPECT_GT(report.getHeapBytes(), 0u);
+		EXPECT_EQ(0, lua_gettop(L));
+
+		// the upvalue and its metatable are reachable from the global function
+		LuaHeapReport full = L.InspectHeap(10000);
+		bool found = false;
+		for (const auto &table : full.getLargestTables()) {
+			if (table.path == "_G.getHidden.<upvalue hidden>.<metatable>.__index") {
+				found = true;
+				EXPECT_EQ(3u, table.entries);
+			}
+		}
+		EXPECT_TRUE(found);
+
+		std::string json = report.ToJSON();
+		EXPECT_EQ('{', json.front());
+		EXPECT_NE(std::string::npos, json.find("\"path\":\"_G.cache.users\""));
+		EXPECT_NE(std::string::npos, json.find("\"table\":{\"count\":"));
+	}
+
+	TEST_F(TestLuaDiagnostics, WorkloadRecordAndReplay) {
+		std::stringstream workload;
+		{
+			LuaContext ctx;
+			ctx.setRecorder(std::make_shared<LuaWorkloadRecorder>(workload));
+			EXPECT_NO_THROW(ctx.CompileString("double", "if type(value) ~= 'number' then error('not a number') end result = value * 2"));
+
+			for (int i = 0; i < 10; i++) {
+				LuaEnvironment env;
+				env["value"] = std::make_shared<LuaTNumber>(i);
+				env["result"] = std::make_shared<LuaTNumber>(0);
+				EXPECT_NO_THROW(ctx.RunWithEnvironment("double", env));
+			}
+			LuaEnvironment env;
+			env["value"] = std::make_shared<LuaTString>("text");
+			EXPECT_FALSE(ctx.TryRunWithEnvironment("double", env).ok());
+			EXPECT_EQ(11u, ctx.getRecorder()->getRecordCount());
+		}
+
+		std::vector<LuaWorkloadRecord> records = LuaWorkloadRecorder::Load(workload);
+		ASSERT_EQ(11u, records.size());
+		EXPECT_EQ("double", records[0].name);
+		EXPECT_LE(records[0].timestamp, records[10].timestamp);
+		LuaEnvironment env = records[3].DecodeEnvironment();
+		EXPECT_EQ(3, ((LuaTNumber &) *env["value"]).getValue());
+
+		// the recorded variables are added to the global variables of the context
+		LuaContext replay;
+		replay.AddGlobalVariable("factor", std::make_shared<LuaTNumber>(2));
+		EXPECT_NO_THROW(replay.CompileString("double", "if type(value) ~= 'number' then error('not a number') end result = value * factor"));
+		std::shared_ptr<LuaProfiler> profiler = std::make_shared<LuaProfiler>();
+		replay.setProfiler(profiler);
+
+		LuaReplayOptions options;
+		options.concurrency = 3;
+		options.requests = 110;
+		LuaReplayReport report = LuaWorkloadReplayer(records).Replay(replay, options);
+		EXPECT_EQ(110u, report.requests);
+		EXPECT_EQ(10u, report.errors);
+		EXPECT_GT(report.throughput, 0);
+		EXPECT_LE(report.p50, report.p99);
+		EXPECT_LE(report.p99, report.p999);
+		EXPECT_LE(report.p999, report.max);
+		EXPECT_FALSE(profiler->getEntries("double").empty());
+
+		// the rate limits the replay to 200 runs per second
+		options.concurrency = 2;
+		options.rate = 200;
+		options.requests = 20;
+		report = LuaWorkloadReplayer(records).Replay(replay, options);
+		EXPECT_GE(report.seconds, 0.09);
+
+		std::stringstream invalid("not a workload");
+		EXPECT_THROW(LuaWorkloadRecorder::Load(invalid), std::invalid_argument);
+	}
+
+	/**
+	 * Collects the records passed to the logger
+	 */
+	struct LogCollector {
+		std::mutex mutex;
+		std::vector<std::pair<uint32_t, std::string>> records;
+
+		LuaLogger::Sink Sink() {
+			return [this](const LuaLogRecord &record) {
+				std::lock_guard<std::mutex> lock(mutex);
+				records.emplace_back(record.thread, std::string(record.text, record.length));
+			};
+		}
+	};
+
+	TEST_F(TestLuaDiagnostics, LoggerKeepsOrderOfEachThread) {
+		LogCollector collector;
+		LuaLogger logger(collector.Sink());
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++) {
+			threads.emplace_back([&logger, t]() {
+				for (int i = 0; i < 200; i++) {
+					std::string seq = std::to_string(i);
+					LuaLogField fields[] = {{"t", t == 0 ? "a b" : "x", t == 0 ? 3u : 1u}, {"seq", seq.c_str(), seq.size()}};
+					EXPECT_TRUE(logger.Log(LuaLogLevel::Info, "tick", 4, fields, 2));
+				}
+			});
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		logger.Flush();
+
+		ASSERT_EQ(800u, collector.records.size());
+		EXPECT_EQ(0u, logger.getDroppedCount());
+
+		std::map<uint32_t, int> next;
+		for (const auto &record : collector.records) {
+			std::string::size_type pos = record.second.find("seq=");
+			ASSERT_NE(std::string::npos, pos);
+			EXPECT_EQ(next[record.first]++, std::stoi(record.second.substr(pos + 4)));
+		}
+		EXPECT_EQ(4u, next.size());
+		EXPECT_EQ(1, std::count_if(collector.records.begin(), collector.records.end(), [](const std::pair<uint32_t, std::string> &record) {
+			return record.second == "tick t=\"a b\" seq=0";
+		}));
+
+		// the rings of the ended threads are released once written
+		for (int i = 0; i < 200 && logger.getRingCount() > 0; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		EXPECT_EQ(0u, logger.getRingCount());
+	}
+
+	TEST_F(TestLuaDiagnostics, LoggerDropsWhenRingIsFull) {
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool released = false;
+		std::vector<std::string> records;
+
+		LuaLogger logger([&](const LuaLogRecord &record) {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&released]() { return released; });
+			records.emplace_back(record.text, record.length);
+		}, 4);
+
+		int accepted = 0;
+		for (int i = 0; i < 10; i++) {
+			accepted += logger.Log(LuaLogLevel::Warn, "blocked") ? 1 : 0;
+		}
+		EXPECT_EQ(4, accepted);
+		EXPECT_EQ(6u, logger.getDroppedCount());
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			released = true;
+		}
+		cv.notify_all();
+		logger.Flush();
+		EXPECT_EQ(4u, records.size());
+	}
+
+	TEST_F(TestLuaDiagnostics, LoggerFiltersAndFormats) {
+		std::stringstream out;
+		{
+			LuaLogger logger(out);
+			EXPECT_FALSE(logger.Log(LuaLogLevel::Debug, "hidden"));
+			logger.setLevel(LuaLogLevel::Debug);
+			EXPECT_TRUE(logger.isEnabled(LuaLogLevel::Debug));
+			EXPECT_FALSE(logger.isEnabled(LuaLogLevel::Trace));
+			EXPECT_TRUE(logger.Log(LuaLogLevel::Debug, "shown"));
+		}
+		std::string line = out.str();
+		EXPECT_EQ(std::string::npos, line.find("hidden"));
+		EXPECT_NE(std::string::npos, line.find("Z DEBUG [1] shown\n"));
+		EXPECT_EQ('T', line[10]);
+
+		LuaLogLevel level;
+		EXPECT_TRUE(LuaLogger::ParseLevel("warn", level));
+		EXPECT_EQ(LuaLogLevel::Warn, level);
+		EXPECT_FALSE(LuaLogger::ParseLevel("warning", level));
+		EXPECT_STREQ("ERROR", LuaLogger::getLevelName(LuaLogLevel::Error));
+	}
+
+	TEST_F(TestLuaDiagnostics, DefaultLoggerReceivesScriptErrors) {
+		LogCollector collector;
+		std::shared_ptr<LuaLogger> logger = std::make_shared<LuaLogger>(collector.Sink());
+		LuaLogger::setDefault(logger);
+
+		LuaContext ctx;
+		ctx.CompileString("failing", "error('boom', 0)");
+		EXPECT_THROW(ctx.Run("failing"), std::runtime_error);
+
+		LuaLogger::setDefault(nullptr);
+		logger->Flush();
+		ASSERT_EQ(1u, collector.records.size());
+		EXPECT_EQ("script failed snippet=failing error=boom", collector.records[0].second);
+	}
+
+}
@@ -0,0 +1,347 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../LuaCpp.hpp"
+#include "gtest/gtest.h"
+
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Library;
+
+namespace LuaCpp {
+
+	class TestLuaLibraries : public ::testing::Test {
+	  protected:
+		LuaContext ctx;
+
+		template <typename T>
+		void AddLibrary() {
+			std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<T>();
+			ctx.AddLibrary(lib);
+		}
+
+		/**
+		 * Runs the code with the arguments on the stack, leaves the results
+		 */
+		static void Call(lua_State *L, const char *code, int nargs, int nresults) {
+			ASSERT_EQ(LUA_OK, luaL_loadstring(L, code)) << lua_tostring(L, -1);
+			lua_insert(L, -(nargs + 1));
+			ASSERT_EQ(LUA_OK, lua_pcall(L, nargs, nresults, 0)) << lua_tostring(L, -1);
+		}
+	};
+
+	TEST_F(TestLuaLibraries, StringBuilderBuildsString) {
+		AddLibrary<LuaStringBuilderLibrary>();
+		std::unique_ptr<LuaState> L = ctx.newState();
+
+		Call(*L, "local sb = strbuf.new(64) "
+		         "sb:append('a', 1, 'b'):appendf('<%s=%d>', 'x', 42):rep('ab', 3, '-') "
+		         "assert(#sb == sb:len() and tostring(sb) == sb:tostring()) "
+		         "local empty = strbuf.new():append('x'):clear() "
+		         "assert(#empty == 0) "
+		         "assert(not pcall(sb.append, sb, {})) "
+		         "return sb", 0, 1);
+
+		LuaStringBuilder *builder = LuaStringBuilder::To(*L, -1);
+		ASSERT_NE(nullptr, builder);
+		EXPECT_EQ("a1b<x=42>ab-ab-ab", builder->getString());
+
+		std::string content = builder->Take();
+		EXPECT_EQ("a1b<x=42>ab-ab-ab", content);
+		EXPECT_TRUE(builder->getString().empty());
+
+		lua_pushstring(*L, "not a builder");
+		EXPECT_EQ(nullptr, LuaStringBuilder::To(*L, -1));
+	}
+
+	TEST_F(TestLuaLibraries, StringBuilderFlushesToSink) {
+		AddLibrary<LuaStringBuilderLibrary>();
+		std::unique_ptr<LuaState> L = ctx.newState();
+
+		std::vector<std::string> chunks;
+		LuaStringBuilder *builder = LuaStringBuilder::Push(*L);
+		builder->setSink([&chunks](const char *data, size_t length) {
+			chunks.emplace_back(data, length);
+		}, 8);
+
+		Call(*L, "local sb = ... "
+		         "for i = 1, 5 do sb:append('abc') end "
+		         "sb:append(string.rep('x', 10)) "
+		         "sb:append('tail'):flush()", 1, 0);
+
+		// the buffer is written before it passes the flush size, the large piece goes directly
+		EXPECT_EQ(std::vector<std::string>({"abcabc", "abcabc", "abc", "xxxxxxxxxx", "tail"}), chunks);
+	}
+
+	TEST_F(TestLuaLibraries, StringOpsMatchScalar) {
+		std::string data;
+		for (int i = 0; i < 600; i++) {
+			data.push_back((char) ((i * 37 + 11) % 256));
+		}
+
+		for (size_t length = 0; length < data.size(); length += 7) {
+			for (char byte : {'a', (char) 0xf0, '\0', ','}) {
+				size_t expected = data.substr(0, length).find(byte);
+				EXPECT_EQ(expected == std::string::npos ? length : expected, LuaStringOps::FindByte(data.data(), length, byte));
+			}
+			for (std::string set : {std::string("xyz"), std::string("\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8a\x8b\x8c\x8d\x8e\x8f\x90")}) {
+				size_t expected = data.substr(0, length).find_first_of(set);
+				EXPECT_EQ(expected == std::string::npos ? length : expected, LuaStringOps::FindAnyOf(data.data(), length, set.data(), set.size()));
+			}
+		}
+
+		std::string lower(data.size(), '\0');
+		std::string upper(data.size(), '\0');
+		LuaStringOps::ToLower(data.data(), data.size(), &lower[0]);
+		LuaStringOps::ToUpper(data.data(), data.size(), &upper[0]);
+		for (size_t i = 0; i < data.size(); i++) {
+			char c = data[i];
+			ASSERT_EQ(c >= 'A' && c <= 'Z' ? c + 32 : c, lower[i]);
+			ASSERT_EQ(c >= 'a' && c <= 'z' ? c - 32 : c, upper[i]);
+		}
+
+		EXPECT_EQ(0xE3069283u, LuaStringOps::Crc32c("123456789", 9));
+		EXPECT_EQ(0xE3069283u, LuaStringOps::Crc32c("6789", 4, LuaStringOps::Crc32c("12345", 5)));
+		EXPECT_EQ(0xEF46DB3751D8E999ull, LuaStringOps::Hash64("", 0));
+		EXPECT_EQ(0xFBCEA83C8A378BF1ull, LuaStringOps::Hash64("Nobody inspects the spammish repetition", 39));
+	}
+
+	TEST_F(TestLuaLibraries, StringLibraryFunctions) {
+		AddLibrary<LuaStringLibrary>();
+		std::unique_ptr<LuaState> L = ctx.newState();
+
+		Call(*L, "local t = strx.split('a,b,,c', ',') "
+		         "assert(#t == 4 and t[1] == 'a' and t[3] == '' and t[4] == 'c') "
+		         "t = strx.split('k=>v=>w', '=>', 2) "
+		         "assert(#t == 2 and t[1] == 'k' and t[2] == 'v=>w') "
+		         "assert(strx.find_any('hello world', 'ow') == 5 and strx.find_any('hello', 'xyz') == nil) "
+		         "assert(strx.find_any('hello world', 'o', 6) == 8) "
+		         "assert(strx.trim('  \\t text \\n') == 'text' and strx.trim('xxaxx', 'x') == 'a') "
+		         "assert(strx.lower('MiXeD 123') == 'mixed 123' and strx.upper('MiXeD') == 'MIXED') "
+		         "assert(strx.hex('\\0\\255A') == '00ff41' and strx.unhex('00FF41') == '\\0\\255A') "
+		         "assert(strx.unhex('0g') == nil and strx.unhex('abc') == nil) "
+		         "local vectors = { [''] = '', f = 'Zg==', fo = 'Zm8=', foo = 'Zm9v', foob = 'Zm9vYg==', fooba = 'Zm9vYmE=', foobar = 'Zm9vYmFy' } "
+		         "for plain, encoded in pairs(vectors) do "
+		         "  assert(strx.base64(plain) == encoded and strx.unbase64(encoded) == plain) "
+		         "end "
+		         "assert(strx.unbase64('Zm9vYg') == 'foob' and strx.unbase64('Zm9v!') == nil) "
+		         "assert(strx.crc32c('123456789') == 0xE3069283) "
+		         "assert(strx.hash('abc') == strx.hash('abc') and strx.hash('abc') ~= strx.hash('abc', 1))", 0, 0);
+	}
+
+	TEST_F(TestLuaLibraries, RegexMatchesWithCache) {
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaRegexLibrary>(2);
+		ctx.AddLibrary(lib);
+		std::unique_ptr<LuaState> L = ctx.newState();
+
+		Call(*L, "local line = '2024-01-02 ERROR [db] timeout after 30s' "
+		         "local date, level = re.match(line, '^(\\\\d{4}-\\\\d{2}-\\\\d{2}) (\\\\w+)') "
+		         "assert(date == '2024-01-02' and level == 'ERROR') "
+		         "assert(re.match(line, '\\\\d+s') == '30s') "
+		         "assert(re.match(line, 'error', 1, 'i') == 'ERROR') "
+		         "assert(re.match(line, '^ERROR', 12) == nil and re.match(line, '\\\\bERROR', 12) == 'ERROR') "
+		         "local s, e, tag = re.find(line, '\\\\[(\\\\w+)\\\\]') "
+		         "assert(s == 18 and e == 21 and tag == 'db') "
+		         "s, e = re.find(line, 'after') "
+		         "assert(line:sub(s, e) == 'after') "
+		         "assert(re.find(line, 'x', -3) == nil) "
+		         "local a, b = re.match('ac', '(a)(b)?(c)') "
+		         "assert(a == 'a' and b == false) "
+		         "local keys = {} "
+		         "for k, v in re.gmatch('a=1, b=22, c=333', '(\\\\w)=(\\\\d+)') do keys[#keys + 1] = k .. v end "
+		         "assert(table.concat(keys, ' ') == 'a1 b22 c333') "
+		         "local count = 0 "
+		         "for m in re.gmatch('abc', 'x*') do count = count + 1 end "
+		         "assert(count == 4) "
+		         "assert(not pcall(re.match, 'x', '(')) "
+		         "assert(not pcall(re.match, 'x', 'x', 1, 'q'))", 0, 0);
+
+		LuaRegexCache *cache = LuaRegexCache::From(*L);
+		ASSERT_NE(nullptr, cache);
+		EXPECT_EQ(2u, cache->getCapacity());
+		EXPECT_EQ(2u, cache->size());
+
+		// the recently used pattern stays, the other one is dropped
+		uint64_t misses = cache->getMisses();
+		Call(*L, "re.match('a', 'a') re.match('b', 'b') re.match('a', 'a') re.match('c', 'c') re.match('a', 'a') re.match('b', 'b')", 0, 0);
+		EXPECT_EQ(misses + 4, cache->getMisses());
+		EXPECT_EQ(2u, cache->size());
+	}
+
+	TEST_F(TestLuaLibraries, RegexSearchesLongSubjects) {
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaRegexLibrary>();
+		ctx.AddLibrary(lib);
+		std::unique_ptr<LuaState> L = ctx.newState();
+
+#ifdef LUACPP_HAS_RE2
+		// RE2 does not recurse, the length of the subject and the nesting of the repetitions are not limited
+		Call(*L, "local long = string.rep('a', 100000) "
+		         "assert(re.match(long, '(a|b)*') == 'a' and re.match(long, '(?:a|b)*') == long) "
+		         "assert(select(2, re.find(long, 'a+')) == #long) "
+		         "local count = 0 "
+		         "for m in re.gmatch(long, '\\\\w*') do count = count + 1 end "
+		         "assert(count == 2) "
+		         "assert(re.match(string.rep('x', 3000) .. ' 42', '\\\\d+') == '42') "
+		         "assert(re.match('id=17 ' .. string.rep('y', 2100), '(\\\\d+)') == '17') "
+		         "assert(re.match('v1.2.3.', '(\\\\d+\\\\.)+') == '3.') "
+		         "assert(re.match(string.rep('a', 30), '(a+)*b') == nil) "
+		         "assert(re.match(long .. 'xyz', 'a+x', #long - 10) == 'aaaaaaaaaaax') "
+		         "assert(re.match('ab,cd,', '(\\\\w{2},)+') == 'cd,') "
+		         "assert(re.match('caaab', 'a{2,}b') == 'aaab')", 0, 0);
+#else
+		// the long subjects raise the error instead of overflowing the stack
+		Call(*L, "local long = string.rep('a', 100000) "
+		         "local ok, err = pcall(re.match, long, '(a|b)*') "
+		         "assert(not ok and err:find('subject too long')) "
+		         "assert(not pcall(re.find, long, 'a+')) "
+		         "assert(not pcall(function() for m in re.gmatch(long, '\\\\w*') do end end)) "
+		         "assert(re.find(long, 'aaa') == 1) "
+		         "assert(re.match(long .. 'xyz', 'a+x', #long - 10) == 'aaaaaaaaaaax') "
+		         "assert(re.match(string.rep('a', 1000), '(?:a|b)*') == string.rep('a', 1000)) "
+		         "ok, err = pcall(re.match, 'aaa', '(a+)*b') "
+		         "assert(not ok and err:find('nested repetition')) "
+		         "assert(re.match('ab,cd,', '(\\\\w{2},)+') == 'cd,') "
+		         "assert(re.match('caaab', 'a{2,}b') == 'aaab')", 0, 0);
+#endif
+	}
+
+	TEST_F(TestLuaLibraries, LogLibraryWritesFieldsAndPrint) {
+		std::vector<std::string> records;
+		std::shared_ptr<Diagnostics::LuaLogger> logger = std::make_shared<Diagnostics::LuaLogger>([&records](const Diagnostics::LuaLogRecord &record) {
+			records.emplace_back(Diagnostics::LuaLogger::getLevelName(record.level) + std::string(" ") + std::string(record.text, record.length));
+		});
+		std::shared_ptr<Registry::LuaLibrary> lib = std::make_shared<LuaLogLibrary>(logger);
+		ctx.AddLibrary(lib);
+		ctx.setBuiltInFnc("print", LuaLogLibrary::Print, true);
+		std::unique_ptr<LuaState> L = ctx.newState();
+
+		Call(*L, "log.debug('hidden') "
+		         "assert(log.enabled('info') and not log.enabled('debug')) "
+		         "assert(not pcall(log.enabled, 'verbose')) "
+		         "log.info('served', {path = '/a b'}) "
+		         "local n = 7 log.warn('slow', {ms = n, [1] = 'skipped'}) "
+		         "assert(math.type == nil or math.type(n) == 'integer') "
+		         "log.print('x', 1, true, nil) "
+		         "log.print(setmetatable({}, {__tostring = function() return 'point(1, 2)' end}), 'end') "
+		         "assert(not pcall(log.print, setmetatable({}, {__tostring = function() return {} end}))) "
+		         "assert(not pcall(log.error, {}))", 0, 0);
+
+		Diagnostics::LuaLogger::setDefault(logger);
+		Call(*L, "print('to', 'default')", 0, 0);
+		Diagnostics::LuaLogger::setDefault(nullptr);
+		logger->Flush();
+
+		std::vector<std::string> expected = {"INFO served path=\"/a b\"", "WARN slow ms=7", "INFO x\t1\ttrue\tnil", "INFO point(1, 2)\tend", "INFO to\tdefault"};
+		EXPECT_EQ(expected, records);
+	}
+
+	TEST_F(TestLuaLibraries, CsvReaderParsesQuotedFields) {
+		const char content[] = "id;name;score\r\n1;\"a;b\";2.5\r\n\n2;\"say \"\"hi\"\"\";-3\n3;;x;";
+		LuaCsvReader reader(content, sizeof(content) - 1, ';');
+		ASSERT_TRUE(reader.ReadHeader());
+		EXPECT_EQ(2, reader.FindColumn("score", 5));
+		EXPECT_EQ(-1, reader.FindColumn("none", 4));
+
+		auto field = [&reader](size_t index) {
+			size_t length;
+			const char *str = reader.getField(index, length);
+			return std::string(str, length);
+		};
+
+		ASSERT_TRUE(reader.Next());
+		EXPECT_EQ(3u, reader.getFieldCount());
+		EXPECT_EQ("a;b", field(1));
+		double number;
+		EXPECT_TRUE(reader.getNumber(2, number));
+		EXPECT_EQ(2.5, number);
+
+		ASSERT_TRUE(reader.Next());
+		EXPECT_EQ(3u, reader.getRow());
+		EXPECT_EQ("say \"hi\"", field(1));
+		int64_t integer;
+		EXPECT_TRUE(reader.getInteger(2, integer));
+		EXPECT_EQ(-3, integer);
+
+		ASSERT_TRUE(reader.Next());
+		EXPECT_EQ(4u, reader.getFieldCount());
+		EXPECT_EQ("", field(1));
+		EXPECT_FALSE(reader.getNumber(2, number));
+		size_t length;
+		EXPECT_EQ(nullptr, reader.getField(4, length));
+		EXPECT_FALSE(reader.Next());
+
+		EXPECT_THROW(LuaCsvReader("a", 1, '"'), std::invalid_argument);
+		EXPECT_THROW(LuaCsvReader(::testing::TempDir() + "luacpp_missing.csv", ','), std::system_error);
+	}
+
+	TEST_F(TestLuaLibraries, CsvLibraryReadsMappedFile) {
+		std::string path = ::testing::TempDir() + "luacpp_csv_test.csv";
+		{
+			std::ofstream out(path, std::ios::binary);
+			out << "city,population,area\n";
+			for (int i = 1; i <= 1000; i++) {
+				out << "\"city " << i << "\"," << i * 10 << "," << i << ".5\n";
+			}
+		}
+
+		AddLibrary<LuaCsvLibrary>();
+		std::unique_ptr<LuaState> L = ctx.newState();
+		lua_pushstring(*L, path.c_str());
+		Call(*L, "local path = ... "
+		         "local r = assert(csv.open(path, {header = true})) "
+		         "assert(r:header()[2] == 'population') "
+		         "local total = 0 "
+		         "for row in r:rows() do "
+		         "  total = total + row:number('population') "
+		         "  if row:row() == 11 then "
+		         "    assert(row:get(1) == 'city 10' and row:integer(3) == nil and row:count() == 3) "
+		         "    local a, b, c = row:fields() assert(a == 'city 10' and b == '100' and c == '10.5') "
+		         "  end "
+		         "end "
+		         "assert(not pcall(r.get, r, 'nothing')) "
+		         "r:close() assert(not pcall(r.next, r)) "
+		         "r = csv.open(path, {header = true}) "
+		         "local pop = r:column('population', 'integer') "
+		         "r = csv.open(path, {header = true}) "
+		         "local area = r:column(3) "
+		         "assert(#area == 1000 and area:get(1000) == 1000.5 and area:get(1001) == nil) "
+		         "local s = csv.parse('1\\n2\\nx\\n') "
+		         "assert(not pcall(s.column, s, 1, 'integer')) "
+		         "local missing, message = csv.open(path .. '.missing') "
+		         "assert(missing == nil and message) "
+		         "return total, #pop, pop:sum(), area:sum()", 1, 4);
+
+		EXPECT_EQ(5005000, lua_tointeger(*L, -4));
+		EXPECT_EQ(1000, lua_tointeger(*L, -3));
+		EXPECT_EQ(5005000, lua_tointeger(*L, -2));
+		EXPECT_DOUBLE_EQ(501000.0, lua_tonumber(*L, -1));
+		std::remove(path.c_str());
+	}
+}
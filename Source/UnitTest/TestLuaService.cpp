@@ -0,0 +1,269 @@
+/*
+   MIT License
+
+   Copyright (c) 2021 Jordan Vrtanoski
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   */
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../LuaCpp.hpp"
+#include "gtest/gtest.h"
+
+using namespace LuaCpp::Engine;
+using namespace LuaCpp::Service;
+
+namespace LuaCpp {
+
+	class TestLuaService : public ::testing::Test {
+	  protected:
+		std::string socketPath;
+
+		virtual void SetUp() {
+			socketPath = "/tmp/luacpp_test_" + std::to_string(getpid()) + ".sock";
+		}
+	};
+
+	TEST_F(TestLuaService, ForkServerRunsSnippets) {
+		LuaContext ctx;
+		ctx.CompileString("add", "local x, y = ... return (x or a) + (y or b), tostring(a) .. '+' .. tostring(b)");
+		ctx.CompileString("count", "n = (n or 0) + 1 return n");
+		ctx.CompileString("fail", "error('expected failure')");
+		ctx.CompileString("table", "return { x = 1, [1] = 'one', nested = { true } }");
+
+		LuaForkServer server(ctx, socketPath);
+		server.Prepare();
+		server.Listen();
+
+		LuaServiceClient first(socketPath);
+		first.Connect();
+		ASSERT_TRUE(server.Accept(5000));
+
+		LuaEnvironment env;
+		env["a"] = std::make_shared<LuaTNumber>(2);
+		env["b"] = std::make_shared<LuaTNumber>(3);
+		LuaResult<LuaServiceResults> res = first.Run("add", env);
+		ASSERT_TRUE(res.ok()) << res.getError().getMessage();
+		ASSERT_EQ(2, (int) res.getValue().size());
+		EXPECT_EQ(5, ((LuaTNumber &) *res.getValue()[0]).getValue());
+		EXPECT_EQ(LUA_TSTRING, res.getValue()[1]->getTypeId());
+
+		// the requests on one connection share the worker
+		EXPECT_EQ(1, ((LuaTNumber &) *first.Run("count").getValue()[0]).getValue());
+		EXPECT_EQ(2, ((LuaTNumber &) *first.Run("count").getValue()[0]).getValue());
+
+		res = first.Run("fail");
+		EXPECT_FALSE(res.ok());
+		EXPECT_EQ(LUA_ERRRUN, res.getError().getCode());
+		EXPECT_NE(nullptr, strstr(res.getError().getMessage(), "expected failure"));
+
+		res = first.Run("missing");
+		EXPECT_EQ(LuaError::ERRNOTFOUND, res.getError().getCode());
+
+		LuaServiceArguments args;
+		args.push_back(std::make_shared<LuaTNumber>(4));
+		args.push_back(std::make_shared<LuaTNumber>(5));
+		res = first.Run("add", LuaEnvironment(), args);
+		ASSERT_TRUE(res.ok()) << res.getError().getMessage();
+		EXPECT_EQ(9, ((LuaTNumber &) *res.getValue()[0]).getValue());
+
+		res = first.Run("table");
+		ASSERT_TRUE(res.ok()) << res.getError().getMessage();
+		LuaTTable &table = (LuaTTable &) *res.getValue()[0];
+		EXPECT_EQ(3, (int) table.getValues().size());
+
+		// the other workers start from the template
+		LuaServiceClient second(socketPath);
+		second.Connect();
+		ASSERT_TRUE(server.Accept(5000));
+		EXPECT_EQ(1, ((LuaTNumber &) *second.Run("count").getValue()[0]).getValue());
+
+		EXPECT_EQ(2, (int) server.Reap());
+		// the workers inherited the client sockets of the test, so they are
+		// stopped by the destructor of the server instead of the end of the connections
+	}
+#ifdef __linux__
+	TEST_F(TestLuaService, ScriptServerRunsSnippets) {
+		LuaContext ctx;
+		ctx.CompileString("sum", "local s = 0 for _, v in ipairs({...}) do s = s + v end return s, name");
+		ctx.CompileString("fail", "error('expected failure')");
+
+		LuaScriptServer server(ctx, socketPath, 2);
+		server.Start();
+		ASSERT_TRUE(server.isRunning());
+
+		std::vector<std::thread> clients;
+		std::vector<int> errors(4, 0);
+		for (int c = 0; c < 4; c++) {
+			clients.emplace_back([this, c, &errors] {
+				LuaServiceClient client(socketPath);
+				client.Connect();
+				for (int i = 0; i < 50; i++) {
+					LuaEnvironment env;
+					env["name"] = std::make_shared<LuaTString>("client" + std::to_string(c));
+					LuaServiceArguments args;
+					args.push_back(std::make_shared<LuaTNumber>(i));
+					args.push_back(std::make_shared<LuaTNumber>(c));
+					LuaResult<LuaServiceResults> res = client.Run("sum", env, args);
+					if (!res.ok() || ((LuaTNumber &) *res.getValue()[0]).getValue() != i + c
+						|| ((LuaTString &) *res.getValue()[1]).getValue() != "client" + std::to_string(c)) {
+						errors[c]++;
+					}
+				}
+			});
+		}
+		for (std::thread &client : clients) {
+			client.join();
+		}
+		for (int c = 0; c < 4; c++) {
+			EXPECT_EQ(0, errors[c]);
+		}
+		EXPECT_EQ(200u, server.getRequestCount());
+
+		LuaServiceClient client(socketPath);
+		client.Connect();
+		LuaResult<LuaServiceResults> res = client.Run("fail");
+		EXPECT_EQ(LUA_ERRRUN, res.getError().getCode());
+		res = client.Run("missing");
+		EXPECT_EQ(LuaError::ERRNOTFOUND, res.getError().getCode());
+		client.Close();
+
+		server.Stop();
+		EXPECT_FALSE(server.isRunning());
+		EXPECT_NE(0, access(socketPath.c_str(), F_OK));
+	}
+
+	TEST_F(TestLuaService, ScriptServerIsolatesRequestGlobals) {
+		LuaContext ctx;
+		ctx.CompileString("peek", "local seen = secret return seen, leaked, type(print)");
+		ctx.CompileString("poke", "leaked = secret return secret");
+		ctx.CompileString("keep", "if not string.kept then string.kept = function() return secret end end return string.kept()");
+
+		// a single worker, all of the requests run in the same state
+		LuaScriptServer server(ctx, socketPath, 1);
+		server.Start();
+
+		LuaServiceClient first(socketPath);
+		first.Connect();
+		LuaEnvironment env;
+		env["secret"] = std::make_shared<LuaTString>("first");
+		LuaResult<LuaServiceResults> res = first.Run("poke", env);
+		ASSERT_TRUE(res.ok());
+		EXPECT_EQ("first", ((LuaTString &) *res.getValue()[0]).getValue());
+		first.Close();
+
+		LuaServiceClient second(socketPath);
+		second.Connect();
+		res = second.Run("peek");
+		ASSERT_TRUE(res.ok());
+		EXPECT_EQ(LUA_TNIL, res.getValue()[0]->getTypeId());
+		EXPECT_EQ(LUA_TNIL, res.getValue()[1]->getTypeId());
+		EXPECT_EQ("function", ((LuaTString &) *res.getValue()[2]).getValue());
+
+		// the closures keep the environment of the request that created them
+		for (const char *secret : {"first", "second"}) {
+			env["secret"] = std::make_shared<LuaTString>(secret);
+			res = second.Run("keep", env);
+			ASSERT_TRUE(res.ok());
+			EXPECT_EQ("first", ((LuaTString &) *res.getValue()[0]).getValue());
+		}
+		second.Close();
+
+		server.Stop();
+	}
+
+	TEST_F(TestLuaService, ExecuteRestoresEnvironmentOfMalformedRequests) {
+		LuaContext ctx;
+		ctx.CompileString("peek", "return secret");
+		std::unique_ptr<LuaState> L = ctx.newState();
+		int snippets = LuaServiceProtocol::LoadSnippets(ctx, *L);
+
+		// the arguments are cut after the environment of the request is set
+		LuaEnvironment env;
+		env["secret"] = std::make_shared<LuaTString>("first");
+		LuaServiceArguments args;
+		args.push_back(std::make_shared<LuaTString>("argument"));
+		std::string request;
+		LuaServiceProtocol::EncodeRequest("peek", env, args, request);
+		request.resize(request.size() - 4);
+		std::string reply;
+		LuaServiceProtocol::Execute(*L, snippets, request.data(), request.size(), reply, true);
+		EXPECT_EQ(LuaError::ERRPROTOCOL, LuaServiceProtocol::DecodeReply(reply).getError().getCode());
+		EXPECT_EQ(snippets, lua_gettop(*L));
+
+		lua_getfield(*L, snippets, "peek");
+		EXPECT_STREQ("_ENV", lua_getupvalue(*L, -1, 1));
+		lua_pushglobaltable(*L);
+		EXPECT_TRUE(lua_rawequal(*L, -1, -2));
+		lua_settop(*L, snippets);
+	}
+
+	TEST_F(TestLuaService, ScriptServerHoldsBackPipelinedRequests) {
+		LuaContext ctx;
+		ctx.CompileString("echo", "return ..., string.rep('x', 4096)");
+
+		LuaScriptServer server(ctx, socketPath, 2);
+		server.Start();
+
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		ASSERT_EQ(0, connect(fd, (struct sockaddr *) &addr, sizeof(addr)));
+
+		// far more requests and replies than the server keeps for a connection
+		const int count = 2000;
+		std::thread writer([fd, count] {
+			for (int i = 0; i < count; i++) {
+				LuaServiceArguments args;
+				args.push_back(std::make_shared<LuaTNumber>(i));
+				std::string request;
+				LuaServiceProtocol::EncodeRequest("echo", LuaEnvironment(), args, request);
+				LuaServiceProtocol::WriteFrame(fd, request);
+			}
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		int errors = 0;
+		for (int i = 0; i < count; i++) {
+			std::string reply;
+			ASSERT_TRUE(LuaServiceProtocol::ReadFrame(fd, reply));
+			LuaResult<LuaServiceResults> res = LuaServiceProtocol::DecodeReply(reply);
+			if (!res.ok() || ((LuaTNumber &) *res.getValue()[0]).getValue() != i) {
+				errors++;
+			}
+		}
+		writer.join();
+		close(fd);
+		EXPECT_EQ(0, errors);
+		EXPECT_EQ((uint64_t) count, server.getRequestCount());
+		server.Stop();
+	}
+#endif
+
+}
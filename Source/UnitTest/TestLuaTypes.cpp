@@ -23,6 +23,9 @@
    */
 
 #include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "../LuaCpp.hpp"
 #include "gtest/gtest.h"
@@ -498,6 +501,11 @@ namespace LuaCpp {
 		EXPECT_EQ("1", ((std::shared_ptr<LuaTString> &) tbl.getValues()[Table::Key(1)])->getValue());
 		EXPECT_EQ("2", ((std::shared_ptr<LuaTString> &) tbl.getValues()[Table::Key(2)])->getValue());
 		EXPECT_EQ("3", ((std::shared_ptr<LuaTString> &) tbl.getValues()[Table::Key(3)])->getValue());
+
+		// the other integer types convert to the same key
+		EXPECT_TRUE(Table::Key((size_t) 1) == Table::Key(1));
+		EXPECT_TRUE(Table::Key(2u) == Table::Key(2));
+		EXPECT_TRUE(Table::Key(3L) == Table::Key(3));
 	}
 
 	TEST_F(TestLuaTypes, TestLuaTTableTableOpsStr) {
@@ -742,5 +750,186 @@ namespace LuaCpp {
 		EXPECT_THROW(ud2.PopValue(*L,-1), std::domain_error);
 	}
 
+	TEST_F(TestLuaTypes, TestTryPopValue) {
+		LuaState L;
+		LuaTNumber num(0);
+		LuaTString str("");
+		LuaTUserData ud(sizeof(int)), ud2(sizeof(int));
+
+		lua_pushnumber(L, 4.5);
+		lua_pushboolean(L, 1);
+
+		// the matching type is read
+		LuaError error = num.TryPopValue(L, 1);
+		EXPECT_TRUE(error.ok());
+		EXPECT_EQ(LUA_OK, error.getCode());
+		EXPECT_EQ(4.5, num.getValue());
+
+		// the mismatch is reported without exception and the value is kept
+		str.setValue("kept");
+		error = str.TryPopValue(L, -1);
+		EXPECT_FALSE(error.ok());
+		EXPECT_EQ(LuaError::ERRTYPE, error.getCode());
+		EXPECT_STREQ("The value at the stack position -1 is boolean, expected string", error.getMessage());
+		EXPECT_EQ("kept", str.getValue());
+
+		error = ud.TryPopValue(L, 1);
+		EXPECT_EQ(LuaError::ERRTYPE, error.getCode());
+
+		ud.PushValue(L);
+		EXPECT_TRUE(ud.TryPopValue(L, -1).ok());
+		EXPECT_EQ(LuaError::ERRDOMAIN, ud2.TryPopValue(L, -1).getCode());
+		EXPECT_EQ(3, lua_gettop(L));
+
+		// the global variable
+		num.PushGlobal(L, "num");
+		luaL_dostring(L, "num = 'changed'");
+		EXPECT_EQ(LuaError::ERRTYPE, num.TryPopGlobal(L).getCode());
+		EXPECT_EQ(3, lua_gettop(L));
+	}
+
+	TEST_F(TestLuaTypes, TestLuaCodec) {
+		std::shared_ptr<LuaTTable> inner = std::make_shared<LuaTTable>();
+		inner->setValue(Table::Key(1), std::make_shared<LuaTNumber>(-2.5));
+		inner->setValue(Table::Key("flag"), std::make_shared<LuaTBoolean>(true));
+
+		LuaTTable tbl;
+		tbl.setValue(Table::Key("name"), std::make_shared<LuaTString>(std::string("with\0zero", 9)));
+		tbl.setValue(Table::Key("inner"), inner);
+		tbl.setValue(Table::Key(7), std::make_shared<LuaTNil>());
+
+		std::string buffer;
+		EXPECT_NO_THROW(LuaCodec::Encode(tbl, buffer));
+
+		const char *pos = buffer.data();
+		std::shared_ptr<LuaType> decoded = LuaCodec::Decode(pos, buffer.data() + buffer.size());
+		EXPECT_EQ(buffer.data() + buffer.size(), pos);
+		ASSERT_EQ(LUA_TTABLE, decoded->getTypeId());
+		EXPECT_EQ(tbl.ToString(), decoded->ToString());
+
+		LuaTTable &table = (LuaTTable &) *decoded;
+		EXPECT_EQ(9u, ((LuaTString &) table.getValue(Table::Key("name"))).getValue().size());
+		LuaTTable &decodedInner = (LuaTTable &) table.getValue(Table::Key("inner"));
+		EXPECT_EQ(-2.5, ((LuaTNumber &) decodedInner.getValue(Table::Key(1))).getValue());
+
+		// truncated buffers and unsupported types are rejected
+		pos = buffer.data();
+		EXPECT_THROW(LuaCodec::Decode(pos, buffer.data() + buffer.size() - 1), std::invalid_argument);
+		LuaTUserData ud(4);
+		EXPECT_THROW(LuaCodec::Encode(ud, buffer), std::invalid_argument);
+
+		// the 64 bit keys are kept
+		LuaTTable wide;
+		wide.setValue(Table::Key((lua_Integer) 1 << 40), std::make_shared<LuaTBoolean>(true));
+		buffer.clear();
+		LuaCodec::Encode(wide, buffer);
+		pos = buffer.data();
+		decoded = LuaCodec::Decode(pos, buffer.data() + buffer.size());
+		EXPECT_EQ((lua_Integer) 1 << 40, ((LuaTTable &) *decoded).getValues().begin()->first.getIntValue());
+
+		// the tables nested deeper than the encoder allows are rejected
+		buffer.clear();
+		for (int i = 0; i < 100; i++) {
+			buffer.push_back((char) LuaCodec::TAG_TABLE);
+			LuaCodec::EncodeUInt32(1, buffer);
+			buffer.push_back((char) LuaCodec::TAG_INTEGER);
+			LuaCodec::EncodeUInt64(1, buffer);
+		}
+		buffer.push_back((char) LuaCodec::TAG_NIL);
+		pos = buffer.data();
+		EXPECT_THROW(LuaCodec::Decode(pos, buffer.data() + buffer.size()), std::invalid_argument);
+	}
+
+	TEST_F(TestLuaTypes, TestLuaCodecStack) {
+		LuaState L;
+		luaL_openlibs(L);
+		ASSERT_EQ(LUA_OK, luaL_dostring(L, "return { n = 7, f = 0.5, s = 'a\\0b', [2] = { false } }"));
+
+		std::string buffer;
+		LuaCodec::Encode(L, -1, buffer);
+		lua_pop(L, 1);
+
+		const char *pos = buffer.data();
+		LuaCodec::Push(L, pos, buffer.data() + buffer.size());
+		EXPECT_EQ(buffer.data() + buffer.size(), pos);
+		lua_setglobal(L, "t");
+		ASSERT_EQ(LUA_OK, luaL_dostring(L, "return (math.type == nil or math.type(t.n) == 'integer') and t.f == 0.5 and #t.s == 3 and t[2][1] == false"));
+		EXPECT_TRUE(lua_toboolean(L, -1));
+		lua_pop(L, 1);
+
+		// the functions can not be serialised, the stack is left as it was
+		ASSERT_EQ(LUA_OK, luaL_dostring(L, "return { f = print }"));
+		int top = lua_gettop(L);
+		EXPECT_THROW(LuaCodec::Encode(L, -1, buffer), std::invalid_argument);
+		EXPECT_EQ(top, lua_gettop(L));
+		lua_pop(L, 1);
+	}
+
+	TEST_F(TestLuaTypes, TestLuaGeneratorCoroutine) {
+		LuaContext ctx;
+		ctx.CompileString("rows", "local n = ... for i = 1, n do coroutine.yield(i, 'row ' .. i) end return 'ignored'");
+		std::unique_ptr<LuaState> L = ctx.newState();
+		int top = lua_gettop(*L);
+
+		ctx.PushSnippet(*L, "rows");
+		lua_pushinteger(*L, 1000);
+		auto rows = LuaGenerator<std::string>::Coroutine(*L, 1, [](lua_State *L, int n) {
+			EXPECT_EQ(2, n);
+			return std::to_string(lua_tointeger(L, -2)) + ":" + lua_tostring(L, -1);
+		});
+		EXPECT_EQ(top, lua_gettop(*L));
+
+		size_t count = 0;
+		for (const std::string &row : *rows) {
+			count++;
+			if (count == 1) {
+				EXPECT_EQ("1:row 1", row);
+			}
+		}
+		EXPECT_EQ(1000u, count);
+		EXPECT_TRUE(rows->begin() == rows->end());
+		EXPECT_EQ(top, lua_gettop(*L));
+
+		ASSERT_EQ(LUA_OK, luaL_loadstring(*L, "coroutine.yield({ a = 1 }) error('broken', 0)"));
+		auto failing = LuaGenerator<std::shared_ptr<LuaType>>::Coroutine(*L, 0, LuaGeneratorBase::FirstValue);
+		auto it = failing->begin();
+		ASSERT_TRUE(it != failing->end());
+		EXPECT_EQ(LUA_TTABLE, (*it)->getTypeId());
+		try {
+			++it;
+			FAIL() << "the error was not raised";
+		} catch (std::runtime_error &e) {
+			EXPECT_STREQ("broken", e.what());
+		}
+		EXPECT_TRUE(failing->begin() == failing->end());
+		EXPECT_EQ(top, lua_gettop(*L));
+	}
+
+	TEST_F(TestLuaTypes, TestLuaGeneratorIterator) {
+		LuaState L;
+		luaL_openlibs(L);
+		ASSERT_EQ(LUA_OK, luaL_dostring(L, "return ipairs({ 'a', 'b', 'c' })"));
+		int top = lua_gettop(L) - 3;
+
+		auto values = LuaGenerator<std::string>::Iterator(L, [](lua_State *L, int n) {
+			return std::to_string(lua_tointeger(L, -n)) + "=" + lua_tostring(L, -n + 1);
+		});
+		std::vector<std::string> items(values->begin(), values->end());
+		std::vector<std::string> expected = {"1=a", "2=b", "3=c"};
+		EXPECT_EQ(expected, items);
+		EXPECT_EQ(top, lua_gettop(L));
+
+		ASSERT_EQ(LUA_OK, luaL_dostring(L, "return function(_, i) i = i + 1 if i > 2 then error('stop', 0) end return i end, nil, 0"));
+		auto failing = LuaGenerator<std::shared_ptr<LuaType>>::Iterator(L, LuaGeneratorBase::FirstValue);
+		auto it = failing->begin();
+		EXPECT_EQ("1", (*it)->ToString().substr(0, 1));
+		++it;
+		EXPECT_THROW(++it, std::runtime_error);
+		EXPECT_EQ(top, lua_gettop(L));
+
+		lua_pushnil(L);
+		EXPECT_THROW(LuaGenerator<int>::Coroutine(L, 0, nullptr), std::invalid_argument);
+		lua_pop(L, 1);
+	}
 
 }